@@ -133,8 +133,8 @@
 /* Enable the stub timer support (src/timer/orbis/\*.c) */
 #define SDL_TIMERS_OPENORBIS 1
 
-/* Enable the stub joystick driver (src/joystick/orbis/\*.c) */
-//#define SDL_JOYSTICK_OPENORBIS        1
+/* Enable the DualShock 4 joystick driver (src/joystick/openorbis/\*.c) */
+#define SDL_JOYSTICK_OPENORBIS        1
 
 /* Enable the stub audio driver (src/audio/orbis/\*.c) */
 //#define SDL_AUDIO_DRIVER_OPENORBIS    1
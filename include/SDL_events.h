@@ -628,6 +628,50 @@ extern DECLSPEC void SDLCALL SDL_FlushEvents(Uint32 minType, Uint32 maxType);
  */
 extern DECLSPEC int SDLCALL SDL_PollEvent(SDL_Event * event);
 
+/**
+ *  \brief Polls for currently pending events, taking out as many as fit.
+ *
+ *  This pumps the event loop once and then removes up to \c numevents events
+ *  from the queue in a single pass, which is cheaper than calling
+ *  SDL_PollEvent() once per event.
+ *
+ *  \return The number of events stored in \c events, which is 0 if there are
+ *          none available, or -1 if there was an error.
+ *
+ *  \param events    The array to store the events in, in the order they were
+ *                   queued.
+ *  \param numevents The size of \c events.
+ */
+extern DECLSPEC int SDLCALL SDL_PollEvents(SDL_Event * events, int numevents);
+
+/**
+ *  \brief Counters for the time an application spends polling for events.
+ *
+ *  \sa SDL_GetEventStats
+ */
+typedef struct SDL_EventStats
+{
+    Uint32 polls;       /**< Calls to SDL_PollEvent() and SDL_PollEvents() */
+    Uint32 events;      /**< Events they took out of the queue */
+    Uint32 coalesced;   /**< Events merged into a queued one, see SDL_HINT_EVENT_COALESCING */
+    Uint64 poll_time;   /**< Time spent in SDL_PollEvents(), pumping included,
+                             in SDL_GetPerformanceCounter() units */
+} SDL_EventStats;
+
+/**
+ *  \brief Get the event polling counters, for profiling.
+ *
+ *  Reading and resetting them once per frame shows how much of the frame went
+ *  to input. They are kept by the thread that polls for events, and aren't
+ *  meant to be updated from several threads at once.
+ */
+extern DECLSPEC void SDLCALL SDL_GetEventStats(SDL_EventStats * stats);
+
+/**
+ *  \brief Reset the event polling counters to zero.
+ */
+extern DECLSPEC void SDLCALL SDL_ResetEventStats(void);
+
 /**
  *  \brief Waits indefinitely for the next available event.
  *
@@ -703,7 +747,22 @@ extern DECLSPEC void SDLCALL SDL_AddEventWatch(SDL_EventFilter filter,
                                                void *userdata);
 
 /**
- *  Remove an event watch function added with SDL_AddEventWatch()
+ *  Add a function which is called when an event with a type between minType
+ *  and maxType (inclusive) is added to the queue.
+ *
+ *  Events of other types don't call the function at all, which is cheaper
+ *  than filtering them out in the function itself.
+ *
+ *  \sa SDL_DelEventWatch()
+ */
+extern DECLSPEC void SDLCALL SDL_AddEventWatchForTypes(Uint32 minType,
+                                                       Uint32 maxType,
+                                                       SDL_EventFilter filter,
+                                                       void *userdata);
+
+/**
+ *  Remove an event watch function added with SDL_AddEventWatch() or
+ *  SDL_AddEventWatchForTypes()
  */
 extern DECLSPEC void SDLCALL SDL_DelEventWatch(SDL_EventFilter filter,
                                                void *userdata);
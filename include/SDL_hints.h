@@ -142,6 +142,20 @@ extern "C" {
  */
 #define SDL_HINT_RENDER_SCALE_QUALITY       "SDL_RENDER_SCALE_QUALITY"
 
+/**
+ *  \brief  A variable controlling how SDL_ConvertSurface() picks colors when
+ *          converting a surface without a palette to an 8-bit paletted format
+ *
+ *  This variable can be set to the following values:
+ *    "0" or "fast"      - Match colors through a 3-3-2 bit color cube
+ *    "1" or "nearest"   - Use the nearest palette color for each pixel
+ *    "2" or "ordered"   - Add a 4x4 ordered dither pattern, then use the nearest color
+ *    "3" or "diffusion" - Spread each pixel's error to its neighbors (Floyd-Steinberg)
+ *
+ *  By default colors are matched through the color cube
+ */
+#define SDL_HINT_SURFACE_PALETTE_MATCH      "SDL_SURFACE_PALETTE_MATCH"
+
 /**
  *  \brief  A variable controlling whether updates to the SDL screen surface should be synchronized with the vertical refresh, to avoid tearing.
  *
@@ -930,6 +944,41 @@ extern "C" {
  */
 #define SDL_HINT_AUDIO_CATEGORY   "SDL_AUDIO_CATEGORY"
 
+/**
+ *  \brief  A variable controlling which high frequency motion events are merged
+ *          while they wait in the event queue.
+ *
+ *  A new event is merged into a queued one of the same type, for the same
+ *  device (and axis or finger), as long as only events of that type were
+ *  queued after it. The merged event has the latest position, value and
+ *  timestamp, and the relative motion of both.
+ *
+ *  This variable can be set to the following values:
+ *    "0"       - Every event is queued (default)
+ *    "1"       - Mouse motion, finger motion, joystick axis and game controller
+ *                axis events are merged
+ *
+ *  or a comma separated list of the types to merge, out of "mouse", "touch",
+ *  "joystick" and "controller".
+ */
+#define SDL_HINT_EVENT_COALESCING   "SDL_EVENT_COALESCING"
+
+/**
+ *  \brief  A variable controlling how many worker threads call timer callbacks.
+ *
+ *  By default the timer thread calls every callback itself, so a slow one
+ *  delays all the timers due after it. With worker threads, the timer thread
+ *  hands due timers to them instead. A timer is never called on two threads
+ *  at once, but different timers can be.
+ *
+ *  This variable can be set to the following values:
+ *    "0"       - The timer thread calls the callbacks (default)
+ *    "N"       - N worker threads call the callbacks, up to 8
+ *
+ *  The hint is read when the timer subsystem is initialized.
+ */
+#define SDL_HINT_TIMER_THREADS   "SDL_TIMER_THREADS"
+
 /**
  *  \brief  An enumeration of hint priorities
  */
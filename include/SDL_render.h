@@ -115,6 +115,16 @@ typedef enum
     SDL_FLIP_VERTICAL = 0x00000002     /**< flip vertically */
 } SDL_RendererFlip;
 
+/**
+ *  \brief Vertex structure for SDL_RenderGeometry()
+ */
+typedef struct SDL_Vertex
+{
+    SDL_FPoint position;        /**< Vertex position, in SDL_Renderer coordinates  */
+    SDL_Color  color;           /**< Vertex color */
+    SDL_FPoint tex_coord;       /**< Normalized texture coordinates, if needed */
+} SDL_Vertex;
+
 /**
  *  \brief A structure representing rendering state
  */
@@ -835,6 +845,33 @@ extern DECLSPEC int SDLCALL SDL_RenderCopyEx(SDL_Renderer * renderer,
                                            const SDL_Point *center,
                                            const SDL_RendererFlip flip);
 
+/**
+ *  \brief Render a list of triangles, optionally using a texture and indices
+ *         into the vertex array.
+ *
+ *  \param renderer     The renderer which should draw the triangles.
+ *  \param texture      The texture to map onto the triangles, or NULL to use
+ *                      the vertex colors alone.
+ *  \param vertices     The vertices of the triangles.
+ *  \param num_vertices The number of vertices.
+ *  \param indices      An array of vertex indices, three per triangle, or NULL
+ *                      to draw every three vertices as a triangle.
+ *  \param num_indices  The number of indices.
+ *
+ *  The texture is sampled without perspective correction and multiplied by
+ *  the interpolated vertex colors and the texture color and alpha modulation.
+ *  Textured triangles use the texture blend mode, the others use the renderer
+ *  draw blend mode.
+ *
+ *  \return 0 on success, or -1 on error
+ */
+extern DECLSPEC int SDLCALL SDL_RenderGeometry(SDL_Renderer * renderer,
+                                               SDL_Texture * texture,
+                                               const SDL_Vertex * vertices,
+                                               int num_vertices,
+                                               const int * indices,
+                                               int num_indices);
+
 /**
  *  \brief Read pixels from the current rendering target.
  *
@@ -53,6 +53,8 @@ extern "C" {
 #define SDL_PREALLOC        0x00000001  /**< Surface uses preallocated memory */
 #define SDL_RLEACCEL        0x00000002  /**< Surface is RLE encoded */
 #define SDL_DONTFREE        0x00000004  /**< Surface is referenced internally */
+#define SDL_SURFACEVIEW     0x00000008  /**< Surface shares the pixels of another surface */
+#define SDL_SHAREDPIXELS    0x00000010  /**< Surface pixels are shared with views */
 /* @} *//* Surface flags */
 
 /**
@@ -375,6 +377,31 @@ extern DECLSPEC void SDLCALL SDL_GetClipRect(SDL_Surface * surface,
  */
 extern DECLSPEC SDL_Surface *SDLCALL SDL_DuplicateSurface(SDL_Surface * surface);
 
+/**
+ *  \brief Create a surface that uses an area of another surface's pixels,
+ *         without copying them.
+ *
+ *  The view has the format, palette and pitch of \c surface, and starts with
+ *  the same color key, blend mode and color and alpha modulation. Drawing
+ *  into either surface changes both. The view holds a reference to the
+ *  surface that owns the pixels, so the surfaces may be freed in any order.
+ *
+ *  A surface whose pixels are shared is never RLE encoded, since that would
+ *  release its pixels. To get a view in another pixel format, convert it with
+ *  SDL_ConvertSurface(), which makes a copy.
+ *
+ *  \param surface The surface to share pixels with, which may itself be a
+ *                 view.
+ *  \param rect    The area of \c surface to use, or NULL for all of it. It is
+ *                 clipped to the surface.
+ *
+ *  \return The new surface, or NULL if there was an error.
+ *
+ *  \sa SDL_FreeSurface
+ */
+extern DECLSPEC SDL_Surface *SDLCALL SDL_CreateSurfaceView(SDL_Surface * surface,
+                                                          const SDL_Rect * rect);
+
 /**
  *  Creates a new surface of the specified format, and then copies and maps
  *  the given surface to it so the blit of the converted surface will be as
@@ -495,13 +522,28 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
  *  \brief Perform a fast, low quality, stretch blit between two surfaces of the
  *         same pixel format.
  *
- *  \note This function uses a static buffer, and is not thread-safe.
+ *  \note This function is reentrant, it may be called from several threads
+ *        at once as long as they don't write to the same destination.
  */
 extern DECLSPEC int SDLCALL SDL_SoftStretch(SDL_Surface * src,
                                             const SDL_Rect * srcrect,
                                             SDL_Surface * dst,
                                             const SDL_Rect * dstrect);
 
+/**
+ *  \brief Perform a bilinear filtered stretch blit between two surfaces of
+ *         the same 32-bit pixel format.
+ *
+ *  When shrinking, each destination pixel is the average of the source
+ *  pixels it covers.
+ *
+ *  \note Like SDL_SoftStretch(), this function is reentrant.
+ */
+extern DECLSPEC int SDLCALL SDL_SoftStretchLinear(SDL_Surface * src,
+                                                  const SDL_Rect * srcrect,
+                                                  SDL_Surface * dst,
+                                                  const SDL_Rect * dstrect);
+
 #define SDL_BlitScaled SDL_UpperBlitScaled
 
 /**
@@ -535,6 +577,117 @@ extern DECLSPEC SDL_YUV_CONVERSION_MODE SDLCALL SDL_GetYUVConversionMode(void);
  */
 extern DECLSPEC SDL_YUV_CONVERSION_MODE SDLCALL SDL_GetYUVConversionModeForResolution(int width, int height);
 
+/**
+ *  \brief Counters for the caches used when setting up surface blits.
+ *
+ *  \sa SDL_GetBlitCacheStats
+ */
+typedef struct SDL_BlitCacheStats
+{
+    Uint32 blit_hits;       /**< Blit function lookups answered by the cache */
+    Uint32 blit_misses;     /**< Blit function lookups that had to be computed */
+    Uint32 palette_hits;    /**< Palette lookup tables reused from the cache */
+    Uint32 palette_misses;  /**< Palette lookup tables that had to be built */
+} SDL_BlitCacheStats;
+
+/**
+ *  \brief Get the blit setup cache counters, for profiling.
+ *
+ *  Every change of a surface's color mod, alpha mod, blend mode or color key
+ *  makes its next blit look up a blit function again, and paletted surfaces
+ *  also need a color lookup table.
+ */
+extern DECLSPEC void SDLCALL SDL_GetBlitCacheStats(SDL_BlitCacheStats * stats);
+
+/**
+ *  \brief Reset the blit setup cache counters to zero.
+ */
+extern DECLSPEC void SDLCALL SDL_ResetBlitCacheStats(void);
+
+/**
+ *  \brief A set of small surfaces packed into one large surface.
+ *
+ *  \sa SDL_CreateAtlas
+ */
+typedef struct SDL_Atlas SDL_Atlas;
+
+/**
+ *  \brief One entry of an SDL_BlitAtlasBatch() call: the atlas handle to draw
+ *         and the destination position of its top left corner.
+ */
+typedef struct SDL_AtlasBlit
+{
+    int handle;
+    int x, y;
+} SDL_AtlasBlit;
+
+/**
+ *  \brief Create an empty atlas backed by a \c w x \c h surface of the given
+ *         pixel format.
+ *
+ *  \return The new atlas, or NULL if there was an error.
+ */
+extern DECLSPEC SDL_Atlas * SDLCALL SDL_CreateAtlas(int w, int h, Uint32 format);
+
+/**
+ *  \brief Copy a surface into free space in the atlas.
+ *
+ *  The pixels are copied without blending, so per-surface blend mode, alpha
+ *  and color modulation must be set on the atlas surface instead.
+ *
+ *  \return A handle for the packed surface, or -1 if there was no room.
+ */
+extern DECLSPEC int SDLCALL SDL_AtlasAddSurface(SDL_Atlas * atlas, SDL_Surface * surface);
+
+/**
+ *  \brief Pack several surfaces at once, tallest first, which wastes less
+ *         space than adding them one by one.
+ *
+ *  \param handles If not NULL, receives the handle of each surface, or -1 for
+ *                 the ones that didn't fit.
+ *
+ *  \return The number of surfaces added, or -1 on invalid parameters.
+ */
+extern DECLSPEC int SDLCALL SDL_AtlasAddSurfaces(SDL_Atlas * atlas,
+                                                 SDL_Surface ** surfaces,
+                                                 int count, int *handles);
+
+/**
+ *  \brief Get the surface holding the packed pixels.
+ *
+ *  This can be used to set the blend mode and modulation of every sprite in
+ *  the atlas, or be passed to SDL_CreateTextureFromSurface().
+ */
+extern DECLSPEC SDL_Surface * SDLCALL SDL_GetAtlasSurface(SDL_Atlas * atlas);
+
+/**
+ *  \brief Get the area of the atlas surface used by a handle.
+ *
+ *  \return 0 on success, or -1 if the handle is invalid.
+ */
+extern DECLSPEC int SDLCALL SDL_GetAtlasRect(SDL_Atlas * atlas, int handle,
+                                             SDL_Rect * rect);
+
+/**
+ *  \brief Blit many atlas entries to a surface in one call.
+ *
+ *  The entries are clipped against the destination clip rectangle, and the
+ *  blit mapping and surface locks are set up once for the whole batch. The
+ *  entries may be drawn in any order, so overlapping sprites should be drawn
+ *  in separate batches.
+ *
+ *  \return 0 on success, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_BlitAtlasBatch(SDL_Atlas * atlas,
+                                               SDL_Surface * dst,
+                                               const SDL_AtlasBlit * entries,
+                                               int count);
+
+/**
+ *  \brief Free an atlas and its surface.
+ */
+extern DECLSPEC void SDLCALL SDL_FreeAtlas(SDL_Atlas * atlas);
+
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
 }
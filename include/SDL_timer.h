@@ -103,6 +103,33 @@ extern DECLSPEC SDL_TimerID SDLCALL SDL_AddTimer(Uint32 interval,
  */
 extern DECLSPEC SDL_bool SDLCALL SDL_RemoveTimer(SDL_TimerID id);
 
+/**
+ *  \brief Counters for how late timer callbacks are called.
+ *
+ *  \sa SDL_GetTimerStats
+ */
+typedef struct SDL_TimerStats
+{
+    Uint32 fired;           /**< Timer callbacks that were called */
+    Uint64 total_lateness;  /**< Time between each of them being due and
+                                 being called, added up, in microseconds */
+    Uint32 max_lateness;    /**< The longest of those times, in microseconds */
+} SDL_TimerStats;
+
+/**
+ *  \brief Get the timer lateness counters, for profiling.
+ *
+ *  A slow callback delays the ones due after it, unless they are called on
+ *  worker threads, see SDL_HINT_TIMER_THREADS. The counters are updated by
+ *  the threads calling the timers, and can be read from any thread.
+ */
+extern DECLSPEC void SDLCALL SDL_GetTimerStats(SDL_TimerStats * stats);
+
+/**
+ *  \brief Reset the timer lateness counters to zero.
+ */
+extern DECLSPEC void SDLCALL SDL_ResetTimerStats(void);
+
 
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
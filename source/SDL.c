@@ -33,6 +33,7 @@
 #include "events/SDL_events_c.h"
 #include "haptic/SDL_haptic_c.h"
 #include "joystick/SDL_joystick_c.h"
+#include "thread/SDL_parallel_c.h"
 
 /* Initialization/Cleanup routines */
 #if !SDL_TIMERS_DISABLED
@@ -357,6 +358,8 @@ SDL_Quit(void)
     SDL_TicksQuit();
 #endif
 
+    SDL_QuitParallel();
+
     SDL_ClearHints();
     SDL_AssertionsQuit();
     SDL_LogResetPriorities();
@@ -433,6 +433,12 @@ SDL_GetCPUCount(void)
                             &SDL_CPUCount, sizeof(SDL_CPUCount) );
         }
 #endif
+#ifdef __OPENORBIS__
+        if (SDL_CPUCount <= 0) {
+            /* Games get six of the eight cores */
+            SDL_CPUCount = 6;
+        }
+#endif
 #endif
         /* There has to be at least 1, right? :) */
         if (SDL_CPUCount <= 0) {
@@ -670,3 +670,21 @@
 #define SDL_log10 SDL_log10_REAL
 #define SDL_log10f SDL_log10f_REAL
 #define SDL_GameControllerMappingForDeviceIndex SDL_GameControllerMappingForDeviceIndex_REAL
+#define SDL_SoftStretchLinear SDL_SoftStretchLinear_REAL
+#define SDL_CreateAtlas SDL_CreateAtlas_REAL
+#define SDL_AtlasAddSurface SDL_AtlasAddSurface_REAL
+#define SDL_AtlasAddSurfaces SDL_AtlasAddSurfaces_REAL
+#define SDL_GetAtlasSurface SDL_GetAtlasSurface_REAL
+#define SDL_GetAtlasRect SDL_GetAtlasRect_REAL
+#define SDL_BlitAtlasBatch SDL_BlitAtlasBatch_REAL
+#define SDL_FreeAtlas SDL_FreeAtlas_REAL
+#define SDL_GetBlitCacheStats SDL_GetBlitCacheStats_REAL
+#define SDL_ResetBlitCacheStats SDL_ResetBlitCacheStats_REAL
+#define SDL_CreateSurfaceView SDL_CreateSurfaceView_REAL
+#define SDL_RenderGeometry SDL_RenderGeometry_REAL
+#define SDL_PollEvents SDL_PollEvents_REAL
+#define SDL_GetEventStats SDL_GetEventStats_REAL
+#define SDL_ResetEventStats SDL_ResetEventStats_REAL
+#define SDL_AddEventWatchForTypes SDL_AddEventWatchForTypes_REAL
+#define SDL_GetTimerStats SDL_GetTimerStats_REAL
+#define SDL_ResetTimerStats SDL_ResetTimerStats_REAL
@@ -35,12 +35,21 @@
 
 /*#define SDL_DEBUG_EVENTS 1*/
 
-/* An arbitrary limit so we don't have unbounded growth */
-#define SDL_MAX_QUEUED_EVENTS   65535
+/* The event queue is a fixed size ring, which must be a power of two */
+#define SDL_MAX_QUEUED_EVENTS   16384
+#define SDL_EVENT_QUEUE_MASK    (SDL_MAX_QUEUED_EVENTS - 1)
+
+/* How far back from the tail to look for an event to merge a new one into */
+#define SDL_MAX_COALESCING_DISTANCE 16
+
+/* How often to pump while waiting, when there are no threads to wake us */
+#define SDL_EVENT_POLL_INTERVAL 10
 
 typedef struct SDL_EventWatcher {
     SDL_EventFilter callback;
     void *userdata;
+    Uint32 minType;
+    Uint32 maxType;
     SDL_bool removed;
 } SDL_EventWatcher;
 
@@ -48,25 +57,59 @@ static SDL_mutex *SDL_event_watchers_lock;
 static SDL_EventWatcher SDL_EventOK;
 static SDL_EventWatcher *SDL_event_watchers = NULL;
 static int SDL_event_watchers_count = 0;
-static SDL_bool SDL_event_watchers_dispatching = SDL_FALSE;
+static int SDL_event_watchers_dispatching = 0;
 static SDL_bool SDL_event_watchers_removed = SDL_FALSE;
 
+/* The watchers for each group of 256 event types, as indices into
+   SDL_event_watchers in the order they were added: the ones for group i are
+   SDL_event_watch_table[SDL_event_watch_start[i]] up to the one before
+   SDL_event_watch_table[SDL_event_watch_start[i+1]]. The table is rebuilt
+   when watchers are added or removed, or once dispatching is done.
+*/
+static int SDL_event_watch_start[257];
+static int *SDL_event_watch_table = NULL;
+static SDL_bool SDL_event_watch_table_valid = SDL_FALSE;
+static SDL_bool SDL_event_watch_table_dirty = SDL_FALSE;
+
 typedef struct {
     Uint32 bits[8];
 } SDL_DisabledEventBlock;
 
 static SDL_DisabledEventBlock *SDL_disabled_events[256];
 static Uint32 SDL_userevents = SDL_USEREVENT;
-
-/* Private data -- event queue */
-typedef struct _SDL_EventEntry
+static SDL_EventStats SDL_event_stats;
+
+/* The event types merged according to SDL_HINT_EVENT_COALESCING */
+#define SDL_COALESCE_MOUSE          0x01
+#define SDL_COALESCE_TOUCH          0x02
+#define SDL_COALESCE_JOYSTICK       0x04
+#define SDL_COALESCE_CONTROLLER     0x08
+#define SDL_COALESCE_ALL            0x0F
+
+static Uint32 SDL_event_coalescing = 0;
+
+/* Private data -- event queue
+
+   Any thread can add events without taking a lock: a producer claims a
+   position by advancing the tail, writes the event into that slot and then
+   publishes it through the slot's sequence. Events are taken out by one
+   thread at a time, holding the queue lock, starting at the head.
+
+   The sequence of the slot for position pos is kept relative to the
+   slot's index, so that a zeroed ring is empty. With round being
+   pos & ~SDL_EVENT_QUEUE_MASK, it is:
+       round                            - the slot is free for pos
+       round + 1                        - the event at pos is ready
+       round + SDL_MAX_QUEUED_EVENTS    - free for the next time around
+*/
+typedef struct _SDL_EventSlot
 {
+    SDL_atomic_t sequence;
+    SDL_bool cut;               /* removed, waiting to be compacted away */
     SDL_Event event;
-    SDL_SysWMmsg msg;
-    struct _SDL_EventEntry *prev;
-    struct _SDL_EventEntry *next;
-} SDL_EventEntry;
+} SDL_EventSlot;
 
+/* SysWM messages are big, so queued events point at one of these */
 typedef struct _SDL_SysWMEntry
 {
     SDL_SysWMmsg msg;
@@ -77,14 +120,22 @@ static struct
 {
     SDL_mutex *lock;
     SDL_atomic_t active;
-    SDL_atomic_t count;
     int max_events_seen;
-    SDL_EventEntry *head;
-    SDL_EventEntry *tail;
-    SDL_EventEntry *free;
+    SDL_EventSlot *slots;
+    void *slots_memory;
+    Uint32 head;                /* only used with the queue locked */
+    Uint8 tail_padding[SDL_CACHELINE_SIZE];
+    SDL_atomic_t tail;          /* shared by all the producers */
+    SDL_atomic_t producers;     /* threads inside SDL_AddEvent() */
+    Uint8 wmmsg_padding[SDL_CACHELINE_SIZE];
     SDL_SysWMEntry *wmmsg_used;
     SDL_SysWMEntry *wmmsg_free;
-} SDL_EventQ = { NULL, { 1 }, { 0 }, 0, NULL, NULL, NULL, NULL, NULL };
+    SDL_sem *wakeup;            /* posted for waiting threads as events are added */
+    SDL_atomic_t waiting;       /* how many threads are waiting for events */
+    SDL_atomic_t signalled;     /* wakeup was posted and no waiter has taken it yet */
+} SDL_EventQ = { NULL, { 1 }, 0, NULL, NULL, 0, { 0 }, { 0 }, { 0 }, { 0 }, NULL, NULL, NULL, { 0 }, { 0 } };
+
+static void SDL_FlushQueuedEvents(void);
 
 
 #ifdef SDL_DEBUG_EVENTS
@@ -311,6 +362,50 @@ SDL_DebugPrintEvent(const SDL_Event *event)
 
 
 
+static void SDLCALL
+SDL_EventCoalescingChanged(void *userdata, const char *name, const char *oldValue, const char *hint)
+{
+    static const struct {
+        const char *name;
+        Uint32 flag;
+    } types[] = {
+        { "mouse", SDL_COALESCE_MOUSE },
+        { "touch", SDL_COALESCE_TOUCH },
+        { "joystick", SDL_COALESCE_JOYSTICK },
+        { "controller", SDL_COALESCE_CONTROLLER },
+    };
+    Uint32 coalescing = 0;
+
+    if (!hint || *hint == '0' || SDL_strcasecmp(hint, "false") == 0) {
+        coalescing = 0;
+    } else if (*hint == '1' || SDL_strcasecmp(hint, "true") == 0) {
+        coalescing = SDL_COALESCE_ALL;
+    } else {
+        while (*hint) {
+            const char *end;
+            size_t length;
+            int i;
+
+            while (*hint == ' ') {
+                ++hint;
+            }
+            end = SDL_strchr(hint, ',');
+            length = end ? (size_t)(end - hint) : SDL_strlen(hint);
+            for (i = 0; i < SDL_arraysize(types); ++i) {
+                if (SDL_strlen(types[i].name) == length &&
+                    SDL_strncasecmp(hint, types[i].name, length) == 0) {
+                    coalescing |= types[i].flag;
+                }
+            }
+            hint += length;
+            if (*hint == ',') {
+                ++hint;
+            }
+        }
+    }
+    SDL_event_coalescing = coalescing;
+}
+
 /* Public functions */
 
 void
@@ -318,31 +413,27 @@ SDL_StopEventLoop(void)
 {
     const char *report = SDL_GetHint("SDL_EVENT_QUEUE_STATISTICS");
     int i;
-    SDL_EventEntry *entry;
     SDL_SysWMEntry *wmmsg;
 
+    /* Producers don't take the queue lock, so turn new ones away and wait
+       for the ones already adding an event before freeing the ring */
+    SDL_AtomicSet(&SDL_EventQ.active, 0);
+    while (SDL_AtomicGet(&SDL_EventQ.producers) > 0) {
+        SDL_Delay(0);
+    }
+
     if (SDL_EventQ.lock) {
         SDL_LockMutex(SDL_EventQ.lock);
     }
 
-    SDL_AtomicSet(&SDL_EventQ.active, 0);
-
     if (report && SDL_atoi(report)) {
         SDL_Log("SDL EVENT QUEUE: Maximum events in-flight: %d\n",
                 SDL_EventQ.max_events_seen);
     }
 
     /* Clean out EventQ */
-    for (entry = SDL_EventQ.head; entry; ) {
-        SDL_EventEntry *next = entry->next;
-        SDL_free(entry);
-        entry = next;
-    }
-    for (entry = SDL_EventQ.free; entry; ) {
-        SDL_EventEntry *next = entry->next;
-        SDL_free(entry);
-        entry = next;
-    }
+    SDL_FlushQueuedEvents();
+    SDL_free(SDL_EventQ.slots_memory);
     for (wmmsg = SDL_EventQ.wmmsg_used; wmmsg; ) {
         SDL_SysWMEntry *next = wmmsg->next;
         SDL_free(wmmsg);
@@ -354,14 +445,17 @@ SDL_StopEventLoop(void)
         wmmsg = next;
     }
 
-    SDL_AtomicSet(&SDL_EventQ.count, 0);
     SDL_EventQ.max_events_seen = 0;
-    SDL_EventQ.head = NULL;
-    SDL_EventQ.tail = NULL;
-    SDL_EventQ.free = NULL;
+    SDL_EventQ.slots = NULL;
+    SDL_EventQ.slots_memory = NULL;
+    SDL_EventQ.head = 0;
+    SDL_AtomicSet(&SDL_EventQ.tail, 0);
     SDL_EventQ.wmmsg_used = NULL;
     SDL_EventQ.wmmsg_free = NULL;
 
+    SDL_DelHintCallback(SDL_HINT_EVENT_COALESCING, SDL_EventCoalescingChanged, NULL);
+    SDL_event_coalescing = 0;
+
     /* Clear disabled event state */
     for (i = 0; i < SDL_arraysize(SDL_disabled_events); ++i) {
         SDL_free(SDL_disabled_events[i]);
@@ -377,8 +471,17 @@ SDL_StopEventLoop(void)
         SDL_event_watchers = NULL;
         SDL_event_watchers_count = 0;
     }
+    SDL_free(SDL_event_watch_table);
+    SDL_event_watch_table = NULL;
+    SDL_event_watch_table_valid = SDL_FALSE;
     SDL_zero(SDL_EventOK);
 
+    if (SDL_EventQ.wakeup) {
+        SDL_DestroySemaphore(SDL_EventQ.wakeup);
+        SDL_EventQ.wakeup = NULL;
+    }
+    SDL_AtomicSet(&SDL_EventQ.signalled, 0);
+
     if (SDL_EventQ.lock) {
         SDL_UnlockMutex(SDL_EventQ.lock);
         SDL_DestroyMutex(SDL_EventQ.lock);
@@ -411,6 +514,13 @@ SDL_StartEventLoop(void)
             return -1;
         }
     }
+
+    if (!SDL_EventQ.wakeup) {
+        SDL_EventQ.wakeup = SDL_CreateSemaphore(0);
+        if (SDL_EventQ.wakeup == NULL) {
+            return -1;
+        }
+    }
 #endif /* !SDL_THREADS_DISABLED */
 
     /* Process most event types */
@@ -418,90 +528,407 @@ SDL_StartEventLoop(void)
     SDL_EventState(SDL_TEXTEDITING, SDL_DISABLE);
     SDL_EventState(SDL_SYSWMEVENT, SDL_DISABLE);
 
+    SDL_AddHintCallback(SDL_HINT_EVENT_COALESCING, SDL_EventCoalescingChanged, NULL);
+
     SDL_AtomicSet(&SDL_EventQ.active, 1);
 
     return 0;
 }
 
 
-/* Add an event to the event queue -- called with the queue locked */
+/* Allocate the ring the first time an event is added, which may be before
+   SDL_StartEventLoop() is called
+*/
+static SDL_EventSlot *
+SDL_GetEventSlots(void)
+{
+    SDL_EventSlot *slots = (SDL_EventSlot *)SDL_AtomicGetPtr((void **)&SDL_EventQ.slots);
+    void *memory;
+
+    if (slots) {
+        return slots;
+    }
+
+    /* Align the slots to cache lines, so producers don't share them */
+    memory = SDL_calloc(SDL_MAX_QUEUED_EVENTS * sizeof(*slots) + SDL_CACHELINE_SIZE, 1);
+    if (!memory) {
+        SDL_OutOfMemory();
+        return NULL;
+    }
+    slots = (SDL_EventSlot *)(((uintptr_t)memory + SDL_CACHELINE_SIZE - 1) & ~(uintptr_t)(SDL_CACHELINE_SIZE - 1));
+
+    if (!SDL_AtomicCASPtr((void **)&SDL_EventQ.slots, NULL, slots)) {
+        /* Another thread got there first */
+        SDL_free(memory);
+        return (SDL_EventSlot *)SDL_AtomicGetPtr((void **)&SDL_EventQ.slots);
+    }
+    SDL_EventQ.slots_memory = memory;
+    return slots;
+}
+
+/* Keep a copy of a SysWM message for as long as its event is queued */
+static SDL_SysWMmsg *
+SDL_AllocSysWMmsg(const SDL_SysWMmsg *msg)
+{
+    SDL_SysWMEntry *wmmsg = NULL;
+
+    if (!SDL_EventQ.lock || SDL_LockMutex(SDL_EventQ.lock) == 0) {
+        if (SDL_EventQ.wmmsg_free) {
+            wmmsg = SDL_EventQ.wmmsg_free;
+            SDL_EventQ.wmmsg_free = wmmsg->next;
+        }
+        if (SDL_EventQ.lock) {
+            SDL_UnlockMutex(SDL_EventQ.lock);
+        }
+    }
+    if (!wmmsg) {
+        wmmsg = (SDL_SysWMEntry *)SDL_malloc(sizeof(*wmmsg));
+        if (!wmmsg) {
+            return NULL;
+        }
+    }
+    wmmsg->msg = *msg;
+    return &wmmsg->msg;
+}
+
+/* Give back a queued SysWM message -- called with the queue locked */
+static void
+SDL_FreeSysWMmsg(SDL_SysWMmsg *msg)
+{
+    SDL_SysWMEntry *wmmsg = (SDL_SysWMEntry *)msg;
+
+    wmmsg->next = SDL_EventQ.wmmsg_free;
+    SDL_EventQ.wmmsg_free = wmmsg;
+}
+
+/* Get the event at pos if it has been published -- called with the queue locked */
+static SDL_EventSlot *
+SDL_GetReadyEvent(Uint32 pos)
+{
+    SDL_EventSlot *slot = &SDL_EventQ.slots[pos & SDL_EVENT_QUEUE_MASK];
+
+    if ((Uint32)SDL_AtomicGet(&slot->sequence) != (pos & ~SDL_EVENT_QUEUE_MASK) + 1) {
+        return NULL;
+    }
+    SDL_MemoryBarrierAcquire();
+    return slot;
+}
+
+static Uint32
+SDL_GetCoalescingFlag(Uint32 type)
+{
+    switch (type) {
+    case SDL_MOUSEMOTION:
+        return SDL_COALESCE_MOUSE;
+    case SDL_FINGERMOTION:
+        return SDL_COALESCE_TOUCH;
+    case SDL_JOYAXISMOTION:
+        return SDL_COALESCE_JOYSTICK;
+    case SDL_CONTROLLERAXISMOTION:
+        return SDL_COALESCE_CONTROLLER;
+    default:
+        return 0;
+    }
+}
+
+/* Merge event into a queued event of the same type, if it is for the same
+   device, keeping the latest state and adding up the relative motion
+*/
+static SDL_bool
+SDL_MergeEvent(SDL_Event * queued, const SDL_Event * event)
+{
+    switch (event->type) {
+    case SDL_MOUSEMOTION:
+        if (queued->motion.windowID != event->motion.windowID ||
+            queued->motion.which != event->motion.which) {
+            return SDL_FALSE;
+        }
+        queued->motion.state = event->motion.state;
+        queued->motion.x = event->motion.x;
+        queued->motion.y = event->motion.y;
+        queued->motion.xrel += event->motion.xrel;
+        queued->motion.yrel += event->motion.yrel;
+        break;
+    case SDL_FINGERMOTION:
+        if (queued->tfinger.touchId != event->tfinger.touchId ||
+            queued->tfinger.fingerId != event->tfinger.fingerId) {
+            return SDL_FALSE;
+        }
+        queued->tfinger.x = event->tfinger.x;
+        queued->tfinger.y = event->tfinger.y;
+        queued->tfinger.dx += event->tfinger.dx;
+        queued->tfinger.dy += event->tfinger.dy;
+        queued->tfinger.pressure = event->tfinger.pressure;
+        break;
+    case SDL_JOYAXISMOTION:
+        if (queued->jaxis.which != event->jaxis.which ||
+            queued->jaxis.axis != event->jaxis.axis) {
+            return SDL_FALSE;
+        }
+        queued->jaxis.value = event->jaxis.value;
+        break;
+    case SDL_CONTROLLERAXISMOTION:
+        if (queued->caxis.which != event->caxis.which ||
+            queued->caxis.axis != event->caxis.axis) {
+            return SDL_FALSE;
+        }
+        queued->caxis.value = event->caxis.value;
+        break;
+    default:
+        return SDL_FALSE;
+    }
+    queued->common.timestamp = event->common.timestamp;
+    return SDL_TRUE;
+}
+
+/* Merge event into one waiting near the tail of the queue, looking back only
+   over events of the same type so it doesn't move past any other event.
+   Events are only read with the queue locked, so they can be changed in
+   place while they are still queued.
+*/
+static SDL_bool
+SDL_CoalesceEvent(const SDL_Event * event)
+{
+    SDL_bool merged = SDL_FALSE;
+
+    if (SDL_EventQ.lock && SDL_LockMutex(SDL_EventQ.lock) < 0) {
+        return SDL_FALSE;
+    }
+    if (SDL_EventQ.slots) {
+        Uint32 pos = (Uint32)SDL_AtomicGet(&SDL_EventQ.tail);
+        int distance;
+
+        for (distance = 0; distance < SDL_MAX_COALESCING_DISTANCE && pos != SDL_EventQ.head; ++distance) {
+            SDL_EventSlot *slot = SDL_GetReadyEvent(--pos);
+
+            if (!slot || slot->cut || slot->event.type != event->type) {
+                break;
+            }
+            if (SDL_MergeEvent(&slot->event, event)) {
+                ++SDL_event_stats.coalesced;
+                merged = SDL_TRUE;
+                break;
+            }
+        }
+    }
+    if (SDL_EventQ.lock) {
+        SDL_UnlockMutex(SDL_EventQ.lock);
+    }
+    return merged;
+}
+
+/* Interrupt the wait of SDL_WaitForEvents() */
+static void
+SDL_PostEventWakeup(void)
+{
+    SDL_VideoDevice *_this = SDL_GetVideoDevice();
+
+    if (_this && _this->WaitEventTimeout) {
+        if (_this->SendWakeupEvent) {
+            _this->SendWakeupEvent(_this);
+        }
+    } else if (SDL_EventQ.wakeup) {
+        SDL_SemPost(SDL_EventQ.wakeup);
+    }
+}
+
+/* Post the wakeup once per wait, not once per event, so a burst of events
+   doesn't leave counts behind for later waits to wake on -- called with the
+   producer counted */
+static void
+SDL_PrivateSendEventWakeup(void)
+{
+    if (SDL_AtomicGet(&SDL_EventQ.waiting) > 0 &&
+        SDL_AtomicCAS(&SDL_EventQ.signalled, 0, 1)) {
+        SDL_PostEventWakeup();
+    }
+}
+
+void
+SDL_SendEventWakeup(void)
+{
+    SDL_AtomicAdd(&SDL_EventQ.producers, 1);
+    if (SDL_AtomicGet(&SDL_EventQ.active)) {
+        SDL_PrivateSendEventWakeup();
+    }
+    SDL_AtomicAdd(&SDL_EventQ.producers, -1);
+}
+
+/* Add an event to the event queue -- called with the producer counted */
 static int
-SDL_AddEvent(SDL_Event * event)
+SDL_PrivateAddEvent(SDL_Event * event)
 {
-    SDL_EventEntry *entry;
-    const int initial_count = SDL_AtomicGet(&SDL_EventQ.count);
-    int final_count;
+    SDL_EventSlot *slots = SDL_GetEventSlots();
+    SDL_EventSlot *slot;
+    SDL_SysWMmsg *msg = NULL;
+    Uint32 pos, round;
+    int diff;
 
-    if (initial_count >= SDL_MAX_QUEUED_EVENTS) {
-        SDL_SetError("Event queue is full (%d events)", initial_count);
+    if (!slots) {
         return 0;
     }
 
-    if (SDL_EventQ.free == NULL) {
-        entry = (SDL_EventEntry *)SDL_malloc(sizeof(*entry));
-        if (!entry) {
+    if ((SDL_event_coalescing & SDL_GetCoalescingFlag(event->type)) &&
+        SDL_CoalesceEvent(event)) {
+        return 1;
+    }
+
+    if (event->type == SDL_SYSWMEVENT) {
+        msg = SDL_AllocSysWMmsg(event->syswm.msg);
+        if (!msg) {
             return 0;
         }
-    } else {
-        entry = SDL_EventQ.free;
-        SDL_EventQ.free = entry->next;
+    }
+
+    /* Claim the next position, unless its slot hasn't been taken out yet */
+    pos = (Uint32)SDL_AtomicGet(&SDL_EventQ.tail);
+    for (;;) {
+        slot = &slots[pos & SDL_EVENT_QUEUE_MASK];
+        round = pos & ~SDL_EVENT_QUEUE_MASK;
+        diff = (int)((Uint32)SDL_AtomicGet(&slot->sequence) - round);
+        if (diff == 0) {
+            if (SDL_AtomicCAS(&SDL_EventQ.tail, (int)pos, (int)(pos + 1))) {
+                break;
+            }
+        } else if (diff < 0) {
+            SDL_SetError("Event queue is full (%d events)", SDL_MAX_QUEUED_EVENTS);
+            if (msg) {
+                if (!SDL_EventQ.lock || SDL_LockMutex(SDL_EventQ.lock) == 0) {
+                    SDL_FreeSysWMmsg(msg);
+                    if (SDL_EventQ.lock) {
+                        SDL_UnlockMutex(SDL_EventQ.lock);
+                    }
+                }
+            }
+            return 0;
+        }
+        pos = (Uint32)SDL_AtomicGet(&SDL_EventQ.tail);
     }
 
     #ifdef SDL_DEBUG_EVENTS
     SDL_DebugPrintEvent(event);
     #endif
 
-    entry->event = *event;
-    if (event->type == SDL_SYSWMEVENT) {
-        entry->msg = *event->syswm.msg;
-        entry->event.syswm.msg = &entry->msg;
+    slot->event = *event;
+    if (msg) {
+        slot->event.syswm.msg = msg;
     }
+    slot->cut = SDL_FALSE;
 
-    if (SDL_EventQ.tail) {
-        SDL_EventQ.tail->next = entry;
-        entry->prev = SDL_EventQ.tail;
-        SDL_EventQ.tail = entry;
-        entry->next = NULL;
-    } else {
-        SDL_assert(!SDL_EventQ.head);
-        SDL_EventQ.head = entry;
-        SDL_EventQ.tail = entry;
-        entry->prev = NULL;
-        entry->next = NULL;
-    }
+    /* Publish the event */
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&slot->sequence, (int)(round + 1));
 
-    final_count = SDL_AtomicAdd(&SDL_EventQ.count, 1) + 1;
-    if (final_count > SDL_EventQ.max_events_seen) {
-        SDL_EventQ.max_events_seen = final_count;
-    }
+    SDL_PrivateSendEventWakeup();
 
     return 1;
 }
 
-/* Remove an event from the queue -- called with the queue locked */
+/* Add an event to the event queue, from any thread */
+static int
+SDL_AddEvent(SDL_Event * event)
+{
+    int added = 0;
+
+    /* Count ourselves in before looking at active, so that
+       SDL_StopEventLoop() either turns us away or waits for us */
+    SDL_AtomicAdd(&SDL_EventQ.producers, 1);
+    if (SDL_AtomicGet(&SDL_EventQ.active)) {
+        added = SDL_PrivateAddEvent(event);
+    }
+    SDL_AtomicAdd(&SDL_EventQ.producers, -1);
+    return added;
+}
+
+/* Hand the slot at pos back to the producers -- called with the queue locked */
 static void
-SDL_CutEvent(SDL_EventEntry *entry)
+SDL_ReleaseEvent(Uint32 pos)
 {
-    if (entry->prev) {
-        entry->prev->next = entry->next;
+    SDL_EventSlot *slot = &SDL_EventQ.slots[pos & SDL_EVENT_QUEUE_MASK];
+
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&slot->sequence, (int)((pos & ~SDL_EVENT_QUEUE_MASK) + SDL_MAX_QUEUED_EVENTS));
+}
+
+/* Mark an event for removal -- called with the queue locked */
+static void
+SDL_CutEvent(SDL_EventSlot *slot)
+{
+    if (slot->event.type == SDL_SYSWMEVENT) {
+        SDL_FreeSysWMmsg(slot->event.syswm.msg);
     }
-    if (entry->next) {
-        entry->next->prev = entry->prev;
+    slot->cut = SDL_TRUE;
+}
+
+/* Close the gaps left by cut events in front of end, moving the remaining
+   events towards the tail so the slots free up at the head, in order
+   -- called with the queue locked
+*/
+static void
+SDL_CompactEvents(Uint32 end)
+{
+    SDL_EventSlot *slots = SDL_EventQ.slots;
+    Uint32 src = end, dst = end;
+
+    while (src != SDL_EventQ.head) {
+        SDL_EventSlot *slot = &slots[--src & SDL_EVENT_QUEUE_MASK];
+        if (!slot->cut) {
+            SDL_EventSlot *kept = &slots[--dst & SDL_EVENT_QUEUE_MASK];
+            if (kept != slot) {
+                kept->event = slot->event;
+                kept->cut = SDL_FALSE;
+            }
+        }
     }
+    while (SDL_EventQ.head != dst) {
+        slots[SDL_EventQ.head & SDL_EVENT_QUEUE_MASK].cut = SDL_FALSE;
+        SDL_ReleaseEvent(SDL_EventQ.head++);
+    }
+}
+
+/* Remove every published event -- called with the queue locked */
+static void
+SDL_FlushQueuedEvents(void)
+{
+    SDL_EventSlot *slot;
 
-    if (entry == SDL_EventQ.head) {
-        SDL_assert(entry->prev == NULL);
-        SDL_EventQ.head = entry->next;
+    if (!SDL_EventQ.slots) {
+        return;
     }
-    if (entry == SDL_EventQ.tail) {
-        SDL_assert(entry->next == NULL);
-        SDL_EventQ.tail = entry->prev;
+    while ((slot = SDL_GetReadyEvent(SDL_EventQ.head)) != NULL) {
+        if (slot->event.type == SDL_SYSWMEVENT) {
+            SDL_FreeSysWMmsg(slot->event.syswm.msg);
+        }
+        SDL_ReleaseEvent(SDL_EventQ.head++);
     }
+}
+
+/* Hand a queued SysWM message to the application.
+   For now we'll guarantee it's valid at least until the next call to
+   SDL_PeepEvents() -- called with the queue locked
+*/
+static SDL_SysWMmsg *
+SDL_KeepSysWMmsg(SDL_SysWMmsg *msg, SDL_bool take)
+{
+    SDL_SysWMEntry *wmmsg;
 
-    entry->next = SDL_EventQ.free;
-    SDL_EventQ.free = entry;
-    SDL_assert(SDL_AtomicGet(&SDL_EventQ.count) > 0);
-    SDL_AtomicAdd(&SDL_EventQ.count, -1);
+    if (take) {
+        wmmsg = (SDL_SysWMEntry *)msg;
+    } else {
+        if (SDL_EventQ.wmmsg_free) {
+            wmmsg = SDL_EventQ.wmmsg_free;
+            SDL_EventQ.wmmsg_free = wmmsg->next;
+        } else {
+            wmmsg = (SDL_SysWMEntry *)SDL_malloc(sizeof(*wmmsg));
+            if (!wmmsg) {
+                return NULL;
+            }
+        }
+        wmmsg->msg = *msg;
+    }
+    wmmsg->next = SDL_EventQ.wmmsg_used;
+    SDL_EventQ.wmmsg_used = wmmsg;
+    return &wmmsg->msg;
 }
 
 /* Lock the event queue, take a peep at it, and unlock it */
@@ -519,60 +946,76 @@ SDL_PeepEvents(SDL_Event * events, int numevents, SDL_eventaction action,
         }
         return (-1);
     }
-    /* Lock the event queue */
+
     used = 0;
+    if (action == SDL_ADDEVENT) {
+        for (i = 0; i < numevents; ++i) {
+            used += SDL_AddEvent(&events[i]);
+        }
+        return (used);
+    }
+
+    /* Lock the event queue */
     if (!SDL_EventQ.lock || SDL_LockMutex(SDL_EventQ.lock) == 0) {
-        if (action == SDL_ADDEVENT) {
-            for (i = 0; i < numevents; ++i) {
-                used += SDL_AddEvent(&events[i]);
+        SDL_EventSlot *slot;
+        SDL_SysWMEntry *wmmsg, *wmmsg_next;
+        const SDL_bool get = (action == SDL_GETEVENT);
+        const int in_flight = (int)((Uint32)SDL_AtomicGet(&SDL_EventQ.tail) - SDL_EventQ.head);
+
+        if (in_flight > SDL_EventQ.max_events_seen) {
+            SDL_EventQ.max_events_seen = in_flight;
+        }
+
+        if (get) {
+            /* Clean out any used wmmsg data
+               FIXME: Do we want to retain the data for some period of time?
+             */
+            for (wmmsg = SDL_EventQ.wmmsg_used; wmmsg; wmmsg = wmmsg_next) {
+                wmmsg_next = wmmsg->next;
+                wmmsg->next = SDL_EventQ.wmmsg_free;
+                SDL_EventQ.wmmsg_free = wmmsg;
             }
-        } else {
-            SDL_EventEntry *entry, *next;
-            SDL_SysWMEntry *wmmsg, *wmmsg_next;
-            Uint32 type;
+            SDL_EventQ.wmmsg_used = NULL;
+        }
 
-            if (action == SDL_GETEVENT) {
-                /* Clean out any used wmmsg data
-                   FIXME: Do we want to retain the data for some period of time?
-                 */
-                for (wmmsg = SDL_EventQ.wmmsg_used; wmmsg; wmmsg = wmmsg_next) {
-                    wmmsg_next = wmmsg->next;
-                    wmmsg->next = SDL_EventQ.wmmsg_free;
-                    SDL_EventQ.wmmsg_free = wmmsg;
+        if (!SDL_EventQ.slots) {
+            /* Nothing has been queued yet */
+        } else if (get && events && minType <= SDL_FIRSTEVENT && maxType >= SDL_LASTEVENT) {
+            /* Taking any event, straight off the head of the queue */
+            while (used < numevents && (slot = SDL_GetReadyEvent(SDL_EventQ.head)) != NULL) {
+                events[used] = slot->event;
+                if (slot->event.type == SDL_SYSWMEVENT) {
+                    events[used].syswm.msg = SDL_KeepSysWMmsg(slot->event.syswm.msg, SDL_TRUE);
                 }
-                SDL_EventQ.wmmsg_used = NULL;
+                SDL_ReleaseEvent(SDL_EventQ.head++);
+                ++used;
             }
+        } else {
+            Uint32 pos;
+            SDL_bool cut = SDL_FALSE;
+            Uint32 type;
 
-            for (entry = SDL_EventQ.head; entry && (!events || used < numevents); entry = next) {
-                next = entry->next;
-                type = entry->event.type;
+            for (pos = SDL_EventQ.head; (!events || used < numevents) && (slot = SDL_GetReadyEvent(pos)) != NULL; ++pos) {
+                type = slot->event.type;
                 if (minType <= type && type <= maxType) {
                     if (events) {
-                        events[used] = entry->event;
-                        if (entry->event.type == SDL_SYSWMEVENT) {
-                            /* We need to copy the wmmsg somewhere safe.
-                               For now we'll guarantee it's valid at least until
-                               the next call to SDL_PeepEvents()
-                             */
-                            if (SDL_EventQ.wmmsg_free) {
-                                wmmsg = SDL_EventQ.wmmsg_free;
-                                SDL_EventQ.wmmsg_free = wmmsg->next;
-                            } else {
-                                wmmsg = (SDL_SysWMEntry *)SDL_malloc(sizeof(*wmmsg));
-                            }
-                            wmmsg->msg = *entry->event.syswm.msg;
-                            wmmsg->next = SDL_EventQ.wmmsg_used;
-                            SDL_EventQ.wmmsg_used = wmmsg;
-                            events[used].syswm.msg = &wmmsg->msg;
+                        events[used] = slot->event;
+                        if (type == SDL_SYSWMEVENT) {
+                            events[used].syswm.msg = SDL_KeepSysWMmsg(slot->event.syswm.msg, get);
                         }
 
-                        if (action == SDL_GETEVENT) {
-                            SDL_CutEvent(entry);
+                        if (get) {
+                            /* The message went to the application with the event */
+                            slot->cut = SDL_TRUE;
+                            cut = SDL_TRUE;
                         }
                     }
                     ++used;
                 }
             }
+            if (cut) {
+                SDL_CompactEvents(pos);
+            }
         }
         if (SDL_EventQ.lock) {
             SDL_UnlockMutex(SDL_EventQ.lock);
@@ -619,13 +1062,22 @@ SDL_FlushEvents(Uint32 minType, Uint32 maxType)
 
     /* Lock the event queue */
     if (!SDL_EventQ.lock || SDL_LockMutex(SDL_EventQ.lock) == 0) {
-        SDL_EventEntry *entry, *next;
-        Uint32 type;
-        for (entry = SDL_EventQ.head; entry; entry = next) {
-            next = entry->next;
-            type = entry->event.type;
-            if (minType <= type && type <= maxType) {
-                SDL_CutEvent(entry);
+        if (minType <= SDL_FIRSTEVENT && maxType >= SDL_LASTEVENT) {
+            SDL_FlushQueuedEvents();
+        } else if (SDL_EventQ.slots) {
+            SDL_EventSlot *slot;
+            Uint32 pos, type;
+            SDL_bool cut = SDL_FALSE;
+
+            for (pos = SDL_EventQ.head; (slot = SDL_GetReadyEvent(pos)) != NULL; ++pos) {
+                type = slot->event.type;
+                if (minType <= type && type <= maxType) {
+                    SDL_CutEvent(slot);
+                    cut = SDL_TRUE;
+                }
+            }
+            if (cut) {
+                SDL_CompactEvents(pos);
             }
         }
         if (SDL_EventQ.lock) {
@@ -656,10 +1108,56 @@ SDL_PumpEvents(void)
 
 /* Public functions */
 
+/* Only SDL_PollEvents() is timed, reading the counter around every single
+   event would cost more than taking it out of the queue */
 int
 SDL_PollEvent(SDL_Event * event)
 {
-    return SDL_WaitEventTimeout(event, 0);
+    int used;
+
+    SDL_PumpEvents();
+    used = SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+    ++SDL_event_stats.polls;
+    if (used > 0) {
+        if (event) {
+            ++SDL_event_stats.events;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int
+SDL_PollEvents(SDL_Event * events, int numevents)
+{
+    const Uint64 start = SDL_GetPerformanceCounter();
+    int used;
+
+    SDL_PumpEvents();
+    used = SDL_PeepEvents(events, numevents, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+    ++SDL_event_stats.polls;
+    if (used > 0 && events) {
+        SDL_event_stats.events += SDL_min(used, numevents);
+    }
+    SDL_event_stats.poll_time += SDL_GetPerformanceCounter() - start;
+    return used;
+}
+
+void
+SDL_GetEventStats(SDL_EventStats * stats)
+{
+    if (!stats) {
+        return;
+    }
+    *stats = SDL_event_stats;
+}
+
+void
+SDL_ResetEventStats(void)
+{
+    SDL_zero(SDL_event_stats);
 }
 
 int
@@ -668,6 +1166,54 @@ SDL_WaitEvent(SDL_Event * event)
     return SDL_WaitEventTimeout(event, -1);
 }
 
+/* Whether an event is ready at the head of the queue, without locking it */
+static SDL_bool
+SDL_EventsReady(void)
+{
+    SDL_EventSlot *slots = (SDL_EventSlot *)SDL_AtomicGetPtr((void **)&SDL_EventQ.slots);
+    const Uint32 head = SDL_EventQ.head;
+
+    if (!slots) {
+        return SDL_FALSE;
+    }
+    return ((Uint32)SDL_AtomicGet(&slots[head & SDL_EVENT_QUEUE_MASK].sequence) == (head & ~SDL_EVENT_QUEUE_MASK) + 1);
+}
+
+/* Sleep until an event is added, a driver has something to pump, or
+   timeout milliseconds (-1 for ever, otherwise more than 0) have passed
+*/
+static void
+SDL_WaitForEvents(int timeout)
+{
+    SDL_VideoDevice *_this = SDL_GetVideoDevice();
+
+    /* Announce the wait before the last look at the queue, so that an event
+       added from here on posts the wakeup */
+    SDL_AtomicAdd(&SDL_EventQ.waiting, 1);
+    if (!SDL_EventsReady()) {
+        if (_this && _this->WaitEventTimeout) {
+            _this->WaitEventTimeout(_this, timeout);
+        } else if (SDL_EventQ.wakeup) {
+            if (timeout < 0) {
+                SDL_SemWait(SDL_EventQ.wakeup);
+            } else {
+                SDL_SemWaitTimeout(SDL_EventQ.wakeup, (Uint32)timeout);
+            }
+        } else {
+            SDL_Delay((timeout < 0 || timeout > SDL_EVENT_POLL_INTERVAL) ? SDL_EVENT_POLL_INTERVAL : timeout);
+        }
+    }
+    SDL_AtomicAdd(&SDL_EventQ.waiting, -1);
+
+    /* Re-arm the wakeup. If it was posted after a timeout, the count left
+       behind costs the next wait one early return, and no more than that.
+       Other threads still waiting get the wakeup passed on, so they look at
+       the queue too. */
+    if (SDL_AtomicCAS(&SDL_EventQ.signalled, 1, 0)) {
+        SDL_PrivateSendEventWakeup();
+    }
+}
+
 int
 SDL_WaitEventTimeout(SDL_Event * event, int timeout)
 {
@@ -677,6 +1223,8 @@ SDL_WaitEventTimeout(SDL_Event * event, int timeout)
         expiration = SDL_GetTicks() + timeout;
 
     for (;;) {
+        int wait = -1;
+
         SDL_PumpEvents();
         switch (SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT)) {
         case -1:
@@ -686,16 +1234,118 @@ SDL_WaitEventTimeout(SDL_Event * event, int timeout)
                 /* Polling and no events, just return */
                 return 0;
             }
-            if (timeout > 0 && SDL_TICKS_PASSED(SDL_GetTicks(), expiration)) {
-                /* Timeout expired and no events */
-                return 0;
+            if (timeout > 0) {
+                wait = (int)(expiration - SDL_GetTicks());
+                if (wait <= 0) {
+                    /* Timeout expired and no events */
+                    return 0;
+                }
             }
-            SDL_Delay(10);
+            SDL_WaitForEvents(wait);
             break;
         default:
             /* Has events */
-			//SDL_Log("SDL there is event %d\n",event->type);  
-        	return 1;
+            return 1;
+        }
+    }
+}
+
+/* The group of 256 event types that type is in */
+static int
+SDL_GetEventGroup(Uint32 type)
+{
+    return (type > SDL_LASTEVENT) ? 255 : (int)(type >> 8);
+}
+
+/* Rebuild the watcher table -- called with the watchers locked, when not
+   dispatching. If it can't be allocated, every watcher is checked instead.
+*/
+static void
+SDL_UpdateEventWatchTable(void)
+{
+    int fill[256];
+    int i, group;
+
+    SDL_zero(fill);
+    for (i = 0; i < SDL_event_watchers_count; ++i) {
+        const SDL_EventWatcher *watcher = &SDL_event_watchers[i];
+        for (group = SDL_GetEventGroup(watcher->minType); group <= SDL_GetEventGroup(watcher->maxType); ++group) {
+            ++fill[group];
+        }
+    }
+
+    SDL_event_watch_start[0] = 0;
+    for (group = 0; group < 256; ++group) {
+        SDL_event_watch_start[group + 1] = SDL_event_watch_start[group] + fill[group];
+        fill[group] = SDL_event_watch_start[group];
+    }
+
+    SDL_free(SDL_event_watch_table);
+    SDL_event_watch_table = NULL;
+    SDL_event_watch_table_valid = SDL_FALSE;
+    if (SDL_event_watch_start[256] > 0) {
+        SDL_event_watch_table = (int *)SDL_malloc(SDL_event_watch_start[256] * sizeof(*SDL_event_watch_table));
+        if (!SDL_event_watch_table) {
+            return;
+        }
+    }
+
+    for (i = 0; i < SDL_event_watchers_count; ++i) {
+        const SDL_EventWatcher *watcher = &SDL_event_watchers[i];
+        for (group = SDL_GetEventGroup(watcher->minType); group <= SDL_GetEventGroup(watcher->maxType); ++group) {
+            SDL_event_watch_table[fill[group]++] = i;
+        }
+    }
+    SDL_event_watch_table_valid = SDL_TRUE;
+}
+
+/* Call the watchers interested in event -- called with the watchers locked */
+static void
+SDL_DispatchEventWatchers(SDL_Event * event)
+{
+    const Uint32 type = event->type;
+    const int *table = NULL;
+    int i, first, last;
+
+    /* Make sure we only dispatch the current watcher list. If it changed
+       during an outer dispatch, the table is out of date until that's done.
+    */
+    if (SDL_event_watch_table_valid && !SDL_event_watch_table_dirty) {
+        const int group = SDL_GetEventGroup(type);
+        table = SDL_event_watch_table;
+        first = SDL_event_watch_start[group];
+        last = SDL_event_watch_start[group + 1];
+    } else {
+        first = 0;
+        last = SDL_event_watchers_count;
+    }
+
+    ++SDL_event_watchers_dispatching;
+    for (i = first; i < last; ++i) {
+        /* A watcher may add another one, which can move the array */
+        const SDL_EventWatcher *watcher = &SDL_event_watchers[table ? table[i] : i];
+        if (!watcher->removed && watcher->minType <= type && type <= watcher->maxType) {
+            watcher->callback(watcher->userdata, event);
+        }
+    }
+    --SDL_event_watchers_dispatching;
+
+    /* Watchers that pushed events of their own are still dispatching */
+    if (SDL_event_watchers_dispatching == 0) {
+        if (SDL_event_watchers_removed) {
+            for (i = SDL_event_watchers_count; i--; ) {
+                if (SDL_event_watchers[i].removed) {
+                    --SDL_event_watchers_count;
+                    if (i < SDL_event_watchers_count) {
+                        SDL_memmove(&SDL_event_watchers[i], &SDL_event_watchers[i+1], (SDL_event_watchers_count - i) * sizeof(SDL_event_watchers[i]));
+                    }
+                }
+            }
+            SDL_event_watchers_removed = SDL_FALSE;
+        }
+        if (SDL_event_watch_table_dirty) {
+            SDL_event_watch_table_dirty = SDL_FALSE;
+            SDL_UpdateEventWatchTable();
         }
     }
 }
@@ -715,28 +1365,7 @@ SDL_PushEvent(SDL_Event * event)
             }
 
             if (SDL_event_watchers_count > 0) {
-                /* Make sure we only dispatch the current watcher list */
-                int i, event_watchers_count = SDL_event_watchers_count;
-
-                SDL_event_watchers_dispatching = SDL_TRUE;
-                for (i = 0; i < event_watchers_count; ++i) {
-                    if (!SDL_event_watchers[i].removed) {
-                        SDL_event_watchers[i].callback(SDL_event_watchers[i].userdata, event);
-                    }
-                }
-                SDL_event_watchers_dispatching = SDL_FALSE;
-
-                if (SDL_event_watchers_removed) {
-                    for (i = SDL_event_watchers_count; i--; ) {
-                        if (SDL_event_watchers[i].removed) {
-                            --SDL_event_watchers_count;
-                            if (i < SDL_event_watchers_count) {
-                                SDL_memmove(&SDL_event_watchers[i], &SDL_event_watchers[i+1], (SDL_event_watchers_count - i) * sizeof(SDL_event_watchers[i]));
-                            }
-                        }
-                    }
-                    SDL_event_watchers_removed = SDL_FALSE;
-                }
+                SDL_DispatchEventWatchers(event);
             }
 
             if (SDL_event_watchers_lock) {
@@ -795,6 +1424,12 @@ SDL_GetEventFilter(SDL_EventFilter * filter, void **userdata)
 
 void
 SDL_AddEventWatch(SDL_EventFilter filter, void *userdata)
+{
+    SDL_AddEventWatchForTypes(SDL_FIRSTEVENT, SDL_LASTEVENT, filter, userdata);
+}
+
+void
+SDL_AddEventWatchForTypes(Uint32 minType, Uint32 maxType, SDL_EventFilter filter, void *userdata)
 {
     if (!SDL_event_watchers_lock || SDL_LockMutex(SDL_event_watchers_lock) == 0) {
         SDL_EventWatcher *event_watchers;
@@ -807,8 +1442,16 @@ SDL_AddEventWatch(SDL_EventFilter filter, void *userdata)
             watcher = &SDL_event_watchers[SDL_event_watchers_count];
             watcher->callback = filter;
             watcher->userdata = userdata;
+            watcher->minType = minType;
+            watcher->maxType = maxType;
             watcher->removed = SDL_FALSE;
             ++SDL_event_watchers_count;
+
+            if (SDL_event_watchers_dispatching) {
+                SDL_event_watch_table_dirty = SDL_TRUE;
+            } else {
+                SDL_UpdateEventWatchTable();
+            }
         }
 
         if (SDL_event_watchers_lock) {
@@ -817,26 +1460,40 @@ SDL_AddEventWatch(SDL_EventFilter filter, void *userdata)
     }
 }
 
-void
-SDL_DelEventWatch(SDL_EventFilter filter, void *userdata)
+/* Remove the first watcher with this callback and userdata, or all of them */
+static void
+SDL_PrivateDelEventWatch(SDL_EventFilter filter, void *userdata, SDL_bool all)
 {
     if (!SDL_event_watchers_lock || SDL_LockMutex(SDL_event_watchers_lock) == 0) {
-        int i;
-
-        for (i = 0; i < SDL_event_watchers_count; ++i) {
-            if (SDL_event_watchers[i].callback == filter && SDL_event_watchers[i].userdata == userdata) {
-                if (SDL_event_watchers_dispatching) {
-                    SDL_event_watchers[i].removed = SDL_TRUE;
-                    SDL_event_watchers_removed = SDL_TRUE;
-                } else {
-                    --SDL_event_watchers_count;
-                    if (i < SDL_event_watchers_count) {
-                        SDL_memmove(&SDL_event_watchers[i], &SDL_event_watchers[i+1], (SDL_event_watchers_count - i) * sizeof(SDL_event_watchers[i]));
-                    }
+        SDL_bool compacted = SDL_FALSE;
+        int i = 0;
+
+        while (i < SDL_event_watchers_count) {
+            SDL_EventWatcher *watcher = &SDL_event_watchers[i];
+
+            if (watcher->removed || watcher->callback != filter || watcher->userdata != userdata) {
+                ++i;
+                continue;
+            }
+            if (SDL_event_watchers_dispatching) {
+                watcher->removed = SDL_TRUE;
+                SDL_event_watchers_removed = SDL_TRUE;
+                SDL_event_watch_table_dirty = SDL_TRUE;
+                ++i;
+            } else {
+                --SDL_event_watchers_count;
+                if (i < SDL_event_watchers_count) {
+                    SDL_memmove(&SDL_event_watchers[i], &SDL_event_watchers[i+1], (SDL_event_watchers_count - i) * sizeof(SDL_event_watchers[i]));
                 }
+                compacted = SDL_TRUE;
+            }
+            if (!all) {
                 break;
             }
         }
+        if (compacted) {
+            SDL_UpdateEventWatchTable();
+        }
 
         if (SDL_event_watchers_lock) {
             SDL_UnlockMutex(SDL_event_watchers_lock);
@@ -844,17 +1501,35 @@ SDL_DelEventWatch(SDL_EventFilter filter, void *userdata)
     }
 }
 
+void
+SDL_DelEventWatch(SDL_EventFilter filter, void *userdata)
+{
+    SDL_PrivateDelEventWatch(filter, userdata, SDL_FALSE);
+}
+
+void
+SDL_DelEventWatches(SDL_EventFilter filter, void *userdata)
+{
+    SDL_PrivateDelEventWatch(filter, userdata, SDL_TRUE);
+}
+
 void
 SDL_FilterEvents(SDL_EventFilter filter, void *userdata)
 {
     if (!SDL_EventQ.lock || SDL_LockMutex(SDL_EventQ.lock) == 0) {
-        SDL_EventEntry *entry, *next;
-        for (entry = SDL_EventQ.head; entry; entry = next) {
-            next = entry->next;
-            if (!filter(userdata, &entry->event)) {
-                SDL_CutEvent(entry);
+        SDL_EventSlot *slot;
+        Uint32 pos;
+        SDL_bool cut = SDL_FALSE;
+
+        for (pos = SDL_EventQ.head; SDL_EventQ.slots && (slot = SDL_GetReadyEvent(pos)) != NULL; ++pos) {
+            if (!filter(userdata, &slot->event)) {
+                SDL_CutEvent(slot);
+                cut = SDL_TRUE;
             }
         }
+        if (cut) {
+            SDL_CompactEvents(pos);
+        }
         if (SDL_EventQ.lock) {
             SDL_UnlockMutex(SDL_EventQ.lock);
         }
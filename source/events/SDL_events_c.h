@@ -46,4 +46,11 @@ extern void SDL_QuitQuit(void);
 
 extern void SDL_SendPendingQuit(void);
 
+/* Wake up threads waiting for events, from any thread. Drivers whose input
+   arrives between pumps call this when they have something to report. */
+extern void SDL_SendEventWakeup(void);
+
+/* Remove every event watch added with this callback and userdata */
+extern void SDL_DelEventWatches(SDL_EventFilter filter, void *userdata);
+
 /* vi: set ts=4 sw=4 expandtab: */
@@ -47,6 +47,10 @@
 /* a list of currently opened game controllers */
 static SDL_GameController *SDL_gamecontrollers = NULL;
 
+/* the same controllers, hashed by the instance id of their joystick */
+#define SDL_GAMECONTROLLER_HASH_SIZE    64
+static SDL_GameController *SDL_gamecontroller_hash[SDL_GAMECONTROLLER_HASH_SIZE];
+
 typedef struct
 {
     SDL_GameControllerBindType inputType;
@@ -95,12 +99,19 @@ typedef struct _ControllerMapping_t
     SDL_JoystickGUID guid;
     char *name;
     char *mapping;
+    const char *source;     /* static mapping string that name and mapping haven't been parsed from yet */
     SDL_ControllerMappingPriority priority;
     struct _ControllerMapping_t *next;
+    struct _ControllerMapping_t *hash_next;
 } ControllerMapping_t;
 
+/* the mappings are also hashed by GUID */
+#define SDL_CONTROLLER_MAPPING_HASH_SIZE    256
+
 static SDL_JoystickGUID s_zeroGUID;
 static ControllerMapping_t *s_pSupportedControllers = NULL;
+static ControllerMapping_t *s_pSupportedControllersTail = NULL;
+static ControllerMapping_t *s_pMappingHash[SDL_CONTROLLER_MAPPING_HASH_SIZE];
 static ControllerMapping_t *s_pDefaultMapping = NULL;
 static ControllerMapping_t *s_pXInputMapping = NULL;
 
@@ -119,6 +130,7 @@ struct _SDL_GameController
     Uint32 guide_button_down;
 
     struct _SDL_GameController *next; /* pointer to next game controller we have allocated */
+    struct _SDL_GameController *hash_next; /* pointer to next game controller in the same hash bucket */
 };
 
 
@@ -340,6 +352,43 @@ static void HandleJoystickHat(SDL_GameController *gamecontroller, int hat, Uint8
     gamecontroller->last_hat_mask[hat] = value;
 }
 
+/*
+ * Find the open controller for a joystick instance id
+ */
+static SDL_GameController *
+SDL_PrivateFindGameController(SDL_JoystickID instance_id)
+{
+    SDL_GameController *controller = SDL_gamecontroller_hash[instance_id & (SDL_GAMECONTROLLER_HASH_SIZE - 1)];
+    while (controller) {
+        if (controller->joystick->instance_id == instance_id) {
+            return controller;
+        }
+        controller = controller->hash_next;
+    }
+    return NULL;
+}
+
+static void
+SDL_PrivateHashGameController(SDL_GameController *gamecontroller)
+{
+    SDL_GameController **bucket = &SDL_gamecontroller_hash[gamecontroller->joystick->instance_id & (SDL_GAMECONTROLLER_HASH_SIZE - 1)];
+    gamecontroller->hash_next = *bucket;
+    *bucket = gamecontroller;
+}
+
+static void
+SDL_PrivateUnhashGameController(SDL_GameController *gamecontroller)
+{
+    SDL_GameController **link = &SDL_gamecontroller_hash[gamecontroller->joystick->instance_id & (SDL_GAMECONTROLLER_HASH_SIZE - 1)];
+    while (*link) {
+        if (*link == gamecontroller) {
+            *link = gamecontroller->hash_next;
+            break;
+        }
+        link = &(*link)->hash_next;
+    }
+}
+
 /*
  * Event filter to fire controller events from joystick ones
  */
@@ -348,38 +397,26 @@ static int SDLCALL SDL_GameControllerEventWatcher(void *userdata, SDL_Event * ev
     switch(event->type) {
     case SDL_JOYAXISMOTION:
         {
-            SDL_GameController *controllerlist = SDL_gamecontrollers;
-            while (controllerlist) {
-                if (controllerlist->joystick->instance_id == event->jaxis.which) {
-                    HandleJoystickAxis(controllerlist, event->jaxis.axis, event->jaxis.value);
-                    break;
-                }
-                controllerlist = controllerlist->next;
+            SDL_GameController *controller = SDL_PrivateFindGameController(event->jaxis.which);
+            if (controller) {
+                HandleJoystickAxis(controller, event->jaxis.axis, event->jaxis.value);
             }
         }
         break;
     case SDL_JOYBUTTONDOWN:
     case SDL_JOYBUTTONUP:
         {
-            SDL_GameController *controllerlist = SDL_gamecontrollers;
-            while (controllerlist) {
-                if (controllerlist->joystick->instance_id == event->jbutton.which) {
-                    HandleJoystickButton(controllerlist, event->jbutton.button, event->jbutton.state);
-                    break;
-                }
-                controllerlist = controllerlist->next;
+            SDL_GameController *controller = SDL_PrivateFindGameController(event->jbutton.which);
+            if (controller) {
+                HandleJoystickButton(controller, event->jbutton.button, event->jbutton.state);
             }
         }
         break;
     case SDL_JOYHATMOTION:
         {
-            SDL_GameController *controllerlist = SDL_gamecontrollers;
-            while (controllerlist) {
-                if (controllerlist->joystick->instance_id == event->jhat.which) {
-                    HandleJoystickHat(controllerlist, event->jhat.hat, event->jhat.value);
-                    break;
-                }
-                controllerlist = controllerlist->next;
+            SDL_GameController *controller = SDL_PrivateFindGameController(event->jhat.which);
+            if (controller) {
+                HandleJoystickHat(controller, event->jhat.hat, event->jhat.value);
             }
         }
         break;
@@ -395,19 +432,14 @@ static int SDLCALL SDL_GameControllerEventWatcher(void *userdata, SDL_Event * ev
         break;
     case SDL_JOYDEVICEREMOVED:
         {
-            SDL_GameController *controllerlist = SDL_gamecontrollers;
-            while (controllerlist) {
-                if (controllerlist->joystick->instance_id == event->jdevice.which) {
-                    SDL_Event deviceevent;
+            if (SDL_PrivateFindGameController(event->jdevice.which)) {
+                SDL_Event deviceevent;
 
-                    deviceevent.type = SDL_CONTROLLERDEVICEREMOVED;
-                    deviceevent.cdevice.which = event->jdevice.which;
-                    SDL_PushEvent(&deviceevent);
+                deviceevent.type = SDL_CONTROLLERDEVICEREMOVED;
+                deviceevent.cdevice.which = event->jdevice.which;
+                SDL_PushEvent(&deviceevent);
 
-                    UpdateEventsForDeviceRemoval();
-                    break;
-                }
-                controllerlist = controllerlist->next;
+                UpdateEventsForDeviceRemoval();
             }
         }
         break;
@@ -419,16 +451,30 @@ static int SDLCALL SDL_GameControllerEventWatcher(void *userdata, SDL_Event * ev
 }
 
 /*
- * Helper function to scan the mappings database for a controller with the specified GUID
+ * Helper function to pick the hash bucket of a GUID
+ */
+static ControllerMapping_t **SDL_PrivateGetControllerMappingBucket(const SDL_JoystickGUID *guid)
+{
+    Uint32 hash = 2166136261u;
+    int i;
+
+    for (i = 0; i < SDL_arraysize(guid->data); ++i) {
+        hash = (hash ^ guid->data[i]) * 16777619u;
+    }
+    return &s_pMappingHash[hash & (SDL_CONTROLLER_MAPPING_HASH_SIZE - 1)];
+}
+
+/*
+ * Helper function to look up the mappings database for a controller with the specified GUID
  */
 static ControllerMapping_t *SDL_PrivateGetControllerMappingForGUID(SDL_JoystickGUID *guid)
 {
-    ControllerMapping_t *pSupportedController = s_pSupportedControllers;
+    ControllerMapping_t *pSupportedController = *SDL_PrivateGetControllerMappingBucket(guid);
     while (pSupportedController) {
         if (SDL_memcmp(guid, &pSupportedController->guid, sizeof(*guid)) == 0) {
             return pSupportedController;
         }
-        pSupportedController = pSupportedController->next;
+        pSupportedController = pSupportedController->hash_next;
     }
 #if SDL_JOYSTICK_XINPUT
     if (guid->data[14] == 'x') {
@@ -704,19 +750,16 @@ static void SDL_PrivateLoadButtonMapping(SDL_GameController *gamecontroller, SDL
 
 
 /*
- * grab the guid string from a mapping string
+ * grab the guid string from a mapping string, into a buffer large enough for a GUID
  */
-static char *SDL_PrivateGetControllerGUIDFromMappingString(const char *pMapping)
+static SDL_bool SDL_PrivateGetControllerGUIDFromMappingString(const char *pMapping, char *pchGUID, size_t size)
 {
     const char *pFirstComma = SDL_strchr(pMapping, ',');
     if (pFirstComma) {
-        char *pchGUID = SDL_malloc(pFirstComma - pMapping + 1);
-        if (!pchGUID) {
-            SDL_OutOfMemory();
-            return NULL;
-        }
-        SDL_memcpy(pchGUID, pMapping, pFirstComma - pMapping);
-        pchGUID[pFirstComma - pMapping] = '\0';
+        /* Only the first 32 characters of a longer GUID count anyway */
+        size_t length = SDL_min((size_t)(pFirstComma - pMapping), size - 1);
+        SDL_memcpy(pchGUID, pMapping, length);
+        pchGUID[length] = '\0';
 
         /* Convert old style GUIDs to the new style in 2.0.5 */
 #if __WIN32__
@@ -736,9 +779,9 @@ static char *SDL_PrivateGetControllerGUIDFromMappingString(const char *pMapping)
             SDL_memcpy(&pchGUID[0], "03000000", 8);
         }
 #endif
-        return pchGUID;
+        return SDL_TRUE;
     }
-    return NULL;
+    return SDL_FALSE;
 }
 
 
@@ -787,12 +830,45 @@ static char *SDL_PrivateGetControllerMappingFromMappingString(const char *pMappi
     return SDL_strdup(pSecondComma + 1); /* mapping is everything after the 3rd comma */
 }
 
+/*
+ * Helper function to parse the name and mapping of an entry from the built-in database, the first time they're needed
+ */
+static int SDL_PrivateParseControllerMapping(ControllerMapping_t *pControllerMapping)
+{
+    char *pchName;
+    char *pchMapping;
+
+    if (!pControllerMapping->source) {
+        return 0;
+    }
+
+    pchName = SDL_PrivateGetControllerNameFromMappingString(pControllerMapping->source);
+    if (!pchName) {
+        return SDL_SetError("Couldn't parse name from %s", pControllerMapping->source);
+    }
+
+    pchMapping = SDL_PrivateGetControllerMappingFromMappingString(pControllerMapping->source);
+    if (!pchMapping) {
+        SDL_free(pchName);
+        return SDL_SetError("Couldn't parse %s", pControllerMapping->source);
+    }
+
+    pControllerMapping->name = pchName;
+    pControllerMapping->mapping = pchMapping;
+    pControllerMapping->source = NULL;
+    return 0;
+}
+
 /*
  * Helper function to refresh a mapping
  */
 static void SDL_PrivateGameControllerRefreshMapping(ControllerMapping_t *pControllerMapping)
 {
     SDL_GameController *gamecontrollerlist = SDL_gamecontrollers;
+
+    if (gamecontrollerlist && SDL_PrivateParseControllerMapping(pControllerMapping) < 0) {
+        return;
+    }
     while (gamecontrollerlist) {
         if (!SDL_memcmp(&gamecontrollerlist->guid, &pControllerMapping->guid, sizeof(pControllerMapping->guid))) {
             SDL_Event event;
@@ -809,26 +885,28 @@ static void SDL_PrivateGameControllerRefreshMapping(ControllerMapping_t *pContro
 }
 
 /*
- * Helper function to add a mapping for a guid
+ * Helper function to add a mapping for a guid. A static mappingString is parsed when the mapping is first used.
  */
 static ControllerMapping_t *
-SDL_PrivateAddMappingForGUID(SDL_JoystickGUID jGUID, const char *mappingString, SDL_bool *existing, SDL_ControllerMappingPriority priority)
+SDL_PrivateAddMappingForGUID(SDL_JoystickGUID jGUID, const char *mappingString, SDL_bool *existing, SDL_ControllerMappingPriority priority, SDL_bool is_static)
 {
-    char *pchName;
-    char *pchMapping;
+    char *pchName = NULL;
+    char *pchMapping = NULL;
     ControllerMapping_t *pControllerMapping;
 
-    pchName = SDL_PrivateGetControllerNameFromMappingString(mappingString);
-    if (!pchName) {
-        SDL_SetError("Couldn't parse name from %s", mappingString);
-        return NULL;
-    }
+    if (!is_static) {
+        pchName = SDL_PrivateGetControllerNameFromMappingString(mappingString);
+        if (!pchName) {
+            SDL_SetError("Couldn't parse name from %s", mappingString);
+            return NULL;
+        }
 
-    pchMapping = SDL_PrivateGetControllerMappingFromMappingString(mappingString);
-    if (!pchMapping) {
-        SDL_free(pchName);
-        SDL_SetError("Couldn't parse %s", mappingString);
-        return NULL;
+        pchMapping = SDL_PrivateGetControllerMappingFromMappingString(mappingString);
+        if (!pchMapping) {
+            SDL_free(pchName);
+            SDL_SetError("Couldn't parse %s", mappingString);
+            return NULL;
+        }
     }
 
     pControllerMapping = SDL_PrivateGetControllerMappingForGUID(&jGUID);
@@ -840,6 +918,7 @@ SDL_PrivateAddMappingForGUID(SDL_JoystickGUID jGUID, const char *mappingString,
             pControllerMapping->name = pchName;
             SDL_free(pControllerMapping->mapping);
             pControllerMapping->mapping = pchMapping;
+            pControllerMapping->source = is_static ? mappingString : NULL;
             pControllerMapping->priority = priority;
             /* refresh open controllers */
             SDL_PrivateGameControllerRefreshMapping(pControllerMapping);
@@ -849,6 +928,8 @@ SDL_PrivateAddMappingForGUID(SDL_JoystickGUID jGUID, const char *mappingString,
         }
         *existing = SDL_TRUE;
     } else {
+        ControllerMapping_t **bucket;
+
         pControllerMapping = SDL_malloc(sizeof(*pControllerMapping));
         if (!pControllerMapping) {
             SDL_free(pchName);
@@ -856,25 +937,25 @@ SDL_PrivateAddMappingForGUID(SDL_JoystickGUID jGUID, const char *mappingString,
             SDL_OutOfMemory();
             return NULL;
         }
+
         pControllerMapping->guid = jGUID;
         pControllerMapping->name = pchName;
         pControllerMapping->mapping = pchMapping;
+        pControllerMapping->source = is_static ? mappingString : NULL;
         pControllerMapping->next = NULL;
         pControllerMapping->priority = priority;
 
-        if (s_pSupportedControllers) {
-            /* Add the mapping to the end of the list */
-            ControllerMapping_t *pCurrMapping, *pPrevMapping;
-
-            for ( pPrevMapping = s_pSupportedControllers, pCurrMapping = pPrevMapping->next;
-                  pCurrMapping; 
-                  pPrevMapping = pCurrMapping, pCurrMapping = pCurrMapping->next ) {
-                continue;
-            }
-            pPrevMapping->next = pControllerMapping;
+        /* Add the mapping to the end of the list */
+        if (s_pSupportedControllersTail) {
+            s_pSupportedControllersTail->next = pControllerMapping;
         } else {
             s_pSupportedControllers = pControllerMapping;
         }
+        s_pSupportedControllersTail = pControllerMapping;
+
+        bucket = SDL_PrivateGetControllerMappingBucket(&jGUID);
+        pControllerMapping->hash_next = *bucket;
+        *bucket = pControllerMapping;
         *existing = SDL_FALSE;
     }
     return pControllerMapping;
@@ -986,7 +1067,7 @@ static ControllerMapping_t *SDL_CreateMappingForAndroidController(const char *na
         SDL_strlcat(mapping_string, "righttrigger:a5,", sizeof(mapping_string));
     }
     return SDL_PrivateAddMappingForGUID(guid, mapping_string,
-                      &existing, SDL_CONTROLLER_MAPPING_PRIORITY_DEFAULT);
+                      &existing, SDL_CONTROLLER_MAPPING_PRIORITY_DEFAULT, SDL_FALSE);
 }
 #endif /* __ANDROID__ */
 
@@ -1006,7 +1087,7 @@ static ControllerMapping_t *SDL_PrivateGetControllerMappingForNameAndGUID(const
             SDL_bool existing;
             mapping = SDL_PrivateAddMappingForGUID(guid,
 "none,X360 Wireless Controller,a:b0,b:b1,back:b6,dpdown:b14,dpleft:b11,dpright:b12,dpup:b13,guide:b8,leftshoulder:b4,leftstick:b9,lefttrigger:a2,leftx:a0,lefty:a1,rightshoulder:b5,rightstick:b10,righttrigger:a5,rightx:a3,righty:a4,start:b7,x:b2,y:b3,",
-                          &existing, SDL_CONTROLLER_MAPPING_PRIORITY_DEFAULT);
+                          &existing, SDL_CONTROLLER_MAPPING_PRIORITY_DEFAULT, SDL_FALSE);
         }
     }
 #endif /* __LINUX__ */
@@ -1123,9 +1204,9 @@ SDL_GameControllerAddMappingsFromRW(SDL_RWops * rw, int freerw)
  * Add or update an entry into the Mappings Database with a priority
  */
 static int
-SDL_PrivateGameControllerAddMapping(const char *mappingString, SDL_ControllerMappingPriority priority)
+SDL_PrivateGameControllerAddMapping(const char *mappingString, SDL_ControllerMappingPriority priority, SDL_bool is_static)
 {
-    char *pchGUID;
+    char pchGUID[64];
     SDL_JoystickGUID jGUID;
     SDL_bool is_default_mapping = SDL_FALSE;
     SDL_bool is_xinput_mapping = SDL_FALSE;
@@ -1136,8 +1217,7 @@ SDL_PrivateGameControllerAddMapping(const char *mappingString, SDL_ControllerMap
         return SDL_InvalidParamError("mappingString");
     }
 
-    pchGUID = SDL_PrivateGetControllerGUIDFromMappingString(mappingString);
-    if (!pchGUID) {
+    if (!SDL_PrivateGetControllerGUIDFromMappingString(mappingString, pchGUID, sizeof(pchGUID))) {
         return SDL_SetError("Couldn't parse GUID from %s", mappingString);
     }
     if (!SDL_strcasecmp(pchGUID, "default")) {
@@ -1146,9 +1226,8 @@ SDL_PrivateGameControllerAddMapping(const char *mappingString, SDL_ControllerMap
         is_xinput_mapping = SDL_TRUE;
     }
     jGUID = SDL_JoystickGetGUIDFromString(pchGUID);
-    SDL_free(pchGUID);
 
-    pControllerMapping = SDL_PrivateAddMappingForGUID(jGUID, mappingString, &existing, priority);
+    pControllerMapping = SDL_PrivateAddMappingForGUID(jGUID, mappingString, &existing, priority, is_static);
     if (!pControllerMapping) {
         return -1;
     }
@@ -1171,7 +1250,7 @@ SDL_PrivateGameControllerAddMapping(const char *mappingString, SDL_ControllerMap
 int
 SDL_GameControllerAddMapping(const char *mappingString)
 {
-    return SDL_PrivateGameControllerAddMapping(mappingString, SDL_CONTROLLER_MAPPING_PRIORITY_API);
+    return SDL_PrivateGameControllerAddMapping(mappingString, SDL_CONTROLLER_MAPPING_PRIORITY_API, SDL_FALSE);
 }
 
 /*
@@ -1209,6 +1288,9 @@ SDL_GameControllerMappingForIndex(int mapping_index)
             char pchGUID[33];
             size_t needed;
 
+            if (SDL_PrivateParseControllerMapping(mapping) < 0) {
+                return NULL;
+            }
             SDL_JoystickGetGUIDString(mapping->guid, pchGUID, sizeof(pchGUID));
             /* allocate enough memory for GUID + ',' + name + ',' + mapping + \0 */
             needed = SDL_strlen(pchGUID) + 1 + SDL_strlen(mapping->name) + 1 + SDL_strlen(mapping->mapping) + 1;
@@ -1236,6 +1318,9 @@ SDL_GameControllerMappingForGUID(SDL_JoystickGUID guid)
     if (mapping) {
         char pchGUID[33];
         size_t needed;
+        if (SDL_PrivateParseControllerMapping(mapping) < 0) {
+            return NULL;
+        }
         SDL_JoystickGetGUIDString(guid, pchGUID, sizeof(pchGUID));
         /* allocate enough memory for GUID + ',' + name + ',' + mapping + \0 */
         needed = SDL_strlen(pchGUID) + 1 + SDL_strlen(mapping->name) + 1 + SDL_strlen(mapping->mapping) + 1;
@@ -1279,7 +1364,7 @@ SDL_GameControllerLoadHints()
             if (pchNewLine)
                 *pchNewLine = '\0';
 
-            SDL_PrivateGameControllerAddMapping(pUserMappings, SDL_CONTROLLER_MAPPING_PRIORITY_USER);
+            SDL_PrivateGameControllerAddMapping(pUserMappings, SDL_CONTROLLER_MAPPING_PRIORITY_USER, SDL_FALSE);
 
             if (pchNewLine) {
                 pUserMappings = pchNewLine + 1;
@@ -1319,7 +1404,8 @@ SDL_GameControllerInitMappings(void)
     const char *pMappingString = NULL;
     pMappingString = s_ControllerMappings[i];
     while (pMappingString) {
-        SDL_PrivateGameControllerAddMapping(pMappingString, SDL_CONTROLLER_MAPPING_PRIORITY_DEFAULT);
+        /* Only the GUID is parsed here, the rest when a controller uses the mapping */
+        SDL_PrivateGameControllerAddMapping(pMappingString, SDL_CONTROLLER_MAPPING_PRIORITY_DEFAULT, SDL_TRUE);
 
         i++;
         pMappingString = s_ControllerMappings[i];
@@ -1346,7 +1432,7 @@ SDL_GameControllerInit(void)
     int i;
 
     /* watch for joy events and fire controller ones if needed */
-    SDL_AddEventWatch(SDL_GameControllerEventWatcher, NULL);
+    SDL_AddEventWatchForTypes(SDL_JOYAXISMOTION, SDL_JOYDEVICEREMOVED, SDL_GameControllerEventWatcher, NULL);
 
     /* Send added events for controllers currently attached */
     for (i = 0; i < SDL_NumJoysticks(); ++i) {
@@ -1369,7 +1455,7 @@ const char *
 SDL_GameControllerNameForIndex(int device_index)
 {
     ControllerMapping_t *pSupportedController = SDL_PrivateGetControllerMapping(device_index);
-    if (pSupportedController) {
+    if (pSupportedController && SDL_PrivateParseControllerMapping(pSupportedController) == 0) {
         if (SDL_strcmp(pSupportedController->name, "*") == 0) {
             return SDL_JoystickNameForIndex(device_index);
         } else {
@@ -1393,7 +1479,7 @@ SDL_GameControllerMappingForDeviceIndex(int joystick_index)
 
     SDL_LockJoysticks();
     mapping = SDL_PrivateGetControllerMapping(joystick_index);
-    if (mapping) {
+    if (mapping && SDL_PrivateParseControllerMapping(mapping) == 0) {
         SDL_JoystickGUID guid;
         char pchGUID[33];
         size_t needed;
@@ -1502,7 +1588,6 @@ SDL_GameController *
 SDL_GameControllerOpen(int device_index)
 {
     SDL_GameController *gamecontroller;
-    SDL_GameController *gamecontrollerlist;
     ControllerMapping_t *pSupportedController = NULL;
 
     SDL_LockJoysticks();
@@ -1513,16 +1598,12 @@ SDL_GameControllerOpen(int device_index)
         return (NULL);
     }
 
-    gamecontrollerlist = SDL_gamecontrollers;
     /* If the controller is already open, return it */
-    while (gamecontrollerlist) {
-        if (SDL_SYS_GetInstanceIdOfDeviceIndex(device_index) == gamecontrollerlist->joystick->instance_id) {
-                gamecontroller = gamecontrollerlist;
-                ++gamecontroller->ref_count;
-                SDL_UnlockJoysticks();
-                return (gamecontroller);
-        }
-        gamecontrollerlist = gamecontrollerlist->next;
+    gamecontroller = SDL_PrivateFindGameController(SDL_SYS_GetInstanceIdOfDeviceIndex(device_index));
+    if (gamecontroller) {
+        ++gamecontroller->ref_count;
+        SDL_UnlockJoysticks();
+        return (gamecontroller);
     }
 
     /* Find a controller mapping */
@@ -1532,6 +1613,10 @@ SDL_GameControllerOpen(int device_index)
         SDL_UnlockJoysticks();
         return NULL;
     }
+    if (SDL_PrivateParseControllerMapping(pSupportedController) < 0) {
+        SDL_UnlockJoysticks();
+        return NULL;
+    }
 
     /* Create and initialize the controller */
     gamecontroller = (SDL_GameController *) SDL_calloc(1, sizeof(*gamecontroller));
@@ -1577,6 +1662,7 @@ SDL_GameControllerOpen(int device_index)
     /* Link the controller in the list */
     gamecontroller->next = SDL_gamecontrollers;
     SDL_gamecontrollers = gamecontroller;
+    SDL_PrivateHashGameController(gamecontroller);
 
     SDL_UnlockJoysticks();
 
@@ -1756,16 +1842,9 @@ SDL_GameControllerFromInstanceID(SDL_JoystickID joyid)
     SDL_GameController *gamecontroller;
 
     SDL_LockJoysticks();
-    gamecontroller = SDL_gamecontrollers;
-    while (gamecontroller) {
-        if (gamecontroller->joystick->instance_id == joyid) {
-            SDL_UnlockJoysticks();
-            return gamecontroller;
-        }
-        gamecontroller = gamecontroller->next;
-    }
+    gamecontroller = SDL_PrivateFindGameController(joyid);
     SDL_UnlockJoysticks();
-    return NULL;
+    return gamecontroller;
 }
 
 
@@ -1848,6 +1927,7 @@ SDL_GameControllerClose(SDL_GameController * gamecontroller)
         return;
     }
 
+    SDL_PrivateUnhashGameController(gamecontroller);
     SDL_JoystickClose(gamecontroller->joystick);
 
     gamecontrollerlist = SDL_gamecontrollers;
@@ -1901,6 +1981,10 @@ SDL_GameControllerQuitMappings(void)
         SDL_free(pControllerMap->mapping);
         SDL_free(pControllerMap);
     }
+    s_pSupportedControllersTail = NULL;
+    SDL_zero(s_pMappingHash);
+    s_pDefaultMapping = NULL;
+    s_pXInputMapping = NULL;
 
     SDL_DelEventWatch(SDL_GameControllerEventWatcher, NULL);
 
@@ -2038,13 +2122,9 @@ SDL_GameControllerEventState(int state)
 void
 SDL_GameControllerHandleDelayedGuideButton(SDL_Joystick *joystick)
 {
-    SDL_GameController *controllerlist = SDL_gamecontrollers;
-    while (controllerlist) {
-        if (controllerlist->joystick == joystick) {
-            SDL_PrivateGameControllerButton(controllerlist, SDL_CONTROLLER_BUTTON_GUIDE, SDL_RELEASED);
-            break;
-        }
-        controllerlist = controllerlist->next;
+    SDL_GameController *controller = SDL_PrivateFindGameController(joystick->instance_id);
+    if (controller && controller->joystick == joystick) {
+        SDL_PrivateGameControllerButton(controller, SDL_CONTROLLER_BUTTON_GUIDE, SDL_RELEASED);
     }
 }
 
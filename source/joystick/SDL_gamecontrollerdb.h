@@ -227,8 +227,8 @@ static const char *s_ControllerMappings [] =
 #if defined(SDL_JOYSTICK_VITA)
     "50535669746120436f6e74726f6c6c65,PSVita Controller,y:b0,b:b1,a:b2,x:b3,leftshoulder:b4,rightshoulder:b5,dpdown:b6,dpleft:b7,dpup:b8,dpright:b9,back:b10,start:b11,leftx:a0,lefty:a1,rightx:a2,righty:a3,",
 #endif
-#if defined(SDL_JOYSTICK_ORBIS)
-    "4f5242495320436f6e74726f6c6c6572,ORBIS Controller,y:b0,b:b1,a:b2,x:b3,leftshoulder:b4,rightshoulder:b5,dpdown:b6,dpleft:b7,dpup:b8,dpright:b9,back:b10,start:b11,lefttrigger:b12,righttrigger:b13,leftstick:b14,rigthstick:b15,leftx:a0,lefty:a1,rightx:a2,righty:a3,",
+#if defined(SDL_JOYSTICK_OPENORBIS)
+    "4f5242495320436f6e74726f6c6c6572,ORBIS Controller,y:b0,b:b1,a:b2,x:b3,leftshoulder:b4,rightshoulder:b5,dpdown:b6,dpleft:b7,dpup:b8,dpright:b9,back:b10,start:b11,leftstick:b14,rightstick:b15,leftx:a0,lefty:a1,rightx:a2,righty:a3,lefttrigger:a4,righttrigger:a5,",
 #endif
     NULL
 };
@@ -0,0 +1,311 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2018 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../../SDL_internal.h"
+
+#if SDL_JOYSTICK_OPENORBIS && defined(SDL_JOYSTICK_OPENORBIS_FAKEPAD)
+
+/* A scripted stand-in for the pad and user service libraries, so the
+   DualShock 4 driver can be timed without a controller attached.
+
+   Build with SDL_JOYSTICK_OPENORBIS_FAKEPAD defined and without linking the
+   real libraries. The driver then takes its declarations from SDL_fakepad.h
+   instead of the SDK, so both files also build with a host compiler and no
+   SDK, given SDL_JOYSTICK_OPENORBIS=1. The thread and timer code they run on
+   still comes from the port.
+
+   Point the SDL_FAKEPAD_SCRIPT environment variable at a text file with one
+   line per state change:
+
+       ms buttons lx ly rx ry l2 r2 [fingers [id x y]...]
+
+   ms counts from scePadInit(), buttons is the hexadecimal ORBIS button mask
+   and the rest are decimal. Lines starting with '#' are ignored. There is a
+   single user with a single pad. The pad disconnects at the line
+   "ms disconnect", and the user logs out and back in at "ms logout" and
+   "ms login". The user is logged in from the start, unless the first of
+   those lines is a login. scePadRead() returns one sample per 4 ms.
+*/
+
+#include "SDL_timer.h"
+#include "SDL_rwops.h"
+
+#include "SDL_fakepad.h"
+
+#define FAKEPAD_HANDLE      1
+#define FAKEPAD_USER        1
+#define FAKEPAD_INTERVAL    4
+#define FAKEPAD_MAX_EVENTS  256
+
+typedef enum
+{
+    FAKEPAD_STATE,
+    FAKEPAD_LOGIN,
+    FAKEPAD_LOGOUT
+} FakePadEventType;
+
+typedef struct FakePadEvent
+{
+    Uint32 ms;
+    FakePadEventType type;
+    OrbisPadData data;
+} FakePadEvent;
+
+/* Kept until the next scePadInit(), since pads are closed and opened
+   again as the user logs out and in */
+static FakePadEvent fakepad_events[FAKEPAD_MAX_EVENTS];
+static int fakepad_count = 0;
+static Uint64 fakepad_start = 0;
+static Uint32 fakepad_sent = 0;     /* Samples returned so far */
+
+static char *
+FakePad_ReadScript(void)
+{
+    const char *path = SDL_getenv("SDL_FAKEPAD_SCRIPT");
+    SDL_RWops *rw;
+    Sint64 size;
+    char *text;
+
+    if (!path) {
+        return NULL;
+    }
+    rw = SDL_RWFromFile(path, "rb");
+    if (!rw) {
+        return NULL;
+    }
+    size = SDL_RWsize(rw);
+    text = (size >= 0) ? (char *) SDL_malloc((size_t) size + 1) : NULL;
+    if (text) {
+        if (SDL_RWread(rw, text, 1, (size_t) size) != (size_t) size) {
+            SDL_free(text);
+            text = NULL;
+        } else {
+            text[size] = '\0';
+        }
+    }
+    SDL_RWclose(rw);
+    return text;
+}
+
+static void
+FakePad_ParseLine(const char *line)
+{
+    FakePadEvent *event;
+    char *end;
+    int i, fingers;
+
+    if (fakepad_count == FAKEPAD_MAX_EVENTS) {
+        return;
+    }
+    event = &fakepad_events[fakepad_count];
+    SDL_zerop(event);
+
+    event->ms = (Uint32) SDL_strtoul(line, &end, 10);
+    if (end == line) {
+        return;
+    }
+    line = end;
+    while (*line == ' ' || *line == '\t') {
+        ++line;
+    }
+    ++fakepad_count;
+    if (SDL_strncmp(line, "disconnect", 10) == 0) {
+        return;
+    }
+    if (SDL_strncmp(line, "login", 5) == 0) {
+        event->type = FAKEPAD_LOGIN;
+        return;
+    }
+    if (SDL_strncmp(line, "logout", 6) == 0) {
+        event->type = FAKEPAD_LOGOUT;
+        return;
+    }
+
+    event->data.connected = 1;
+    event->data.buttons = (unsigned int) SDL_strtoul(line, &end, 16);
+    event->data.leftStick.x = (Uint8) SDL_strtol(end, &end, 10);
+    event->data.leftStick.y = (Uint8) SDL_strtol(end, &end, 10);
+    event->data.rightStick.x = (Uint8) SDL_strtol(end, &end, 10);
+    event->data.rightStick.y = (Uint8) SDL_strtol(end, &end, 10);
+    event->data.analogButtons.l2 = (Uint8) SDL_strtol(end, &end, 10);
+    event->data.analogButtons.r2 = (Uint8) SDL_strtol(end, &end, 10);
+    fingers = (int) SDL_strtol(end, &end, 10);
+    fingers = SDL_min(SDL_max(fingers, 0), 2);
+    event->data.touch.fingers = (Uint8) fingers;
+    for (i = 0; i < fingers; ++i) {
+        event->data.touch.touch[i].finger = (Uint8) SDL_strtol(end, &end, 10);
+        event->data.touch.touch[i].x = (Uint16) SDL_strtol(end, &end, 10);
+        event->data.touch.touch[i].y = (Uint16) SDL_strtol(end, &end, 10);
+    }
+}
+
+/* The scripted state at a time, in milliseconds from scePadInit() */
+static void
+FakePad_GetState(Uint32 ms, OrbisPadData *data)
+{
+    int i;
+
+    /* Connected and centered until the script says otherwise */
+    SDL_zerop(data);
+    data->connected = 1;
+    data->leftStick.x = data->leftStick.y = 128;
+    data->rightStick.x = data->rightStick.y = 128;
+
+    for (i = 0; i < fakepad_count && fakepad_events[i].ms <= ms; ++i) {
+        if (fakepad_events[i].type == FAKEPAD_STATE) {
+            *data = fakepad_events[i].data;
+        }
+    }
+    data->timestamp = (Uint64) ms * 1000;
+}
+
+/* Whether the user is logged in at a time, in milliseconds from scePadInit() */
+static SDL_bool
+FakePad_LoggedIn(Uint32 ms)
+{
+    SDL_bool logged_in = SDL_TRUE;
+    SDL_bool first = SDL_TRUE;
+    int i;
+
+    for (i = 0; i < fakepad_count; ++i) {
+        const FakePadEventType type = fakepad_events[i].type;
+
+        if (type == FAKEPAD_STATE) {
+            continue;
+        }
+        if (first) {
+            logged_in = (type == FAKEPAD_LOGOUT) ? SDL_TRUE : SDL_FALSE;
+            first = SDL_FALSE;
+        }
+        if (fakepad_events[i].ms > ms) {
+            break;
+        }
+        logged_in = (type == FAKEPAD_LOGIN) ? SDL_TRUE : SDL_FALSE;
+    }
+    return logged_in;
+}
+
+static Uint32
+FakePad_Now(void)
+{
+    return (Uint32) ((SDL_GetPerformanceCounter() - fakepad_start) * 1000 / SDL_GetPerformanceFrequency());
+}
+
+int
+scePadInit(void)
+{
+    char *text = FakePad_ReadScript();
+
+    fakepad_count = 0;
+    if (text) {
+        char *line = text;
+        while (*line) {
+            char *next = SDL_strchr(line, '\n');
+            if (next) {
+                *next++ = '\0';
+            } else {
+                next = line + SDL_strlen(line);
+            }
+            if (*line != '#') {
+                FakePad_ParseLine(line);
+            }
+            line = next;
+        }
+        SDL_free(text);
+    }
+
+    fakepad_start = SDL_GetPerformanceCounter();
+    fakepad_sent = 0;
+    return 0;
+}
+
+int
+scePadOpen(int userID, int type, int index, void *param)
+{
+    const Uint32 now = FakePad_Now();
+
+    if (userID != FAKEPAD_USER || !FakePad_LoggedIn(now)) {
+        return -1;
+    }
+    /* A new handle only gets the samples from here on */
+    fakepad_sent = now / FAKEPAD_INTERVAL;
+    return FAKEPAD_HANDLE;
+}
+
+int
+scePadClose(int handle)
+{
+    return 0;
+}
+
+int
+scePadSetMotionSensorState(int handle, SDL_bool enable)
+{
+    return 0;
+}
+
+int
+scePadReadState(int handle, void *data)
+{
+    FakePad_GetState(FakePad_Now(), (OrbisPadData *) data);
+    return 0;
+}
+
+int
+scePadRead(int handle, void *data, int count)
+{
+    OrbisPadData *samples = (OrbisPadData *) data;
+    const Uint32 due = FakePad_Now() / FAKEPAD_INTERVAL;
+    int i = 0;
+
+    /* Like the real library, only the most recent samples are kept */
+    if (due - fakepad_sent > (Uint32) count) {
+        fakepad_sent = due - count;
+    }
+    while (fakepad_sent < due) {
+        ++fakepad_sent;
+        FakePad_GetState(fakepad_sent * FAKEPAD_INTERVAL, &samples[i++]);
+    }
+    return i;
+}
+
+int
+sceUserServiceInitialize(void *params)
+{
+    return 0;
+}
+
+int
+sceUserServiceGetLoginUserIdList(OrbisUserServiceLoginUserIdList *list)
+{
+    int i;
+
+    for (i = 0; i < SDL_arraysize(list->userId); ++i) {
+        list->userId[i] = -1;
+    }
+    if (FakePad_LoggedIn(FakePad_Now())) {
+        list->userId[0] = FAKEPAD_USER;
+    }
+    return 0;
+}
+
+#endif /* SDL_JOYSTICK_OPENORBIS && SDL_JOYSTICK_OPENORBIS_FAKEPAD */
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,132 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2018 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef _SDL_fakepad_h
+#define _SDL_fakepad_h
+
+#include "../../SDL_internal.h"
+
+/* The parts of <orbis/Pad.h> and <orbis/UserService.h> that the DualShock 4
+   driver uses, laid out the same way, so that the driver and SDL_fakepad.c
+   can be built without the OpenOrbis SDK.
+*/
+
+typedef struct stick
+{
+    Uint8 x;
+    Uint8 y;
+} stick;
+
+typedef struct analog
+{
+    Uint8 l2;
+    Uint8 r2;
+} analog;
+
+typedef struct vec_float3
+{
+    float x;
+    float y;
+    float z;
+} vec_float3;
+
+typedef struct vec_float4
+{
+    float x;
+    float y;
+    float z;
+    float w;
+} vec_float4;
+
+typedef struct OrbisPadTouch
+{
+    Uint16 x;
+    Uint16 y;
+    Uint8 finger;
+    Uint8 pad[3];
+} OrbisPadTouch;
+
+typedef struct OrbisPadTouchData
+{
+    Uint8 fingers;
+    Uint8 padding1[3];
+    Uint32 padding2;
+    OrbisPadTouch touch[2];
+} OrbisPadTouchData;
+
+typedef struct OrbisPadData
+{
+    unsigned int buttons;
+    stick leftStick;
+    stick rightStick;
+    analog analogButtons;
+    Uint16 padding;
+    vec_float4 quat;
+    vec_float3 vel;
+    vec_float3 acell;
+    OrbisPadTouchData touch;
+    Uint8 connected;
+    Uint64 timestamp;
+    Uint8 ext[16];
+    Uint8 count;
+    Uint8 unknown[15];
+} OrbisPadData;
+
+typedef enum OrbisPadButton
+{
+    ORBIS_PAD_BUTTON_L3         = 0x0002,
+    ORBIS_PAD_BUTTON_R3         = 0x0004,
+    ORBIS_PAD_BUTTON_OPTIONS    = 0x0008,
+    ORBIS_PAD_BUTTON_UP         = 0x0010,
+    ORBIS_PAD_BUTTON_RIGHT      = 0x0020,
+    ORBIS_PAD_BUTTON_DOWN       = 0x0040,
+    ORBIS_PAD_BUTTON_LEFT       = 0x0080,
+    ORBIS_PAD_BUTTON_L2         = 0x0100,
+    ORBIS_PAD_BUTTON_R2         = 0x0200,
+    ORBIS_PAD_BUTTON_L1         = 0x0400,
+    ORBIS_PAD_BUTTON_R1         = 0x0800,
+    ORBIS_PAD_BUTTON_TRIANGLE   = 0x1000,
+    ORBIS_PAD_BUTTON_CIRCLE     = 0x2000,
+    ORBIS_PAD_BUTTON_CROSS      = 0x4000,
+    ORBIS_PAD_BUTTON_SQUARE     = 0x8000,
+    ORBIS_PAD_BUTTON_TOUCH_PAD  = 0x100000
+} OrbisPadButton;
+
+#define ORBIS_USER_SERVICE_MAX_LOGIN_USERS  4
+
+typedef struct OrbisUserServiceLoginUserIdList
+{
+    Sint32 userId[ORBIS_USER_SERVICE_MAX_LOGIN_USERS];
+} OrbisUserServiceLoginUserIdList;
+
+extern int scePadInit(void);
+extern int scePadOpen(int userID, int type, int index, void *param);
+extern int scePadClose(int handle);
+extern int scePadSetMotionSensorState(int handle, SDL_bool enable);
+extern int scePadReadState(int handle, void *data);
+extern int scePadRead(int handle, void *data, int count);
+
+extern int sceUserServiceInitialize(void *params);
+extern int sceUserServiceGetLoginUserIdList(OrbisUserServiceLoginUserIdList *list);
+
+#endif /* _SDL_fakepad_h */
+
+/* vi: set ts=4 sw=4 expandtab: */
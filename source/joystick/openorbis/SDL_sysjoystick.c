@@ -0,0 +1,665 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2018 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../../SDL_internal.h"
+
+#if SDL_JOYSTICK_OPENORBIS
+
+/* This is the DualShock 4 implementation of the SDL joystick API.
+
+   scePadRead() is drained by a thread at the controller's native report
+   rate, so button taps shorter than the application's frame time are not
+   lost. The thread publishes a snapshot per pad through a lock-free triple
+   buffer, and SDL_SYS_JoystickUpdate() turns the difference between the
+   last snapshot it consumed and the newest one into joystick events. The
+   thread wakes up SDL_WaitEvent() when there is something to pump.
+
+   The thread also looks for users who logged in or out every second, and
+   opens or closes their pads. Only the thread opens pads and fills slots.
+   A slot is reused only once its pad is closed and SDL_SYS_JoystickDetect()
+   has reported the removal.
+*/
+
+#include "SDL_events.h"
+#include "SDL_joystick.h"
+#include "SDL_hints.h"
+#include "SDL_atomic.h"
+#include "SDL_timer.h"
+#include "../SDL_sysjoystick.h"
+#include "../SDL_joystick_c.h"
+#include "../../events/SDL_events_c.h"
+#include "../../events/SDL_touch_c.h"
+#include "../../thread/SDL_systhread.h"
+
+#ifdef SDL_JOYSTICK_OPENORBIS_FAKEPAD
+#include "SDL_fakepad.h"
+#else
+#include <orbis/Pad.h>
+#include <orbis/UserService.h>
+#endif
+
+#define SDL_ORBIS_MAX_PADS      4
+#define SDL_ORBIS_NUM_BUTTONS   16
+#define SDL_ORBIS_NUM_AXES      6
+#define SDL_ORBIS_NUM_SENSORS   6
+#define SDL_ORBIS_MAX_SAMPLES   16
+
+/* The pads report every 4 ms */
+#define SDL_ORBIS_POLL_INTERVAL 4
+
+/* How often to look for users who logged in or out, in milliseconds */
+#define SDL_ORBIS_USERS_INTERVAL    1000
+
+/* Touchpad resolution, in the units scePadRead() reports */
+#define SDL_ORBIS_TOUCH_WIDTH   1920
+#define SDL_ORBIS_TOUCH_HEIGHT  943
+
+/* Set in the middle slot of the triple buffer when it holds an unread snapshot */
+#define SDL_ORBIS_FRESH         4
+
+/* ORBIS button masks, in SDL button order */
+static const Uint32 SDL_orbis_buttons[SDL_ORBIS_NUM_BUTTONS] = {
+    ORBIS_PAD_BUTTON_TRIANGLE, ORBIS_PAD_BUTTON_CIRCLE, ORBIS_PAD_BUTTON_CROSS, ORBIS_PAD_BUTTON_SQUARE,
+    ORBIS_PAD_BUTTON_L1, ORBIS_PAD_BUTTON_R1,
+    ORBIS_PAD_BUTTON_DOWN, ORBIS_PAD_BUTTON_LEFT, ORBIS_PAD_BUTTON_UP, ORBIS_PAD_BUTTON_RIGHT,
+    ORBIS_PAD_BUTTON_TOUCH_PAD, ORBIS_PAD_BUTTON_OPTIONS,
+    ORBIS_PAD_BUTTON_L2, ORBIS_PAD_BUTTON_R2,
+    ORBIS_PAD_BUTTON_L3, ORBIS_PAD_BUTTON_R3
+};
+
+/* Everything SDL reports about a pad, as of one report */
+typedef struct SDL_OrbisPadState
+{
+    Uint32 buttons;
+    Sint16 axes[SDL_ORBIS_NUM_AXES + SDL_ORBIS_NUM_SENSORS];
+    int fingers;
+    struct {
+        Uint8 id;
+        Uint16 x;
+        Uint16 y;
+    } touch[2];
+    /* How many times each button went down, so taps between two updates
+       still come out as a press and a release */
+    Uint8 presses[SDL_ORBIS_NUM_BUTTONS];
+} SDL_OrbisPadState;
+
+typedef struct SDL_OrbisPad
+{
+    int user_id;
+    int handle;                     /* -1 once the user logged out */
+    SDL_JoystickID instance_id;     /* -1 while the pad isn't reported to SDL */
+    SDL_atomic_t attached;          /* instance_id, for the poll thread */
+    SDL_atomic_t connected;
+    SDL_atomic_t opened;            /* How many joysticks have the slot open */
+
+    /* Triple buffer: the poll thread owns states[back], the reader owns
+       states[front], and they trade their slot for the middle one */
+    SDL_OrbisPadState states[3];
+    SDL_atomic_t middle;
+    int back;
+    int front;
+
+    /* Poll thread state */
+    Uint32 last_buttons;
+    Uint8 presses[SDL_ORBIS_NUM_BUTTONS];
+    SDL_OrbisPadState published;
+} SDL_OrbisPad;
+
+struct joystick_hwdata
+{
+    SDL_OrbisPad *pad;
+    SDL_TouchID touch_id;
+    SDL_bool reported;              /* Whether last holds what SDL was told */
+    SDL_OrbisPadState last;
+};
+
+static SDL_OrbisPad SDL_orbis_pads[SDL_ORBIS_MAX_PADS];
+static SDL_atomic_t SDL_orbis_numpads;   /* Slots filled by the poll thread */
+static SDL_bool SDL_orbis_motion = SDL_FALSE;
+static SDL_Thread *SDL_orbis_thread = NULL;
+static SDL_atomic_t SDL_orbis_running;
+static SDL_JoystickID SDL_orbis_next_instance_id = 0;
+
+static Sint16
+ORBIS_ClampAxis(float value)
+{
+    if (value >= SDL_JOYSTICK_AXIS_MAX) {
+        return SDL_JOYSTICK_AXIS_MAX;
+    }
+    if (value <= SDL_JOYSTICK_AXIS_MIN) {
+        return SDL_JOYSTICK_AXIS_MIN;
+    }
+    return (Sint16) value;
+}
+
+static void
+ORBIS_ConvertPadData(const OrbisPadData *data, SDL_OrbisPadState *state)
+{
+    int i;
+
+    state->buttons = data->buttons;
+    state->axes[0] = (Sint16) (data->leftStick.x * 257 - 32768);
+    state->axes[1] = (Sint16) (data->leftStick.y * 257 - 32768);
+    state->axes[2] = (Sint16) (data->rightStick.x * 257 - 32768);
+    state->axes[3] = (Sint16) (data->rightStick.y * 257 - 32768);
+    state->axes[4] = (Sint16) (data->analogButtons.l2 * 257 - 32768);
+    state->axes[5] = (Sint16) (data->analogButtons.r2 * 257 - 32768);
+
+    /* Acceleration in g over +/-4 g, angular velocity in rad/s over +/-32 rad/s */
+    if (SDL_orbis_motion) {
+        state->axes[6] = ORBIS_ClampAxis(data->acell.x * 8192.0f);
+        state->axes[7] = ORBIS_ClampAxis(data->acell.y * 8192.0f);
+        state->axes[8] = ORBIS_ClampAxis(data->acell.z * 8192.0f);
+        state->axes[9] = ORBIS_ClampAxis(data->vel.x * 1024.0f);
+        state->axes[10] = ORBIS_ClampAxis(data->vel.y * 1024.0f);
+        state->axes[11] = ORBIS_ClampAxis(data->vel.z * 1024.0f);
+    }
+
+    state->fingers = SDL_min(data->touch.fingers, 2);
+    for (i = 0; i < state->fingers; ++i) {
+        state->touch[i].id = data->touch.touch[i].finger;
+        state->touch[i].x = data->touch.touch[i].x;
+        state->touch[i].y = data->touch.touch[i].y;
+    }
+}
+
+/* Called from the poll thread. A change is reported by SDL_SYS_JoystickDetect(),
+   so it has to be pumped. */
+static void
+ORBIS_SetConnected(SDL_OrbisPad *pad, SDL_bool connected)
+{
+    if (SDL_AtomicSet(&pad->connected, connected) != (int) connected) {
+        SDL_SendEventWakeup();
+    }
+}
+
+/* Called from the poll thread */
+static void
+ORBIS_PollPad(SDL_OrbisPad *pad)
+{
+    OrbisPadData data[SDL_ORBIS_MAX_SAMPLES];
+    SDL_OrbisPadState state;
+    int count, i, j;
+
+    count = scePadRead(pad->handle, data, SDL_arraysize(data));
+    if (count <= 0) {
+        if (count < 0) {
+            ORBIS_SetConnected(pad, SDL_FALSE);
+        }
+        return;
+    }
+
+    /* Count every press, even ones released before the last sample */
+    for (i = 0; i < count; ++i) {
+        const Uint32 pressed = data[i].buttons & ~pad->last_buttons;
+        if (pressed) {
+            for (j = 0; j < SDL_ORBIS_NUM_BUTTONS; ++j) {
+                if (pressed & SDL_orbis_buttons[j]) {
+                    ++pad->presses[j];
+                }
+            }
+        }
+        pad->last_buttons = data[i].buttons;
+    }
+
+    SDL_zero(state);
+    ORBIS_ConvertPadData(&data[count - 1], &state);
+    SDL_memcpy(state.presses, pad->presses, sizeof(state.presses));
+    ORBIS_SetConnected(pad, data[count - 1].connected ? SDL_TRUE : SDL_FALSE);
+
+    if (SDL_memcmp(&state, &pad->published, sizeof(state)) == 0) {
+        return;
+    }
+
+    pad->published = state;
+    pad->states[pad->back] = state;
+    SDL_MemoryBarrierRelease();
+    pad->back = SDL_AtomicSet(&pad->middle, pad->back | SDL_ORBIS_FRESH) & 3;
+
+    if (SDL_AtomicGet(&pad->opened)) {
+        SDL_SendEventWakeup();
+    }
+}
+
+/* Open the pad of a user who logged in, in a free slot -- called from the
+   poll thread, or before it starts */
+static void
+ORBIS_OpenPad(int user_id)
+{
+    const int numpads = SDL_AtomicGet(&SDL_orbis_numpads);
+    SDL_OrbisPad *pad = NULL;
+    OrbisPadData data;
+    SDL_bool connected = SDL_FALSE;
+    int handle, i;
+
+    for (i = 0; i < numpads; ++i) {
+        if (SDL_orbis_pads[i].handle < 0 && !SDL_AtomicGet(&SDL_orbis_pads[i].attached)) {
+            pad = &SDL_orbis_pads[i];
+            break;
+        }
+    }
+    if (!pad) {
+        if (numpads == SDL_ORBIS_MAX_PADS) {
+            return;
+        }
+        pad = &SDL_orbis_pads[numpads];
+    }
+
+    handle = scePadOpen(user_id, 0, 0, NULL);
+    if (handle < 0) {
+        return;
+    }
+
+    pad->user_id = user_id;
+    pad->handle = handle;
+    pad->back = 0;
+    pad->front = 1;
+    SDL_AtomicSet(&pad->middle, 2);
+    pad->last_buttons = 0;
+    SDL_zero(pad->presses);
+    SDL_zero(pad->published);
+    if (SDL_orbis_motion) {
+        scePadSetMotionSensorState(handle, SDL_TRUE);
+    }
+
+    /* Start from the current state so a held button doesn't count as a press */
+    SDL_zero(data);
+    if (scePadReadState(handle, &data) >= 0 && data.connected) {
+        ORBIS_ConvertPadData(&data, &pad->published);
+        pad->last_buttons = data.buttons;
+        connected = SDL_TRUE;
+    }
+    pad->states[0] = pad->states[1] = pad->states[2] = pad->published;
+
+    if (pad == &SDL_orbis_pads[numpads]) {
+        pad->instance_id = -1;
+        SDL_AtomicSet(&SDL_orbis_numpads, numpads + 1);
+    }
+    if (connected) {
+        ORBIS_SetConnected(pad, SDL_TRUE);
+    }
+}
+
+/* Open the pads of users who logged in and close the ones of users who
+   logged out -- called from the poll thread, or before it starts */
+static int
+ORBIS_UpdateUsers(void)
+{
+    OrbisUserServiceLoginUserIdList users;
+    int numpads, i, j;
+
+    if (sceUserServiceGetLoginUserIdList(&users) < 0) {
+        return -1;
+    }
+
+    numpads = SDL_AtomicGet(&SDL_orbis_numpads);
+    for (i = 0; i < numpads; ++i) {
+        SDL_OrbisPad *pad = &SDL_orbis_pads[i];
+
+        if (pad->handle < 0) {
+            continue;
+        }
+        for (j = 0; j < SDL_arraysize(users.userId); ++j) {
+            if (users.userId[j] == pad->user_id) {
+                break;
+            }
+        }
+        if (j == SDL_arraysize(users.userId)) {
+            scePadClose(pad->handle);
+            pad->handle = -1;
+            ORBIS_SetConnected(pad, SDL_FALSE);
+        }
+    }
+
+    for (j = 0; j < SDL_arraysize(users.userId); ++j) {
+        if (users.userId[j] < 0) {
+            continue;
+        }
+        numpads = SDL_AtomicGet(&SDL_orbis_numpads);
+        for (i = 0; i < numpads; ++i) {
+            if (SDL_orbis_pads[i].handle >= 0 && SDL_orbis_pads[i].user_id == users.userId[j]) {
+                break;
+            }
+        }
+        if (i == numpads) {
+            ORBIS_OpenPad(users.userId[j]);
+        }
+    }
+    return 0;
+}
+
+static int
+ORBIS_PollThread(void *data)
+{
+    Uint32 users_due = SDL_GetTicks() + SDL_ORBIS_USERS_INTERVAL;
+    int numpads, i;
+
+    while (SDL_AtomicGet(&SDL_orbis_running)) {
+        if (SDL_TICKS_PASSED(SDL_GetTicks(), users_due)) {
+            ORBIS_UpdateUsers();
+            users_due = SDL_GetTicks() + SDL_ORBIS_USERS_INTERVAL;
+        }
+
+        numpads = SDL_AtomicGet(&SDL_orbis_numpads);
+        for (i = 0; i < numpads; ++i) {
+            if (SDL_orbis_pads[i].handle >= 0) {
+                ORBIS_PollPad(&SDL_orbis_pads[i]);
+            }
+        }
+        SDL_Delay(SDL_ORBIS_POLL_INTERVAL);
+    }
+    return 0;
+}
+
+/* Swap in the newest snapshot of a pad, if there is one */
+static const SDL_OrbisPadState *
+ORBIS_ReadPad(SDL_OrbisPad *pad)
+{
+    if (SDL_AtomicGet(&pad->middle) & SDL_ORBIS_FRESH) {
+        SDL_MemoryBarrierRelease();
+        pad->front = SDL_AtomicSet(&pad->middle, pad->front) & 3;
+    }
+    return &pad->states[pad->front];
+}
+
+static SDL_OrbisPad *
+ORBIS_GetPadForDeviceIndex(int device_index)
+{
+    const int numpads = SDL_AtomicGet(&SDL_orbis_numpads);
+    int i;
+
+    for (i = 0; i < numpads; ++i) {
+        if (SDL_orbis_pads[i].instance_id >= 0) {
+            if (device_index == 0) {
+                return &SDL_orbis_pads[i];
+            }
+            --device_index;
+        }
+    }
+    return NULL;
+}
+
+int
+SDL_SYS_JoystickInit(void)
+{
+    sceUserServiceInitialize(NULL);
+    if (scePadInit() < 0) {
+        return SDL_SetError("Couldn't initialize the pad library");
+    }
+
+    SDL_orbis_motion = SDL_GetHintBoolean(SDL_HINT_ACCELEROMETER_AS_JOYSTICK, SDL_TRUE);
+
+    SDL_zero(SDL_orbis_pads);
+    SDL_AtomicSet(&SDL_orbis_numpads, 0);
+    if (ORBIS_UpdateUsers() < 0) {
+        return SDL_SetError("Couldn't get the logged in users");
+    }
+
+    SDL_AtomicSet(&SDL_orbis_running, 1);
+    SDL_orbis_thread = SDL_CreateThreadInternal(ORBIS_PollThread, "SDLOrbisPad", 64 * 1024, NULL);
+    if (!SDL_orbis_thread) {
+        SDL_SYS_JoystickQuit();
+        return -1;
+    }
+
+    SDL_SYS_JoystickDetect();
+
+    return SDL_SYS_NumJoysticks();
+}
+
+int
+SDL_SYS_NumJoysticks(void)
+{
+    const int numpads = SDL_AtomicGet(&SDL_orbis_numpads);
+    int i, count = 0;
+
+    for (i = 0; i < numpads; ++i) {
+        if (SDL_orbis_pads[i].instance_id >= 0) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void
+SDL_SYS_JoystickDetect(void)
+{
+    const int numpads = SDL_AtomicGet(&SDL_orbis_numpads);
+    int i, device_index = 0;
+
+    for (i = 0; i < numpads; ++i) {
+        SDL_OrbisPad *pad = &SDL_orbis_pads[i];
+        const SDL_bool connected = SDL_AtomicGet(&pad->connected) ? SDL_TRUE : SDL_FALSE;
+
+        if (connected && pad->instance_id < 0) {
+            pad->instance_id = SDL_orbis_next_instance_id++;
+            SDL_AtomicSet(&pad->attached, 1);
+            SDL_PrivateJoystickAdded(device_index);
+        } else if (!connected && pad->instance_id >= 0) {
+            const SDL_JoystickID instance_id = pad->instance_id;
+            pad->instance_id = -1;
+            /* The poll thread may fill the slot again from here on */
+            SDL_MemoryBarrierRelease();
+            SDL_AtomicSet(&pad->attached, 0);
+            SDL_PrivateJoystickRemoved(instance_id);
+        }
+        if (pad->instance_id >= 0) {
+            ++device_index;
+        }
+    }
+}
+
+const char *
+SDL_SYS_JoystickNameForDeviceIndex(int device_index)
+{
+    return "PS4 Controller";
+}
+
+SDL_JoystickID
+SDL_SYS_GetInstanceIdOfDeviceIndex(int device_index)
+{
+    SDL_OrbisPad *pad = ORBIS_GetPadForDeviceIndex(device_index);
+    return pad ? pad->instance_id : -1;
+}
+
+int
+SDL_SYS_JoystickOpen(SDL_Joystick * joystick, int device_index)
+{
+    SDL_OrbisPad *pad = ORBIS_GetPadForDeviceIndex(device_index);
+
+    if (!pad) {
+        return SDL_SetError("No joystick at device index %d", device_index);
+    }
+
+    joystick->hwdata = (struct joystick_hwdata *) SDL_calloc(1, sizeof(*joystick->hwdata));
+    if (!joystick->hwdata) {
+        return SDL_OutOfMemory();
+    }
+    joystick->hwdata->pad = pad;
+    joystick->hwdata->touch_id = (SDL_TouchID) (pad - SDL_orbis_pads) + 1;
+    joystick->instance_id = pad->instance_id;
+    joystick->nbuttons = SDL_ORBIS_NUM_BUTTONS;
+    joystick->naxes = SDL_ORBIS_NUM_AXES;
+    if (SDL_orbis_motion) {
+        joystick->naxes += SDL_ORBIS_NUM_SENSORS;
+    }
+    joystick->nhats = 0;
+    joystick->nballs = 0;
+
+    if (SDL_AddTouch(joystick->hwdata->touch_id, "PS4 Controller Touchpad") < 0) {
+        SDL_free(joystick->hwdata);
+        joystick->hwdata = NULL;
+        return -1;
+    }
+    SDL_AtomicAdd(&pad->opened, 1);
+    return 0;
+}
+
+SDL_bool
+SDL_SYS_JoystickAttached(SDL_Joystick * joystick)
+{
+    return joystick->hwdata->pad->instance_id == joystick->instance_id;
+}
+
+static void
+ORBIS_UpdateTouch(struct joystick_hwdata *hwdata, const SDL_OrbisPadState *state)
+{
+    const SDL_OrbisPadState *last = &hwdata->last;
+    int i, j;
+
+    for (i = 0; i < last->fingers; ++i) {
+        for (j = 0; j < state->fingers; ++j) {
+            if (state->touch[j].id == last->touch[i].id) {
+                break;
+            }
+        }
+        if (j == state->fingers) {
+            SDL_SendTouch(hwdata->touch_id, last->touch[i].id, SDL_FALSE,
+                          (float) last->touch[i].x / SDL_ORBIS_TOUCH_WIDTH,
+                          (float) last->touch[i].y / SDL_ORBIS_TOUCH_HEIGHT, 1.0f);
+        }
+    }
+
+    for (i = 0; i < state->fingers; ++i) {
+        const float x = (float) state->touch[i].x / SDL_ORBIS_TOUCH_WIDTH;
+        const float y = (float) state->touch[i].y / SDL_ORBIS_TOUCH_HEIGHT;
+
+        for (j = 0; j < last->fingers; ++j) {
+            if (last->touch[j].id == state->touch[i].id) {
+                break;
+            }
+        }
+        if (j == last->fingers) {
+            SDL_SendTouch(hwdata->touch_id, state->touch[i].id, SDL_TRUE, x, y, 1.0f);
+        } else if (last->touch[j].x != state->touch[i].x || last->touch[j].y != state->touch[i].y) {
+            SDL_SendTouchMotion(hwdata->touch_id, state->touch[i].id, x, y, 1.0f);
+        }
+    }
+}
+
+void
+SDL_SYS_JoystickUpdate(SDL_Joystick * joystick)
+{
+    struct joystick_hwdata *hwdata = joystick->hwdata;
+    const SDL_OrbisPadState *state;
+    SDL_OrbisPadState *last = &hwdata->last;
+    int i;
+
+    if (!SDL_SYS_JoystickAttached(joystick)) {
+        return;
+    }
+
+    state = ORBIS_ReadPad(hwdata->pad);
+    if (!hwdata->reported) {
+        /* Report everything once, taking the press counts as they are */
+        SDL_zerop(last);
+        for (i = 0; i < joystick->naxes; ++i) {
+            last->axes[i] = ~state->axes[i];
+        }
+        SDL_memcpy(last->presses, state->presses, sizeof(last->presses));
+        last->buttons = ~state->buttons;
+        hwdata->reported = SDL_TRUE;
+    } else if (SDL_memcmp(state, last, sizeof(*state)) == 0) {
+        return;
+    }
+
+    for (i = 0; i < joystick->naxes; ++i) {
+        if (state->axes[i] != last->axes[i]) {
+            SDL_PrivateJoystickAxis(joystick, (Uint8) i, state->axes[i]);
+        }
+    }
+
+    for (i = 0; i < SDL_ORBIS_NUM_BUTTONS; ++i) {
+        const Uint32 mask = SDL_orbis_buttons[i];
+        Uint32 pressed = last->buttons & mask;
+
+        if (state->presses[i] != last->presses[i]) {
+            /* At least one press happened since the last update */
+            if (pressed) {
+                SDL_PrivateJoystickButton(joystick, (Uint8) i, SDL_RELEASED);
+            }
+            SDL_PrivateJoystickButton(joystick, (Uint8) i, SDL_PRESSED);
+            pressed = mask;
+        }
+        if ((state->buttons & mask) != pressed) {
+            SDL_PrivateJoystickButton(joystick, (Uint8) i, (state->buttons & mask) ? SDL_PRESSED : SDL_RELEASED);
+        }
+    }
+
+    ORBIS_UpdateTouch(hwdata, state);
+
+    *last = *state;
+}
+
+void
+SDL_SYS_JoystickClose(SDL_Joystick * joystick)
+{
+    if (joystick->hwdata) {
+        SDL_AtomicAdd(&joystick->hwdata->pad->opened, -1);
+        SDL_DelTouch(joystick->hwdata->touch_id);
+        SDL_free(joystick->hwdata);
+        joystick->hwdata = NULL;
+    }
+}
+
+void
+SDL_SYS_JoystickQuit(void)
+{
+    int i;
+
+    if (SDL_orbis_thread) {
+        SDL_AtomicSet(&SDL_orbis_running, 0);
+        SDL_WaitThread(SDL_orbis_thread, NULL);
+        SDL_orbis_thread = NULL;
+    }
+
+    for (i = 0; i < SDL_AtomicGet(&SDL_orbis_numpads); ++i) {
+        if (SDL_orbis_pads[i].handle >= 0) {
+            scePadClose(SDL_orbis_pads[i].handle);
+        }
+    }
+    SDL_zero(SDL_orbis_pads);
+    SDL_AtomicSet(&SDL_orbis_numpads, 0);
+}
+
+static SDL_JoystickGUID
+ORBIS_GetGUID(void)
+{
+    /* The same bytes as the "ORBIS Controller" entry in SDL_gamecontrollerdb.h */
+    SDL_JoystickGUID guid;
+    SDL_memcpy(guid.data, "ORBIS Controller", sizeof(guid.data));
+    return guid;
+}
+
+SDL_JoystickGUID
+SDL_SYS_JoystickGetDeviceGUID(int device_index)
+{
+    return ORBIS_GetGUID();
+}
+
+SDL_JoystickGUID
+SDL_SYS_JoystickGetGUID(SDL_Joystick * joystick)
+{
+    return ORBIS_GetGUID();
+}
+
+#endif /* SDL_JOYSTICK_OPENORBIS */
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -28,6 +28,7 @@
 #include "SDL_render.h"
 #include "SDL_sysrender.h"
 #include "software/SDL_render_sw_c.h"
+#include "../events/SDL_events_c.h"
 
 
 #define SDL_WINDOWRENDERDATA    "_SDL_WindowRenderData"
@@ -379,7 +380,10 @@ SDL_CreateRenderer(SDL_Window * window, int index, Uint32 flags)
 
         SDL_RenderSetViewport(renderer, NULL);
 
-        SDL_AddEventWatch(SDL_RendererEventWatch, renderer);
+        /* Only the event types the watch handles */
+        SDL_AddEventWatchForTypes(SDL_WINDOWEVENT, SDL_WINDOWEVENT, SDL_RendererEventWatch, renderer);
+        SDL_AddEventWatchForTypes(SDL_MOUSEMOTION, SDL_MOUSEBUTTONUP, SDL_RendererEventWatch, renderer);
+        SDL_AddEventWatchForTypes(SDL_FINGERDOWN, SDL_FINGERMOTION, SDL_RendererEventWatch, renderer);
 
         SDL_LogInfo(SDL_LOG_CATEGORY_RENDER,
                     "Created renderer: %s", renderer->info.name);
@@ -1990,6 +1994,65 @@ SDL_RenderCopyEx(SDL_Renderer * renderer, SDL_Texture * texture,
     return renderer->RenderCopyEx(renderer, texture, &real_srcrect, &frect, angle, &fcenter, flip);
 }
 
+int
+SDL_RenderGeometry(SDL_Renderer * renderer, SDL_Texture * texture,
+                   const SDL_Vertex * vertices, int num_vertices,
+                   const int * indices, int num_indices)
+{
+    int i;
+
+    CHECK_RENDERER_MAGIC(renderer, -1);
+
+    if (texture) {
+        CHECK_TEXTURE_MAGIC(texture, -1);
+
+        if (renderer != texture->renderer) {
+            return SDL_SetError("Texture was not created with this renderer");
+        }
+    }
+    if (!renderer->RenderGeometry) {
+        return SDL_SetError("Renderer does not support RenderGeometry");
+    }
+    if (!vertices) {
+        return SDL_InvalidParamError("vertices");
+    }
+    if (num_vertices < 0) {
+        return SDL_InvalidParamError("num_vertices");
+    }
+
+    if (indices) {
+        if (num_indices < 0 || (num_indices % 3) != 0) {
+            return SDL_InvalidParamError("num_indices");
+        }
+        for (i = 0; i < num_indices; ++i) {
+            if (indices[i] < 0 || indices[i] >= num_vertices) {
+                return SDL_SetError("Vertex index %d out of range", indices[i]);
+            }
+        }
+    } else {
+        if ((num_vertices % 3) != 0) {
+            return SDL_InvalidParamError("num_vertices");
+        }
+        num_indices = 0;
+    }
+
+    /* Don't draw while we're hidden */
+    if (renderer->hidden) {
+        return 0;
+    }
+
+    if (num_vertices < 3) {
+        return 0;
+    }
+
+    if (texture && texture->native) {
+        texture = texture->native;
+    }
+
+    return renderer->RenderGeometry(renderer, texture, vertices, num_vertices,
+                                    indices, num_indices, &renderer->scale);
+}
+
 int
 SDL_RenderReadPixels(SDL_Renderer * renderer, const SDL_Rect * rect,
                      Uint32 format, void * pixels, int pitch)
@@ -2079,7 +2142,7 @@ SDL_DestroyRenderer(SDL_Renderer * renderer)
 {
     CHECK_RENDERER_MAGIC(renderer, );
 
-    SDL_DelEventWatch(SDL_RendererEventWatch, renderer);
+    SDL_DelEventWatches(SDL_RendererEventWatch, renderer);
 
     /* Free existing textures for this renderer */
     while (renderer->textures) {
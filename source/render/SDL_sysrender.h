@@ -31,20 +31,6 @@
 
 typedef struct SDL_RenderDriver SDL_RenderDriver;
 
-typedef struct
-{
-    float x;
-    float y;
-} SDL_FPoint;
-
-typedef struct
-{
-    float x;
-    float y;
-    float w;
-    float h;
-} SDL_FRect;
-
 /* Define the SDL texture structure */
 struct SDL_Texture
 {
@@ -113,6 +99,10 @@ struct SDL_Renderer
     int (*RenderCopyEx) (SDL_Renderer * renderer, SDL_Texture * texture,
                        const SDL_Rect * srcquad, const SDL_FRect * dstrect,
                        const double angle, const SDL_FPoint *center, const SDL_RendererFlip flip);
+    int (*RenderGeometry) (SDL_Renderer * renderer, SDL_Texture * texture,
+                           const SDL_Vertex * vertices, int num_vertices,
+                           const int * indices, int num_indices,
+                           const SDL_FPoint * scale);
     int (*RenderReadPixels) (SDL_Renderer * renderer, const SDL_Rect * rect,
                              Uint32 format, void * pixels, int pitch);
     void (*RenderPresent) (SDL_Renderer * renderer);
@@ -31,6 +31,14 @@
 #include <stdlib.h>
 
 #include "SDL_render_openorbis.h"
+#include "../../video/SDL_blit.h"
+#include "../../video/SDL_yuv_c.h"
+#include "../software/SDL_blendfillrect.h"
+#include "../software/SDL_blendline.h"
+#include "../software/SDL_blendpoint.h"
+#include "../software/SDL_drawline.h"
+#include "../software/SDL_drawpoint.h"
+#include "../software/SDL_triangle.h"
 
 void
 StartDrawing(SDL_Renderer *renderer){
@@ -45,6 +53,46 @@ StartDrawing(SDL_Renderer *renderer){
 	data->displayListAvail = SDL_TRUE;
 }
 
+/* Draws are clipped to the viewport, and to the clip rect if there is one */
+static void
+SetClipRect(SDL_Renderer *renderer, SDL_Surface *surface){
+	SDL_Rect clip_rect = renderer->viewport;
+
+	if (renderer->clipping_enabled) {
+		clip_rect = renderer->clip_rect;
+		clip_rect.x += renderer->viewport.x;
+		clip_rect.y += renderer->viewport.y;
+		SDL_IntersectRect(&renderer->viewport, &clip_rect, &clip_rect);
+	}
+	SDL_SetClipRect(surface, &clip_rect);
+}
+
+/* The surface draws go to: the render target, or the screen surface pointed
+   at the frame buffer being drawn */
+static SDL_Surface *
+GetRenderSurface(SDL_Renderer *renderer){
+	OPENORBIS_RenderData *data = (OPENORBIS_RenderData *) renderer->driverdata;
+	SDL_WindowData *windowData = (SDL_WindowData *)renderer->window->driverdata;
+	Scene2D *scene = windowData->scene;
+	void *pixels;
+
+	if (data->target)
+		return data->target;
+
+	StartDrawing(renderer);
+
+	pixels = scene->frameBuffers[scene->activeFrameBufferIdx];
+	if (!data->screen) {
+		data->screen = SDL_CreateRGBSurfaceWithFormatFrom(pixels, scene->width, scene->height,
+			32, scene->width * 4, SDL_PIXELFORMAT_ARGB8888);
+		if (!data->screen)
+			return NULL;
+		SetClipRect(renderer, data->screen);
+	}
+	data->screen->pixels = pixels;
+	return data->screen;
+}
+
 SDL_Renderer *
 OPENORBIS_CreateRenderer(SDL_Window *window, Uint32 flags){
 	SDL_Renderer *renderer;
@@ -66,10 +114,12 @@ OPENORBIS_CreateRenderer(SDL_Window *window, Uint32 flags){
 	renderer->WindowEvent = OPENORBIS_WindowEvent;
 	renderer->CreateTexture = OPENORBIS_CreateTexture;
 	renderer->UpdateTexture = OPENORBIS_UpdateTexture;
+	renderer->UpdateTextureYUV = OPENORBIS_UpdateTextureYUV;
 	renderer->LockTexture = OPENORBIS_LockTexture;
 	renderer->UnlockTexture = OPENORBIS_UnlockTexture;
 	renderer->SetRenderTarget = OPENORBIS_SetRenderTarget;
 	renderer->UpdateViewport = OPENORBIS_UpdateViewport;
+	renderer->UpdateClipRect = OPENORBIS_UpdateClipRect;
 	renderer->RenderClear = OPENORBIS_RenderClear;
 	renderer->RenderDrawPoints = OPENORBIS_RenderDrawPoints;
 	renderer->RenderDrawLines = OPENORBIS_RenderDrawLines;
@@ -77,6 +127,7 @@ OPENORBIS_CreateRenderer(SDL_Window *window, Uint32 flags){
 	renderer->RenderCopy = OPENORBIS_RenderCopy;
 	renderer->RenderReadPixels = OPENORBIS_RenderReadPixels;
 	renderer->RenderCopyEx = OPENORBIS_RenderCopyEx;
+	renderer->RenderGeometry = OPENORBIS_RenderGeometry;
 	renderer->RenderPresent = OPENORBIS_RenderPresent;
 	renderer->DestroyTexture = OPENORBIS_DestroyTexture;
 	renderer->DestroyRenderer = OPENORBIS_DestroyRenderer;
@@ -107,44 +158,192 @@ OPENORBIS_WindowEvent(SDL_Renderer *renderer, const SDL_WindowEvent *event){
 
 }
 
+static SDL_bool
+IsYUVFormat(Uint32 format){
+	return (format == SDL_PIXELFORMAT_YV12 || format == SDL_PIXELFORMAT_IYUV ||
+		format == SDL_PIXELFORMAT_NV12 || format == SDL_PIXELFORMAT_NV21);
+}
+
+/* YUV textures keep their planes like SDL_LockTexture() hands them out:
+   the Y plane at a pitch of the texture width, then the chroma planes.
+*/
+static int
+CreateYUVTexture(SDL_Texture *texture, OPENORBIS_TextureData *openorbis_texture){
+	const int chroma = ((texture->w + 1) / 2) * ((texture->h + 1) / 2);
+
+	openorbis_texture->yuv = (Uint8 *) SDL_malloc(texture->w * texture->h + 2 * chroma);
+	if (!openorbis_texture->yuv)
+		return SDL_OutOfMemory();
+
+	openorbis_texture->w = texture->w;
+	openorbis_texture->h = texture->h;
+	openorbis_texture->pitch = texture->w;
+	openorbis_texture->yuv_dirty = SDL_TRUE;
+	return 0;
+}
+
 static int
 OPENORBIS_CreateTexture(SDL_Renderer *renderer, SDL_Texture *texture){
 	OPENORBIS_TextureData* openorbis_texture = (OPENORBIS_TextureData *) SDL_calloc(1, sizeof(*openorbis_texture));
+	const char *hint = SDL_GetHint(SDL_HINT_RENDER_SCALE_QUALITY);
 
 	if(!openorbis_texture)
-		return -1;
+		return SDL_OutOfMemory();
+
+	/*
+	set texture filtering according to SDL_HINT_RENDER_SCALE_QUALITY
+	suported hint values are nearest (0, default) or linear (1)
+	*/
+	openorbis_texture->linear = (hint && *hint != '0' && SDL_strcasecmp(hint, "nearest") != 0);
+
+	if (IsYUVFormat(texture->format)) {
+		if (texture->access == SDL_TEXTUREACCESS_TARGET) {
+			SDL_free(openorbis_texture);
+			return SDL_SetError("YUV textures can't be render targets");
+		}
+		if (CreateYUVTexture(texture, openorbis_texture) < 0) {
+			SDL_free(openorbis_texture);
+			return -1;
+		}
+		texture->driverdata = openorbis_texture;
+		return 0;
+	}
 
 	openorbis_texture->texture = CreateEmptyTexture(texture->w, texture->h);
 
-	if(!openorbis_texture->texture->datap)
+	if(!openorbis_texture->texture || !openorbis_texture->texture->datap)
 	{
 		SDL_free(openorbis_texture);
 		return SDL_OutOfMemory();
 	}
 
-	/* 
-	set texture filtering according to SDL_HINT_RENDER_SCALE_QUALITY
-	suported hint values are nearest (0, default) or linear (1)
-	scaleMode is either SCE_GXM_TEXTURE_FILTER_POINT (good for tile-map)
-	or SCE_GXM_TEXTURE_FILTER_LINEAR (good for scaling)
-	*/
 	openorbis_texture->w = openorbis_texture->texture->width;
 	openorbis_texture->h = openorbis_texture->texture->height;
 	openorbis_texture->pitch = openorbis_texture->w *SDL_BYTESPERPIXEL(texture->format);
 
+	openorbis_texture->surface = SDL_CreateRGBSurfaceWithFormatFrom(openorbis_texture->texture->datap,
+		openorbis_texture->w, openorbis_texture->h, 32, openorbis_texture->pitch, texture->format);
+	if(!openorbis_texture->surface)
+	{
+		DestroyTexture(openorbis_texture->texture);
+		SDL_free(openorbis_texture);
+		return -1;
+	}
+
+	if (openorbis_texture->linear)
+		openorbis_texture->surface->map->info.flags |= SDL_COPY_LINEAR;
+
 	texture->driverdata = openorbis_texture;
 
 	return 0;
 }
 
+static void
+CopyPlane(Uint8 *dst, int dst_pitch, const Uint8 *src, int src_pitch, int length, int rows){
+	int row;
+
+	if (length == src_pitch && length == dst_pitch) {
+		SDL_memcpy(dst, src, length * rows);
+		return;
+	}
+	for (row = 0; row < rows; ++row) {
+		SDL_memcpy(dst, src, length);
+		src += src_pitch;
+		dst += dst_pitch;
+	}
+}
+
+/* The chroma planes of a YUV texture, in memory order */
+static void
+GetChromaPlanes(SDL_Texture *texture, OPENORBIS_TextureData *openorbis_texture,
+			Uint8 **plane1, Uint8 **plane2, int *chroma_pitch){
+	const int w = openorbis_texture->w;
+	const int h = openorbis_texture->h;
+
+	*plane1 = openorbis_texture->yuv + w * h;
+	if (texture->format == SDL_PIXELFORMAT_NV12 || texture->format == SDL_PIXELFORMAT_NV21) {
+		*plane2 = NULL;
+		*chroma_pitch = 2 * ((w + 1) / 2);
+	} else {
+		*plane2 = *plane1 + ((w + 1) / 2) * ((h + 1) / 2);
+		*chroma_pitch = (w + 1) / 2;
+	}
+}
+
+static int
+UpdateYUVTexture(SDL_Texture *texture, OPENORBIS_TextureData *openorbis_texture,
+			const SDL_Rect *rect, const Uint8 *pixels, int pitch){
+	Uint8 *plane1, *plane2;
+	int chroma_pitch;
+	const int x = rect->x / 2;
+	const int y = rect->y / 2;
+	const int w = (rect->w + 1) / 2;
+	const int h = (rect->h + 1) / 2;
+
+	GetChromaPlanes(texture, openorbis_texture, &plane1, &plane2, &chroma_pitch);
+
+	CopyPlane(openorbis_texture->yuv + rect->y * openorbis_texture->pitch + rect->x,
+		openorbis_texture->pitch, pixels, pitch, rect->w, rect->h);
+	pixels += rect->h * pitch;
+
+	if (!plane2) {
+		/* Interleaved chroma, two bytes per sample */
+		CopyPlane(plane1 + y * chroma_pitch + 2 * x, chroma_pitch,
+			pixels, 2 * ((pitch + 1) / 2), 2 * w, h);
+	} else {
+		CopyPlane(plane1 + y * chroma_pitch + x, chroma_pitch,
+			pixels, (pitch + 1) / 2, w, h);
+		pixels += h * ((pitch + 1) / 2);
+		CopyPlane(plane2 + y * chroma_pitch + x, chroma_pitch,
+			pixels, (pitch + 1) / 2, w, h);
+	}
+
+	openorbis_texture->yuv_dirty = SDL_TRUE;
+	return 0;
+}
+
+static int
+OPENORBIS_UpdateTextureYUV(SDL_Renderer *renderer, SDL_Texture *texture,
+			const SDL_Rect *rect, const Uint8 *Yplane, int Ypitch,
+			const Uint8 *Uplane, int Upitch, const Uint8 *Vplane, int Vpitch){
+	OPENORBIS_TextureData *openorbis_texture = (OPENORBIS_TextureData *) texture->driverdata;
+	Uint8 *plane1, *plane2;
+	int chroma_pitch;
+	const int x = rect->x / 2;
+	const int y = rect->y / 2;
+	const int w = (rect->w + 1) / 2;
+	const int h = (rect->h + 1) / 2;
+
+	GetChromaPlanes(texture, openorbis_texture, &plane1, &plane2, &chroma_pitch);
+
+	/* YV12 stores V before U */
+	if (texture->format == SDL_PIXELFORMAT_YV12) {
+		Uint8 *tmp = plane1;
+		plane1 = plane2;
+		plane2 = tmp;
+	}
+
+	CopyPlane(openorbis_texture->yuv + rect->y * openorbis_texture->pitch + rect->x,
+		openorbis_texture->pitch, Yplane, Ypitch, rect->w, rect->h);
+	CopyPlane(plane1 + y * chroma_pitch + x, chroma_pitch, Uplane, Upitch, w, h);
+	CopyPlane(plane2 + y * chroma_pitch + x, chroma_pitch, Vplane, Vpitch, w, h);
+
+	openorbis_texture->yuv_dirty = SDL_TRUE;
+	return 0;
+}
+
 static int
 OPENORBIS_UpdateTexture(SDL_Renderer *renderer, SDL_Texture *texture,
 				   const SDL_Rect *rect, const void *pixels, int pitch){
+	OPENORBIS_TextureData *openorbis_texture = (OPENORBIS_TextureData *) texture->driverdata;
 	const Uint8 *src;
 	Uint8 *dst;
 	int row, length,dpitch;
 	src = pixels;
 
+	if (openorbis_texture->yuv)
+		return UpdateYUVTexture(texture, openorbis_texture, rect, src, pitch);
+
 	OPENORBIS_LockTexture(renderer, texture, rect, (void **)&dst, &dpitch);
 	length = rect->w * SDL_BYTESPERPIXEL(texture->format);
 	if (length == pitch && length == dpitch) {
@@ -166,6 +365,13 @@ OPENORBIS_LockTexture(SDL_Renderer *renderer, SDL_Texture *texture,
 				 const SDL_Rect *rect, void **pixels, int *pitch){
 	OPENORBIS_TextureData *openorbis_texture = (OPENORBIS_TextureData *) texture->driverdata;
 
+	if (openorbis_texture->yuv) {
+		*pixels = (void *) (openorbis_texture->yuv + rect->y * openorbis_texture->pitch + rect->x);
+		*pitch = openorbis_texture->pitch;
+		openorbis_texture->yuv_dirty = SDL_TRUE;
+		return 0;
+	}
+
 	*pixels =
 		(void *) ((Uint8 *) openorbis_texture->texture->datap
 			+ (rect->y * openorbis_texture->w + rect->x) * SDL_BYTESPERPIXEL(texture->format));
@@ -178,16 +384,36 @@ OPENORBIS_UnlockTexture(SDL_Renderer *renderer, SDL_Texture *texture){
 
 }
 
+/* Render targets are drawn through the surface wrapping their Scene2DTexture */
 static int
 OPENORBIS_SetRenderTarget(SDL_Renderer *renderer, SDL_Texture *texture){
+	OPENORBIS_RenderData *data = (OPENORBIS_RenderData *) renderer->driverdata;
+
+	if (texture) {
+		OPENORBIS_TextureData *openorbis_texture = (OPENORBIS_TextureData *) texture->driverdata;
+		data->target = openorbis_texture->surface;
+	} else {
+		data->target = NULL;
+	}
 	return 0;
 }
 
 static int
 OPENORBIS_UpdateViewport(SDL_Renderer *renderer){
+	OPENORBIS_RenderData *data = (OPENORBIS_RenderData *) renderer->driverdata;
+	SDL_Surface *surface = data->target ? data->target : data->screen;
+
+	/* The screen surface picks the clip up when it's created */
+	if (surface)
+		SetClipRect(renderer, surface);
 	return 0;
 }
 
+static int
+OPENORBIS_UpdateClipRect(SDL_Renderer *renderer){
+	return OPENORBIS_UpdateViewport(renderer);
+}
+
 
 static void
 OPENORBIS_SetBlendMode(SDL_Renderer *renderer, int blendMode){
@@ -196,69 +422,117 @@ OPENORBIS_SetBlendMode(SDL_Renderer *renderer, int blendMode){
 
 static int
 OPENORBIS_RenderClear(SDL_Renderer *renderer){
-	SDL_WindowData *windowData = (SDL_WindowData *)renderer->window->driverdata;
-	/* start list */
-	StartDrawing(renderer);
-	if(OPENORBIS_initialized) {
-		Scene2DColor gc;
-		gc.r = renderer->r;
-		gc.g = renderer->g;
-		gc.b = renderer->b;
-		FrameBufferFill(windowData->scene, gc);
-	}
-	
+	SDL_Surface *surface = GetRenderSurface(renderer);
+	SDL_Rect clip_rect;
+	Uint32 color;
+
+	if (!surface)
+		return -1;
+
+	color = SDL_MapRGBA(surface->format, renderer->r, renderer->g, renderer->b, renderer->a);
+
+	/* By definition the clear ignores the clip rect */
+	clip_rect = surface->clip_rect;
+	SDL_SetClipRect(surface, NULL);
+	SDL_FillRect(surface, NULL, color);
+	SDL_SetClipRect(surface, &clip_rect);
 	return 0;
 }
 
+/* Points and lines go through the software renderer's primitives, which clip
+   against the surface's clip rect and blend according to the draw mode.
+*/
+static void
+GetFinalPoints(SDL_Renderer *renderer, const SDL_FPoint *points, int count, SDL_Point *final_points){
+	int i;
+
+	for (i = 0; i < count; ++i) {
+		final_points[i].x = (int)(renderer->viewport.x + points[i].x);
+		final_points[i].y = (int)(renderer->viewport.y + points[i].y);
+	}
+}
+
 static int
 OPENORBIS_RenderDrawPoints(SDL_Renderer *renderer, const SDL_FPoint *points, int count){
-	SDL_WindowData *windowData = (SDL_WindowData *)renderer->window->driverdata;
-	StartDrawing(renderer);
-		Scene2DColor gc;
-		gc.r = renderer->r;
-		gc.g = renderer->g;
-		gc.b = renderer->b;
+	SDL_Surface *surface = GetRenderSurface(renderer);
+	SDL_Point *final_points;
+	int status;
 
-	for (int i = 0; i < count; ++i) {
-		DrawPixel(windowData->scene, points[i].x, points[i].y, gc);
-	}
+	if (!surface)
+		return -1;
 
-	return 0;
+	final_points = SDL_stack_alloc(SDL_Point, count);
+	if (!final_points)
+		return SDL_OutOfMemory();
+
+	GetFinalPoints(renderer, points, count, final_points);
+
+	if (renderer->blendMode == SDL_BLENDMODE_NONE) {
+		Uint32 color = SDL_MapRGBA(surface->format, renderer->r, renderer->g, renderer->b, renderer->a);
+		status = SDL_DrawPoints(surface, final_points, count, color);
+	} else {
+		status = SDL_BlendPoints(surface, final_points, count, renderer->blendMode,
+			renderer->r, renderer->g, renderer->b, renderer->a);
+	}
+	SDL_stack_free(final_points);
+	return status;
 }
 
 static int
 OPENORBIS_RenderDrawLines(SDL_Renderer *renderer, const SDL_FPoint *points, int count){
-	SDL_WindowData *windowData = (SDL_WindowData *)renderer->window->driverdata;
-	StartDrawing(renderer);
-	Scene2DColor gc;
-	gc.r = renderer->r;
-	gc.g = renderer->g;
-	gc.b = renderer->b;
-
-	for (int i = 0; i < count; ++i) {
-		if (i < count -1) {
-			DrawLine(windowData->scene, points[i].x, points[i].y, points[i+1].x, points[i+1].y, gc);
-		}
-	}
+	SDL_Surface *surface = GetRenderSurface(renderer);
+	SDL_Point *final_points;
+	int status;
 
-	return 0;
+	if (!surface)
+		return -1;
+
+	final_points = SDL_stack_alloc(SDL_Point, count);
+	if (!final_points)
+		return SDL_OutOfMemory();
+
+	GetFinalPoints(renderer, points, count, final_points);
+
+	if (renderer->blendMode == SDL_BLENDMODE_NONE) {
+		Uint32 color = SDL_MapRGBA(surface->format, renderer->r, renderer->g, renderer->b, renderer->a);
+		status = SDL_DrawLines(surface, final_points, count, color);
+	} else {
+		status = SDL_BlendLines(surface, final_points, count, renderer->blendMode,
+			renderer->r, renderer->g, renderer->b, renderer->a);
+	}
+	SDL_stack_free(final_points);
+	return status;
 }
 
 static int
 OPENORBIS_RenderFillRects(SDL_Renderer *renderer, const SDL_FRect *rects, int count){
-	SDL_WindowData *windowData = (SDL_WindowData *)renderer->window->driverdata;
-	StartDrawing(renderer);
-	Scene2DColor gc;
-	gc.r = renderer->r;
-	gc.g = renderer->g;
-	gc.b = renderer->b;
-
-	for (int i = 0; i < count; ++i) {
-		const SDL_FRect *rect = &rects[i];
-		DrawRectangle(windowData->scene, rect->x, rect->w, rect->y, rect->h, gc);
+	SDL_Surface *surface = GetRenderSurface(renderer);
+	SDL_Rect *final_rects;
+	int i, status;
+
+	if (!surface)
+		return -1;
+
+	final_rects = SDL_stack_alloc(SDL_Rect, count);
+	if (!final_rects)
+		return SDL_OutOfMemory();
+
+	for (i = 0; i < count; ++i) {
+		final_rects[i].x = (int)(renderer->viewport.x + rects[i].x);
+		final_rects[i].y = (int)(renderer->viewport.y + rects[i].y);
+		final_rects[i].w = SDL_max((int)rects[i].w, 1);
+		final_rects[i].h = SDL_max((int)rects[i].h, 1);
 	}
 
-	return 0;
+	if (renderer->blendMode == SDL_BLENDMODE_NONE) {
+		Uint32 color = SDL_MapRGBA(surface->format, renderer->r, renderer->g, renderer->b, renderer->a);
+		status = SDL_FillRects(surface, final_rects, count, color);
+	} else {
+		status = SDL_BlendFillRects(surface, final_rects, count, renderer->blendMode,
+			renderer->r, renderer->g, renderer->b, renderer->a);
+	}
+	SDL_stack_free(final_rects);
+	return status;
 }
 
 
@@ -282,29 +556,103 @@ void Swap(float *a, float *b){
 	*b = n;
 }
 
+/* Bring the RGB copy of a YUV texture up to date, for copies that need
+   blending or filtering.
+*/
+static SDL_Surface *
+GetYUVSurface(SDL_Texture *texture, OPENORBIS_TextureData *openorbis_texture){
+	if (!openorbis_texture->surface) {
+		openorbis_texture->surface = SDL_CreateRGBSurfaceWithFormat(0,
+			openorbis_texture->w, openorbis_texture->h, 32, SDL_PIXELFORMAT_ARGB8888);
+		if (!openorbis_texture->surface)
+			return NULL;
+		if (openorbis_texture->linear)
+			openorbis_texture->surface->map->info.flags |= SDL_COPY_LINEAR;
+		openorbis_texture->yuv_dirty = SDL_TRUE;
+	}
+	if (openorbis_texture->yuv_dirty) {
+		if (SDL_ConvertPixels(openorbis_texture->w, openorbis_texture->h, texture->format,
+			openorbis_texture->yuv, openorbis_texture->pitch, SDL_PIXELFORMAT_ARGB8888,
+			openorbis_texture->surface->pixels, openorbis_texture->surface->pitch) < 0)
+			return NULL;
+		openorbis_texture->yuv_dirty = SDL_FALSE;
+	}
+	return openorbis_texture->surface;
+}
+
 static int
 OPENORBIS_RenderCopy(SDL_Renderer *renderer, SDL_Texture *texture,
 				const SDL_Rect *srcrect, const SDL_FRect *dstrect){
 	OPENORBIS_TextureData *openorbis_texture = (OPENORBIS_TextureData *) texture->driverdata;
-	float scaleX = dstrect->w == srcrect->w ? 1 : (float)(dstrect->w/srcrect->w);
-	float scaleY = dstrect->h == srcrect->h ? 1 : (float)(dstrect->h/srcrect->h);
-
-	StartDrawing(renderer);
+	SDL_Surface *src = openorbis_texture->surface;
+	SDL_Surface *screen;
+	SDL_Rect src_rect = *srcrect;
+	SDL_Rect final_rect;
 
 	OPENORBIS_SetBlendMode(renderer, renderer->blendMode);
 
-	//float scaleX = dstrect->w > srcrect->w ? (float)(dstrect->w/srcrect->w) : 1;
-	//float scaleY = dstrect->h > srcrect->h ? (float)(dstrect->h/srcrect->h) : 1;
-	//orbis2dDrawTexturePartScale(openorbis_texture->tex, dstrect->x, dstrect->y,srcrect->x, srcrect->y, srcrect->w, srcrect->h, scaleX, scaleY);
+	screen = GetRenderSurface(renderer);
+	if (!screen)
+		return -1;
 
-	return 0;
+	final_rect.x = (int)(renderer->viewport.x + dstrect->x);
+	final_rect.y = (int)(renderer->viewport.y + dstrect->y);
+	final_rect.w = (int)dstrect->w;
+	final_rect.h = (int)dstrect->h;
+
+	if (openorbis_texture->yuv) {
+		const SDL_bool scaled = (src_rect.w != final_rect.w || src_rect.h != final_rect.h);
+
+		SDL_Rect clipped;
+
+		/* Opaque video is converted straight into the frame buffer, in one pass,
+		   when it isn't clipped */
+		if ((texture->r & texture->g & texture->b & texture->a) == 255 &&
+			(texture->blendMode == SDL_BLENDMODE_NONE || texture->blendMode == SDL_BLENDMODE_BLEND) &&
+			!(scaled && openorbis_texture->linear) &&
+			SDL_IntersectRect(&final_rect, &screen->clip_rect, &clipped) &&
+			SDL_RectEquals(&clipped, &final_rect)) {
+			return SDL_ConvertPixels_YUV_to_RGB_Scaled(openorbis_texture->w, openorbis_texture->h,
+				texture->format, openorbis_texture->yuv, openorbis_texture->pitch, &src_rect,
+				SDL_PIXELFORMAT_ARGB8888,
+				(Uint8 *) screen->pixels + final_rect.y * screen->pitch + final_rect.x * 4,
+				screen->pitch, final_rect.w, final_rect.h);
+		}
+
+		src = GetYUVSurface(texture, openorbis_texture);
+		if (!src)
+			return -1;
+	}
+
+	SDL_SetSurfaceColorMod(src, texture->r, texture->g, texture->b);
+	SDL_SetSurfaceAlphaMod(src, texture->a);
+	SDL_SetSurfaceBlendMode(src, texture->blendMode);
+
+	/* Scaled copies are filtered according to the texture's scale quality */
+	if (src_rect.w == final_rect.w && src_rect.h == final_rect.h)
+		return SDL_BlitSurface(src, &src_rect, screen, &final_rect);
+	return SDL_BlitScaled(src, &src_rect, screen, &final_rect);
 }
 
 static int
 OPENORBIS_RenderReadPixels(SDL_Renderer *renderer, const SDL_Rect *rect,
 					Uint32 pixel_format, void *pixels, int pitch)
 {
-		return 0;
+	SDL_Surface *surface = GetRenderSurface(renderer);
+	const Uint8 *src;
+
+	if (!surface)
+		return -1;
+
+	/* The rect is already offset into the viewport by SDL_RenderReadPixels() */
+	if (rect->x < 0 || rect->x + rect->w > surface->w ||
+		rect->y < 0 || rect->y + rect->h > surface->h)
+		return SDL_SetError("Tried to read outside of surface bounds");
+
+	src = (const Uint8 *) surface->pixels + rect->y * surface->pitch +
+		rect->x * surface->format->BytesPerPixel;
+	return SDL_ConvertPixels(rect->w, rect->h, surface->format->format, src, surface->pitch,
+		pixel_format, pixels, pitch);
 }
 
 
@@ -312,7 +660,70 @@ static int
 OPENORBIS_RenderCopyEx(SDL_Renderer *renderer, SDL_Texture *texture,
 				const SDL_Rect *srcrect, const SDL_FRect *dstrect,
 				const double angle, const SDL_FPoint *center, const SDL_RendererFlip flip){
-	return 1;
+	OPENORBIS_TextureData *openorbis_texture = (OPENORBIS_TextureData *) texture->driverdata;
+	SDL_Surface *src = openorbis_texture->surface;
+	SDL_Surface *screen;
+	SDL_FRect final_rect;
+
+	screen = GetRenderSurface(renderer);
+	if (!screen)
+		return -1;
+
+	if (openorbis_texture->yuv) {
+		src = GetYUVSurface(texture, openorbis_texture);
+		if (!src)
+			return -1;
+	}
+
+	SDL_SetSurfaceColorMod(src, texture->r, texture->g, texture->b);
+	SDL_SetSurfaceAlphaMod(src, texture->a);
+	SDL_SetSurfaceBlendMode(src, texture->blendMode);
+
+	final_rect.x = renderer->viewport.x + dstrect->x;
+	final_rect.y = renderer->viewport.y + dstrect->y;
+	final_rect.w = dstrect->w;
+	final_rect.h = dstrect->h;
+
+	/* Rotated and flipped copies go straight into the frame buffer or target */
+	return SDL_SW_RenderCopyEx(screen, src, srcrect, &final_rect, angle, center, flip);
+}
+
+/* Triangles are rasterized straight into the frame buffer or target */
+static int
+OPENORBIS_RenderGeometry(SDL_Renderer *renderer, SDL_Texture *texture,
+				const SDL_Vertex *vertices, int num_vertices,
+				const int *indices, int num_indices, const SDL_FPoint *scale){
+	SDL_Surface *src = NULL;
+	SDL_Surface *screen;
+	SDL_BlendMode blendMode = renderer->blendMode;
+	SDL_Color mod = { 0xFF, 0xFF, 0xFF, 0xFF };
+	SDL_Point offset;
+
+	screen = GetRenderSurface(renderer);
+	if (!screen)
+		return -1;
+
+	if (texture) {
+		OPENORBIS_TextureData *openorbis_texture = (OPENORBIS_TextureData *) texture->driverdata;
+
+		src = openorbis_texture->surface;
+		if (openorbis_texture->yuv) {
+			src = GetYUVSurface(texture, openorbis_texture);
+			if (!src)
+				return -1;
+		}
+		blendMode = texture->blendMode;
+		mod.r = texture->r;
+		mod.g = texture->g;
+		mod.b = texture->b;
+		mod.a = texture->a;
+	}
+
+	offset.x = renderer->viewport.x;
+	offset.y = renderer->viewport.y;
+
+	return SDL_SW_RenderGeometry(screen, src, blendMode, &mod, vertices, indices,
+		indices ? num_indices : num_vertices, &offset, scale);
 }
 
 static void
@@ -344,7 +755,10 @@ OPENORBIS_DestroyTexture(SDL_Renderer *renderer, SDL_Texture *texture){
 	if(openorbis_texture == 0)
 		return;
 
-	DestroyTexture(openorbis_texture->texture);
+	SDL_FreeSurface(openorbis_texture->surface);
+	if (openorbis_texture->texture)
+		DestroyTexture(openorbis_texture->texture);
+	SDL_free(openorbis_texture->yuv);
 	SDL_free(openorbis_texture);
 	texture->driverdata = NULL;
 }
@@ -360,6 +774,7 @@ OPENORBIS_DestroyRenderer(SDL_Renderer *renderer){
 
 		data->initialized = SDL_FALSE;
 		data->displayListAvail = SDL_FALSE;
+		SDL_FreeSurface(data->screen);
 		SDL_free(data);
 	}
 	SDL_free(renderer);
@@ -370,12 +785,17 @@ SDL_RenderDriver OPENORBIS_RenderDriver = {
 	.info = {
 		.name = "ORBIS",
 		.flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC,
-		.num_texture_formats = 1,
+		.num_texture_formats = 5,
 		.texture_formats = {
 		[0] = SDL_PIXELFORMAT_ARGB8888,
+		[1] = SDL_PIXELFORMAT_YV12,
+		[2] = SDL_PIXELFORMAT_IYUV,
+		[3] = SDL_PIXELFORMAT_NV12,
+		[4] = SDL_PIXELFORMAT_NV21,
 		},
-		.max_texture_width = 1280,
-		.max_texture_height = 720,
+		/* textures live in system memory, 4K video still fits */
+		.max_texture_width = 4096,
+		.max_texture_height = 4096,
 	 }
 };
 #endif /* SDL_VIDEO_RENDER_OPENORBIS */
@@ -38,11 +38,17 @@ typedef struct{
 	SDL_bool	vsync;
 	unsigned int	currentColor;
 	int		 currentBlendMode;
+	SDL_Surface	*screen;	/* the active frame buffer, for blits */
+	SDL_Surface	*target;	/* the render target's surface, NULL for the screen */
 } OPENORBIS_RenderData;
 
 
 typedef struct{
 	Scene2DTexture *texture;
+	SDL_Surface	*surface;	/* wraps texture->datap, or the converted YUV planes */
+	Uint8		*yuv;		/* Y plane followed by the chroma planes */
+	SDL_bool	yuv_dirty;	/* surface is older than the YUV planes */
+	SDL_bool	linear;
 	unsigned int	pitch;
 	unsigned int	w;
 	unsigned int	h;
@@ -56,6 +62,9 @@ static void OPENORBIS_WindowEvent(SDL_Renderer *renderer, const SDL_WindowEvent
 static int OPENORBIS_CreateTexture(SDL_Renderer *renderer, SDL_Texture *texture);
 static int OPENORBIS_UpdateTexture(SDL_Renderer *renderer, SDL_Texture *texture,
 	const SDL_Rect *rect, const void *pixels, int pitch);
+static int OPENORBIS_UpdateTextureYUV(SDL_Renderer *renderer, SDL_Texture *texture,
+	const SDL_Rect *rect, const Uint8 *Yplane, int Ypitch,
+	const Uint8 *Uplane, int Upitch, const Uint8 *Vplane, int Vpitch);
 static int OPENORBIS_LockTexture(SDL_Renderer *renderer, SDL_Texture *texture,
 	const SDL_Rect *rect, void **pixels, int *pitch);
 static void OPENORBIS_UnlockTexture(SDL_Renderer *renderer,
@@ -63,6 +72,7 @@ static void OPENORBIS_UnlockTexture(SDL_Renderer *renderer,
 static int OPENORBIS_SetRenderTarget(SDL_Renderer *renderer,
 		 SDL_Texture *texture);
 static int OPENORBIS_UpdateViewport(SDL_Renderer *renderer);
+static int OPENORBIS_UpdateClipRect(SDL_Renderer *renderer);
 static int OPENORBIS_RenderClear(SDL_Renderer *renderer);
 static int OPENORBIS_RenderDrawPoints(SDL_Renderer *renderer,
 		const SDL_FPoint *points, int count);
@@ -77,6 +87,9 @@ static int OPENORBIS_RenderReadPixels(SDL_Renderer *renderer, const SDL_Rect *re
 static int OPENORBIS_RenderCopyEx(SDL_Renderer *renderer, SDL_Texture *texture,
 	const SDL_Rect *srcrect, const SDL_FRect *dstrect,
 	const double angle, const SDL_FPoint *center, const SDL_RendererFlip flip);
+static int OPENORBIS_RenderGeometry(SDL_Renderer *renderer, SDL_Texture *texture,
+	const SDL_Vertex *vertices, int num_vertices,
+	const int *indices, int num_indices, const SDL_FPoint *scale);
 static void OPENORBIS_RenderPresent(SDL_Renderer *renderer);
 static void OPENORBIS_DestroyTexture(SDL_Renderer *renderer, SDL_Texture *texture);
 static void OPENORBIS_DestroyRenderer(SDL_Renderer *renderer);
@@ -0,0 +1,1026 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2018 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../../SDL_internal.h"
+
+#if !SDL_RENDER_DISABLED
+
+#include "SDL_cpuinfo.h"
+#include "SDL_draw.h"
+#include "SDL_triangle.h"
+#include "../../video/SDL_blit.h"
+
+/* Triangle rasterizer for the software renderers.
+
+   Vertex positions are snapped to 1/16 of a pixel and each edge becomes a
+   64-bit half-space function. For every row the three half-space tests are
+   solved for x, which gives exactly the pixels whose centers are inside the
+   triangle (with the usual top-left rule for pixels on an edge), so the span
+   itself needs no coverage tests. Colors and texel coordinates are planar
+   functions of x and y, evaluated per pixel from the start of the span, and
+   spans are shaded and blended four pixels at a time when SSE2 is available.
+   Textures with linear scale quality are filtered bilinearly, with 8-bit
+   weights, the same way in the scalar and SSE2 code.
+*/
+
+/* Subpixel precision of vertex positions */
+#define SUBPIXEL_BITS   4
+#define SUBPIXEL_ONE    (1 << SUBPIXEL_BITS)
+
+/* Positions are clamped to this many subpixels, about a million pixels */
+#define MAX_COORDINATE  (float) (1 << 24)
+
+/* Triangles, and the quads of SDL_SW_RenderCopyEx() */
+#define MAX_POLYGON_VERTICES    4
+
+enum
+{
+    ATTRIB_R,
+    ATTRIB_G,
+    ATTRIB_B,
+    ATTRIB_A,
+    ATTRIB_U,
+    ATTRIB_V,
+    NUM_ATTRIBS
+};
+
+typedef struct
+{
+    Sint64 x, y;                    /* position, in subpixels */
+    float attribs[NUM_ATTRIBS];     /* color (0-255) and texel coordinates */
+} TriangleVertex;
+
+typedef struct
+{
+    SDL_Surface *dst;
+    SDL_Surface *texture;           /* NULL for untextured triangles */
+    SDL_BlendMode blendMode;
+    SDL_bool dst_fast;              /* 32-bit pixels with 8-bit channels */
+    SDL_bool tex_fast;
+    SDL_bool smooth;                /* bilinear filtering */
+    SDL_bool simd;                  /* spans go through DrawSpan_SSE2() */
+    int dst_shift[4];               /* R, G, B and A shifts, -1 without alpha */
+    int tex_shift[4];               /* texels in other formats are read as ARGB */
+    float tex_maxu, tex_maxv;       /* the last texel in each direction */
+} TriangleContext;
+
+/* Find out whether pixels are 32-bit with 8-bit channels, and where those are */
+static SDL_bool
+GetChannelShifts(const SDL_PixelFormat * format, int shift[4])
+{
+    if (format->BytesPerPixel != 4 || format->palette ||
+        format->Rmask != (0xFFu << format->Rshift) ||
+        format->Gmask != (0xFFu << format->Gshift) ||
+        format->Bmask != (0xFFu << format->Bshift) ||
+        (format->Amask && format->Amask != (0xFFu << format->Ashift))) {
+        return SDL_FALSE;
+    }
+    shift[0] = format->Rshift;
+    shift[1] = format->Gshift;
+    shift[2] = format->Bshift;
+    shift[3] = format->Amask ? format->Ashift : -1;
+    return SDL_TRUE;
+}
+
+static Uint32
+ReadPixel(const Uint8 * pixel, int bpp)
+{
+    switch (bpp) {
+    case 1:
+        return *pixel;
+    case 2:
+        return *(const Uint16 *) pixel;
+    case 3:
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+        return pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);
+#else
+        return (pixel[0] << 16) | (pixel[1] << 8) | pixel[2];
+#endif
+    default:
+        return *(const Uint32 *) pixel;
+    }
+}
+
+static void
+WritePixel(Uint8 * pixel, int bpp, Uint32 value)
+{
+    switch (bpp) {
+    case 1:
+        *pixel = (Uint8) value;
+        break;
+    case 2:
+        *(Uint16 *) pixel = (Uint16) value;
+        break;
+    case 3:
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+        pixel[0] = (Uint8) value;
+        pixel[1] = (Uint8) (value >> 8);
+        pixel[2] = (Uint8) (value >> 16);
+#else
+        pixel[0] = (Uint8) (value >> 16);
+        pixel[1] = (Uint8) (value >> 8);
+        pixel[2] = (Uint8) value;
+#endif
+        break;
+    default:
+        *(Uint32 *) pixel = value;
+        break;
+    }
+}
+
+/* These match the SSE2 min/max and truncation below, NaN included */
+static SDL_INLINE unsigned
+ToColor(float value)
+{
+    value += 0.5f;
+    value = (value > 0.0f) ? value : 0.0f;
+    value = (value < 255.0f) ? value : 255.0f;
+    return (unsigned) value;
+}
+
+static SDL_INLINE int
+ToTexel(float value, float max)
+{
+    value = (value > 0.0f) ? value : 0.0f;
+    value = (value < max) ? value : max;
+    return (int) value;
+}
+
+/* The first of the two texels to filter between, the second, and the weight
+   of the second in 1/256 */
+static SDL_INLINE void
+ToLinearTexel(float value, float max, int *texel, int *next, int *weight)
+{
+    value -= 0.5f;
+    value = (value > 0.0f) ? value : 0.0f;
+    value = (value < max) ? value : max;
+    *texel = (int) value;
+    *next = *texel + (*texel < (int) max);
+    *weight = (int) ((value - (float) *texel) * 256.0f);
+}
+
+static SDL_INLINE Uint32
+FetchTexel(const TriangleContext * ctx, int x, int y)
+{
+    const SDL_Surface *texture = ctx->texture;
+    const int bpp = texture->format->BytesPerPixel;
+    const Uint8 *texel = (const Uint8 *) texture->pixels + y * texture->pitch + x * bpp;
+    Uint8 r, g, b, a;
+
+    if (ctx->tex_fast) {
+        return *(const Uint32 *) texel;
+    }
+    SDL_GetRGBA(ReadPixel(texel, bpp), texture->format, &r, &g, &b, &a);
+    return ((Uint32) a << 24) | ((Uint32) r << 16) | ((Uint32) g << 8) | b;
+}
+
+/* Mix each 8-bit channel of two texels, weight is that of b in 1/256 */
+static SDL_INLINE Uint32
+LerpTexels(Uint32 a, Uint32 b, int weight)
+{
+    const Uint32 inv = 256 - weight;
+    const Uint32 even = ((a & 0x00FF00FF) * inv + (b & 0x00FF00FF) * weight) >> 8;
+    const Uint32 odd = ((a >> 8) & 0x00FF00FF) * inv + ((b >> 8) & 0x00FF00FF) * weight;
+    return (even & 0x00FF00FF) | (odd & 0xFF00FF00);
+}
+
+/* Combine a source color with the destination, the way SDL_draw.h does */
+static SDL_INLINE void
+BlendColor(SDL_BlendMode blendMode, unsigned sr, unsigned sg, unsigned sb, unsigned sa,
+           unsigned *dr, unsigned *dg, unsigned *db, unsigned *da)
+{
+    switch (blendMode) {
+    case SDL_BLENDMODE_BLEND:{
+            const unsigned inva = 0xFF - sa;
+            *dr = DRAW_MUL(inva, *dr) + DRAW_MUL(sr, sa);
+            *dg = DRAW_MUL(inva, *dg) + DRAW_MUL(sg, sa);
+            *db = DRAW_MUL(inva, *db) + DRAW_MUL(sb, sa);
+            *da = DRAW_MUL(inva, *da) + sa;
+            break;
+        }
+    case SDL_BLENDMODE_ADD:
+        *dr = SDL_min(*dr + DRAW_MUL(sr, sa), 0xFF);
+        *dg = SDL_min(*dg + DRAW_MUL(sg, sa), 0xFF);
+        *db = SDL_min(*db + DRAW_MUL(sb, sa), 0xFF);
+        break;
+    case SDL_BLENDMODE_MOD:
+        *dr = DRAW_MUL(*dr, sr);
+        *dg = DRAW_MUL(*dg, sg);
+        *db = DRAW_MUL(*db, sb);
+        break;
+    default:
+        *dr = sr;
+        *dg = sg;
+        *db = sb;
+        *da = sa;
+        break;
+    }
+}
+
+/* Shade a span of pixels one at a time */
+static void
+DrawSpan(const TriangleContext * ctx, Uint8 * pixels, int count,
+         const float *start, const float *step)
+{
+    const SDL_Surface *dst = ctx->dst;
+    const SDL_Surface *texture = ctx->texture;
+    const int bpp = dst->format->BytesPerPixel;
+    int i;
+
+    for (i = 0; i < count; ++i) {
+        const float fi = (float) i;
+        Uint8 *pixel = pixels + i * bpp;
+        unsigned sr = ToColor(start[ATTRIB_R] + fi * step[ATTRIB_R]);
+        unsigned sg = ToColor(start[ATTRIB_G] + fi * step[ATTRIB_G]);
+        unsigned sb = ToColor(start[ATTRIB_B] + fi * step[ATTRIB_B]);
+        unsigned sa = ToColor(start[ATTRIB_A] + fi * step[ATTRIB_A]);
+        unsigned dr, dg, db, da;
+
+        if (texture) {
+            const float u = start[ATTRIB_U] + fi * step[ATTRIB_U];
+            const float v = start[ATTRIB_V] + fi * step[ATTRIB_V];
+            Uint32 value;
+            unsigned tr, tg, tb, ta;
+
+            if (ctx->smooth) {
+                int x0, x1, y0, y1, wx, wy;
+                ToLinearTexel(u, ctx->tex_maxu, &x0, &x1, &wx);
+                ToLinearTexel(v, ctx->tex_maxv, &y0, &y1, &wy);
+                value = LerpTexels(LerpTexels(FetchTexel(ctx, x0, y0), FetchTexel(ctx, x1, y0), wx),
+                                   LerpTexels(FetchTexel(ctx, x0, y1), FetchTexel(ctx, x1, y1), wx),
+                                   wy);
+            } else {
+                value = FetchTexel(ctx, ToTexel(u, ctx->tex_maxu), ToTexel(v, ctx->tex_maxv));
+            }
+            tr = (value >> ctx->tex_shift[0]) & 0xFF;
+            tg = (value >> ctx->tex_shift[1]) & 0xFF;
+            tb = (value >> ctx->tex_shift[2]) & 0xFF;
+            ta = (ctx->tex_shift[3] >= 0) ? ((value >> ctx->tex_shift[3]) & 0xFF) : 0xFF;
+            sr = DRAW_MUL(tr, sr);
+            sg = DRAW_MUL(tg, sg);
+            sb = DRAW_MUL(tb, sb);
+            sa = DRAW_MUL(ta, sa);
+        }
+
+        if (ctx->dst_fast) {
+            const Uint32 value = *(const Uint32 *) pixel;
+            dr = (value >> ctx->dst_shift[0]) & 0xFF;
+            dg = (value >> ctx->dst_shift[1]) & 0xFF;
+            db = (value >> ctx->dst_shift[2]) & 0xFF;
+            da = (ctx->dst_shift[3] >= 0) ? ((value >> ctx->dst_shift[3]) & 0xFF) : 0xFF;
+        } else {
+            Uint8 r, g, b, a;
+            SDL_GetRGBA(ReadPixel(pixel, bpp), dst->format, &r, &g, &b, &a);
+            dr = r;
+            dg = g;
+            db = b;
+            da = a;
+        }
+
+        BlendColor(ctx->blendMode, sr, sg, sb, sa, &dr, &dg, &db, &da);
+
+        if (ctx->dst_fast) {
+            Uint32 value = (dr << ctx->dst_shift[0]) | (dg << ctx->dst_shift[1]) |
+                           (db << ctx->dst_shift[2]);
+            if (ctx->dst_shift[3] >= 0) {
+                value |= da << ctx->dst_shift[3];
+            }
+            *(Uint32 *) pixel = value;
+        } else {
+            WritePixel(pixel, bpp, SDL_MapRGBA(dst->format, (Uint8) dr, (Uint8) dg,
+                                               (Uint8) db, (Uint8) da));
+        }
+    }
+}
+
+#ifdef __SSE2__
+static SDL_INLINE __m128i
+ToColor_SSE2(__m128 value)
+{
+    value = _mm_add_ps(value, _mm_set1_ps(0.5f));
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+    return _mm_cvttps_epi32(value);
+}
+
+static SDL_INLINE __m128i
+ToTexel_SSE2(__m128 value, __m128 max)
+{
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), max);
+    return _mm_cvttps_epi32(value);
+}
+
+/* ToLinearTexel() of four values */
+static SDL_INLINE void
+ToLinearTexel_SSE2(__m128 value, __m128 max, __m128i last,
+                   __m128i *texel, __m128i *next, __m128i *weight)
+{
+    value = _mm_sub_ps(value, _mm_set1_ps(0.5f));
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), max);
+    *texel = _mm_cvttps_epi32(value);
+    *next = _mm_sub_epi32(*texel, _mm_cmplt_epi32(*texel, last));
+    *weight = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(value, _mm_cvtepi32_ps(*texel)),
+                                          _mm_set1_ps(256.0f)));
+}
+
+/* There's no gather in SSE2 */
+static SDL_INLINE __m128i
+FetchTexels_SSE2(const Uint8 * texels, int pitch, __m128i x, __m128i y)
+{
+    return _mm_setr_epi32(
+        *(const Sint32 *) (texels + _mm_cvtsi128_si32(y) * pitch +
+                           _mm_cvtsi128_si32(x) * 4),
+        *(const Sint32 *) (texels + _mm_cvtsi128_si32(_mm_srli_si128(y, 4)) * pitch +
+                           _mm_cvtsi128_si32(_mm_srli_si128(x, 4)) * 4),
+        *(const Sint32 *) (texels + _mm_cvtsi128_si32(_mm_srli_si128(y, 8)) * pitch +
+                           _mm_cvtsi128_si32(_mm_srli_si128(x, 8)) * 4),
+        *(const Sint32 *) (texels + _mm_cvtsi128_si32(_mm_srli_si128(y, 12)) * pitch +
+                           _mm_cvtsi128_si32(_mm_srli_si128(x, 12)) * 4));
+}
+
+/* LerpTexels() of four pairs, with the channels widened to 16 bits */
+static SDL_INLINE __m128i
+LerpTexels_SSE2(__m128i a, __m128i b, __m128i weight)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i even = _mm_shufflehi_epi16(_mm_shufflelo_epi16(weight, _MM_SHUFFLE(0, 0, 0, 0)),
+                                             _MM_SHUFFLE(0, 0, 0, 0));
+    const __m128i odd = _mm_shufflehi_epi16(_mm_shufflelo_epi16(weight, _MM_SHUFFLE(2, 2, 2, 2)),
+                                            _MM_SHUFFLE(2, 2, 2, 2));
+    const __m128i wlo = _mm_unpacklo_epi64(even, odd);     /* pixels 0 and 1 */
+    const __m128i whi = _mm_unpackhi_epi64(even, odd);     /* pixels 2 and 3 */
+    const __m128i full = _mm_set1_epi16(256);
+    const __m128i lo = _mm_srli_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(full, wlo)),
+                      _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wlo)), 8);
+    const __m128i hi = _mm_srli_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(full, whi)),
+                      _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), whi)), 8);
+    return _mm_packus_epi16(lo, hi);
+}
+
+/* DRAW_MUL() of 32-bit lanes holding values up to 255 */
+static SDL_INLINE __m128i
+Mul255_SSE2(__m128i a, __m128i b)
+{
+    const __m128i x = _mm_mullo_epi16(a, b);
+    return _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(x, _mm_srli_epi32(x, 8)),
+                                        _mm_set1_epi32(1)), 8);
+}
+
+/* Shade a span of 32-bit pixels four at a time. The last few pixels of the
+   span go through a scratch group, so that nothing past it is touched. */
+static void
+DrawSpan_SSE2(const TriangleContext * ctx, Uint32 * pixels, int count,
+              const float *start, const float *step, SDL_bool tinted)
+{
+    /* Load everything up front, the pixel stores could alias it all */
+    const Uint8 *texels = ctx->texture ? (const Uint8 *) ctx->texture->pixels : NULL;
+    const int tex_pitch = ctx->texture ? ctx->texture->pitch : 0;
+    const int tex_ashift = ctx->tex_shift[3];
+    const int dst_ashift = ctx->dst_shift[3];
+    const SDL_BlendMode blendMode = ctx->blendMode;
+    const __m128 maxu = _mm_set1_ps(ctx->tex_maxu);
+    const __m128 maxv = _mm_set1_ps(ctx->tex_maxv);
+    const __m128i lastu = _mm_set1_epi32((int) ctx->tex_maxu);
+    const __m128i lastv = _mm_set1_epi32((int) ctx->tex_maxv);
+    const SDL_bool smooth = ctx->smooth;
+    const __m128i tex_r = _mm_cvtsi32_si128(ctx->tex_shift[0]);
+    const __m128i tex_g = _mm_cvtsi32_si128(ctx->tex_shift[1]);
+    const __m128i tex_b = _mm_cvtsi32_si128(ctx->tex_shift[2]);
+    const __m128i tex_a = _mm_cvtsi32_si128(tex_ashift);
+    const __m128i dst_r = _mm_cvtsi32_si128(ctx->dst_shift[0]);
+    const __m128i dst_g = _mm_cvtsi32_si128(ctx->dst_shift[1]);
+    const __m128i dst_b = _mm_cvtsi32_si128(ctx->dst_shift[2]);
+    const __m128i dst_a = _mm_cvtsi32_si128(dst_ashift);
+    const __m128i ff = _mm_set1_epi32(0xFF);
+    __m128 s[NUM_ATTRIBS], d[NUM_ATTRIBS];
+    __m128 fi = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 four = _mm_set1_ps(4.0f);
+    Uint32 scratch[4] = { 0, 0, 0, 0 };
+    int i, j;
+
+    for (i = 0; i < NUM_ATTRIBS; ++i) {
+        s[i] = _mm_set1_ps(start[i]);
+        d[i] = _mm_set1_ps(step[i]);
+    }
+
+    for (i = 0; i < count; i += 4, fi = _mm_add_ps(fi, four)) {
+        Uint32 *group = pixels + i;
+        __m128i r = ff, g = ff, b = ff, a = ff;
+        __m128i p, dr, dg, db, da, out;
+
+        if (count - i < 4) {
+            for (j = 0; j < count - i; ++j) {
+                scratch[j] = group[j];
+            }
+            group = scratch;
+        }
+
+        if (tinted) {
+            r = ToColor_SSE2(_mm_add_ps(s[ATTRIB_R], _mm_mul_ps(fi, d[ATTRIB_R])));
+            g = ToColor_SSE2(_mm_add_ps(s[ATTRIB_G], _mm_mul_ps(fi, d[ATTRIB_G])));
+            b = ToColor_SSE2(_mm_add_ps(s[ATTRIB_B], _mm_mul_ps(fi, d[ATTRIB_B])));
+            a = ToColor_SSE2(_mm_add_ps(s[ATTRIB_A], _mm_mul_ps(fi, d[ATTRIB_A])));
+        }
+
+        if (texels) {
+            const __m128 u = _mm_add_ps(s[ATTRIB_U], _mm_mul_ps(fi, d[ATTRIB_U]));
+            const __m128 v = _mm_add_ps(s[ATTRIB_V], _mm_mul_ps(fi, d[ATTRIB_V]));
+            __m128i t;
+
+            if (smooth) {
+                __m128i x0, x1, y0, y1, wx, wy;
+                ToLinearTexel_SSE2(u, maxu, lastu, &x0, &x1, &wx);
+                ToLinearTexel_SSE2(v, maxv, lastv, &y0, &y1, &wy);
+                t = LerpTexels_SSE2(LerpTexels_SSE2(FetchTexels_SSE2(texels, tex_pitch, x0, y0),
+                                                    FetchTexels_SSE2(texels, tex_pitch, x1, y0), wx),
+                                    LerpTexels_SSE2(FetchTexels_SSE2(texels, tex_pitch, x0, y1),
+                                                    FetchTexels_SSE2(texels, tex_pitch, x1, y1), wx),
+                                    wy);
+            } else {
+                t = FetchTexels_SSE2(texels, tex_pitch,
+                                     ToTexel_SSE2(u, maxu), ToTexel_SSE2(v, maxv));
+            }
+
+            if (tinted) {
+                r = Mul255_SSE2(_mm_and_si128(_mm_srl_epi32(t, tex_r), ff), r);
+                g = Mul255_SSE2(_mm_and_si128(_mm_srl_epi32(t, tex_g), ff), g);
+                b = Mul255_SSE2(_mm_and_si128(_mm_srl_epi32(t, tex_b), ff), b);
+                if (tex_ashift >= 0) {
+                    a = Mul255_SSE2(_mm_and_si128(_mm_srl_epi32(t, tex_a), ff), a);
+                }
+            } else {
+                /* DRAW_MUL() by 255 is exact, so use the texel as is */
+                r = _mm_and_si128(_mm_srl_epi32(t, tex_r), ff);
+                g = _mm_and_si128(_mm_srl_epi32(t, tex_g), ff);
+                b = _mm_and_si128(_mm_srl_epi32(t, tex_b), ff);
+                if (tex_ashift >= 0) {
+                    a = _mm_and_si128(_mm_srl_epi32(t, tex_a), ff);
+                }
+            }
+        }
+
+        p = _mm_loadu_si128((const __m128i *) group);
+        dr = _mm_and_si128(_mm_srl_epi32(p, dst_r), ff);
+        dg = _mm_and_si128(_mm_srl_epi32(p, dst_g), ff);
+        db = _mm_and_si128(_mm_srl_epi32(p, dst_b), ff);
+        da = (dst_ashift >= 0) ? _mm_and_si128(_mm_srl_epi32(p, dst_a), ff) : ff;
+
+        switch (blendMode) {
+        case SDL_BLENDMODE_BLEND:{
+                const __m128i inva = _mm_sub_epi32(ff, a);
+                r = _mm_add_epi32(Mul255_SSE2(inva, dr), Mul255_SSE2(r, a));
+                g = _mm_add_epi32(Mul255_SSE2(inva, dg), Mul255_SSE2(g, a));
+                b = _mm_add_epi32(Mul255_SSE2(inva, db), Mul255_SSE2(b, a));
+                a = _mm_add_epi32(Mul255_SSE2(inva, da), a);
+                break;
+            }
+        case SDL_BLENDMODE_ADD:
+            /* The sums fit in the low 16 bits of each lane */
+            r = _mm_min_epi16(_mm_add_epi32(dr, Mul255_SSE2(r, a)), ff);
+            g = _mm_min_epi16(_mm_add_epi32(dg, Mul255_SSE2(g, a)), ff);
+            b = _mm_min_epi16(_mm_add_epi32(db, Mul255_SSE2(b, a)), ff);
+            a = da;
+            break;
+        case SDL_BLENDMODE_MOD:
+            r = Mul255_SSE2(dr, r);
+            g = Mul255_SSE2(dg, g);
+            b = Mul255_SSE2(db, b);
+            a = da;
+            break;
+        default:
+            break;
+        }
+
+        out = _mm_or_si128(_mm_sll_epi32(r, dst_r), _mm_sll_epi32(g, dst_g));
+        out = _mm_or_si128(out, _mm_sll_epi32(b, dst_b));
+        if (dst_ashift >= 0) {
+            out = _mm_or_si128(out, _mm_sll_epi32(a, dst_a));
+        }
+        _mm_storeu_si128((__m128i *) group, out);
+        if (group == scratch) {
+            for (j = 0; j < count - i; ++j) {
+                pixels[i + j] = scratch[j];
+            }
+        }
+    }
+}
+#endif /* __SSE2__ */
+
+static SDL_INLINE Sint64
+FloorDiv(Sint64 n, Sint64 d)
+{
+    Sint64 q = n / d;
+    if ((n % d) != 0 && n < 0) {
+        --q;
+    }
+    return q;
+}
+
+/* The pixels x of a row inside an edge are those where a * x + f >= 0, so
+   they start (a > 0) or end (a < 0) at a bound that is a quotient. The
+   numerator changes by a constant from row to row, so the quotient and its
+   remainder are stepped rather than divided out again.
+*/
+typedef struct
+{
+    Sint64 a;                   /* change of the edge function per pixel */
+    Sint64 f;                   /* edge function at x = 0, for a == 0 */
+    Sint64 df;                  /* change of f per row */
+    Sint64 divisor;             /* |a| */
+    Sint64 bound, remainder;    /* first or last x inside, and what's left */
+    Sint64 bound_step, remainder_step;
+} TriangleEdge;
+
+static void
+SetupEdge(TriangleEdge * edge, Sint64 a, Sint64 f, Sint64 df)
+{
+    Sint64 n, dn;
+
+    edge->a = a;
+    edge->f = f;
+    edge->df = df;
+    if (a == 0) {
+        return;
+    }
+    if (a > 0) {
+        /* x >= ceil(-f / a) */
+        edge->divisor = a;
+        n = a - 1 - f;
+        dn = -df;
+    } else {
+        /* x <= floor(f / -a) */
+        edge->divisor = -a;
+        n = f;
+        dn = df;
+    }
+    edge->bound = FloorDiv(n, edge->divisor);
+    edge->remainder = n - edge->bound * edge->divisor;
+    edge->bound_step = FloorDiv(dn, edge->divisor);
+    edge->remainder_step = dn - edge->bound_step * edge->divisor;
+}
+
+static SDL_INLINE void
+StepEdge(TriangleEdge * edge)
+{
+    if (edge->a == 0) {
+        edge->f += edge->df;
+        return;
+    }
+    edge->bound += edge->bound_step;
+    edge->remainder += edge->remainder_step;
+    if (edge->remainder >= edge->divisor) {
+        edge->remainder -= edge->divisor;
+        edge->bound += 1;
+    }
+}
+
+/* Narrow [*x0, *x1] to the pixels inside an edge */
+static SDL_INLINE void
+ClipSpan(const TriangleEdge * edge, int *x0, int *x1)
+{
+    if (edge->a > 0) {
+        if (edge->bound > *x0) {
+            *x0 = (edge->bound > *x1) ? (*x1 + 1) : (int) edge->bound;
+        }
+    } else if (edge->a < 0) {
+        if (edge->bound < *x1) {
+            *x1 = (edge->bound < *x0) ? (*x0 - 1) : (int) edge->bound;
+        }
+    } else if (edge->f < 0) {
+        *x1 = *x0 - 1;
+    }
+}
+
+/* Draw a convex polygon of up to MAX_POLYGON_VERTICES, in either winding.
+   The attributes are planar, so they only need the first three vertices. */
+static void
+DrawPolygon(const TriangleContext * ctx, const TriangleVertex * vertices, int count)
+{
+    const SDL_Rect *clip = &ctx->dst->clip_rect;
+    const TriangleVertex *v = vertices;
+    TriangleEdge edges[MAX_POLYGON_VERTICES];
+    Sint64 area = 0, minx, maxx, miny, maxy;
+    float x0, y0, x1, y1, x2, y2, det;
+    float grad_x[NUM_ATTRIBS], grad_y[NUM_ATTRIBS];
+    SDL_bool tinted = SDL_FALSE;
+    int num_edges = 0;
+    int xmin, xmax, ymin, ymax, x, y, i;
+
+    minx = maxx = v[0].x;
+    miny = maxy = v[0].y;
+    for (i = 0; i < count; ++i) {
+        const TriangleVertex *a = &v[i];
+        const TriangleVertex *b = &v[(i + 1) % count];
+        area += a->x * b->y - a->y * b->x;
+        minx = SDL_min(minx, a->x);
+        maxx = SDL_max(maxx, a->x);
+        miny = SDL_min(miny, a->y);
+        maxy = SDL_max(maxy, a->y);
+    }
+    if (area == 0) {
+        return;
+    }
+
+    /* Find the pixel centers that could be covered, within the clip rect */
+    xmin = (int) SDL_max(minx >> SUBPIXEL_BITS, (Sint64) clip->x);
+    xmax = (int) SDL_min(maxx >> SUBPIXEL_BITS, (Sint64) (clip->x + clip->w - 1));
+    ymin = (int) SDL_max(miny >> SUBPIXEL_BITS, (Sint64) clip->y);
+    ymax = (int) SDL_min(maxy >> SUBPIXEL_BITS, (Sint64) (clip->y + clip->h - 1));
+    if (xmin > xmax || ymin > ymax) {
+        return;
+    }
+
+    /* Each edge is inside where A * px + B * py + C is positive, once the
+       polygon is wound that way, for pixel centers px and py in subpixels.
+       A pixel exactly on an edge belongs to the polygon if that is a top or
+       left edge, so the other edges are biased. */
+    for (i = 0; i < count; ++i) {
+        const TriangleVertex *a = &v[i];
+        const TriangleVertex *b = &v[(i + 1) % count];
+        Sint64 A = a->y - b->y;
+        Sint64 B = b->x - a->x;
+        Sint64 C = a->x * b->y - a->y * b->x;
+        if (area < 0) {
+            A = -A;
+            B = -B;
+            C = -C;
+        }
+        if (A == 0 && B == 0) {
+            continue;
+        }
+        if (!(A > 0 || (A == 0 && B > 0))) {
+            C -= 1;
+        }
+        SetupEdge(&edges[num_edges++], A * SUBPIXEL_ONE,
+                  A * (SUBPIXEL_ONE / 2) + B * ((Sint64) ymin * SUBPIXEL_ONE + SUBPIXEL_ONE / 2) + C,
+                  B * SUBPIXEL_ONE);
+    }
+
+    /* Planar gradients of the vertex attributes, in pixels */
+    x0 = (float) v[0].x / SUBPIXEL_ONE;
+    y0 = (float) v[0].y / SUBPIXEL_ONE;
+    x1 = (float) v[1].x / SUBPIXEL_ONE - x0;
+    y1 = (float) v[1].y / SUBPIXEL_ONE - y0;
+    x2 = (float) v[2].x / SUBPIXEL_ONE - x0;
+    y2 = (float) v[2].y / SUBPIXEL_ONE - y0;
+    det = x1 * y2 - x2 * y1;
+    if (det == 0.0f) {
+        return;
+    }
+    for (i = 0; i < NUM_ATTRIBS; ++i) {
+        const float d1 = v[1].attribs[i] - v[0].attribs[i];
+        const float d2 = v[2].attribs[i] - v[0].attribs[i];
+        grad_x[i] = (d1 * y2 - d2 * y1) / det;
+        grad_y[i] = (d2 * x1 - d1 * x2) / det;
+    }
+
+    /* Opaque white vertices leave the texture (or white) as it is */
+    for (i = 0; i < count; ++i) {
+        if (v[i].attribs[ATTRIB_R] != 255.0f || v[i].attribs[ATTRIB_G] != 255.0f ||
+            v[i].attribs[ATTRIB_B] != 255.0f || v[i].attribs[ATTRIB_A] != 255.0f) {
+            tinted = SDL_TRUE;
+        }
+    }
+
+    for (y = ymin; y <= ymax; ++y) {
+        int span_x0 = xmin;
+        int span_x1 = xmax;
+        float start[NUM_ATTRIBS];
+        Uint8 *pixels;
+        int span;
+
+        for (i = 0; i < num_edges; ++i) {
+            ClipSpan(&edges[i], &span_x0, &span_x1);
+            StepEdge(&edges[i]);
+        }
+        if (span_x0 > span_x1) {
+            continue;
+        }
+
+        x = span_x0;
+        span = span_x1 - span_x0 + 1;
+        for (i = 0; i < NUM_ATTRIBS; ++i) {
+            start[i] = v[0].attribs[i] +
+                       grad_x[i] * ((float) x + 0.5f - x0) +
+                       grad_y[i] * ((float) y + 0.5f - y0);
+        }
+
+        pixels = (Uint8 *) ctx->dst->pixels + y * ctx->dst->pitch +
+                 x * ctx->dst->format->BytesPerPixel;
+#ifdef __SSE2__
+        if (ctx->simd) {
+            DrawSpan_SSE2(ctx, (Uint32 *) pixels, span, start, grad_x, tinted);
+            continue;
+        }
+#endif
+        DrawSpan(ctx, pixels, span, start, grad_x);
+    }
+}
+
+static void
+SetupVertex(const TriangleContext * ctx, const SDL_Vertex * vertex,
+            const SDL_Color * mod, const SDL_Point * offset,
+            const SDL_FPoint * scale, TriangleVertex * out)
+{
+    float x = (vertex->position.x * scale->x + offset->x) * SUBPIXEL_ONE;
+    float y = (vertex->position.y * scale->y + offset->y) * SUBPIXEL_ONE;
+
+    /* This also takes care of NaN */
+    x = (x > -MAX_COORDINATE) ? SDL_min(x, MAX_COORDINATE) : -MAX_COORDINATE;
+    y = (y > -MAX_COORDINATE) ? SDL_min(y, MAX_COORDINATE) : -MAX_COORDINATE;
+    out->x = (Sint64) SDL_floorf(x + 0.5f);
+    out->y = (Sint64) SDL_floorf(y + 0.5f);
+
+    out->attribs[ATTRIB_R] = vertex->color.r * (mod->r / 255.0f);
+    out->attribs[ATTRIB_G] = vertex->color.g * (mod->g / 255.0f);
+    out->attribs[ATTRIB_B] = vertex->color.b * (mod->b / 255.0f);
+    out->attribs[ATTRIB_A] = vertex->color.a * (mod->a / 255.0f);
+    if (ctx->texture) {
+        out->attribs[ATTRIB_U] = vertex->tex_coord.x * ctx->texture->w;
+        out->attribs[ATTRIB_V] = vertex->tex_coord.y * ctx->texture->h;
+    } else {
+        out->attribs[ATTRIB_U] = 0.0f;
+        out->attribs[ATTRIB_V] = 0.0f;
+    }
+}
+
+/* Returns 1 if there's nothing to draw */
+static int
+SetupContext(TriangleContext * ctx, SDL_Surface * dst, SDL_Surface * texture,
+             SDL_BlendMode blendMode)
+{
+    if (!dst) {
+        return SDL_SetError("Passed NULL destination surface");
+    }
+    if (dst->format->BitsPerPixel < 8) {
+        return SDL_SetError("SDL_SW_RenderGeometry(): Unsupported surface format");
+    }
+    if (texture && texture->format->BitsPerPixel < 8) {
+        return SDL_SetError("SDL_SW_RenderGeometry(): Unsupported texture format");
+    }
+    if (texture && (texture->w <= 0 || texture->h <= 0)) {
+        return 1;
+    }
+
+    SDL_zerop(ctx);
+    ctx->dst = dst;
+    ctx->texture = texture;
+    ctx->blendMode = blendMode;
+    ctx->dst_fast = GetChannelShifts(dst->format, ctx->dst_shift);
+    if (texture) {
+        ctx->tex_fast = GetChannelShifts(texture->format, ctx->tex_shift);
+        if (!ctx->tex_fast) {
+            ctx->tex_shift[0] = 16;
+            ctx->tex_shift[1] = 8;
+            ctx->tex_shift[2] = 0;
+            ctx->tex_shift[3] = 24;
+        }
+        ctx->smooth = (texture->map->info.flags & SDL_COPY_LINEAR) ? SDL_TRUE : SDL_FALSE;
+        ctx->tex_maxu = (float) (texture->w - 1);
+        ctx->tex_maxv = (float) (texture->h - 1);
+    }
+#ifdef __SSE2__
+    ctx->simd = ctx->dst_fast && (!texture || ctx->tex_fast) && SDL_HasSSE2();
+#endif
+    return 0;
+}
+
+int
+SDL_SW_RenderGeometry(SDL_Surface * dst, SDL_Surface * texture,
+                      SDL_BlendMode blendMode, const SDL_Color * mod,
+                      const SDL_Vertex * vertices, const int * indices,
+                      int count, const SDL_Point * offset,
+                      const SDL_FPoint * scale)
+{
+    static const SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    TriangleContext ctx;
+    TriangleVertex triangle[3];
+    int i, j, retval;
+
+    retval = SetupContext(&ctx, dst, texture, blendMode);
+    if (retval != 0) {
+        return SDL_min(retval, 0);
+    }
+    if (!mod) {
+        mod = &white;
+    }
+
+    if (SDL_MUSTLOCK(dst) && SDL_LockSurface(dst) < 0) {
+        return -1;
+    }
+    for (i = 0; i + 3 <= count; i += 3) {
+        for (j = 0; j < 3; ++j) {
+            const int index = indices ? indices[i + j] : (i + j);
+            SetupVertex(&ctx, &vertices[index], mod, offset, scale, &triangle[j]);
+        }
+        DrawPolygon(&ctx, triangle, 3);
+    }
+    if (SDL_MUSTLOCK(dst)) {
+        SDL_UnlockSurface(dst);
+    }
+    return 0;
+}
+
+/* Copy reversed rows, or reversed pixels within the rows. Returns 1 if the
+   copy needs the general path instead. */
+static int
+FlipCopy(SDL_Surface * dst, SDL_Surface * texture, const SDL_Rect * srcrect,
+         const SDL_Rect * dstrect, SDL_RendererFlip flip)
+{
+    const int bpp = texture->format->BytesPerPixel;
+    SDL_Rect rect;
+    int x, y, row;
+
+    if (SDL_MUSTLOCK(texture) || SDL_MUSTLOCK(dst)) {
+        return 1;
+    }
+    if (!SDL_IntersectRect(dstrect, &dst->clip_rect, &rect)) {
+        return 0;
+    }
+
+    if (!(flip & SDL_FLIP_HORIZONTAL)) {
+        /* Whole rows blit as usual, with blending and modulation */
+        for (y = rect.y; y < rect.y + rect.h; ++y) {
+            SDL_Rect src_row, dst_row;
+            row = (flip & SDL_FLIP_VERTICAL) ? (dstrect->y + dstrect->h - 1 - y) : (y - dstrect->y);
+            src_row.x = srcrect->x;
+            src_row.y = srcrect->y + row;
+            src_row.w = srcrect->w;
+            src_row.h = 1;
+            dst_row.x = dstrect->x;
+            dst_row.y = y;
+            dst_row.w = dstrect->w;
+            dst_row.h = 1;
+            if (SDL_BlitSurface(texture, &src_row, dst, &dst_row) < 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    /* Mirrored rows only for straight copies between identical formats */
+    if ((texture->map->info.flags & (SDL_COPY_MODULATE_COLOR | SDL_COPY_MODULATE_ALPHA |
+                                     SDL_COPY_BLEND | SDL_COPY_ADD | SDL_COPY_MOD |
+                                     SDL_COPY_COLORKEY)) ||
+        texture->format->format != dst->format->format || (bpp != 2 && bpp != 4)) {
+        return 1;
+    }
+
+    for (y = rect.y; y < rect.y + rect.h; ++y) {
+        const int first = srcrect->x + (dstrect->x + dstrect->w - 1 - rect.x);
+        const Uint8 *src;
+        Uint8 *pixels = (Uint8 *) dst->pixels + y * dst->pitch + rect.x * bpp;
+
+        row = (flip & SDL_FLIP_VERTICAL) ? (dstrect->y + dstrect->h - 1 - y) : (y - dstrect->y);
+        src = (const Uint8 *) texture->pixels + (srcrect->y + row) * texture->pitch + first * bpp;
+        if (bpp == 4) {
+            for (x = 0; x < rect.w; ++x) {
+                ((Uint32 *) pixels)[x] = ((const Uint32 *) src)[-x];
+            }
+        } else {
+            for (x = 0; x < rect.w; ++x) {
+                ((Uint16 *) pixels)[x] = ((const Uint16 *) src)[-x];
+            }
+        }
+    }
+    return 0;
+}
+
+int
+SDL_SW_RenderCopyEx(SDL_Surface * dst, SDL_Surface * texture, const SDL_Rect * srcrect,
+                    const SDL_FRect * dstrect, double angle, const SDL_FPoint * center,
+                    SDL_RendererFlip flip)
+{
+    static const SDL_Point origin = { 0, 0 };
+    static const SDL_FPoint unscaled = { 1.0f, 1.0f };
+    TriangleContext ctx;
+    TriangleVertex quad[4];
+    SDL_Rect rect;
+    SDL_BlendMode blendMode;
+    SDL_Color mod;
+    SDL_Vertex vertices[4];
+    float cx, cy, c, s, u0, u1, v0, v1;
+    int i, retval;
+
+    if (!texture) {
+        return SDL_SetError("Passed NULL texture");
+    }
+    SDL_GetSurfaceBlendMode(texture, &blendMode);
+    retval = SetupContext(&ctx, dst, texture, blendMode);
+    if (retval != 0) {
+        return SDL_min(retval, 0);
+    }
+
+    rect.x = (int) dstrect->x;
+    rect.y = (int) dstrect->y;
+    rect.w = (int) dstrect->w;
+    rect.h = (int) dstrect->h;
+
+    if (rect.w == srcrect->w && rect.h == srcrect->h && (int) (angle / 90) == angle / 90) {
+        if ((int) (angle / 360) == angle / 360) {
+            retval = FlipCopy(dst, texture, srcrect, &rect, flip);
+            if (retval <= 0) {
+                return retval;
+            }
+        }
+        /* Quarter turns map texels onto pixels, there's nothing to filter */
+        ctx.smooth = SDL_FALSE;
+    }
+
+    SDL_GetSurfaceColorMod(texture, &mod.r, &mod.g, &mod.b);
+    SDL_GetSurfaceAlphaMod(texture, &mod.a);
+
+    /* The corners of the rectangle turn clockwise around the center */
+    cx = rect.x + center->x;
+    cy = rect.y + center->y;
+    c = (float) SDL_cos(angle * (M_PI / 180.0));
+    s = (float) SDL_sin(angle * (M_PI / 180.0));
+    u0 = (float) srcrect->x;
+    u1 = (float) (srcrect->x + srcrect->w);
+    v0 = (float) srcrect->y;
+    v1 = (float) (srcrect->y + srcrect->h);
+    if (flip & SDL_FLIP_HORIZONTAL) {
+        const float tmp = u0;
+        u0 = u1;
+        u1 = tmp;
+    }
+    if (flip & SDL_FLIP_VERTICAL) {
+        const float tmp = v0;
+        v0 = v1;
+        v1 = tmp;
+    }
+    vertices[0].position.x = (float) rect.x;
+    vertices[0].position.y = (float) rect.y;
+    vertices[0].tex_coord.x = u0;
+    vertices[0].tex_coord.y = v0;
+    vertices[1].position.x = (float) (rect.x + rect.w);
+    vertices[1].position.y = (float) rect.y;
+    vertices[1].tex_coord.x = u1;
+    vertices[1].tex_coord.y = v0;
+    vertices[2].position.x = (float) (rect.x + rect.w);
+    vertices[2].position.y = (float) (rect.y + rect.h);
+    vertices[2].tex_coord.x = u1;
+    vertices[2].tex_coord.y = v1;
+    vertices[3].position.x = (float) rect.x;
+    vertices[3].position.y = (float) (rect.y + rect.h);
+    vertices[3].tex_coord.x = u0;
+    vertices[3].tex_coord.y = v1;
+    for (i = 0; i < 4; ++i) {
+        const float dx = vertices[i].position.x - cx;
+        const float dy = vertices[i].position.y - cy;
+        vertices[i].position.x = cx + dx * c - dy * s;
+        vertices[i].position.y = cy + dx * s + dy * c;
+        vertices[i].color.r = 0xFF;
+        vertices[i].color.g = 0xFF;
+        vertices[i].color.b = 0xFF;
+        vertices[i].color.a = 0xFF;
+        SetupVertex(&ctx, &vertices[i], &mod, &origin, &unscaled, &quad[i]);
+
+        /* Texel coordinates are exact this way, rather than normalized */
+        quad[i].attribs[ATTRIB_U] = vertices[i].tex_coord.x;
+        quad[i].attribs[ATTRIB_V] = vertices[i].tex_coord.y;
+    }
+
+    /* It is possible to encounter an RLE encoded surface here and locking it is
+     * necessary because this code is going to access the pixel buffer directly.
+     */
+    if (SDL_MUSTLOCK(texture) && SDL_LockSurface(texture) < 0) {
+        return -1;
+    }
+    if (SDL_MUSTLOCK(dst) && SDL_LockSurface(dst) < 0) {
+        if (SDL_MUSTLOCK(texture)) {
+            SDL_UnlockSurface(texture);
+        }
+        return -1;
+    }
+    DrawPolygon(&ctx, quad, 4);
+    if (SDL_MUSTLOCK(dst)) {
+        SDL_UnlockSurface(dst);
+    }
+    if (SDL_MUSTLOCK(texture)) {
+        SDL_UnlockSurface(texture);
+    }
+    return 0;
+}
+
+#endif /* !SDL_RENDER_DISABLED */
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -0,0 +1,46 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2018 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../../SDL_internal.h"
+
+#include "SDL_render.h"
+
+/* Draw count / 3 triangles, taking the vertices in order or through indices.
+   Vertex positions are scaled, then offset into the destination surface, and
+   the triangles are clipped to its clip rectangle. The texture, if any, is
+   sampled at the nearest texel and multiplied by the vertex color and mod.
+*/
+extern int SDL_SW_RenderGeometry(SDL_Surface * dst, SDL_Surface * texture,
+                                 SDL_BlendMode blendMode, const SDL_Color * mod,
+                                 const SDL_Vertex * vertices, const int * indices,
+                                 int count, const SDL_Point * offset,
+                                 const SDL_FPoint * scale);
+
+/* Copy srcrect of a texture to dstrect, which is already offset into the
+   destination surface, rotated clockwise by angle degrees around center and
+   flipped. The texture is modulated and blended according to its own
+   settings, as SDL_BlitSurface() would do.
+*/
+extern int SDL_SW_RenderCopyEx(SDL_Surface * dst, SDL_Surface * texture,
+                               const SDL_Rect * srcrect, const SDL_FRect * dstrect,
+                               double angle, const SDL_FPoint * center,
+                               SDL_RendererFlip flip);
+
+/* vi: set ts=4 sw=4 expandtab: */
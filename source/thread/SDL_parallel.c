@@ -0,0 +1,177 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2018 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../SDL_internal.h"
+
+/* A small worker pool for splitting pixel work across CPU cores */
+
+#include "SDL_atomic.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_thread.h"
+#include "SDL_parallel_c.h"
+
+#define MAX_PARALLEL_WORKERS    8
+
+typedef struct
+{
+    SDL_ParallelFunc func;
+    void *data;
+    int count;
+    int grain;
+    SDL_atomic_t next;
+} SDL_ParallelJob;
+
+static SDL_SpinLock parallel_lock;
+static SDL_bool parallel_initialized;
+static int parallel_workers;
+static SDL_Thread *parallel_threads[MAX_PARALLEL_WORKERS];
+static SDL_sem *parallel_start;
+static SDL_sem *parallel_done;
+static SDL_atomic_t parallel_quit;
+static SDL_ParallelJob parallel_job;
+
+static void
+SDL_RunParallelJob(SDL_ParallelJob * job)
+{
+    for (;;) {
+        const int start = SDL_AtomicAdd(&job->next, job->grain);
+        if (start >= job->count) {
+            break;
+        }
+        job->func(job->data, start, SDL_min(start + job->grain, job->count));
+    }
+}
+
+static int SDLCALL
+SDL_ParallelWorker(void *unused)
+{
+    for (;;) {
+        SDL_SemWait(parallel_start);
+        if (SDL_AtomicGet(&parallel_quit)) {
+            break;
+        }
+        SDL_RunParallelJob(&parallel_job);
+        SDL_SemPost(parallel_done);
+    }
+    return 0;
+}
+
+/* Called with parallel_lock held */
+static void
+SDL_InitParallel(void)
+{
+    int i, workers;
+
+    parallel_initialized = SDL_TRUE;
+
+    workers = SDL_min(SDL_GetCPUCount() - 1, MAX_PARALLEL_WORKERS);
+    if (workers <= 0) {
+        return;
+    }
+    parallel_start = SDL_CreateSemaphore(0);
+    parallel_done = SDL_CreateSemaphore(0);
+    if (!parallel_start || !parallel_done) {
+        return;
+    }
+    SDL_AtomicSet(&parallel_quit, 0);
+    for (i = 0; i < workers; ++i) {
+        parallel_threads[i] = SDL_CreateThread(SDL_ParallelWorker, "SDLParallel", NULL);
+        if (!parallel_threads[i]) {
+            break;
+        }
+        ++parallel_workers;
+    }
+}
+
+void
+SDL_ParallelFor(int count, int grain, SDL_ParallelFunc func, void *data)
+{
+    int slices, helpers, i;
+
+    if (count <= 0) {
+        return;
+    }
+    if (grain < 1) {
+        grain = 1;
+    }
+    slices = (count + grain - 1) / grain;
+
+    /* Only one job at a time, nested or concurrent callers run inline */
+    if (slices < 2 || !SDL_AtomicTryLock(&parallel_lock)) {
+        func(data, 0, count);
+        return;
+    }
+    if (!parallel_initialized) {
+        SDL_InitParallel();
+    }
+    helpers = SDL_min(parallel_workers, slices - 1);
+    if (helpers == 0) {
+        SDL_AtomicUnlock(&parallel_lock);
+        func(data, 0, count);
+        return;
+    }
+
+    parallel_job.func = func;
+    parallel_job.data = data;
+    parallel_job.count = count;
+    parallel_job.grain = grain;
+    SDL_AtomicSet(&parallel_job.next, 0);
+
+    for (i = 0; i < helpers; ++i) {
+        SDL_SemPost(parallel_start);
+    }
+    SDL_RunParallelJob(&parallel_job);
+    for (i = 0; i < helpers; ++i) {
+        SDL_SemWait(parallel_done);
+    }
+
+    SDL_AtomicUnlock(&parallel_lock);
+}
+
+void
+SDL_QuitParallel(void)
+{
+    int i;
+
+    SDL_AtomicLock(&parallel_lock);
+    if (parallel_initialized) {
+        SDL_AtomicSet(&parallel_quit, 1);
+        for (i = 0; i < parallel_workers; ++i) {
+            SDL_SemPost(parallel_start);
+        }
+        for (i = 0; i < parallel_workers; ++i) {
+            SDL_WaitThread(parallel_threads[i], NULL);
+            parallel_threads[i] = NULL;
+        }
+        parallel_workers = 0;
+        if (parallel_start) {
+            SDL_DestroySemaphore(parallel_start);
+            parallel_start = NULL;
+        }
+        if (parallel_done) {
+            SDL_DestroySemaphore(parallel_done);
+            parallel_done = NULL;
+        }
+        parallel_initialized = SDL_FALSE;
+    }
+    SDL_AtomicUnlock(&parallel_lock);
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -18,11 +18,24 @@
      misrepresented as being the original software.
   3. This notice may not be removed or altered from any source distribution.
 */
+#include "../SDL_internal.h"
 
-#ifndef MIN
-#define MIN(a,b)    (((a) < (b)) ? (a) : (b))
-#endif
+#ifndef SDL_parallel_c_h_
+#define SDL_parallel_c_h_
 
-extern SDL_Surface *SDLgfx_rotateSurface(SDL_Surface * src, double angle, int centerx, int centery, int smooth, int flipx, int flipy, int dstwidth, int dstheight, double cangle, double sangle);
-extern void SDLgfx_rotozoomSurfaceSizeTrig(int width, int height, double angle, int *dstwidth, int *dstheight, double *cangle, double *sangle);
+/* Runs func over [start, end) slices of [0, count) */
+typedef void (*SDL_ParallelFunc) (void *data, int start, int end);
 
+/* Split [0, count) into slices of at least grain items and run them on a
+   small pool of worker threads, the calling thread included.  Returns once
+   every slice is done.  Runs everything on the calling thread if the pool
+   is busy or there's too little work to share.
+ */
+extern void SDL_ParallelFor(int count, int grain, SDL_ParallelFunc func, void *data);
+
+/* Stop the worker threads, called from SDL_Quit() */
+extern void SDL_QuitParallel(void);
+
+#endif /* SDL_parallel_c_h_ */
+
+/* vi: set ts=4 sw=4 expandtab: */
@@ -43,22 +43,20 @@ void * ThreadEntry(void *arg)
 int SDL_SYS_CreateThread(SDL_Thread *thread, void *args)
 {
     int priority = 0;
-	int ret=0;
-    OrbisPthread thid; 
-    //thid = scePthreadSelf();
-    if (scePthreadGetprio(thid, &priority) == 0 && priority>1) {
-		ret=scePthreadCreate(&thread->handle, NULL, ThreadEntry, args, NULL);
-		if(ret==0)
-		{
-			scePthreadSetprio(thread->handle, priority);
-			return 0;
-		}	
-		else
-		{
-	        return SDL_SetError("scePthreadCreate() failed");
-		}	
+    int ret=0;
+    OrbisPthread thid;
+
+    thid = scePthreadSelf();
+    ret=scePthreadCreate(&thread->handle, NULL, ThreadEntry, args, NULL);
+    if(ret!=0)
+    {
+        return SDL_SetError("scePthreadCreate() failed");
     }
-    return -1;
+    /* Run at the priority of the creating thread */
+    if (scePthreadGetprio(thid, &priority) == 0) {
+        scePthreadSetprio(thread->handle, priority);
+    }
+    return 0;
 }
 
 void SDL_SYS_SetupThread(const char *name)
@@ -68,8 +66,7 @@ void SDL_SYS_SetupThread(const char *name)
 
 SDL_threadID SDL_ThreadID(void)
 {
-    //return (SDL_threadID) scePthreadSelf();
-    return (SDL_threadID) NULL;
+    return (SDL_threadID) scePthreadSelf();
 }
 
 void SDL_SYS_WaitThread(SDL_Thread *thread)
@@ -91,8 +88,8 @@ int SDL_SYS_SetThreadPriority(SDL_ThreadPriority priority)
 {
     int ret=0;
 
-    OrbisPthread thid; 
-    //thid = scePthreadSelf();
+    OrbisPthread thid;
+    thid = scePthreadSelf();
 	ret=scePthreadSetprio(thid, priority);
 	if(ret<0)
 	{
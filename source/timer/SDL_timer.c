@@ -24,6 +24,7 @@
 #include "SDL_timer_c.h"
 #include "SDL_atomic.h"
 #include "SDL_cpuinfo.h"
+#include "SDL_hints.h"
 #include "../thread/SDL_systhread.h"
 
 /* #define DEBUG_TIMERS */
@@ -34,7 +35,9 @@ typedef struct _SDL_Timer
     SDL_TimerCallback callback;
     void *param;
     Uint32 interval;
-    Uint32 scheduled;
+    Uint64 scheduled;       /* in performance counter ticks */
+    Uint64 dispatched;      /* when it was handed to a worker thread */
+    int heap_index;         /* position in the timer heap, or -1 if not in it */
     SDL_atomic_t canceled;
     struct _SDL_Timer *next;
 } SDL_Timer;
@@ -46,13 +49,24 @@ typedef struct _SDL_TimerMap
     struct _SDL_TimerMap *next;
 } SDL_TimerMap;
 
-/* The timers are kept in a sorted list */
+/* The timer map starts with this many buckets and grows as timers are added */
+#define SDL_TIMERMAP_MIN_SIZE   64
+
+/* The timers are kept in a 4-ary heap, sorted by scheduling time */
+#define SDL_TIMER_HEAP_ARITY    4
+
+/* The most worker threads SDL_HINT_TIMER_THREADS can ask for */
+#define SDL_MAX_TIMER_WORKERS   8
+
 typedef struct {
     /* Data used by the main thread */
     SDL_Thread *thread;
     SDL_atomic_t nextID;
-    SDL_TimerMap *timermap;
+    SDL_TimerMap **timermap;
+    int timermap_size;
+    int timermap_count;
     SDL_mutex *timermap_lock;
+    Uint64 frequency;
 
     /* Padding to separate cache lines between threads */
     char cache_pad[SDL_CACHELINE_SIZE];
@@ -61,11 +75,27 @@ typedef struct {
     SDL_SpinLock lock;
     SDL_sem *sem;
     SDL_Timer *pending;
+    SDL_TimerMap *canceled;
+    SDL_Timer *done;
     SDL_Timer *freelist;
     SDL_atomic_t active;
 
-    /* List of timers - this is only touched by the timer thread */
-    SDL_Timer *timers;
+    /* Worker threads that due timers are handed to, if any */
+    SDL_Thread *workers[SDL_MAX_TIMER_WORKERS];
+    int num_workers;
+    SDL_atomic_t workers_active;
+    SDL_SpinLock work_lock;
+    SDL_sem *work_sem;
+    SDL_Timer *work_head;
+    SDL_Timer *work_tail;
+
+    SDL_SpinLock stats_lock;
+    SDL_TimerStats stats;
+
+    /* Heap of timers - this is only touched by the timer thread */
+    SDL_Timer **heap;
+    int heap_count;
+    int heap_size;
 } SDL_TimerData;
 
 static SDL_TimerData SDL_timer_data;
@@ -73,28 +103,177 @@ static SDL_TimerData SDL_timer_data;
 /* The idea here is that any thread might add a timer, but a single
  * thread manages the active timer queue, sorted by scheduling time.
  *
- * Timers are removed by simply setting a canceled flag
+ * Timers are removed by setting a canceled flag and handing their map entry
+ * to the timer thread, which takes them out of the queue.
+ *
+ * With worker threads, the timer thread queues due timers for them and the
+ * workers hand them back once their callback returns. A timer isn't in the
+ * queue while it's away, so it never runs on two threads at once.
  */
 
 static void
-SDL_AddTimerInternal(SDL_TimerData *data, SDL_Timer *timer)
+SDL_SiftTimerUp(SDL_TimerData *data, SDL_Timer *timer, int index)
+{
+    while (index > 0) {
+        const int parent = (index - 1) / SDL_TIMER_HEAP_ARITY;
+        SDL_Timer *other = data->heap[parent];
+        if (other->scheduled <= timer->scheduled) {
+            break;
+        }
+        data->heap[index] = other;
+        other->heap_index = index;
+        index = parent;
+    }
+    data->heap[index] = timer;
+    timer->heap_index = index;
+}
+
+static void
+SDL_SiftTimerDown(SDL_TimerData *data, SDL_Timer *timer, int index)
 {
-    SDL_Timer *prev, *curr;
+    for ( ; ; ) {
+        const int first = index * SDL_TIMER_HEAP_ARITY + 1;
+        const int last = SDL_min(first + SDL_TIMER_HEAP_ARITY, data->heap_count);
+        int i, child = first;
 
-    prev = NULL;
-    for (curr = data->timers; curr; prev = curr, curr = curr->next) {
-        if ((Sint32)(timer->scheduled-curr->scheduled) < 0) {
+        if (first >= data->heap_count) {
+            break;
+        }
+        for (i = first + 1; i < last; ++i) {
+            if (data->heap[i]->scheduled < data->heap[child]->scheduled) {
+                child = i;
+            }
+        }
+        if (timer->scheduled <= data->heap[child]->scheduled) {
             break;
         }
+        data->heap[index] = data->heap[child];
+        data->heap[index]->heap_index = index;
+        index = child;
     }
+    data->heap[index] = timer;
+    timer->heap_index = index;
+}
 
-    /* Insert the timer here! */
-    if (prev) {
-        prev->next = timer;
-    } else {
-        data->timers = timer;
+static SDL_bool
+SDL_AddTimerInternal(SDL_TimerData *data, SDL_Timer *timer)
+{
+    if (data->heap_count == data->heap_size) {
+        const int size = data->heap_size ? data->heap_size * 2 : 64;
+        SDL_Timer **heap = (SDL_Timer **)SDL_realloc(data->heap, size * sizeof(*heap));
+        if (!heap) {
+            return SDL_FALSE;
+        }
+        data->heap = heap;
+        data->heap_size = size;
     }
-    timer->next = curr;
+    SDL_SiftTimerUp(data, timer, data->heap_count++);
+    return SDL_TRUE;
+}
+
+static void
+SDL_RemoveTimerInternal(SDL_TimerData *data, SDL_Timer *timer)
+{
+    const int index = timer->heap_index;
+    SDL_Timer *last = data->heap[--data->heap_count];
+
+    timer->heap_index = -1;
+    if (last != timer) {
+        if (last->scheduled < timer->scheduled) {
+            SDL_SiftTimerUp(data, last, index);
+        } else {
+            SDL_SiftTimerDown(data, last, index);
+        }
+    }
+}
+
+/* Convert performance counter ticks to milliseconds, rounding up */
+static Uint32
+SDL_TimerTicksToMS(SDL_TimerData *data, Uint64 ticks)
+{
+    const Uint64 ms = (ticks * 1000 + data->frequency - 1) / data->frequency;
+    return (ms < SDL_MUTEX_MAXWAIT) ? (Uint32)ms : SDL_MUTEX_MAXWAIT - 1;
+}
+
+/* Call a timer's callback, keeping track of how late it is */
+static Uint32
+SDL_RunTimer(SDL_TimerData *data, SDL_Timer *timer)
+{
+    const Uint64 now = SDL_GetPerformanceCounter();
+    Uint64 lateness = 0;
+
+    if (now > timer->scheduled) {
+        lateness = (now - timer->scheduled) * 1000000 / data->frequency;
+    }
+
+    SDL_AtomicLock(&data->stats_lock);
+    ++data->stats.fired;
+    data->stats.total_lateness += lateness;
+    if (lateness > data->stats.max_lateness) {
+        data->stats.max_lateness = (Uint32)SDL_min(lateness, 0xFFFFFFFF);
+    }
+    SDL_AtomicUnlock(&data->stats_lock);
+
+    return timer->callback(timer->interval, timer->param);
+}
+
+static void
+SDL_FreeTimerInternal(SDL_Timer *timer, SDL_Timer **freelist_head, SDL_Timer **freelist_tail)
+{
+    timer->next = NULL;
+    if (!*freelist_head) {
+        *freelist_head = timer;
+    }
+    if (*freelist_tail) {
+        (*freelist_tail)->next = timer;
+    }
+    *freelist_tail = timer;
+
+    SDL_AtomicSet(&timer->canceled, 1);
+}
+
+static int SDLCALL
+SDL_TimerWorker(void *_data)
+{
+    SDL_TimerData *data = (SDL_TimerData *)_data;
+    SDL_Timer *timer;
+
+    for ( ; ; ) {
+        SDL_SemWait(data->work_sem);
+
+        SDL_AtomicLock(&data->work_lock);
+        timer = data->work_head;
+        if (timer) {
+            data->work_head = timer->next;
+            if (!data->work_head) {
+                data->work_tail = NULL;
+            }
+        }
+        SDL_AtomicUnlock(&data->work_lock);
+
+        if (!timer) {
+            if (!SDL_AtomicGet(&data->workers_active)) {
+                break;
+            }
+            continue;
+        }
+
+        /* Timers still queued at shutdown don't run */
+        if (SDL_AtomicGet(&timer->canceled) || !SDL_AtomicGet(&data->workers_active)) {
+            timer->interval = 0;
+        } else {
+            timer->interval = SDL_RunTimer(data, timer);
+        }
+
+        /* Hand it back to the timer thread */
+        SDL_AtomicLock(&data->lock);
+        timer->next = data->done;
+        data->done = timer;
+        SDL_AtomicUnlock(&data->lock);
+
+        SDL_SemPost(data->sem);
+    }
+    return 0;
 }
 
 static int SDLCALL
@@ -102,13 +281,21 @@ SDL_TimerThread(void *_data)
 {
     SDL_TimerData *data = (SDL_TimerData *)_data;
     SDL_Timer *pending;
+    SDL_Timer *done;
     SDL_Timer *current;
+    SDL_Timer *retry = NULL;
+    SDL_Timer *work_head, *work_tail;
+    SDL_TimerMap *canceled;
+    SDL_TimerMap *entry;
     SDL_Timer *freelist_head = NULL;
     SDL_Timer *freelist_tail = NULL;
-    Uint32 tick, now, interval, delay;
+    Uint64 tick, now;
+    Uint32 interval, delay;
+    int work_count;
 
     /* Threaded timer loop:
-     *  1. Queue timers added by other threads
+     *  1. Queue timers added by other threads or returned by the workers,
+     *     drop the ones removed
      *  2. Handle any timers that should dispatch this cycle
      *  3. Wait until next dispatch time or new timer arrives
      */
@@ -116,9 +303,13 @@ SDL_TimerThread(void *_data)
         /* Pending and freelist maintenance */
         SDL_AtomicLock(&data->lock);
         {
-            /* Get any timers ready to be queued */
+            /* Get any timers ready to be queued or removed */
             pending = data->pending;
             data->pending = NULL;
+            done = data->done;
+            data->done = NULL;
+            canceled = data->canceled;
+            data->canceled = NULL;
 
             /* Make any unused timer structures available */
             if (freelist_head) {
@@ -127,70 +318,135 @@ SDL_TimerThread(void *_data)
             }
         }
         SDL_AtomicUnlock(&data->lock);
+        freelist_head = NULL;
+        freelist_tail = NULL;
+
+        /* Reschedule the timers the workers are done with */
+        while (done) {
+            current = done;
+            done = done->next;
 
-        /* Sort the pending timers into our list */
+            if (current->interval > 0 && !SDL_AtomicGet(&current->canceled)) {
+                current->scheduled = current->dispatched + (Uint64)current->interval * data->frequency / 1000;
+                current->next = pending;
+                pending = current;
+            } else {
+                SDL_FreeTimerInternal(current, &freelist_head, &freelist_tail);
+            }
+        }
+
+        /* Put the pending timers into our heap, after any that didn't fit
+           the last time around */
+        if (retry) {
+            current = retry;
+            while (current->next) {
+                current = current->next;
+            }
+            current->next = pending;
+            pending = retry;
+        }
         while (pending) {
-            current = pending;
+            if (!SDL_AddTimerInternal(data, pending)) {
+                break;
+            }
             pending = pending->next;
-            SDL_AddTimerInternal(data, current);
         }
-        freelist_head = NULL;
-        freelist_tail = NULL;
+        retry = pending;
+
+        /* Take removed timers out of the heap. A timer that isn't in it is
+           being dispatched, or was already freed and maybe reused, and its
+           canceled flag takes care of it.
+         */
+        while (canceled) {
+            entry = canceled;
+            canceled = canceled->next;
+
+            current = entry->timer;
+            if (current->heap_index >= 0 && current->timerID == entry->timerID) {
+                SDL_RemoveTimerInternal(data, current);
+                SDL_FreeTimerInternal(current, &freelist_head, &freelist_tail);
+            }
+            SDL_free(entry);
+        }
 
         /* Check to see if we're still running, after maintenance */
         if (!SDL_AtomicGet(&data->active)) {
             break;
         }
 
-        /* Initial delay if there are no timers */
-        delay = SDL_MUTEX_MAXWAIT;
-
-        tick = SDL_GetTicks();
+        tick = SDL_GetPerformanceCounter();
+        work_head = NULL;
+        work_tail = NULL;
+        work_count = 0;
 
         /* Process all the pending timers for this tick */
-        while (data->timers) {
-            current = data->timers;
-
-            if ((Sint32)(tick-current->scheduled) < 0) {
-                /* Scheduled for the future, wait a bit */
-                delay = (current->scheduled - tick);
-                break;
-            }
-
+        while (data->heap_count > 0 && data->heap[0]->scheduled <= tick) {
             /* We're going to do something with this timer */
-            data->timers = current->next;
+            current = data->heap[0];
+            SDL_RemoveTimerInternal(data, current);
 
             if (SDL_AtomicGet(&current->canceled)) {
-                interval = 0;
-            } else {
-                interval = current->callback(current->interval, current->param);
+                SDL_FreeTimerInternal(current, &freelist_head, &freelist_tail);
+                continue;
+            }
+
+            if (data->num_workers > 0) {
+                /* Queue it for the workers */
+                current->dispatched = tick;
+                current->next = NULL;
+                if (work_tail) {
+                    work_tail->next = current;
+                } else {
+                    work_head = current;
+                }
+                work_tail = current;
+                ++work_count;
+                continue;
             }
 
-            if (interval > 0) {
+            interval = SDL_RunTimer(data, current);
+            if (interval > 0 && !SDL_AtomicGet(&current->canceled)) {
                 /* Reschedule this timer */
                 current->interval = interval;
-                current->scheduled = tick + interval;
-                SDL_AddTimerInternal(data, current);
-            } else {
-                if (!freelist_head) {
-                    freelist_head = current;
+                current->scheduled = tick + (Uint64)interval * data->frequency / 1000;
+                if (SDL_AddTimerInternal(data, current)) {
+                    continue;
                 }
-                if (freelist_tail) {
-                    freelist_tail->next = current;
-                }
-                freelist_tail = current;
+                current->next = retry;
+                retry = current;
+            } else {
+                SDL_FreeTimerInternal(current, &freelist_head, &freelist_tail);
+            }
+        }
+
+        if (work_head) {
+            SDL_AtomicLock(&data->work_lock);
+            if (data->work_tail) {
+                data->work_tail->next = work_head;
+            } else {
+                data->work_head = work_head;
+            }
+            data->work_tail = work_tail;
+            SDL_AtomicUnlock(&data->work_lock);
 
-                SDL_AtomicSet(&current->canceled, 1);
+            while (work_count--) {
+                SDL_SemPost(data->work_sem);
             }
         }
 
-        /* Adjust the delay based on processing time */
-        now = SDL_GetTicks();
-        interval = (now - tick);
-        if (interval > delay) {
-            delay = 0;
-        } else {
-            delay -= interval;
+        /* Wait until the next timer is due, allowing for processing time */
+        delay = SDL_MUTEX_MAXWAIT;
+        if (data->heap_count > 0) {
+            now = SDL_GetPerformanceCounter();
+            if (data->heap[0]->scheduled > now) {
+                delay = SDL_TimerTicksToMS(data, data->heap[0]->scheduled - now);
+            } else {
+                delay = 0;
+            }
+        }
+        if (retry) {
+            /* Out of memory, try again soon */
+            delay = SDL_min(delay, 1);
         }
 
         /* Note that each time a timer is added, this will return
@@ -200,9 +456,73 @@ SDL_TimerThread(void *_data)
          */
         SDL_SemWaitTimeout(data->sem, delay);
     }
+
+    /* Leave the timers that never made it into the heap for cleanup */
+    SDL_AtomicLock(&data->lock);
+    while (retry) {
+        current = retry;
+        retry = retry->next;
+        current->next = data->pending;
+        data->pending = current;
+    }
+    if (freelist_head) {
+        freelist_tail->next = data->freelist;
+        data->freelist = freelist_head;
+    }
+    SDL_AtomicUnlock(&data->lock);
     return 0;
 }
 
+/* Start the worker threads asked for with SDL_HINT_TIMER_THREADS. If they
+   can't be created, the timer thread calls the timers itself. */
+static void
+SDL_StartTimerWorkers(SDL_TimerData *data)
+{
+    const char *hint = SDL_GetHint(SDL_HINT_TIMER_THREADS);
+    int count = hint ? SDL_atoi(hint) : 0;
+
+    if (count <= 0) {
+        return;
+    }
+    count = SDL_min(count, SDL_MAX_TIMER_WORKERS);
+
+    data->work_sem = SDL_CreateSemaphore(0);
+    if (!data->work_sem) {
+        return;
+    }
+
+    SDL_AtomicSet(&data->workers_active, 1);
+    while (data->num_workers < count) {
+        /* Worker threads use a callback into the app too */
+        SDL_Thread *thread = SDL_CreateThreadInternal(SDL_TimerWorker, "SDLTimerWorker", 0, data);
+        if (!thread) {
+            break;
+        }
+        data->workers[data->num_workers++] = thread;
+    }
+}
+
+static void
+SDL_StopTimerWorkers(SDL_TimerData *data)
+{
+    int i;
+
+    SDL_AtomicSet(&data->workers_active, 0);
+    for (i = 0; i < data->num_workers; ++i) {
+        SDL_SemPost(data->work_sem);
+    }
+    for (i = 0; i < data->num_workers; ++i) {
+        SDL_WaitThread(data->workers[i], NULL);
+        data->workers[i] = NULL;
+    }
+    data->num_workers = 0;
+
+    if (data->work_sem) {
+        SDL_DestroySemaphore(data->work_sem);
+        data->work_sem = NULL;
+    }
+}
+
 int
 SDL_TimerInit(void)
 {
@@ -221,6 +541,10 @@ SDL_TimerInit(void)
             return -1;
         }
 
+        data->frequency = SDL_GetPerformanceFrequency();
+
+        SDL_StartTimerWorkers(data);
+
         SDL_AtomicSet(&data->active, 1);
 
         /* Timer threads use a callback into the app, so we can't set a limited stack size here. */
@@ -241,6 +565,7 @@ SDL_TimerQuit(void)
     SDL_TimerData *data = &SDL_timer_data;
     SDL_Timer *timer;
     SDL_TimerMap *entry;
+    int i;
 
     if (SDL_AtomicCAS(&data->active, 1, 0)) {  /* active? Move to inactive. */
         /* Shutdown the timer thread */
@@ -250,37 +575,108 @@ SDL_TimerQuit(void)
             data->thread = NULL;
         }
 
+        /* The workers hand back the timers they have, so stop them next */
+        SDL_StopTimerWorkers(data);
+
         SDL_DestroySemaphore(data->sem);
         data->sem = NULL;
 
         /* Clean up the timer entries */
-        while (data->timers) {
-            timer = data->timers;
-            data->timers = timer->next;
+        for (i = 0; i < data->heap_count; ++i) {
+            SDL_free(data->heap[i]);
+        }
+        SDL_free(data->heap);
+        data->heap = NULL;
+        data->heap_count = 0;
+        data->heap_size = 0;
+        while (data->pending) {
+            timer = data->pending;
+            data->pending = timer->next;
+            SDL_free(timer);
+        }
+        while (data->done) {
+            timer = data->done;
+            data->done = timer->next;
+            SDL_free(timer);
+        }
+        while (data->work_head) {
+            timer = data->work_head;
+            data->work_head = timer->next;
             SDL_free(timer);
         }
+        data->work_tail = NULL;
         while (data->freelist) {
             timer = data->freelist;
             data->freelist = timer->next;
             SDL_free(timer);
         }
-        while (data->timermap) {
-            entry = data->timermap;
-            data->timermap = entry->next;
+        while (data->canceled) {
+            entry = data->canceled;
+            data->canceled = entry->next;
             SDL_free(entry);
         }
+        for (i = 0; i < data->timermap_size; ++i) {
+            while (data->timermap[i]) {
+                entry = data->timermap[i];
+                data->timermap[i] = entry->next;
+                SDL_free(entry);
+            }
+        }
+        SDL_free(data->timermap);
+        data->timermap = NULL;
+        data->timermap_size = 0;
+        data->timermap_count = 0;
 
         SDL_DestroyMutex(data->timermap_lock);
         data->timermap_lock = NULL;
     }
 }
 
+/* Add an entry to the timer map, growing it as needed -- called with the
+   timer map locked */
+static int
+SDL_AddTimerMapEntry(SDL_TimerData *data, SDL_TimerMap *entry)
+{
+    SDL_TimerMap **bucket;
+
+    if (data->timermap_count >= data->timermap_size) {
+        const int size = data->timermap_size ? data->timermap_size * 2 : SDL_TIMERMAP_MIN_SIZE;
+        SDL_TimerMap **timermap = (SDL_TimerMap **)SDL_calloc(size, sizeof(*timermap));
+        if (timermap) {
+            int i;
+
+            for (i = 0; i < data->timermap_size; ++i) {
+                while (data->timermap[i]) {
+                    SDL_TimerMap *next = data->timermap[i]->next;
+                    bucket = &timermap[data->timermap[i]->timerID & (size - 1)];
+                    data->timermap[i]->next = *bucket;
+                    *bucket = data->timermap[i];
+                    data->timermap[i] = next;
+                }
+            }
+            SDL_free(data->timermap);
+            data->timermap = timermap;
+            data->timermap_size = size;
+        } else if (!data->timermap) {
+            return SDL_OutOfMemory();
+        }
+        /* Otherwise the buckets just get longer */
+    }
+
+    bucket = &data->timermap[entry->timerID & (data->timermap_size - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    ++data->timermap_count;
+    return 0;
+}
+
 SDL_TimerID
 SDL_AddTimer(Uint32 interval, SDL_TimerCallback callback, void *param)
 {
     SDL_TimerData *data = &SDL_timer_data;
     SDL_Timer *timer;
     SDL_TimerMap *entry;
+    int retval;
 
     SDL_AtomicLock(&data->lock);
     if (!SDL_AtomicGet(&data->active)) {
@@ -304,12 +700,13 @@ SDL_AddTimer(Uint32 interval, SDL_TimerCallback callback, void *param)
             SDL_OutOfMemory();
             return 0;
         }
+        timer->heap_index = -1;
     }
     timer->timerID = SDL_AtomicIncRef(&data->nextID);
     timer->callback = callback;
     timer->param = param;
     timer->interval = interval;
-    timer->scheduled = SDL_GetTicks() + interval;
+    timer->scheduled = SDL_GetPerformanceCounter() + (Uint64)interval * data->frequency / 1000;
     SDL_AtomicSet(&timer->canceled, 0);
 
     entry = (SDL_TimerMap *)SDL_malloc(sizeof(*entry));
@@ -322,9 +719,13 @@ SDL_AddTimer(Uint32 interval, SDL_TimerCallback callback, void *param)
     entry->timerID = timer->timerID;
 
     SDL_LockMutex(data->timermap_lock);
-    entry->next = data->timermap;
-    data->timermap = entry;
+    retval = SDL_AddTimerMapEntry(data, entry);
     SDL_UnlockMutex(data->timermap_lock);
+    if (retval < 0) {
+        SDL_free(entry);
+        SDL_free(timer);
+        return 0;
+    }
 
     /* Add the timer to the pending list for the timer thread */
     SDL_AtomicLock(&data->lock);
@@ -342,32 +743,61 @@ SDL_bool
 SDL_RemoveTimer(SDL_TimerID id)
 {
     SDL_TimerData *data = &SDL_timer_data;
-    SDL_TimerMap *prev, *entry;
+    SDL_TimerMap **link, *entry = NULL;
     SDL_bool canceled = SDL_FALSE;
 
     /* Find the timer */
     SDL_LockMutex(data->timermap_lock);
-    prev = NULL;
-    for (entry = data->timermap; entry; prev = entry, entry = entry->next) {
-        if (entry->timerID == id) {
-            if (prev) {
-                prev->next = entry->next;
-            } else {
-                data->timermap = entry->next;
+    if (data->timermap) {
+        for (link = &data->timermap[id & (data->timermap_size - 1)]; *link; link = &(*link)->next) {
+            if ((*link)->timerID == id) {
+                entry = *link;
+                *link = entry->next;
+                --data->timermap_count;
+                break;
             }
-            break;
         }
     }
     SDL_UnlockMutex(data->timermap_lock);
 
     if (entry) {
-        if (!SDL_AtomicGet(&entry->timer->canceled)) {
-            SDL_AtomicSet(&entry->timer->canceled, 1);
+        if (SDL_AtomicCAS(&entry->timer->canceled, 0, 1)) {
             canceled = SDL_TRUE;
+
+            /* Have the timer thread take it out of the queue */
+            SDL_AtomicLock(&data->lock);
+            entry->next = data->canceled;
+            data->canceled = entry;
+            SDL_AtomicUnlock(&data->lock);
+            SDL_SemPost(data->sem);
+        } else {
+            SDL_free(entry);
         }
-        SDL_free(entry);
     }
     return canceled;
 }
 
+void
+SDL_GetTimerStats(SDL_TimerStats * stats)
+{
+    SDL_TimerData *data = &SDL_timer_data;
+
+    if (!stats) {
+        return;
+    }
+    SDL_AtomicLock(&data->stats_lock);
+    *stats = data->stats;
+    SDL_AtomicUnlock(&data->stats_lock);
+}
+
+void
+SDL_ResetTimerStats(void)
+{
+    SDL_TimerData *data = &SDL_timer_data;
+
+    SDL_AtomicLock(&data->stats_lock);
+    SDL_zero(data->stats);
+    SDL_AtomicUnlock(&data->stats_lock);
+}
+
 /* vi: set ts=4 sw=4 expandtab: */
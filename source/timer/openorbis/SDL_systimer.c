@@ -65,16 +65,17 @@ Uint32 SDL_GetTicks(void)
     return (ticks);
 }
 
+/* The time stamp counter is cheap enough to read around every event poll */
 Uint64
 SDL_GetPerformanceCounter(void)
 {
-    return SDL_GetTicks();
+    return sceKernelReadTsc();
 }
 
 Uint64
 SDL_GetPerformanceFrequency(void)
 {
-    return 1000;
+    return sceKernelGetTscFrequency();
 }
 
 void SDL_Delay(Uint32 ms)
@@ -104,6 +104,86 @@
 #define OPAQUE_BLIT(to, from, length, bpp, alpha)   \
     PIXEL_COPY(to, from, length, bpp)
 
+#ifdef __SSE2__
+/*
+ * SSE2 versions of the 32bpp blenders, four pixels at a time.
+ * They compute d + (s - d) * alpha / 256 rounded down for each component,
+ * which is exactly what the scalar code below does, so both can be mixed
+ * freely within a run. The full 17-bit product is rebuilt from the low and
+ * high halves of the 16-bit multiplication.
+ */
+static SDL_INLINE __m128i
+BlendRLE_SSE2(__m128i s, __m128i d, __m128i alpha)
+{
+    const __m128i diff = _mm_sub_epi16(s, d);
+    const __m128i lo = _mm_mullo_epi16(diff, alpha);
+    const __m128i hi = _mm_mulhi_epi16(diff, alpha);
+    return _mm_add_epi16(d, _mm_or_si128(_mm_slli_epi16(hi, 8),
+                                         _mm_srli_epi16(lo, 8)));
+}
+
+/* per-surface alpha, the result has a zero top byte like ALPHA_BLIT32_888 */
+static int
+BlendRun888_SSE2(Uint32 * dst, const Uint32 * src, int n, unsigned alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgbmask = _mm_set1_epi32(0x00ffffff);
+    const __m128i a = _mm_set1_epi16((short) alpha);
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        const __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+        const __m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+        const __m128i lo = BlendRLE_SSE2(_mm_unpacklo_epi8(s, zero),
+                                         _mm_unpacklo_epi8(d, zero), a);
+        const __m128i hi = BlendRLE_SSE2(_mm_unpackhi_epi8(s, zero),
+                                         _mm_unpackhi_epi8(d, zero), a);
+        _mm_storeu_si128((__m128i *) (dst + i),
+                         _mm_and_si128(_mm_packus_epi16(lo, hi), rgbmask));
+    }
+    return i;
+}
+
+/* per-pixel alpha in the top byte, the result is opaque like BLIT_TRANSL_888 */
+static int
+BlendTranslRun888_SSE2(Uint32 * dst, const Uint32 * src, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i amask = _mm_set1_epi32(0xff000000);
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        const __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+        const __m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+        const __m128i slo = _mm_unpacklo_epi8(s, zero);
+        const __m128i shi = _mm_unpackhi_epi8(s, zero);
+        /* spread each pixel's alpha over its four components */
+        const __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(slo, 0xff), 0xff);
+        const __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(shi, 0xff), 0xff);
+        const __m128i lo = BlendRLE_SSE2(slo, _mm_unpacklo_epi8(d, zero), alo);
+        const __m128i hi = BlendRLE_SSE2(shi, _mm_unpackhi_epi8(d, zero), ahi);
+        _mm_storeu_si128((__m128i *) (dst + i),
+                         _mm_or_si128(_mm_packus_epi16(lo, hi), amask));
+    }
+    return i;
+}
+
+#define DECLARE_USE_SSE2 const SDL_bool use_sse2 = SDL_HasSSE2()
+#define BLEND_RUN_888(to, from, length, alpha)                      \
+    (use_sse2 ? BlendRun888_SSE2((Uint32 *)(to), (Uint32 *)(from),  \
+                                 (int)(length), alpha) : 0)
+#define BLEND_TRANSL_RUN_888(to, from, length)                          \
+    (use_sse2 ? BlendTranslRun888_SSE2((Uint32 *)(to), (Uint32 *)(from), \
+                                       (int)(length)) : 0)
+#else
+#define DECLARE_USE_SSE2
+#define BLEND_RUN_888(to, from, length, alpha) 0
+#define BLEND_TRANSL_RUN_888(to, from, length) 0
+#endif /* __SSE2__ */
+
+/* The 16bpp translucent blenders are scalar only */
+#define BLEND_TRANSL_RUN_16(to, from, length) 0
+
 /*
  * For 32bpp pixels on the form 0x00rrggbb:
  * If we treat the middle component separately, we can process the two
@@ -113,10 +193,10 @@
  */
 #define ALPHA_BLIT32_888(to, from, length, bpp, alpha)      \
     do {                                                    \
-        int i;                                              \
-        Uint32 *src = (Uint32 *)(from);                     \
-        Uint32 *dst = (Uint32 *)(to);                       \
-        for (i = 0; i < (int)(length); i++) {               \
+        int i = BLEND_RUN_888(to, from, length, alpha);     \
+        Uint32 *src = (Uint32 *)(from) + i;                 \
+        Uint32 *dst = (Uint32 *)(to) + i;                   \
+        for (; i < (int)(length); i++) {                    \
             Uint32 s = *src++;                              \
             Uint32 d = *dst;                                \
             Uint32 s1 = s & 0xff00ff;                       \
@@ -391,6 +471,7 @@ RLEClipBlit(int w, Uint8 * srcbuf, SDL_Surface * surf_dst,
             Uint8 * dstbuf, SDL_Rect * srcrect, unsigned alpha)
 {
     SDL_PixelFormat *fmt = surf_dst->format;
+    DECLARE_USE_SSE2;
 
 #define RLECLIPBLIT(bpp, Type, do_blit)                         \
     do {                                                        \
@@ -519,6 +600,7 @@ SDL_RLEBlit(SDL_Surface * surf_src, SDL_Rect * srcrect,
         RLEClipBlit(w, srcbuf, surf_dst, dstbuf, srcrect, alpha);
     } else {
         SDL_PixelFormat *fmt = surf_src->format;
+        DECLARE_USE_SSE2;
 
 #define RLEBLIT(bpp, Type, do_blit)                       \
         do {                                  \
@@ -636,12 +718,14 @@ RLEAlphaClipBlit(int w, Uint8 * srcbuf, SDL_Surface * surf_dst,
                  Uint8 * dstbuf, SDL_Rect * srcrect)
 {
     SDL_PixelFormat *df = surf_dst->format;
+    DECLARE_USE_SSE2;
     /*
      * clipped blitter: Ptype is the destination pixel type,
-     * Ctype the translucent count type, and do_blend the macro
-     * to blend one pixel.
+     * Ctype the translucent count type, do_blend the macro
+     * to blend one pixel and do_blend_run the one to blend as much
+     * of a run as it can at once.
      */
-#define RLEALPHACLIPBLIT(Ptype, Ctype, do_blend)              \
+#define RLEALPHACLIPBLIT(Ptype, Ctype, do_blend, do_blend_run) \
     do {                                  \
     int linecount = srcrect->h;                   \
     int left = srcrect->x;                        \
@@ -697,8 +781,8 @@ RLEAlphaClipBlit(int w, Uint8 * srcbuf, SDL_Surface * surf_dst,
             if(crun > 0) {                    \
             Ptype *dst = (Ptype *)dstbuf + cofs;          \
             Uint32 *src = (Uint32 *)srcbuf + (cofs - ofs);    \
-            int i;                        \
-            for(i = 0; i < crun; i++)             \
+            int i = do_blend_run(dst, src, crun);         \
+            for(; i < crun; i++)                  \
                 do_blend(src[i], dst[i]);             \
             }                             \
             srcbuf += run * 4;                    \
@@ -712,12 +796,12 @@ RLEAlphaClipBlit(int w, Uint8 * srcbuf, SDL_Surface * surf_dst,
     switch (df->BytesPerPixel) {
     case 2:
         if (df->Gmask == 0x07e0 || df->Rmask == 0x07e0 || df->Bmask == 0x07e0)
-            RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_565);
+            RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_565, BLEND_TRANSL_RUN_16);
         else
-            RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_555);
+            RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_555, BLEND_TRANSL_RUN_16);
         break;
     case 4:
-        RLEALPHACLIPBLIT(Uint32, Uint16, BLIT_TRANSL_888);
+        RLEALPHACLIPBLIT(Uint32, Uint16, BLIT_TRANSL_888, BLEND_TRANSL_RUN_888);
         break;
     }
 }
@@ -804,13 +888,15 @@ SDL_RLEAlphaBlit(SDL_Surface * surf_src, SDL_Rect * srcrect,
     if (srcrect->x || srcrect->w != surf_src->w) {
         RLEAlphaClipBlit(w, srcbuf, surf_dst, dstbuf, srcrect);
     } else {
+        DECLARE_USE_SSE2;
 
         /*
          * non-clipped blitter. Ptype is the destination pixel type,
-         * Ctype the translucent count type, and do_blend the
-         * macro to blend one pixel.
+         * Ctype the translucent count type, do_blend the
+         * macro to blend one pixel and do_blend_run the one to blend
+         * as much of a run as it can at once.
          */
-#define RLEALPHABLIT(Ptype, Ctype, do_blend)                 \
+#define RLEALPHABLIT(Ptype, Ctype, do_blend, do_blend_run)   \
     do {                                 \
         int linecount = srcrect->h;                  \
         do {                             \
@@ -841,8 +927,10 @@ SDL_RLEAlphaBlit(SDL_Surface * surf_src, SDL_Rect * srcrect,
             srcbuf += 4;                     \
             if(run) {                        \
             Ptype *dst = (Ptype *)dstbuf + ofs;      \
-            unsigned i;                  \
-            for(i = 0; i < run; i++) {           \
+            unsigned i = do_blend_run(dst, srcbuf, run); \
+            srcbuf += i * 4;                 \
+            dst += i;                    \
+            for(; i < run; i++) {                \
                 Uint32 src = *(Uint32 *)srcbuf;      \
                 do_blend(src, *dst);             \
                 srcbuf += 4;                 \
@@ -859,12 +947,12 @@ SDL_RLEAlphaBlit(SDL_Surface * surf_src, SDL_Rect * srcrect,
         case 2:
             if (df->Gmask == 0x07e0 || df->Rmask == 0x07e0
                 || df->Bmask == 0x07e0)
-                RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_565);
+                RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_565, BLEND_TRANSL_RUN_16);
             else
-                RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_555);
+                RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_555, BLEND_TRANSL_RUN_16);
             break;
         case 4:
-            RLEALPHABLIT(Uint32, Uint16, BLIT_TRANSL_888);
+            RLEALPHABLIT(Uint32, Uint16, BLIT_TRANSL_888, BLEND_TRANSL_RUN_888);
             break;
         }
     }
@@ -986,9 +1074,38 @@ static int
 copy_32(void *dst, Uint32 * src, int n,
         SDL_PixelFormat * sfmt, SDL_PixelFormat * dfmt)
 {
-    int i;
+    int i = 0;
     Uint32 *d = dst;
-    for (i = 0; i < n; i++) {
+#ifdef __SSE2__
+    /* With 8-bit components everywhere this is just moving bytes around */
+    if (n >= 4 && SDL_HasSSE2() &&
+        (sfmt->Rmask >> sfmt->Rshift) == 0xff &&
+        (sfmt->Gmask >> sfmt->Gshift) == 0xff &&
+        (sfmt->Bmask >> sfmt->Bshift) == 0xff &&
+        (sfmt->Amask >> sfmt->Ashift) == 0xff &&
+        !dfmt->Rloss && !dfmt->Gloss && !dfmt->Bloss) {
+        const __m128i ff = _mm_set1_epi32(0xff);
+        const __m128i sr = _mm_cvtsi32_si128(sfmt->Rshift);
+        const __m128i sg = _mm_cvtsi32_si128(sfmt->Gshift);
+        const __m128i sb = _mm_cvtsi32_si128(sfmt->Bshift);
+        const __m128i sa = _mm_cvtsi32_si128(sfmt->Ashift);
+        const __m128i dr = _mm_cvtsi32_si128(dfmt->Rshift);
+        const __m128i dg = _mm_cvtsi32_si128(dfmt->Gshift);
+        const __m128i db = _mm_cvtsi32_si128(dfmt->Bshift);
+        for (; i + 4 <= n; i += 4) {
+            const __m128i s = _mm_loadu_si128((const __m128i *) src);
+            __m128i p;
+            p = _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(s, sr), ff), dr);
+            p = _mm_or_si128(p, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(s, sg), ff), dg));
+            p = _mm_or_si128(p, _mm_sll_epi32(_mm_and_si128(_mm_srl_epi32(s, sb), ff), db));
+            p = _mm_or_si128(p, _mm_slli_epi32(_mm_srl_epi32(s, sa), 24));
+            _mm_storeu_si128((__m128i *) d, p);
+            src += 4;
+            d += 4;
+        }
+    }
+#endif
+    for (; i < n; i++) {
         unsigned r, g, b, a;
         RGBA_FROM_8888(*src, sfmt, r, g, b, a);
         RLEPIXEL_FROM_RGBA(*d, dfmt, r, g, b, a);
@@ -1021,6 +1138,66 @@ uncopy_32(Uint32 * dst, void *src, int n,
 #define ISTRANSL(pixel, fmt)    \
     ((unsigned)((((pixel) & fmt->Amask) >> fmt->Ashift) - 1U) < 254U)
 
+/* index of the lowest set bit, mask must not be zero */
+static SDL_INLINE int
+RLEFirstBit(Uint32 mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+/*
+ * Find where a run of pixels that are (or are not, if !inside) opaque,
+ * or translucent if transl is set, ends. Used by the alpha encoder to
+ * classify four pixels per step instead of one.
+ */
+static int
+RLEAlphaRunEnd(const Uint32 * src, int x, int w, const SDL_PixelFormat * sf,
+               SDL_bool transl, SDL_bool inside)
+{
+#ifdef __SSE2__
+    if ((sf->Amask >> sf->Ashift) == 0xff && SDL_HasSSE2()) {
+        const __m128i amask = _mm_set1_epi32(sf->Amask);
+        const __m128i ashift = _mm_cvtsi32_si128(sf->Ashift);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ff = _mm_set1_epi32(0xff);
+        const int want = inside ? 0xf : 0;
+        for (; x + 4 <= w; x += 4) {
+            const __m128i v = _mm_loadu_si128((const __m128i *) (src + x));
+            const __m128i a = _mm_srl_epi32(_mm_and_si128(v, amask), ashift);
+            __m128i match = _mm_cmpeq_epi32(a, ff);
+            int bits;
+            if (transl) {
+                /* neither completely transparent nor opaque */
+                match = _mm_or_si128(match, _mm_cmpeq_epi32(a, zero));
+                bits = ~_mm_movemask_ps(_mm_castsi128_ps(match)) & 0xf;
+            } else {
+                bits = _mm_movemask_ps(_mm_castsi128_ps(match));
+            }
+            if (bits != want) {
+                return x + RLEFirstBit(bits ^ want);
+            }
+        }
+    }
+#endif
+    if (transl) {
+        while (x < w && (ISTRANSL(src[x], sf) ? inside : !inside))
+            x++;
+    } else {
+        while (x < w && (ISOPAQUE(src[x], sf) ? inside : !inside))
+            x++;
+    }
+    return x;
+}
+
 /* convert surface to be quickly alpha-blittable onto dest, if possible */
 static int
 RLEAlphaSurface(SDL_Surface * surface)
@@ -1146,11 +1323,9 @@ RLEAlphaSurface(SDL_Surface * surface)
             do {
                 int run, skip, len;
                 skipstart = x;
-                while (x < w && !ISOPAQUE(src[x], sf))
-                    x++;
+                x = RLEAlphaRunEnd(src, x, w, sf, SDL_FALSE, SDL_FALSE);
                 runstart = x;
-                while (x < w && ISOPAQUE(src[x], sf))
-                    x++;
+                x = RLEAlphaRunEnd(src, x, w, sf, SDL_FALSE, SDL_TRUE);
                 skip = runstart - skipstart;
                 if (skip == w)
                     blankline = 1;
@@ -1181,11 +1356,9 @@ RLEAlphaSurface(SDL_Surface * surface)
             do {
                 int run, skip, len;
                 skipstart = x;
-                while (x < w && !ISTRANSL(src[x], sf))
-                    x++;
+                x = RLEAlphaRunEnd(src, x, w, sf, SDL_TRUE, SDL_FALSE);
                 runstart = x;
-                while (x < w && ISTRANSL(src[x], sf))
-                    x++;
+                x = RLEAlphaRunEnd(src, x, w, sf, SDL_TRUE, SDL_TRUE);
                 skip = runstart - skipstart;
                 blankline &= (skip == w);
                 run = x - runstart;
@@ -1235,40 +1408,92 @@ RLEAlphaSurface(SDL_Surface * surface)
     return 0;
 }
 
-static Uint32
-getpix_8(Uint8 * srcbuf)
-{
-    return *srcbuf;
-}
-
-static Uint32
-getpix_16(Uint8 * srcbuf)
-{
-    return *(Uint16 *) srcbuf;
-}
-
-static Uint32
-getpix_24(Uint8 * srcbuf)
-{
+#define GETPIX_8(srcbuf)    (*(const Uint8 *)(srcbuf))
+#define GETPIX_16(srcbuf)   (*(const Uint16 *)(srcbuf))
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
-    return srcbuf[0] + (srcbuf[1] << 8) + (srcbuf[2] << 16);
+#define GETPIX_24(srcbuf)   \
+    ((srcbuf)[0] + ((srcbuf)[1] << 8) + ((srcbuf)[2] << 16))
 #else
-    return (srcbuf[0] << 16) + (srcbuf[1] << 8) + srcbuf[2];
+#define GETPIX_24(srcbuf)   \
+    (((srcbuf)[0] << 16) + ((srcbuf)[1] << 8) + (srcbuf)[2])
 #endif
-}
+#define GETPIX_32(srcbuf)   (*(const Uint32 *)(srcbuf))
 
-static Uint32
-getpix_32(Uint8 * srcbuf)
+/*
+ * Find where a run of transparent (or, if !transparent, opaque) colorkeyed
+ * pixels starting at x ends. The SSE2 path compares 16 bytes of pixels
+ * against the key at once.
+ */
+static int
+RLEColorkeyRunEnd(const Uint8 * srcbuf, int x, int w, int bpp,
+                  Uint32 ckey, Uint32 rgbmask, SDL_bool transparent)
 {
-    return *(Uint32 *) srcbuf;
+#define SCAN_SCALAR(getpix)                                             \
+    while (x < w && ((getpix(srcbuf + x * bpp) & rgbmask) == ckey) == transparent) \
+        x++;
+
+#ifdef __SSE2__
+    /* a key wider than the pixel never matches, leave that to the scalar code */
+    if ((bpp == 4 || (ckey >> (bpp * 8)) == 0) && bpp != 3 && SDL_HasSSE2()) {
+        const int per_vector = 16 / bpp;
+        const int want = transparent ? 0xffff : 0;
+        __m128i key, mask;
+        switch (bpp) {
+        case 1:
+            key = _mm_set1_epi8((char) ckey);
+            mask = _mm_set1_epi8((char) rgbmask);
+            break;
+        case 2:
+            key = _mm_set1_epi16((short) ckey);
+            mask = _mm_set1_epi16((short) rgbmask);
+            break;
+        default:
+            key = _mm_set1_epi32(ckey);
+            mask = _mm_set1_epi32(rgbmask);
+            break;
+        }
+        for (; x + per_vector <= w; x += per_vector) {
+            const __m128i v = _mm_and_si128(
+                _mm_loadu_si128((const __m128i *) (srcbuf + x * bpp)), mask);
+            __m128i eq;
+            int bits;
+            switch (bpp) {
+            case 1:
+                eq = _mm_cmpeq_epi8(v, key);
+                break;
+            case 2:
+                eq = _mm_cmpeq_epi16(v, key);
+                break;
+            default:
+                eq = _mm_cmpeq_epi32(v, key);
+                break;
+            }
+            /* one bit per byte, so bpp bits per pixel */
+            bits = _mm_movemask_epi8(eq);
+            if (bits != want) {
+                return x + RLEFirstBit(bits ^ want) / bpp;
+            }
+        }
+    }
+#endif
+    switch (bpp) {
+    case 1:
+        SCAN_SCALAR(GETPIX_8);
+        break;
+    case 2:
+        SCAN_SCALAR(GETPIX_16);
+        break;
+    case 3:
+        SCAN_SCALAR(GETPIX_24);
+        break;
+    case 4:
+        SCAN_SCALAR(GETPIX_32);
+        break;
+    }
+#undef SCAN_SCALAR
+    return x;
 }
 
-typedef Uint32(*getpix_func) (Uint8 *);
-
-static const getpix_func getpixes[4] = {
-    getpix_8, getpix_16, getpix_24, getpix_32
-};
-
 static int
 RLEColorkeySurface(SDL_Surface * surface)
 {
@@ -1278,7 +1503,6 @@ RLEColorkeySurface(SDL_Surface * surface)
     Uint8 *srcbuf, *lastline;
     int maxsize = 0;
     const int bpp = surface->format->BytesPerPixel;
-    getpix_func getpix;
     Uint32 ckey, rgbmask;
     int w, h;
 
@@ -1317,7 +1541,6 @@ RLEColorkeySurface(SDL_Surface * surface)
     rgbmask = ~surface->format->Amask;
     ckey = surface->map->info.colorkey & rgbmask;
     lastline = dst;
-    getpix = getpixes[bpp - 1];
     w = surface->w;
     h = surface->h;
 
@@ -1341,11 +1564,9 @@ RLEColorkeySurface(SDL_Surface * surface)
             int skipstart = x;
 
             /* find run of transparent, then opaque pixels */
-            while (x < w && (getpix(srcbuf + x * bpp) & rgbmask) == ckey)
-                x++;
+            x = RLEColorkeyRunEnd(srcbuf, x, w, bpp, ckey, rgbmask, SDL_TRUE);
             runstart = x;
-            while (x < w && (getpix(srcbuf + x * bpp) & rgbmask) != ckey)
-                x++;
+            x = RLEColorkeyRunEnd(srcbuf, x, w, bpp, ckey, rgbmask, SDL_FALSE);
             skip = runstart - skipstart;
             if (skip == w)
                 blankline = 1;
@@ -1419,6 +1640,11 @@ SDL_RLESurface(SDL_Surface * surface)
         return -1;
     }
 
+    /* Encoding would free pixels that views of the surface are using */
+    if ((surface->flags & (SDL_SHAREDPIXELS | SDL_PREALLOC)) == SDL_SHAREDPIXELS) {
+        return -1;
+    }
+
     /* If we don't have colorkey or blending, nothing to do... */
     flags = surface->map->info.flags;
     if (!(flags & (SDL_COPY_COLORKEY | SDL_COPY_BLEND))) {
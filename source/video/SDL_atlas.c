@@ -0,0 +1,472 @@
+/*
+  Simple DirectMedia Layer
+  Copyright (C) 1997-2018 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../SDL_internal.h"
+
+/*
+ * Sprite atlases: many small surfaces packed into one large surface with a
+ * skyline bottom-left packer, so they can share a single blit mapping and be
+ * drawn in batches.
+ */
+
+#include "SDL_video.h"
+#include "SDL_blit.h"
+#include "SDL_pixels_c.h"
+
+/* One horizontal segment of the packed area's upper outline */
+typedef struct
+{
+    int x, y, w;
+} SDL_AtlasSkyline;
+
+/* A batch entry after clipping, ready to hand to the blitter */
+typedef struct
+{
+    SDL_Rect src;
+    SDL_Rect dst;
+} SDL_AtlasBlitOp;
+
+struct SDL_Atlas
+{
+    SDL_Surface *surface;
+
+    SDL_AtlasSkyline *skyline;
+    int num_skyline;
+
+    SDL_Rect *rects;
+    int num_rects;
+    int max_rects;
+
+    /* scratch space for SDL_BlitAtlasBatch(), kept to avoid per-frame mallocs */
+    SDL_AtlasBlitOp *ops;
+    int max_ops;
+};
+
+SDL_Atlas *
+SDL_CreateAtlas(int w, int h, Uint32 format)
+{
+    SDL_Atlas *atlas;
+
+    if (w <= 0 || h <= 0) {
+        SDL_InvalidParamError("w/h");
+        return NULL;
+    }
+
+    atlas = (SDL_Atlas *) SDL_calloc(1, sizeof(*atlas));
+    if (!atlas) {
+        SDL_OutOfMemory();
+        return NULL;
+    }
+
+    /* Segments never overlap, so there are at most w of them (plus one while inserting) */
+    atlas->skyline = (SDL_AtlasSkyline *) SDL_malloc((w + 1) * sizeof(*atlas->skyline));
+    if (!atlas->skyline) {
+        SDL_FreeAtlas(atlas);
+        SDL_OutOfMemory();
+        return NULL;
+    }
+    atlas->skyline[0].x = 0;
+    atlas->skyline[0].y = 0;
+    atlas->skyline[0].w = w;
+    atlas->num_skyline = 1;
+
+    /* New surfaces are zero filled, so unused space is transparent */
+    atlas->surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 0, format);
+    if (!atlas->surface) {
+        SDL_FreeAtlas(atlas);
+        return NULL;
+    }
+    return atlas;
+}
+
+/* Lowest y a w by h rectangle can sit at on top of skyline node i, or -1 */
+static int
+SDL_AtlasFit(const SDL_Atlas * atlas, int i, int w, int h)
+{
+    const SDL_AtlasSkyline *node = &atlas->skyline[i];
+    int width_left = w;
+    int y = node->y;
+
+    if (node->x + w > atlas->surface->w) {
+        return -1;
+    }
+    while (width_left > 0) {
+        if (node->y > y) {
+            y = node->y;
+        }
+        if (y + h > atlas->surface->h) {
+            return -1;
+        }
+        width_left -= node->w;
+        ++node;
+    }
+    return y;
+}
+
+static SDL_bool
+SDL_AtlasPack(SDL_Atlas * atlas, int w, int h, SDL_Rect * rect)
+{
+    SDL_AtlasSkyline *skyline = atlas->skyline;
+    int best = -1, best_bottom = 0, best_width = 0;
+    int i;
+
+    /* Bottom-left rule, ties broken by the narrowest segment */
+    for (i = 0; i < atlas->num_skyline; ++i) {
+        const int y = SDL_AtlasFit(atlas, i, w, h);
+        if (y >= 0) {
+            const int bottom = y + h;
+            if (best < 0 || bottom < best_bottom ||
+                (bottom == best_bottom && skyline[i].w < best_width)) {
+                best = i;
+                best_bottom = bottom;
+                best_width = skyline[i].w;
+                rect->x = skyline[i].x;
+                rect->y = y;
+            }
+        }
+    }
+    if (best < 0) {
+        return SDL_FALSE;
+    }
+    rect->w = w;
+    rect->h = h;
+
+    /* Insert the new segment on top of the rectangle */
+    SDL_memmove(&skyline[best + 1], &skyline[best],
+                (atlas->num_skyline - best) * sizeof(*skyline));
+    skyline[best].x = rect->x;
+    skyline[best].y = rect->y + h;
+    skyline[best].w = w;
+    ++atlas->num_skyline;
+
+    /* Trim or drop the segments it now covers */
+    i = best + 1;
+    while (i < atlas->num_skyline) {
+        const int covered = skyline[i - 1].x + skyline[i - 1].w - skyline[i].x;
+        if (covered <= 0) {
+            break;
+        }
+        if (covered < skyline[i].w) {
+            skyline[i].x += covered;
+            skyline[i].w -= covered;
+            break;
+        }
+        SDL_memmove(&skyline[i], &skyline[i + 1],
+                    (atlas->num_skyline - i - 1) * sizeof(*skyline));
+        --atlas->num_skyline;
+    }
+
+    /* Merge neighbours at the same height */
+    for (i = 0; i < atlas->num_skyline - 1; ) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].w += skyline[i + 1].w;
+            SDL_memmove(&skyline[i + 1], &skyline[i + 2],
+                        (atlas->num_skyline - i - 2) * sizeof(*skyline));
+            --atlas->num_skyline;
+        } else {
+            ++i;
+        }
+    }
+    return SDL_TRUE;
+}
+
+int
+SDL_AtlasAddSurface(SDL_Atlas * atlas, SDL_Surface * surface)
+{
+    SDL_BlendMode blendMode;
+    SDL_Rect rect;
+
+    if (!atlas) {
+        return SDL_InvalidParamError("atlas");
+    }
+    if (!surface) {
+        return SDL_InvalidParamError("surface");
+    }
+
+    if (atlas->num_rects == atlas->max_rects) {
+        const int max_rects = atlas->max_rects ? atlas->max_rects * 2 : 64;
+        SDL_Rect *rects = (SDL_Rect *) SDL_realloc(atlas->rects, max_rects * sizeof(*rects));
+        if (!rects) {
+            return SDL_OutOfMemory();
+        }
+        atlas->rects = rects;
+        atlas->max_rects = max_rects;
+    }
+
+    if (!SDL_AtlasPack(atlas, surface->w, surface->h, &rect)) {
+        return SDL_SetError("Atlas is full");
+    }
+
+    /* Copy the pixels as they are, colorkeyed pixels are left transparent */
+    SDL_GetSurfaceBlendMode(surface, &blendMode);
+    SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+    if (SDL_BlitSurface(surface, NULL, atlas->surface, &rect) < 0) {
+        SDL_SetSurfaceBlendMode(surface, blendMode);
+        return -1;
+    }
+    SDL_SetSurfaceBlendMode(surface, blendMode);
+
+    atlas->rects[atlas->num_rects] = rect;
+    return atlas->num_rects++;
+}
+
+static int
+SDL_CompareAtlasHeights(const void *a, const void *b)
+{
+    const SDL_Surface *A = *(const SDL_Surface **) a;
+    const SDL_Surface *B = *(const SDL_Surface **) b;
+
+    if (A->h != B->h) {
+        return B->h - A->h;
+    }
+    return B->w - A->w;
+}
+
+int
+SDL_AtlasAddSurfaces(SDL_Atlas * atlas, SDL_Surface ** surfaces, int count,
+                     int *handles)
+{
+    SDL_Surface **sorted;
+    int i, j, added = 0;
+
+    if (!atlas) {
+        return SDL_InvalidParamError("atlas");
+    }
+    if (!surfaces || count < 0) {
+        return SDL_InvalidParamError("surfaces");
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    /* Packing tallest first wastes a lot less space. The count comes from
+       the caller, so the copy goes on the heap rather than the stack. */
+    sorted = (SDL_Surface **) SDL_malloc(count * sizeof(*sorted));
+    if (!sorted) {
+        return SDL_OutOfMemory();
+    }
+    SDL_memcpy(sorted, surfaces, count * sizeof(*sorted));
+    SDL_qsort(sorted, count, sizeof(*sorted), SDL_CompareAtlasHeights);
+
+    for (i = 0; i < count; ++i) {
+        const int handle = SDL_AtlasAddSurface(atlas, sorted[i]);
+        if (handle >= 0) {
+            ++added;
+        }
+        if (handles) {
+            for (j = 0; j < count; ++j) {
+                if (surfaces[j] == sorted[i]) {
+                    handles[j] = handle;
+                }
+            }
+        }
+    }
+    SDL_free(sorted);
+
+    if (added < count) {
+        SDL_SetError("Atlas is full");
+    }
+    return added;
+}
+
+SDL_Surface *
+SDL_GetAtlasSurface(SDL_Atlas * atlas)
+{
+    if (!atlas) {
+        SDL_InvalidParamError("atlas");
+        return NULL;
+    }
+    return atlas->surface;
+}
+
+int
+SDL_GetAtlasRect(SDL_Atlas * atlas, int handle, SDL_Rect * rect)
+{
+    if (!atlas) {
+        return SDL_InvalidParamError("atlas");
+    }
+    if (handle < 0 || handle >= atlas->num_rects) {
+        return SDL_InvalidParamError("handle");
+    }
+    if (rect) {
+        *rect = atlas->rects[handle];
+    }
+    return 0;
+}
+
+static int
+SDL_CompareAtlasBlitOps(const void *a, const void *b)
+{
+    const SDL_AtlasBlitOp *A = (const SDL_AtlasBlitOp *) a;
+    const SDL_AtlasBlitOp *B = (const SDL_AtlasBlitOp *) b;
+
+    if (A->dst.y != B->dst.y) {
+        return A->dst.y - B->dst.y;
+    }
+    return A->dst.x - B->dst.x;
+}
+
+int
+SDL_BlitAtlasBatch(SDL_Atlas * atlas, SDL_Surface * dst,
+                   const SDL_AtlasBlit * entries, int count)
+{
+    SDL_Surface *src;
+    const SDL_Rect *clip;
+    SDL_BlitMap *map;
+    int i, num_ops = 0;
+
+    if (!atlas) {
+        return SDL_InvalidParamError("atlas");
+    }
+    if (!dst) {
+        return SDL_InvalidParamError("dst");
+    }
+    if (!entries || count < 0) {
+        return SDL_InvalidParamError("entries");
+    }
+    src = atlas->surface;
+    if (src->locked || dst->locked) {
+        return SDL_SetError("Surfaces must not be locked during blit");
+    }
+
+    if (count > atlas->max_ops) {
+        SDL_AtlasBlitOp *ops = (SDL_AtlasBlitOp *) SDL_realloc(atlas->ops, count * sizeof(*ops));
+        if (!ops) {
+            return SDL_OutOfMemory();
+        }
+        atlas->ops = ops;
+        atlas->max_ops = count;
+    }
+
+    /* Clip everything against the destination up front */
+    clip = &dst->clip_rect;
+    for (i = 0; i < count; ++i) {
+        SDL_AtlasBlitOp *op = &atlas->ops[num_ops];
+        int dx, dy;
+
+        if (entries[i].handle < 0 || entries[i].handle >= atlas->num_rects) {
+            return SDL_InvalidParamError("entries");
+        }
+        op->src = atlas->rects[entries[i].handle];
+        op->dst.x = entries[i].x;
+        op->dst.y = entries[i].y;
+
+        dx = clip->x - op->dst.x;
+        if (dx > 0) {
+            op->src.w -= dx;
+            op->src.x += dx;
+            op->dst.x += dx;
+        }
+        dx = op->dst.x + op->src.w - clip->x - clip->w;
+        if (dx > 0) {
+            op->src.w -= dx;
+        }
+        dy = clip->y - op->dst.y;
+        if (dy > 0) {
+            op->src.h -= dy;
+            op->src.y += dy;
+            op->dst.y += dy;
+        }
+        dy = op->dst.y + op->src.h - clip->y - clip->h;
+        if (dy > 0) {
+            op->src.h -= dy;
+        }
+        if (op->src.w > 0 && op->src.h > 0) {
+            op->dst.w = op->src.w;
+            op->dst.h = op->src.h;
+            ++num_ops;
+        }
+    }
+    if (!num_ops) {
+        return 0;
+    }
+
+    /* Walk the destination top to bottom, for cache locality */
+    SDL_qsort(atlas->ops, num_ops, sizeof(*atlas->ops), SDL_CompareAtlasBlitOps);
+
+    /* Map once for the whole batch */
+    map = src->map;
+    if ((map->dst != dst) ||
+        (dst->format->palette &&
+         map->dst_palette_version != dst->format->palette->version) ||
+        (src->format->palette &&
+         map->src_palette_version != src->format->palette->version)) {
+        if (SDL_MapSurface(src, dst) < 0) {
+            return -1;
+        }
+    }
+
+    if (map->info.flags & SDL_COPY_RLE_MASK) {
+        /* RLE blits decode from the start of the surface, go through them */
+        for (i = 0; i < num_ops; ++i) {
+            if (map->blit(src, &atlas->ops[i].src, dst, &atlas->ops[i].dst) < 0) {
+                return -1;
+            }
+        }
+    } else {
+        SDL_BlitFunc RunBlit = (SDL_BlitFunc) map->data;
+        SDL_BlitInfo *info = &map->info;
+        const int src_bpp = info->src_fmt->BytesPerPixel;
+        const int dst_bpp = info->dst_fmt->BytesPerPixel;
+
+        if (SDL_MUSTLOCK(dst) && SDL_LockSurface(dst) < 0) {
+            return -1;
+        }
+
+        /* The same kernel over every entry, only the pointers change */
+        info->src_pitch = src->pitch;
+        info->dst_pitch = dst->pitch;
+        for (i = 0; i < num_ops; ++i) {
+            const SDL_AtlasBlitOp *op = &atlas->ops[i];
+            info->src = (Uint8 *) src->pixels + op->src.y * src->pitch +
+                op->src.x * src_bpp;
+            info->src_w = op->src.w;
+            info->src_h = op->src.h;
+            info->src_skip = info->src_pitch - info->src_w * src_bpp;
+            info->dst = (Uint8 *) dst->pixels + op->dst.y * dst->pitch +
+                op->dst.x * dst_bpp;
+            info->dst_w = op->dst.w;
+            info->dst_h = op->dst.h;
+            info->dst_skip = info->dst_pitch - info->dst_w * dst_bpp;
+            RunBlit(info);
+        }
+
+        if (SDL_MUSTLOCK(dst)) {
+            SDL_UnlockSurface(dst);
+        }
+    }
+    return 0;
+}
+
+void
+SDL_FreeAtlas(SDL_Atlas * atlas)
+{
+    if (!atlas) {
+        return;
+    }
+    SDL_FreeSurface(atlas->surface);
+    SDL_free(atlas->skyline);
+    SDL_free(atlas->rects);
+    SDL_free(atlas->ops);
+    SDL_free(atlas);
+}
+
+/* vi: set ts=4 sw=4 expandtab: */
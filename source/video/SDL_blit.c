@@ -124,11 +124,9 @@ SDL_UseAltivecPrefetch()
 }
 #endif /* __MACOSX__ */
 
-static SDL_BlitFunc
-SDL_ChooseBlitFunc(Uint32 src_format, Uint32 dst_format, int flags,
-                   SDL_BlitFuncEntry * entries)
+static Uint32
+SDL_GetBlitCPUFeatures(void)
 {
-    int i, flagcheck;
     static Uint32 features = 0xffffffff;
 
     /* Get the available CPU features */
@@ -162,6 +160,15 @@ SDL_ChooseBlitFunc(Uint32 src_format, Uint32 dst_format, int flags,
             }
         }
     }
+    return features;
+}
+
+static SDL_BlitFunc
+SDL_ChooseBlitFunc(Uint32 src_format, Uint32 dst_format, int flags,
+                   SDL_BlitFuncEntry * entries)
+{
+    int i, flagcheck;
+    Uint32 features = SDL_GetBlitCPUFeatures();
 
     for (i = 0; entries[i].func; ++i) {
         /* Check for matching pixel formats */
@@ -211,13 +218,132 @@ SDL_ChooseBlitFunc(Uint32 src_format, Uint32 dst_format, int flags,
     return NULL;
 }
 
+/* Blit functions chosen so far, so that remapping a surface after its color
+   mod, alpha mod or blend mode changed doesn't walk the whole selection
+   chain again.  Everything the choice depends on is part of the key.
+ */
+#define BLIT_CACHE_SIZE     256     /* must be a power of two */
+#define BLIT_CACHE_PROBES   4
+
+typedef struct
+{
+    Uint32 src_format;
+    Uint32 dst_format;
+    int flags;
+    int identity;
+    Uint32 cpu;
+    SDL_BlitFunc func;
+} SDL_BlitCacheEntry;
+
+static SDL_BlitCacheEntry SDL_blit_cache[BLIT_CACHE_SIZE];
+static SDL_SpinLock SDL_blit_cache_lock;
+static Uint32 SDL_blit_cache_hits;
+static Uint32 SDL_blit_cache_misses;
+SDL_atomic_t SDL_palette_map_hits;
+SDL_atomic_t SDL_palette_map_misses;
+
+static Uint32
+SDL_HashBlitKey(Uint32 src_format, Uint32 dst_format, int flags, int identity)
+{
+    Uint32 hash = src_format * 0x9E3779B1u;
+    hash = (hash ^ dst_format) * 0x85EBCA77u;
+    hash = (hash ^ (Uint32) flags) * 0xC2B2AE3Du;
+    hash ^= (Uint32) identity;
+    return hash ^ (hash >> 16);
+}
+
+static SDL_BlitFunc
+SDL_LookupBlitCache(Uint32 src_format, Uint32 dst_format, int flags,
+                    int identity, Uint32 cpu)
+{
+    Uint32 slot = SDL_HashBlitKey(src_format, dst_format, flags, identity);
+    SDL_BlitFunc func = NULL;
+    int i;
+
+    SDL_AtomicLock(&SDL_blit_cache_lock);
+    for (i = 0; i < BLIT_CACHE_PROBES; ++i, ++slot) {
+        const SDL_BlitCacheEntry *entry = &SDL_blit_cache[slot & (BLIT_CACHE_SIZE - 1)];
+        if (!entry->func) {
+            break;
+        }
+        if (entry->src_format == src_format && entry->dst_format == dst_format &&
+            entry->flags == flags && entry->identity == identity &&
+            entry->cpu == cpu) {
+            func = entry->func;
+            break;
+        }
+    }
+    if (func) {
+        ++SDL_blit_cache_hits;
+    } else {
+        ++SDL_blit_cache_misses;
+    }
+    SDL_AtomicUnlock(&SDL_blit_cache_lock);
+
+    return func;
+}
+
+static void
+SDL_InsertBlitCache(Uint32 src_format, Uint32 dst_format, int flags,
+                    int identity, Uint32 cpu, SDL_BlitFunc func)
+{
+    Uint32 slot = SDL_HashBlitKey(src_format, dst_format, flags, identity);
+    SDL_BlitCacheEntry *entry = &SDL_blit_cache[slot & (BLIT_CACHE_SIZE - 1)];
+    int i;
+
+    SDL_AtomicLock(&SDL_blit_cache_lock);
+    /* Take the first free slot, or evict the first one probed */
+    for (i = 0; i < BLIT_CACHE_PROBES; ++i, ++slot) {
+        if (!SDL_blit_cache[slot & (BLIT_CACHE_SIZE - 1)].func) {
+            entry = &SDL_blit_cache[slot & (BLIT_CACHE_SIZE - 1)];
+            break;
+        }
+    }
+    entry->src_format = src_format;
+    entry->dst_format = dst_format;
+    entry->flags = flags;
+    entry->identity = identity;
+    entry->cpu = cpu;
+    entry->func = func;
+    SDL_AtomicUnlock(&SDL_blit_cache_lock);
+}
+
+void
+SDL_GetBlitCacheStats(SDL_BlitCacheStats * stats)
+{
+    if (!stats) {
+        return;
+    }
+    SDL_AtomicLock(&SDL_blit_cache_lock);
+    stats->blit_hits = SDL_blit_cache_hits;
+    stats->blit_misses = SDL_blit_cache_misses;
+    SDL_AtomicUnlock(&SDL_blit_cache_lock);
+    stats->palette_hits = (Uint32) SDL_AtomicGet(&SDL_palette_map_hits);
+    stats->palette_misses = (Uint32) SDL_AtomicGet(&SDL_palette_map_misses);
+}
+
+void
+SDL_ResetBlitCacheStats(void)
+{
+    SDL_AtomicLock(&SDL_blit_cache_lock);
+    SDL_blit_cache_hits = 0;
+    SDL_blit_cache_misses = 0;
+    SDL_AtomicUnlock(&SDL_blit_cache_lock);
+    SDL_AtomicSet(&SDL_palette_map_hits, 0);
+    SDL_AtomicSet(&SDL_palette_map_misses, 0);
+}
+
 /* Figure out which of many blit routines to set up on a surface */
-int
-SDL_CalculateBlit(SDL_Surface * surface)
+static int
+SDL_ChooseBlit(SDL_Surface * surface)
 {
     SDL_BlitFunc blit = NULL;
     SDL_BlitMap *map = surface->map;
     SDL_Surface *dst = map->dst;
+    Uint32 src_format = surface->format->format;
+    Uint32 dst_format = dst->format->format;
+    Uint32 cpu;
+    SDL_bool cacheable;
 
     /* We don't currently support blitting to < 8 bpp surfaces */
     if (dst->format->BitsPerPixel < 8) {
@@ -242,6 +368,19 @@ SDL_CalculateBlit(SDL_Surface * surface)
         }
     }
 
+    /* The choice only depends on the format enums, unless they're unknown */
+    cpu = SDL_GetBlitCPUFeatures();
+    cacheable = (src_format != SDL_PIXELFORMAT_UNKNOWN &&
+                 dst_format != SDL_PIXELFORMAT_UNKNOWN);
+    if (cacheable) {
+        blit = SDL_LookupBlitCache(src_format, dst_format, map->info.flags,
+                                   map->identity, cpu);
+        if (blit) {
+            map->data = blit;
+            return 0;
+        }
+    }
+
     /* Choose a standard blit function */
     if (map->identity && !(map->info.flags & ~SDL_COPY_RLE_DESIRED)) {
         blit = SDL_BlitCopy;
@@ -261,9 +400,6 @@ SDL_CalculateBlit(SDL_Surface * surface)
         blit = SDL_CalculateBlitN(surface);
     }
     if (blit == NULL) {
-        Uint32 src_format = surface->format->format;
-        Uint32 dst_format = dst->format->format;
-
         blit =
             SDL_ChooseBlitFunc(src_format, dst_format, map->info.flags,
                                SDL_GeneratedBlitFuncTable);
@@ -272,9 +408,6 @@ SDL_CalculateBlit(SDL_Surface * surface)
     if (blit == NULL)
 #endif
     {
-        Uint32 src_format = surface->format->format;
-        Uint32 dst_format = dst->format->format;
-
         if (!SDL_ISPIXELFORMAT_INDEXED(src_format) &&
             !SDL_ISPIXELFORMAT_FOURCC(src_format) &&
             !SDL_ISPIXELFORMAT_INDEXED(dst_format) &&
@@ -290,7 +423,26 @@ SDL_CalculateBlit(SDL_Surface * surface)
         return SDL_SetError("Blit combination not supported");
     }
 
+    if (cacheable) {
+        SDL_InsertBlitCache(src_format, dst_format, map->info.flags,
+                            map->identity, cpu, blit);
+    }
     return 0;
 }
 
+int
+SDL_CalculateBlit(SDL_Surface * surface)
+{
+    /* Scale quality only matters to SDL_LowerBlitScaled(), the blitters
+       never see it.
+    */
+    const Uint32 linear = (surface->map->info.flags & SDL_COPY_LINEAR);
+    int retval;
+
+    surface->map->info.flags &= ~SDL_COPY_LINEAR;
+    retval = SDL_ChooseBlit(surface);
+    surface->map->info.flags |= linear;
+    return retval;
+}
+
 /* vi: set ts=4 sw=4 expandtab: */
@@ -23,6 +23,7 @@
 #ifndef SDL_blit_h_
 #define SDL_blit_h_
 
+#include "SDL_atomic.h"
 #include "SDL_cpuinfo.h"
 #include "SDL_endian.h"
 #include "SDL_surface.h"
@@ -30,6 +31,10 @@
 /* Table to do pixel byte expansion */
 extern Uint8* SDL_expand_byte[9];
 
+/* Palette map cache counters, reported by SDL_GetBlitCacheStats() */
+extern SDL_atomic_t SDL_palette_map_hits;
+extern SDL_atomic_t SDL_palette_map_misses;
+
 /* SDL blit copy flags */
 #define SDL_COPY_MODULATE_COLOR     0x00000001
 #define SDL_COPY_MODULATE_ALPHA     0x00000002
@@ -38,6 +43,7 @@ extern Uint8* SDL_expand_byte[9];
 #define SDL_COPY_MOD                0x00000040
 #define SDL_COPY_COLORKEY           0x00000100
 #define SDL_COPY_NEAREST            0x00000200
+#define SDL_COPY_LINEAR             0x00000400
 #define SDL_COPY_RLE_DESIRED        0x00001000
 #define SDL_COPY_RLE_COLORKEY       0x00002000
 #define SDL_COPY_RLE_ALPHAKEY       0x00004000
@@ -95,6 +101,16 @@ typedef struct SDL_BlitMap
        an invalid mapping */
     Uint32 dst_palette_version;
     Uint32 src_palette_version;
+
+    /* Scratch surfaces kept for linear scaled blits from this surface */
+    SDL_Surface *linear_src;
+    SDL_Surface *linear_dst;
+
+    /* How many views share this surface's pixels */
+    int views;
+
+    /* For a view, the surface whose pixels it shares */
+    SDL_Surface *owner;
 } SDL_BlitMap;
 
 /* Functions found in SDL_blit.c */
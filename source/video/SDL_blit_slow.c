@@ -26,28 +26,305 @@
 
 /* The ONE TRUE BLITTER
  * This puppy has to handle all the unoptimized cases - yes, it's slow.
+ *
+ * Rows are processed in chunks: the pixels are unpacked into one array per
+ * channel using the format masks and shifts, blended a whole chunk at a time
+ * and packed again, so the inner loops don't branch on the formats or the
+ * blend mode, and the common 8 bits per channel formats can use SIMD.
  */
+
+#define SLOW_CHUNK  64
+
+typedef struct
+{
+    Uint16 r[SLOW_CHUNK];
+    Uint16 g[SLOW_CHUNK];
+    Uint16 b[SLOW_CHUNK];
+    Uint16 a[SLOW_CHUNK];
+} SlowChannels;
+
+static SDL_INLINE Uint32
+SlowLoadPixel(const Uint8 * buf, int bpp)
+{
+    Uint32 pixel;
+    RETRIEVE_RGB_PIXEL(buf, bpp, pixel);
+    return pixel;
+}
+
+static SDL_INLINE void
+SlowStorePixel(Uint8 * buf, int bpp, Uint32 pixel)
+{
+    switch (bpp) {
+    case 1:
+        *buf = (Uint8) pixel;
+        break;
+    case 2:
+        *(Uint16 *) buf = (Uint16) pixel;
+        break;
+    case 3:
+        if (SDL_BYTEORDER == SDL_LIL_ENDIAN) {
+            buf[0] = (Uint8) pixel;
+            buf[1] = (Uint8) (pixel >> 8);
+            buf[2] = (Uint8) (pixel >> 16);
+        } else {
+            buf[0] = (Uint8) (pixel >> 16);
+            buf[1] = (Uint8) (pixel >> 8);
+            buf[2] = (Uint8) pixel;
+        }
+        break;
+    case 4:
+        *(Uint32 *) buf = pixel;
+        break;
+    }
+}
+
+/* Unpack n pixels, n rounded up to a multiple of 8 */
+static void
+SlowUnpack(const Uint32 * pixels, int n, const SDL_PixelFormat * fmt,
+           SlowChannels * c)
+{
+    int i;
+
+#ifdef __SSE2__
+    if (fmt->Rloss == 0 && fmt->Gloss == 0 && fmt->Bloss == 0 &&
+        (fmt->Aloss == 0 || !fmt->Amask) && SDL_HasSSE2()) {
+        const __m128i rs = _mm_cvtsi32_si128(fmt->Rshift);
+        const __m128i gs = _mm_cvtsi32_si128(fmt->Gshift);
+        const __m128i bs = _mm_cvtsi32_si128(fmt->Bshift);
+        const __m128i as = _mm_cvtsi32_si128(fmt->Ashift);
+        const __m128i ff = _mm_set1_epi32(0xFF);
+        const __m128i opaque = _mm_set1_epi16(0xFF);
+
+        for (i = 0; i < n; i += 8) {
+            const __m128i p0 = _mm_loadu_si128((const __m128i *) &pixels[i]);
+            const __m128i p1 = _mm_loadu_si128((const __m128i *) &pixels[i + 4]);
+#define UNPACK_CHANNEL(shift) \
+            _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(p0, shift), ff), \
+                            _mm_and_si128(_mm_srl_epi32(p1, shift), ff))
+            _mm_storeu_si128((__m128i *) &c->r[i], UNPACK_CHANNEL(rs));
+            _mm_storeu_si128((__m128i *) &c->g[i], UNPACK_CHANNEL(gs));
+            _mm_storeu_si128((__m128i *) &c->b[i], UNPACK_CHANNEL(bs));
+            if (fmt->Amask) {
+                _mm_storeu_si128((__m128i *) &c->a[i], UNPACK_CHANNEL(as));
+            } else {
+                _mm_storeu_si128((__m128i *) &c->a[i], opaque);
+            }
+#undef UNPACK_CHANNEL
+        }
+        return;
+    }
+#endif /* __SSE2__ */
+
+    for (i = 0; i < n; ++i) {
+        const Uint32 pixel = pixels[i];
+        unsigned r, g, b, a;
+        RGBA_FROM_PIXEL(pixel, fmt, r, g, b, a);
+        c->r[i] = r;
+        c->g[i] = g;
+        c->b[i] = b;
+        c->a[i] = fmt->Amask ? a : 0xFF;
+    }
+}
+
+/* Pack n pixels, n rounded up to a multiple of 8 */
+static void
+SlowPack(const SlowChannels * c, int n, const SDL_PixelFormat * fmt,
+         Uint32 * pixels)
+{
+    int i;
+
+#ifdef __SSE2__
+    if (SDL_HasSSE2()) {
+        const __m128i rl = _mm_cvtsi32_si128(fmt->Rloss);
+        const __m128i gl = _mm_cvtsi32_si128(fmt->Gloss);
+        const __m128i bl = _mm_cvtsi32_si128(fmt->Bloss);
+        const __m128i al = _mm_cvtsi32_si128(fmt->Aloss);
+        const __m128i rs = _mm_cvtsi32_si128(fmt->Rshift);
+        const __m128i gs = _mm_cvtsi32_si128(fmt->Gshift);
+        const __m128i bs = _mm_cvtsi32_si128(fmt->Bshift);
+        const __m128i as = _mm_cvtsi32_si128(fmt->Ashift);
+        const __m128i zero = _mm_setzero_si128();
+
+        for (i = 0; i < n; i += 8) {
+            const __m128i r = _mm_loadu_si128((const __m128i *) &c->r[i]);
+            const __m128i g = _mm_loadu_si128((const __m128i *) &c->g[i]);
+            const __m128i b = _mm_loadu_si128((const __m128i *) &c->b[i]);
+            const __m128i a = _mm_loadu_si128((const __m128i *) &c->a[i]);
+#define PACK_CHANNEL(v, unpack, loss, shift) \
+            _mm_sll_epi32(_mm_srl_epi32(unpack(v, zero), loss), shift)
+#define PACK_PIXELS(unpack) \
+            _mm_or_si128(_mm_or_si128(PACK_CHANNEL(r, unpack, rl, rs), \
+                                      PACK_CHANNEL(g, unpack, gl, gs)), \
+                         _mm_or_si128(PACK_CHANNEL(b, unpack, bl, bs), \
+                                      PACK_CHANNEL(a, unpack, al, as)))
+            _mm_storeu_si128((__m128i *) &pixels[i], PACK_PIXELS(_mm_unpacklo_epi16));
+            _mm_storeu_si128((__m128i *) &pixels[i + 4], PACK_PIXELS(_mm_unpackhi_epi16));
+#undef PACK_PIXELS
+#undef PACK_CHANNEL
+        }
+        return;
+    }
+#endif /* __SSE2__ */
+
+    for (i = 0; i < n; ++i) {
+        Uint32 pixel;
+        PIXEL_FROM_RGBA(pixel, fmt, c->r[i], c->g[i], c->b[i], c->a[i]);
+        pixels[i] = pixel;
+    }
+}
+
+/* x * y / 255, exact for any product that fits in 16 bits */
+#define SLOW_MUL255(x, y)   (((Uint32) (x) * (y)) / 255)
+
+#ifdef __SSE2__
+static SDL_INLINE __m128i
+SlowMul255_SSE2(__m128i x, __m128i y)
+{
+    return _mm_srli_epi16(_mm_mulhi_epu16(_mm_mullo_epi16(x, y),
+                                          _mm_set1_epi16((short) 0x8081)), 7);
+}
+#endif
+
+/* Apply the modulation and blend mode of the blit to n pixels */
+static void
+SlowBlend(const SDL_BlitInfo * info, SlowChannels * s, SlowChannels * d, int n)
+{
+    const int flags = info->flags;
+    const int op = flags & (SDL_COPY_BLEND | SDL_COPY_ADD | SDL_COPY_MOD);
+    int i;
+
+#ifdef __SSE2__
+    if (SDL_HasSSE2()) {
+        const __m128i mr = _mm_set1_epi16(info->r);
+        const __m128i mg = _mm_set1_epi16(info->g);
+        const __m128i mb = _mm_set1_epi16(info->b);
+        const __m128i ma = _mm_set1_epi16(info->a);
+        const __m128i ff = _mm_set1_epi16(0xFF);
+
+        for (i = 0; i < n; i += 8) {
+            __m128i sr = _mm_loadu_si128((const __m128i *) &s->r[i]);
+            __m128i sg = _mm_loadu_si128((const __m128i *) &s->g[i]);
+            __m128i sb = _mm_loadu_si128((const __m128i *) &s->b[i]);
+            __m128i sa = _mm_loadu_si128((const __m128i *) &s->a[i]);
+            __m128i dr = _mm_loadu_si128((const __m128i *) &d->r[i]);
+            __m128i dg = _mm_loadu_si128((const __m128i *) &d->g[i]);
+            __m128i db = _mm_loadu_si128((const __m128i *) &d->b[i]);
+            __m128i da = _mm_loadu_si128((const __m128i *) &d->a[i]);
+
+            if (flags & SDL_COPY_MODULATE_COLOR) {
+                sr = SlowMul255_SSE2(sr, mr);
+                sg = SlowMul255_SSE2(sg, mg);
+                sb = SlowMul255_SSE2(sb, mb);
+            }
+            if (flags & SDL_COPY_MODULATE_ALPHA) {
+                sa = SlowMul255_SSE2(sa, ma);
+            }
+            if (flags & (SDL_COPY_BLEND | SDL_COPY_ADD)) {
+                /* An opaque source comes through unchanged */
+                sr = SlowMul255_SSE2(sr, sa);
+                sg = SlowMul255_SSE2(sg, sa);
+                sb = SlowMul255_SSE2(sb, sa);
+            }
+            switch (op) {
+            case 0:
+                dr = sr;
+                dg = sg;
+                db = sb;
+                da = sa;
+                break;
+            case SDL_COPY_BLEND: {
+                const __m128i inv = _mm_sub_epi16(ff, sa);
+                dr = _mm_add_epi16(sr, SlowMul255_SSE2(inv, dr));
+                dg = _mm_add_epi16(sg, SlowMul255_SSE2(inv, dg));
+                db = _mm_add_epi16(sb, SlowMul255_SSE2(inv, db));
+                da = _mm_add_epi16(sa, SlowMul255_SSE2(inv, da));
+                break;
+            }
+            case SDL_COPY_ADD:
+                dr = _mm_min_epi16(_mm_add_epi16(sr, dr), ff);
+                dg = _mm_min_epi16(_mm_add_epi16(sg, dg), ff);
+                db = _mm_min_epi16(_mm_add_epi16(sb, db), ff);
+                break;
+            case SDL_COPY_MOD:
+                dr = SlowMul255_SSE2(sr, dr);
+                dg = SlowMul255_SSE2(sg, dg);
+                db = SlowMul255_SSE2(sb, db);
+                break;
+            }
+            _mm_storeu_si128((__m128i *) &d->r[i], dr);
+            _mm_storeu_si128((__m128i *) &d->g[i], dg);
+            _mm_storeu_si128((__m128i *) &d->b[i], db);
+            _mm_storeu_si128((__m128i *) &d->a[i], da);
+        }
+        return;
+    }
+#endif /* __SSE2__ */
+
+    for (i = 0; i < n; ++i) {
+        Uint32 srcR = s->r[i], srcG = s->g[i], srcB = s->b[i], srcA = s->a[i];
+
+        if (flags & SDL_COPY_MODULATE_COLOR) {
+            srcR = SLOW_MUL255(srcR, info->r);
+            srcG = SLOW_MUL255(srcG, info->g);
+            srcB = SLOW_MUL255(srcB, info->b);
+        }
+        if (flags & SDL_COPY_MODULATE_ALPHA) {
+            srcA = SLOW_MUL255(srcA, info->a);
+        }
+        if (flags & (SDL_COPY_BLEND | SDL_COPY_ADD)) {
+            /* This goes away if we ever use premultiplied alpha */
+            if (srcA < 255) {
+                srcR = SLOW_MUL255(srcR, srcA);
+                srcG = SLOW_MUL255(srcG, srcA);
+                srcB = SLOW_MUL255(srcB, srcA);
+            }
+        }
+        switch (op) {
+        case 0:
+            d->r[i] = srcR;
+            d->g[i] = srcG;
+            d->b[i] = srcB;
+            d->a[i] = srcA;
+            break;
+        case SDL_COPY_BLEND:
+            d->r[i] = srcR + SLOW_MUL255(255 - srcA, d->r[i]);
+            d->g[i] = srcG + SLOW_MUL255(255 - srcA, d->g[i]);
+            d->b[i] = srcB + SLOW_MUL255(255 - srcA, d->b[i]);
+            d->a[i] = srcA + SLOW_MUL255(255 - srcA, d->a[i]);
+            break;
+        case SDL_COPY_ADD:
+            d->r[i] = SDL_min(srcR + d->r[i], 255);
+            d->g[i] = SDL_min(srcG + d->g[i], 255);
+            d->b[i] = SDL_min(srcB + d->b[i], 255);
+            break;
+        case SDL_COPY_MOD:
+            d->r[i] = SLOW_MUL255(srcR, d->r[i]);
+            d->g[i] = SLOW_MUL255(srcG, d->g[i]);
+            d->b[i] = SLOW_MUL255(srcB, d->b[i]);
+            break;
+        }
+    }
+}
+
 void
 SDL_Blit_Slow(SDL_BlitInfo * info)
 {
     const int flags = info->flags;
-    const Uint32 modulateR = info->r;
-    const Uint32 modulateG = info->g;
-    const Uint32 modulateB = info->b;
-    const Uint32 modulateA = info->a;
-    Uint32 srcpixel;
-    Uint32 srcR, srcG, srcB, srcA;
-    Uint32 dstpixel;
-    Uint32 dstR, dstG, dstB, dstA;
+    SDL_PixelFormat *src_fmt = info->src_fmt;
+    SDL_PixelFormat *dst_fmt = info->dst_fmt;
+    const int srcbpp = src_fmt->BytesPerPixel;
+    const int dstbpp = dst_fmt->BytesPerPixel;
+    const Uint32 rgbmask = ~src_fmt->Amask;
+    const Uint32 ckey = info->colorkey & rgbmask;
+    /* Without a blend mode the destination pixels aren't read */
+    const SDL_bool read_dst =
+        (flags & (SDL_COPY_BLEND | SDL_COPY_ADD | SDL_COPY_MOD)) ? SDL_TRUE : SDL_FALSE;
+    Uint32 pixels[SLOW_CHUNK];
+    Uint8 keyed[SLOW_CHUNK];
+    SlowChannels s, d;
     int srcy, srcx;
     int posy, posx;
     int incy, incx;
-    SDL_PixelFormat *src_fmt = info->src_fmt;
-    SDL_PixelFormat *dst_fmt = info->dst_fmt;
-    int srcbpp = src_fmt->BytesPerPixel;
-    int dstbpp = dst_fmt->BytesPerPixel;
-    Uint32 rgbmask = ~src_fmt->Amask;
-    Uint32 ckey = info->colorkey & rgbmask;
 
     srcy = 0;
     posy = 0;
@@ -55,106 +332,78 @@ SDL_Blit_Slow(SDL_BlitInfo * info)
     incx = (info->src_w << 16) / info->dst_w;
 
     while (info->dst_h--) {
-        Uint8 *src = 0;
+        const Uint8 *src = NULL;
         Uint8 *dst = (Uint8 *) info->dst;
-        int n = info->dst_w;
+        int x = 0;
+
         srcx = -1;
         posx = 0x10000L;
         while (posy >= 0x10000L) {
             ++srcy;
             posy -= 0x10000L;
         }
-        while (n--) {
-            if (posx >= 0x10000L) {
-                while (posx >= 0x10000L) {
-                    ++srcx;
-                    posx -= 0x10000L;
+
+        while (x < info->dst_w) {
+            const int n = SDL_min(info->dst_w - x, SLOW_CHUNK);
+            const int n8 = (n + 7) & ~7;
+            int i, skipped = 0;
+
+            /* Fetch the source pixels, stepping through the row */
+            for (i = 0; i < n; ++i) {
+                if (posx >= 0x10000L) {
+                    while (posx >= 0x10000L) {
+                        ++srcx;
+                        posx -= 0x10000L;
+                    }
+                    src = (info->src + (srcy * info->src_pitch) + (srcx * srcbpp));
                 }
-                src =
-                    (info->src + (srcy * info->src_pitch) + (srcx * srcbpp));
+                pixels[i] = SlowLoadPixel(src, srcbpp);
+                posx += incx;
             }
-            if (src_fmt->Amask) {
-                DISEMBLE_RGBA(src, srcbpp, src_fmt, srcpixel, srcR, srcG,
-                              srcB, srcA);
-            } else {
-                DISEMBLE_RGB(src, srcbpp, src_fmt, srcpixel, srcR, srcG,
-                             srcB);
-                srcA = 0xFF;
+            for (; i < n8; ++i) {
+                pixels[i] = 0;
             }
+
             if (flags & SDL_COPY_COLORKEY) {
-                /* srcpixel isn't set for 24 bpp */
-                if (srcbpp == 3) {
-                    srcpixel = (srcR << src_fmt->Rshift) |
-                        (srcG << src_fmt->Gshift) | (srcB << src_fmt->Bshift);
+                for (i = 0; i < n; ++i) {
+                    keyed[i] = ((pixels[i] & rgbmask) == ckey);
+                    skipped += keyed[i];
                 }
-                if ((srcpixel & rgbmask) == ckey) {
-                    posx += incx;
-                    dst += dstbpp;
+                if (skipped == n) {
+                    dst += n * dstbpp;
+                    x += n;
                     continue;
                 }
             }
-            if (dst_fmt->Amask) {
-                DISEMBLE_RGBA(dst, dstbpp, dst_fmt, dstpixel, dstR, dstG,
-                              dstB, dstA);
-            } else {
-                DISEMBLE_RGB(dst, dstbpp, dst_fmt, dstpixel, dstR, dstG,
-                             dstB);
-                dstA = 0xFF;
-            }
+            SlowUnpack(pixels, n8, src_fmt, &s);
 
-            if (flags & SDL_COPY_MODULATE_COLOR) {
-                srcR = (srcR * modulateR) / 255;
-                srcG = (srcG * modulateG) / 255;
-                srcB = (srcB * modulateB) / 255;
-            }
-            if (flags & SDL_COPY_MODULATE_ALPHA) {
-                srcA = (srcA * modulateA) / 255;
-            }
-            if (flags & (SDL_COPY_BLEND | SDL_COPY_ADD)) {
-                /* This goes away if we ever use premultiplied alpha */
-                if (srcA < 255) {
-                    srcR = (srcR * srcA) / 255;
-                    srcG = (srcG * srcA) / 255;
-                    srcB = (srcB * srcA) / 255;
+            if (read_dst) {
+                for (i = 0; i < n; ++i) {
+                    pixels[i] = SlowLoadPixel(dst + i * dstbpp, dstbpp);
                 }
+                for (; i < n8; ++i) {
+                    pixels[i] = 0;
+                }
+                SlowUnpack(pixels, n8, dst_fmt, &d);
             }
-            switch (flags & (SDL_COPY_BLEND | SDL_COPY_ADD | SDL_COPY_MOD)) {
-            case 0:
-                dstR = srcR;
-                dstG = srcG;
-                dstB = srcB;
-                dstA = srcA;
-                break;
-            case SDL_COPY_BLEND:
-                dstR = srcR + ((255 - srcA) * dstR) / 255;
-                dstG = srcG + ((255 - srcA) * dstG) / 255;
-                dstB = srcB + ((255 - srcA) * dstB) / 255;
-                dstA = srcA + ((255 - srcA) * dstA) / 255;
-                break;
-            case SDL_COPY_ADD:
-                dstR = srcR + dstR;
-                if (dstR > 255)
-                    dstR = 255;
-                dstG = srcG + dstG;
-                if (dstG > 255)
-                    dstG = 255;
-                dstB = srcB + dstB;
-                if (dstB > 255)
-                    dstB = 255;
-                break;
-            case SDL_COPY_MOD:
-                dstR = (srcR * dstR) / 255;
-                dstG = (srcG * dstG) / 255;
-                dstB = (srcB * dstB) / 255;
-                break;
-            }
-            if (dst_fmt->Amask) {
-                ASSEMBLE_RGBA(dst, dstbpp, dst_fmt, dstR, dstG, dstB, dstA);
+            SlowBlend(info, &s, &d, n8);
+            SlowPack(&d, n8, dst_fmt, pixels);
+
+            if (skipped) {
+                for (i = 0; i < n; ++i) {
+                    if (!keyed[i]) {
+                        SlowStorePixel(dst + i * dstbpp, dstbpp, pixels[i]);
+                    }
+                }
+            } else if (dstbpp == 4) {
+                SDL_memcpy(dst, pixels, n * 4);
             } else {
-                ASSEMBLE_RGB(dst, dstbpp, dst_fmt, dstR, dstG, dstB);
+                for (i = 0; i < n; ++i) {
+                    SlowStorePixel(dst + i * dstbpp, dstbpp, pixels[i]);
+                }
             }
-            posx += incx;
-            dst += dstbpp;
+            dst += n * dstbpp;
+            x += n;
         }
         posy += incy;
         info->dst += info->dst_pitch;
@@ -36,10 +36,14 @@
 #include "SDL_video.h"
 #include "SDL_assert.h"
 #include "SDL_endian.h"
+#include "SDL_cpuinfo.h"
 #include "SDL_pixels_c.h"
 
 #define SAVE_32BIT_BMP
 
+/* How many bytes of rows to collect before writing them out */
+#define BMP_WRITE_CHUNK (256 * 1024)
+
 /* Compression encodings for BMP files */
 #ifndef BI_RGB
 #define BI_RGB      0
@@ -83,21 +87,191 @@ static void CorrectAlphaChannel(SDL_Surface *surface)
     }
 }
 
+/* Expand a row of 1 or 4 bit pixels to one byte per pixel */
+static void
+ExpandBMPRow(const Uint8 *src, Uint8 *dst, int width, int bits)
+{
+    int i = 0;
+
+    if (bits == 4) {
+#ifdef __SSE2__
+        if (SDL_HasSSE2()) {
+            const __m128i nibble = _mm_set1_epi8(0x0F);
+            for (; i + 32 <= width; i += 32) {
+                const __m128i v = _mm_loadu_si128((const __m128i *) (src + i / 2));
+                const __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+                const __m128i lo = _mm_and_si128(v, nibble);
+                _mm_storeu_si128((__m128i *) (dst + i), _mm_unpacklo_epi8(hi, lo));
+                _mm_storeu_si128((__m128i *) (dst + i + 16), _mm_unpackhi_epi8(hi, lo));
+            }
+        }
+#endif
+        for (; i + 2 <= width; i += 2) {
+            const Uint8 pixel = src[i / 2];
+            dst[i] = pixel >> 4;
+            dst[i + 1] = pixel & 0x0F;
+        }
+        if (i < width) {
+            dst[i] = src[i / 2] >> 4;
+        }
+    } else {
+#ifdef __SSE2__
+        if (SDL_HasSSE2()) {
+            const __m128i bit = _mm_set_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char) 0x80,
+                                             0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char) 0x80);
+            const __m128i one = _mm_set1_epi8(1);
+            for (; i + 16 <= width; i += 16) {
+                /* Spread the two source bytes across eight lanes each */
+                __m128i v = _mm_cvtsi32_si128(src[i / 8] | (src[i / 8 + 1] << 8));
+                v = _mm_unpacklo_epi8(v, v);
+                v = _mm_unpacklo_epi16(v, v);
+                v = _mm_unpacklo_epi32(v, v);
+                v = _mm_cmpeq_epi8(_mm_and_si128(v, bit), bit);
+                _mm_storeu_si128((__m128i *) (dst + i), _mm_and_si128(v, one));
+            }
+        }
+#endif
+        for (; i < width; ++i) {
+            dst[i] = (src[i / 8] >> (7 - (i % 8))) & 1;
+        }
+    }
+}
+
+/* Reverse the order of the rows of an image, in place */
+static void
+FlipBMPRows(Uint8 *pixels, int pitch, int h)
+{
+    Uint8 tmp[1024];
+    Uint8 *top = pixels;
+    Uint8 *bottom = pixels + (h - 1) * pitch;
+
+    while (top < bottom) {
+        int done, len;
+        for (done = 0; done < pitch; done += len) {
+            len = SDL_min(pitch - done, (int) sizeof(tmp));
+            SDL_memcpy(tmp, top + done, len);
+            SDL_memcpy(top + done, bottom + done, len);
+            SDL_memcpy(bottom + done, tmp, len);
+        }
+        top += pitch;
+        bottom -= pitch;
+    }
+}
+
+/*
+ * Read all of the pixel rows of a BMP at once, rather than a row or a pixel
+ * at a time. Memory streams are decoded in place, and uncompressed rows that
+ * match the surface layout are read straight into the surface.
+ */
+static int
+ReadBMPPixels(SDL_RWops * src, SDL_Surface * surface, int ExpandBMP,
+              SDL_bool topDown)
+{
+    int bmpPitch, filePitch, y;
+    size_t size;
+    Uint8 *buffer = NULL;
+    const Uint8 *bits;
+
+    if (surface->h == 0) {
+        return 0;
+    }
+
+    switch (ExpandBMP) {
+    case 1:
+        bmpPitch = (surface->w + 7) >> 3;
+        break;
+    case 4:
+        bmpPitch = (surface->w + 1) >> 1;
+        break;
+    default:
+        /* BMP rows are padded to 4 bytes, just like surface rows */
+        bmpPitch = surface->pitch;
+        break;
+    }
+    filePitch = (bmpPitch + 3) & ~3;
+
+    /* The padding after the last row is optional */
+    size = (size_t) filePitch * (surface->h - 1) + bmpPitch;
+
+    if (src->type == SDL_RWOPS_MEMORY || src->type == SDL_RWOPS_MEMORY_RO) {
+        if ((size_t) (src->hidden.mem.stop - src->hidden.mem.here) < size) {
+            return SDL_Error(SDL_EFREAD);
+        }
+        bits = src->hidden.mem.here;
+        SDL_RWseek(src, (Sint64) filePitch * surface->h, RW_SEEK_CUR);
+    } else if (!ExpandBMP) {
+        if (SDL_RWread(src, surface->pixels, 1, size) != size) {
+            return SDL_Error(SDL_EFREAD);
+        }
+        if (!topDown) {
+            FlipBMPRows((Uint8 *) surface->pixels, surface->pitch, surface->h);
+        }
+        bits = NULL;
+    } else {
+        buffer = (Uint8 *) SDL_malloc(size);
+        if (!buffer) {
+            return SDL_OutOfMemory();
+        }
+        if (SDL_RWread(src, buffer, 1, size) != size) {
+            SDL_free(buffer);
+            return SDL_Error(SDL_EFREAD);
+        }
+        bits = buffer;
+    }
+
+    if (bits) {
+        for (y = 0; y < surface->h; ++y) {
+            const int row = topDown ? y : (surface->h - 1 - y);
+            Uint8 *dst = (Uint8 *) surface->pixels + row * surface->pitch;
+            if (ExpandBMP) {
+                ExpandBMPRow(bits, dst, surface->w, ExpandBMP);
+            } else {
+                SDL_memcpy(dst, bits, bmpPitch);
+            }
+            bits += filePitch;
+        }
+        SDL_free(buffer);
+    }
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    /* Byte-swap the pixels if needed. Note that the 24bpp
+       case has already been taken care of above. */
+    for (y = 0; y < surface->h; ++y) {
+        Uint8 *row = (Uint8 *) surface->pixels + y * surface->pitch;
+        int i;
+        switch (surface->format->BitsPerPixel) {
+        case 15:
+        case 16:{
+                Uint16 *pix = (Uint16 *) row;
+                for (i = 0; i < surface->w; i++)
+                    pix[i] = SDL_Swap16(pix[i]);
+                break;
+            }
+
+        case 32:{
+                Uint32 *pix = (Uint32 *) row;
+                for (i = 0; i < surface->w; i++)
+                    pix[i] = SDL_Swap32(pix[i]);
+                break;
+            }
+        }
+    }
+#endif
+    return 0;
+}
+
 SDL_Surface *
 SDL_LoadBMP_RW(SDL_RWops * src, int freesrc)
 {
     SDL_bool was_error;
     Sint64 fp_offset = 0;
-    int bmpPitch;
-    int i, pad;
+    int i;
     SDL_Surface *surface;
     Uint32 Rmask = 0;
     Uint32 Gmask = 0;
     Uint32 Bmask = 0;
     Uint32 Amask = 0;
     SDL_Palette *palette;
-    Uint8 *bits;
-    Uint8 *top, *end;
     SDL_bool topDown;
     int ExpandBMP;
     SDL_bool haveRGBMasks = SDL_FALSE;
@@ -331,25 +505,31 @@ SDL_LoadBMP_RW(SDL_RWops * src, int freesrc)
         } else if ((int) biClrUsed < palette->ncolors) {
             palette->ncolors = biClrUsed;
         }
-        if (biSize == 12) {
-            for (i = 0; i < (int) biClrUsed; ++i) {
-                SDL_RWread(src, &palette->colors[i].b, 1, 1);
-                SDL_RWread(src, &palette->colors[i].g, 1, 1);
-                SDL_RWread(src, &palette->colors[i].r, 1, 1);
-                palette->colors[i].a = SDL_ALPHA_OPAQUE;
-            }
-        } else {
-            for (i = 0; i < (int) biClrUsed; ++i) {
-                SDL_RWread(src, &palette->colors[i].b, 1, 1);
-                SDL_RWread(src, &palette->colors[i].g, 1, 1);
-                SDL_RWread(src, &palette->colors[i].r, 1, 1);
-                SDL_RWread(src, &palette->colors[i].a, 1, 1);
-
-                /* According to Microsoft documentation, the fourth element
-                   is reserved and must be zero, so we shouldn't treat it as
-                   alpha.
-                */
-                palette->colors[i].a = SDL_ALPHA_OPAQUE;
+        {
+            /* Old BITMAPCOREHEADER palettes have 3 byte entries */
+            const int entrySize = (biSize == 12) ? 3 : 4;
+            Uint8 entries[256 * 4];
+
+            for (i = 0; i < (int) biClrUsed; ) {
+                const int count = (int) SDL_RWread(src, entries, entrySize,
+                                                   SDL_min((int) biClrUsed - i, 256));
+                const Uint8 *entry = entries;
+                int j;
+
+                if (count <= 0) {
+                    break;
+                }
+                for (j = 0; j < count; ++j, ++i, entry += entrySize) {
+                    palette->colors[i].b = entry[0];
+                    palette->colors[i].g = entry[1];
+                    palette->colors[i].r = entry[2];
+
+                    /* According to Microsoft documentation, the fourth element
+                       is reserved and must be zero, so we shouldn't treat it as
+                       alpha.
+                    */
+                    palette->colors[i].a = SDL_ALPHA_OPAQUE;
+                }
             }
         }
     }
@@ -360,87 +540,9 @@ SDL_LoadBMP_RW(SDL_RWops * src, int freesrc)
         was_error = SDL_TRUE;
         goto done;
     }
-    top = (Uint8 *)surface->pixels;
-    end = (Uint8 *)surface->pixels+(surface->h*surface->pitch);
-    switch (ExpandBMP) {
-    case 1:
-        bmpPitch = (biWidth + 7) >> 3;
-        pad = (((bmpPitch) % 4) ? (4 - ((bmpPitch) % 4)) : 0);
-        break;
-    case 4:
-        bmpPitch = (biWidth + 1) >> 1;
-        pad = (((bmpPitch) % 4) ? (4 - ((bmpPitch) % 4)) : 0);
-        break;
-    default:
-        pad = ((surface->pitch % 4) ? (4 - (surface->pitch % 4)) : 0);
-        break;
-    }
-    if (topDown) {
-        bits = top;
-    } else {
-        bits = end - surface->pitch;
-    }
-    while (bits >= top && bits < end) {
-        switch (ExpandBMP) {
-        case 1:
-        case 4:{
-                Uint8 pixel = 0;
-                int shift = (8 - ExpandBMP);
-                for (i = 0; i < surface->w; ++i) {
-                    if (i % (8 / ExpandBMP) == 0) {
-                        if (!SDL_RWread(src, &pixel, 1, 1)) {
-                            SDL_SetError("Error reading from BMP");
-                            was_error = SDL_TRUE;
-                            goto done;
-                        }
-                    }
-                    *(bits + i) = (pixel >> shift);
-                    pixel <<= ExpandBMP;
-                }
-            }
-            break;
-
-        default:
-            if (SDL_RWread(src, bits, 1, surface->pitch)
-                != surface->pitch) {
-                SDL_Error(SDL_EFREAD);
-                was_error = SDL_TRUE;
-                goto done;
-            }
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-            /* Byte-swap the pixels if needed. Note that the 24bpp
-               case has already been taken care of above. */
-            switch (biBitCount) {
-            case 15:
-            case 16:{
-                    Uint16 *pix = (Uint16 *) bits;
-                    for (i = 0; i < surface->w; i++)
-                        pix[i] = SDL_Swap16(pix[i]);
-                    break;
-                }
-
-            case 32:{
-                    Uint32 *pix = (Uint32 *) bits;
-                    for (i = 0; i < surface->w; i++)
-                        pix[i] = SDL_Swap32(pix[i]);
-                    break;
-                }
-            }
-#endif
-            break;
-        }
-        /* Skip padding bytes, ugh */
-        if (pad) {
-            Uint8 padbyte;
-            for (i = 0; i < pad; ++i) {
-                SDL_RWread(src, &padbyte, 1, 1);
-            }
-        }
-        if (topDown) {
-            bits += surface->pitch;
-        } else {
-            bits -= surface->pitch;
-        }
+    if (ReadBMPPixels(src, surface, ExpandBMP, topDown) < 0) {
+        was_error = SDL_TRUE;
+        goto done;
     }
     if (correctAlpha) {
         CorrectAlphaChannel(surface);
@@ -459,15 +561,42 @@ SDL_LoadBMP_RW(SDL_RWops * src, int freesrc)
     return (surface);
 }
 
+/* Pack a row of XRGB8888 pixels into the 24-bit BGR layout used by BMP files */
+static void
+PackBMPRow24(const Uint32 *src, Uint8 *dst, int width)
+{
+    int i = 0;
+
+    /* Four pixels make three whole words */
+    for (; i + 4 <= width; i += 4, dst += 12) {
+        const Uint32 p0 = src[i] & 0x00FFFFFF;
+        const Uint32 p1 = src[i + 1] & 0x00FFFFFF;
+        const Uint32 p2 = src[i + 2] & 0x00FFFFFF;
+        const Uint32 p3 = src[i + 3] & 0x00FFFFFF;
+        const Uint32 words[3] = {
+            p0 | (p1 << 24),
+            (p1 >> 8) | (p2 << 16),
+            (p2 >> 16) | (p3 << 8)
+        };
+        SDL_memcpy(dst, words, sizeof(words));
+    }
+    for (; i < width; ++i, dst += 3) {
+        const Uint32 pixel = src[i];
+        dst[0] = (Uint8) pixel;
+        dst[1] = (Uint8) (pixel >> 8);
+        dst[2] = (Uint8) (pixel >> 16);
+    }
+}
+
 int
 SDL_SaveBMP_RW(SDL_Surface * saveme, SDL_RWops * dst, int freedst)
 {
     Sint64 fp_offset;
     int i, pad;
     SDL_Surface *surface;
-    Uint8 *bits;
     SDL_bool save32bit = SDL_FALSE;
     SDL_bool saveLegacyBMP = SDL_FALSE;
+    SDL_bool pack24bit = SDL_FALSE;
 
     /* The Win32 BMP file header (14 bytes) */
     char magic[2] = { 'B', 'M' };
@@ -530,6 +659,21 @@ SDL_SaveBMP_RW(SDL_Surface * saveme, SDL_RWops * dst, int freedst)
 #endif
             ) {
             surface = saveme;
+        } else if (save32bit && saveme->format->format == SDL_PIXELFORMAT_BGRA32 &&
+                   !(saveme->map->info.flags & SDL_COPY_COLORKEY)) {
+            /* Already laid out the way the file wants it, and a colorkey
+               still has to be turned into alpha by the conversion below */
+            surface = saveme;
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+        } else if (!save32bit && !saveme->format->palette &&
+                   (saveme->format->BytesPerPixel == 4) &&
+                   (saveme->format->Rmask == 0x00FF0000) &&
+                   (saveme->format->Gmask == 0x0000FF00) &&
+                   (saveme->format->Bmask == 0x000000FF)) {
+            /* Drop the unused byte while writing, rather than converting */
+            surface = saveme;
+            pack24bit = SDL_TRUE;
+#endif
         } else {
             SDL_PixelFormat format;
 
@@ -557,7 +701,9 @@ SDL_SaveBMP_RW(SDL_Surface * saveme, SDL_RWops * dst, int freedst)
     }
 
     if (surface && (SDL_LockSurface(surface) == 0)) {
-        const int bw = surface->w * surface->format->BytesPerPixel;
+        const int bpp = pack24bit ? 3 : surface->format->BytesPerPixel;
+        const int bw = surface->w * bpp;
+        const int rowBytes = (bw + 3) & ~3;
 
         /* Set the BMP file header values */
         bfSize = 0;             /* We'll write this when we're done */
@@ -579,9 +725,9 @@ SDL_SaveBMP_RW(SDL_Surface * saveme, SDL_RWops * dst, int freedst)
         biWidth = surface->w;
         biHeight = surface->h;
         biPlanes = 1;
-        biBitCount = surface->format->BitsPerPixel;
+        biBitCount = pack24bit ? 24 : surface->format->BitsPerPixel;
         biCompression = BI_RGB;
-        biSizeImage = surface->h * surface->pitch;
+        biSizeImage = surface->h * rowBytes;
         biXPelsPerMeter = 0;
         biYPelsPerMeter = 0;
         if (surface->format->palette) {
@@ -638,14 +784,20 @@ SDL_SaveBMP_RW(SDL_Surface * saveme, SDL_RWops * dst, int freedst)
         if (surface->format->palette) {
             SDL_Color *colors;
             int ncolors;
+            Uint8 entries[256 * 4];
 
             colors = surface->format->palette->colors;
             ncolors = surface->format->palette->ncolors;
-            for (i = 0; i < ncolors; ++i) {
-                SDL_RWwrite(dst, &colors[i].b, 1, 1);
-                SDL_RWwrite(dst, &colors[i].g, 1, 1);
-                SDL_RWwrite(dst, &colors[i].r, 1, 1);
-                SDL_RWwrite(dst, &colors[i].a, 1, 1);
+            for (i = 0; i < ncolors; ) {
+                const int count = SDL_min(ncolors - i, 256);
+                int j;
+                for (j = 0; j < count; ++j, ++i) {
+                    entries[j * 4 + 0] = colors[i].b;
+                    entries[j * 4 + 1] = colors[i].g;
+                    entries[j * 4 + 2] = colors[i].r;
+                    entries[j * 4 + 3] = colors[i].a;
+                }
+                SDL_RWwrite(dst, entries, 4, count);
             }
         }
 
@@ -659,21 +811,36 @@ SDL_SaveBMP_RW(SDL_Surface * saveme, SDL_RWops * dst, int freedst)
             SDL_Error(SDL_EFSEEK);
         }
 
-        /* Write the bitmap image upside down */
-        bits = (Uint8 *) surface->pixels + (surface->h * surface->pitch);
-        pad = ((bw % 4) ? (4 - (bw % 4)) : 0);
-        while (bits > (Uint8 *) surface->pixels) {
-            bits -= surface->pitch;
-            if (SDL_RWwrite(dst, bits, 1, bw) != bw) {
-                SDL_Error(SDL_EFWRITE);
-                break;
+        /* Write the bitmap image upside down, gathering rows into chunks */
+        pad = rowBytes - bw;
+        if (surface->h > 0 && rowBytes > 0) {
+            const int chunkRows = SDL_max(1, SDL_min(surface->h, BMP_WRITE_CHUNK / rowBytes));
+            Uint8 *buffer = (Uint8 *) SDL_malloc((size_t) chunkRows * rowBytes);
+            int y = surface->h;
+
+            if (!buffer) {
+                SDL_OutOfMemory();
+                y = 0;
             }
-            if (pad) {
-                const Uint8 padbyte = 0;
-                for (i = 0; i < pad; ++i) {
-                    SDL_RWwrite(dst, &padbyte, 1, 1);
+            while (y > 0) {
+                const int count = SDL_min(chunkRows, y);
+                Uint8 *out = buffer;
+
+                for (i = 0; i < count; ++i, out += rowBytes) {
+                    const Uint8 *bits = (const Uint8 *) surface->pixels + (--y) * surface->pitch;
+                    if (pack24bit) {
+                        PackBMPRow24((const Uint32 *) bits, out, surface->w);
+                    } else {
+                        SDL_memcpy(out, bits, bw);
+                    }
+                    SDL_memset(out + bw, 0, pad);
+                }
+                if (SDL_RWwrite(dst, buffer, 1, out - buffer) != (size_t) (out - buffer)) {
+                    SDL_Error(SDL_EFWRITE);
+                    break;
                 }
             }
+            SDL_free(buffer);
         }
 
         /* Write the BMP file size */
@@ -24,6 +24,7 @@
 
 #include "SDL_endian.h"
 #include "SDL_video.h"
+#include "SDL_hints.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
 #include "SDL_pixels_c.h"
@@ -635,6 +636,20 @@ SDL_FreeFormat(SDL_PixelFormat *format)
     SDL_free(format);
 }
 
+/* Palette versions are unique across all palettes, so a palette pointer and
+   version together identify its contents even if the memory gets reused. */
+Uint32
+SDL_NextPaletteVersion(void)
+{
+    static SDL_atomic_t next_version;
+    Uint32 version;
+
+    do {
+        version = (Uint32) SDL_AtomicAdd(&next_version, 1) + 1;
+    } while (!version);
+    return version;
+}
+
 SDL_Palette *
 SDL_AllocPalette(int ncolors)
 {
@@ -658,7 +673,7 @@ SDL_AllocPalette(int ncolors)
         return NULL;
     }
     palette->ncolors = ncolors;
-    palette->version = 1;
+    palette->version = SDL_NextPaletteVersion();
     palette->refcount = 1;
 
     SDL_memset(palette->colors, 0xFF, ncolors * sizeof(*palette->colors));
@@ -713,10 +728,7 @@ SDL_SetPaletteColors(SDL_Palette * palette, const SDL_Color * colors,
         SDL_memcpy(palette->colors + firstcolor, colors,
                    ncolors * sizeof(*colors));
     }
-    ++palette->version;
-    if (!palette->version) {
-        palette->version = 1;
-    }
+    palette->version = SDL_NextPaletteVersion();
 
     return status;
 }
@@ -763,21 +775,354 @@ SDL_DitherColors(SDL_Color * colors, int bpp)
     }
 }
 
-/*
- * Match an RGB value to a particular palette index
+/* Inverse colormaps: for each cell of a 5-5-5 bit RGB cube, the list of
+   palette entries that can be nearest to an opaque color in that cell. The
+   lists are built the first time a cell is looked up, and searching them gives
+   exactly the same result as searching the whole palette.
  */
-Uint8
-SDL_FindColor(SDL_Palette * pal, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+#define INVERSE_CUBE_BITS           5
+#define INVERSE_CUBE_CELLS          (1 << (3 * INVERSE_CUBE_BITS))
+#define INVERSE_CELL_UNBUILT        0xFFFFFFFF
+#define INVERSE_COLORMAP_MIN_COLORS 16
+#define INVERSE_COLORMAP_CACHE_SIZE 4
+
+typedef enum
+{
+    SDL_PALETTE_MATCH_FAST,
+    SDL_PALETTE_MATCH_NEAREST,
+    SDL_PALETTE_MATCH_ORDERED,
+    SDL_PALETTE_MATCH_DIFFUSION
+} SDL_PaletteMatch;
+
+typedef struct
+{
+    const SDL_Palette *palette;
+    Uint32 version;
+    int ncolors;
+    int padded;                     /* ncolors rounded up to a multiple of 8 */
+    SDL_Color colors[256];
+    Sint16 r[256];
+    Sint16 g[256];
+    Sint16 b[256];
+    Sint32 a[256];                  /* squared distance of the alpha from opaque */
+    Uint32 cells[INVERSE_CUBE_CELLS];   /* first candidate << 9 | count */
+    Uint8 *candidates;
+    int used;
+    int allocated;
+} SDL_InverseColormap;
+
+static SDL_InverseColormap *inverse_colormaps[INVERSE_COLORMAP_CACHE_SIZE];
+static int inverse_colormap_next;
+static SDL_SpinLock inverse_colormap_lock;
+
+/* Take the inverse colormap of a palette out of the cache, or make a new one.
+   Nobody else can use it until it's released, so it needs no locking. Copies
+   of a palette, like the ones SDL_ConvertSurface() makes, share an entry.
+ */
+static SDL_InverseColormap *
+AcquireInverseColormap(const SDL_Palette * pal)
+{
+    SDL_InverseColormap *inv = NULL;
+    int i;
+
+    SDL_AtomicLock(&inverse_colormap_lock);
+    for (i = 0; i < INVERSE_COLORMAP_CACHE_SIZE; ++i) {
+        if (inverse_colormaps[i] &&
+            inverse_colormaps[i]->palette == pal &&
+            inverse_colormaps[i]->version == pal->version) {
+            inv = inverse_colormaps[i];
+            inverse_colormaps[i] = NULL;
+            break;
+        }
+    }
+    if (!inv && pal->ncolors <= 256) {
+        for (i = 0; i < INVERSE_COLORMAP_CACHE_SIZE; ++i) {
+            if (inverse_colormaps[i] &&
+                inverse_colormaps[i]->ncolors == pal->ncolors &&
+                SDL_memcmp(inverse_colormaps[i]->colors, pal->colors,
+                           pal->ncolors * sizeof(SDL_Color)) == 0) {
+                inv = inverse_colormaps[i];
+                inverse_colormaps[i] = NULL;
+                inv->palette = pal;
+                inv->version = pal->version;
+                break;
+            }
+        }
+    }
+    if (!inv) {
+        /* If the cache is full, reuse the memory of the oldest entry */
+        for (i = 0; i < INVERSE_COLORMAP_CACHE_SIZE; ++i) {
+            if (!inverse_colormaps[i]) {
+                break;
+            }
+        }
+        if (i == INVERSE_COLORMAP_CACHE_SIZE) {
+            inv = inverse_colormaps[inverse_colormap_next];
+            inverse_colormaps[inverse_colormap_next] = NULL;
+            inverse_colormap_next = (inverse_colormap_next + 1) % INVERSE_COLORMAP_CACHE_SIZE;
+        }
+    }
+    SDL_AtomicUnlock(&inverse_colormap_lock);
+
+    if (inv && inv->palette == pal && inv->version == pal->version) {
+        return inv;
+    }
+    if (!inv) {
+        inv = (SDL_InverseColormap *) SDL_calloc(1, sizeof(*inv));
+        if (!inv) {
+            return NULL;
+        }
+    }
+
+    inv->palette = pal;
+    inv->version = pal->version;
+    inv->ncolors = SDL_min(pal->ncolors, 256);
+    inv->padded = (inv->ncolors + 7) & ~7;
+    SDL_memcpy(inv->colors, pal->colors, inv->ncolors * sizeof(SDL_Color));
+    for (i = 0; i < inv->ncolors; ++i) {
+        const int ad = pal->colors[i].a - SDL_ALPHA_OPAQUE;
+        inv->r[i] = pal->colors[i].r;
+        inv->g[i] = pal->colors[i].g;
+        inv->b[i] = pal->colors[i].b;
+        inv->a[i] = ad * ad;
+    }
+    for (; i < inv->padded; ++i) {
+        /* Far enough away to never be a candidate */
+        inv->r[i] = inv->g[i] = inv->b[i] = 0x3FFF;
+        inv->a[i] = 0;
+    }
+    SDL_memset(inv->cells, 0xFF, sizeof(inv->cells));
+    inv->used = 0;
+    return inv;
+}
+
+static void
+ReleaseInverseColormap(SDL_InverseColormap * inv)
+{
+    SDL_InverseColormap *evicted;
+    int i;
+
+    SDL_AtomicLock(&inverse_colormap_lock);
+    for (i = 0; i < INVERSE_COLORMAP_CACHE_SIZE; ++i) {
+        if (!inverse_colormaps[i]) {
+            break;
+        }
+    }
+    if (i == INVERSE_COLORMAP_CACHE_SIZE) {
+        i = inverse_colormap_next;
+        inverse_colormap_next = (inverse_colormap_next + 1) % INVERSE_COLORMAP_CACHE_SIZE;
+    }
+    evicted = inverse_colormaps[i];
+    inverse_colormaps[i] = inv;
+    SDL_AtomicUnlock(&inverse_colormap_lock);
+
+    if (evicted) {
+        SDL_free(evicted->candidates);
+        SDL_free(evicted);
+    }
+}
+
+#ifdef __SSE2__
+static SDL_INLINE __m128i
+Min32_SSE2(__m128i a, __m128i b)
+{
+    const __m128i mask = _mm_cmplt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/* Sums squared 16-bit channel distances of 8 colors into two vectors of 4 */
+static SDL_INLINE void
+SumSquares_SSE2(__m128i r, __m128i g, __m128i b, const Sint32 *a,
+                __m128i *lo, __m128i *hi)
+{
+    const __m128i rg_lo = _mm_unpacklo_epi16(r, g);
+    const __m128i rg_hi = _mm_unpackhi_epi16(r, g);
+    const __m128i b_lo = _mm_unpacklo_epi16(b, _mm_setzero_si128());
+    const __m128i b_hi = _mm_unpackhi_epi16(b, _mm_setzero_si128());
+
+    *lo = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rg_lo, rg_lo), _mm_madd_epi16(b_lo, b_lo)),
+                        _mm_loadu_si128((const __m128i *) a));
+    *hi = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rg_hi, rg_hi), _mm_madd_epi16(b_hi, b_hi)),
+                        _mm_loadu_si128((const __m128i *) (a + 4)));
+}
+#endif /* __SSE2__ */
+
+/* Find the candidates of a cell: every color whose nearest point in the cell
+   is no further away than the furthest point of the closest color.
+ */
+static SDL_bool
+BuildInverseCell(SDL_InverseColormap * inv, int cell)
+{
+    const int shift = 8 - INVERSE_CUBE_BITS;
+    const int mask = (1 << INVERSE_CUBE_BITS) - 1;
+    const int r_lo = ((cell >> (2 * INVERSE_CUBE_BITS)) & mask) << shift;
+    const int g_lo = ((cell >> INVERSE_CUBE_BITS) & mask) << shift;
+    const int b_lo = (cell & mask) << shift;
+    const int r_hi = r_lo + (1 << shift) - 1;
+    const int g_hi = g_lo + (1 << shift) - 1;
+    const int b_hi = b_lo + (1 << shift) - 1;
+    Sint32 limit = SDL_MAX_SINT32;
+    int start, count = 0;
+    int i = 0;
+
+    if (inv->allocated - inv->used < inv->ncolors) {
+        const int allocated = SDL_max(inv->allocated * 2, 4096);
+        Uint8 *candidates = (Uint8 *) SDL_realloc(inv->candidates, allocated);
+        if (!candidates) {
+            return SDL_FALSE;
+        }
+        inv->candidates = candidates;
+        inv->allocated = allocated;
+    }
+    start = inv->used;
+
+#ifdef __SSE2__
+    if (SDL_HasSSE2()) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rl = _mm_set1_epi16(r_lo), rh = _mm_set1_epi16(r_hi);
+        const __m128i gl = _mm_set1_epi16(g_lo), gh = _mm_set1_epi16(g_hi);
+        const __m128i bl = _mm_set1_epi16(b_lo), bh = _mm_set1_epi16(b_hi);
+        __m128i lo, hi, best = _mm_set1_epi32(SDL_MAX_SINT32);
+        Sint32 bests[4];
+
+        for (i = 0; i < inv->padded; i += 8) {
+            const __m128i r = _mm_loadu_si128((const __m128i *) &inv->r[i]);
+            const __m128i g = _mm_loadu_si128((const __m128i *) &inv->g[i]);
+            const __m128i b = _mm_loadu_si128((const __m128i *) &inv->b[i]);
+            SumSquares_SSE2(_mm_max_epi16(_mm_sub_epi16(r, rl), _mm_sub_epi16(rh, r)),
+                            _mm_max_epi16(_mm_sub_epi16(g, gl), _mm_sub_epi16(gh, g)),
+                            _mm_max_epi16(_mm_sub_epi16(b, bl), _mm_sub_epi16(bh, b)),
+                            &inv->a[i], &lo, &hi);
+            best = Min32_SSE2(best, Min32_SSE2(lo, hi));
+        }
+        _mm_storeu_si128((__m128i *) bests, best);
+        limit = SDL_min(SDL_min(bests[0], bests[1]), SDL_min(bests[2], bests[3]));
+
+        best = _mm_set1_epi32(limit);
+        for (i = 0; i < inv->padded; i += 8) {
+            const __m128i r = _mm_loadu_si128((const __m128i *) &inv->r[i]);
+            const __m128i g = _mm_loadu_si128((const __m128i *) &inv->g[i]);
+            const __m128i b = _mm_loadu_si128((const __m128i *) &inv->b[i]);
+            int bits, k;
+
+            SumSquares_SSE2(_mm_max_epi16(_mm_max_epi16(_mm_sub_epi16(rl, r), _mm_sub_epi16(r, rh)), zero),
+                            _mm_max_epi16(_mm_max_epi16(_mm_sub_epi16(gl, g), _mm_sub_epi16(g, gh)), zero),
+                            _mm_max_epi16(_mm_max_epi16(_mm_sub_epi16(bl, b), _mm_sub_epi16(b, bh)), zero),
+                            &inv->a[i], &lo, &hi);
+            bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(lo, best))) |
+                   (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(hi, best))) << 4);
+            for (k = 0; k < 8; ++k) {
+                if (!(bits & (1 << k))) {
+                    inv->candidates[start + count++] = (Uint8) (i + k);
+                }
+            }
+        }
+    } else
+#endif
+    {
+        for (i = 0; i < inv->ncolors; ++i) {
+            const int rd = SDL_max(inv->r[i] - r_lo, r_hi - inv->r[i]);
+            const int gd = SDL_max(inv->g[i] - g_lo, g_hi - inv->g[i]);
+            const int bd = SDL_max(inv->b[i] - b_lo, b_hi - inv->b[i]);
+            limit = SDL_min(limit, rd * rd + gd * gd + bd * bd + inv->a[i]);
+        }
+        for (i = 0; i < inv->ncolors; ++i) {
+            const int rd = SDL_max(SDL_max(r_lo - inv->r[i], inv->r[i] - r_hi), 0);
+            const int gd = SDL_max(SDL_max(g_lo - inv->g[i], inv->g[i] - g_hi), 0);
+            const int bd = SDL_max(SDL_max(b_lo - inv->b[i], inv->b[i] - b_hi), 0);
+            if (rd * rd + gd * gd + bd * bd + inv->a[i] <= limit) {
+                inv->candidates[start + count++] = (Uint8) i;
+            }
+        }
+    }
+
+    inv->used += count;
+    inv->cells[cell] = ((Uint32) start << 9) | count;
+    return SDL_TRUE;
+}
+
+/* Find the nearest color to an opaque RGB value, or -1 if out of memory */
+static SDL_INLINE int
+FindInverseColor(SDL_InverseColormap * inv, Uint8 r, Uint8 g, Uint8 b)
+{
+    const int shift = 8 - INVERSE_CUBE_BITS;
+    const int cell = ((r >> shift) << (2 * INVERSE_CUBE_BITS)) |
+                     ((g >> shift) << INVERSE_CUBE_BITS) | (b >> shift);
+    const Uint8 *candidates;
+    unsigned int smallest = ~0;
+    int count, pixel = 0;
+
+    if (inv->cells[cell] == INVERSE_CELL_UNBUILT && !BuildInverseCell(inv, cell)) {
+        return -1;
+    }
+    candidates = inv->candidates + (inv->cells[cell] >> 9);
+    count = inv->cells[cell] & 0x1FF;
+    if (count == 1) {
+        return *candidates;
+    }
+    while (count--) {
+        const int i = *candidates++;
+        const int rd = inv->r[i] - r;
+        const int gd = inv->g[i] - g;
+        const int bd = inv->b[i] - b;
+        const unsigned int distance = (rd * rd) + (gd * gd) + (bd * bd) + inv->a[i];
+        if (distance < smallest) {
+            pixel = i;
+            smallest = distance;
+        }
+    }
+    return pixel;
+}
+
+/* Search the whole palette for the nearest color */
+static Uint8
+FindColorInPalette(const SDL_Palette * pal, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
 {
     /* Do colorspace distance matching */
     unsigned int smallest;
     unsigned int distance;
     int rd, gd, bd, ad;
-    int i;
+    int i = 0;
     Uint8 pixel = 0;
 
     smallest = ~0;
-    for (i = 0; i < pal->ncolors; ++i) {
+#ifdef __SSE2__
+    if (pal->ncolors >= 8 && SDL_HasSSE2()) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i color = _mm_set_epi16(a, b, g, r, a, b, g, r);
+        const __m128i four = _mm_set1_epi32(4);
+        __m128i index = _mm_set_epi32(3, 2, 1, 0);
+        __m128i best = _mm_set1_epi32(SDL_MAX_SINT32);
+        __m128i best_index = zero;
+        Sint32 bests[4], indices[4];
+        int k;
+
+        for (; i + 4 <= pal->ncolors; i += 4) {
+            const __m128i colors = _mm_loadu_si128((const __m128i *) &pal->colors[i]);
+            const __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(colors, zero), color);
+            const __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(colors, zero), color);
+            const __m128 sum_lo = _mm_castsi128_ps(_mm_madd_epi16(lo, lo));
+            const __m128 sum_hi = _mm_castsi128_ps(_mm_madd_epi16(hi, hi));
+            const __m128i distances = _mm_add_epi32(
+                _mm_castps_si128(_mm_shuffle_ps(sum_lo, sum_hi, _MM_SHUFFLE(2, 0, 2, 0))),
+                _mm_castps_si128(_mm_shuffle_ps(sum_lo, sum_hi, _MM_SHUFFLE(3, 1, 3, 1))));
+            const __m128i closer = _mm_cmplt_epi32(distances, best);
+            best = _mm_or_si128(_mm_and_si128(closer, distances), _mm_andnot_si128(closer, best));
+            best_index = _mm_or_si128(_mm_and_si128(closer, index), _mm_andnot_si128(closer, best_index));
+            index = _mm_add_epi32(index, four);
+        }
+        _mm_storeu_si128((__m128i *) bests, best);
+        _mm_storeu_si128((__m128i *) indices, best_index);
+        for (k = 0; k < 4; ++k) {
+            distance = (unsigned int) bests[k];
+            if (distance < smallest || (distance == smallest && indices[k] < pixel)) {
+                pixel = (Uint8) indices[k];
+                smallest = distance;
+            }
+        }
+    }
+#endif
+    for (; i < pal->ncolors; ++i) {
         rd = pal->colors[i].r - r;
         gd = pal->colors[i].g - g;
         bd = pal->colors[i].b - b;
@@ -794,6 +1139,162 @@ SDL_FindColor(SDL_Palette * pal, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
     return (pixel);
 }
 
+/*
+ * Match an RGB value to a particular palette index
+ */
+Uint8
+SDL_FindColor(SDL_Palette * pal, Uint8 r, Uint8 g, Uint8 b, Uint8 a)
+{
+    if (a == SDL_ALPHA_OPAQUE && pal->version &&
+        pal->ncolors >= INVERSE_COLORMAP_MIN_COLORS) {
+        SDL_InverseColormap *inv = AcquireInverseColormap(pal);
+        if (inv) {
+            const int pixel = FindInverseColor(inv, r, g, b);
+            ReleaseInverseColormap(inv);
+            if (pixel >= 0) {
+                return (Uint8) pixel;
+            }
+        }
+    }
+    return FindColorInPalette(pal, r, g, b, a);
+}
+
+static SDL_PaletteMatch
+GetPaletteMatch(void)
+{
+    const char *hint = SDL_GetHint(SDL_HINT_SURFACE_PALETTE_MATCH);
+
+    if (!hint || *hint == '0' || SDL_strcasecmp(hint, "fast") == 0) {
+        return SDL_PALETTE_MATCH_FAST;
+    }
+    if (*hint == '1' || SDL_strcasecmp(hint, "nearest") == 0) {
+        return SDL_PALETTE_MATCH_NEAREST;
+    }
+    if (*hint == '2' || SDL_strcasecmp(hint, "ordered") == 0) {
+        return SDL_PALETTE_MATCH_ORDERED;
+    }
+    if (*hint == '3' || SDL_strcasecmp(hint, "diffusion") == 0) {
+        return SDL_PALETTE_MATCH_DIFFUSION;
+    }
+    return SDL_PALETTE_MATCH_FAST;
+}
+
+/*
+ * Convert the pixels of a surface without a palette to the nearest colors of
+ * an 8-bit paletted surface of the same size, dithering if the hint asks for it.
+ * Returns 1 if the hint asks for the fast color cube mapping instead.
+ */
+int
+SDL_ConvertPixelsToPalette(SDL_Surface * src, SDL_Surface * dst)
+{
+    /* 4x4 Bayer matrix, scaled to offsets of -15 to 15 */
+    static const Sint8 bayer[4][4] = {
+        { -15,   1, -11,   5 },
+        {   9,  -7,  13,  -3 },
+        {  -9,   7, -13,   3 },
+        {  15,  -1,  11,  -5 }
+    };
+    const SDL_PaletteMatch match = GetPaletteMatch();
+    const SDL_Palette *pal = dst->format->palette;
+    const int width = src->w;
+    SDL_InverseColormap *inv;
+    Uint32 *row;
+    Uint32 last_color = 0;
+    int last_pixel = -1;
+    int *errors = NULL;
+    int x, y;
+
+    if (match == SDL_PALETTE_MATCH_FAST) {
+        return 1;
+    }
+
+    row = (Uint32 *) SDL_malloc(width * sizeof(*row));
+    if (!row) {
+        return SDL_OutOfMemory();
+    }
+    if (match == SDL_PALETTE_MATCH_DIFFUSION) {
+        /* Error of the current and next row, with a guard pixel at each end */
+        errors = (int *) SDL_calloc(2 * 3 * (width + 2), sizeof(*errors));
+        if (!errors) {
+            SDL_free(row);
+            return SDL_OutOfMemory();
+        }
+    }
+    inv = AcquireInverseColormap(pal);
+    if (!inv) {
+        SDL_free(errors);
+        SDL_free(row);
+        return SDL_OutOfMemory();
+    }
+
+    for (y = 0; y < src->h; ++y) {
+        Uint8 *pixels = (Uint8 *) dst->pixels + y * dst->pitch;
+        int *error = NULL, *next = NULL;
+
+        SDL_ConvertPixels(width, 1, src->format->format,
+                          (const Uint8 *) src->pixels + y * src->pitch, src->pitch,
+                          SDL_PIXELFORMAT_ARGB8888, row, width * sizeof(*row));
+        if (errors) {
+            error = errors + 3 * (width + 2) * (y & 1);
+            next = errors + 3 * (width + 2) * (~y & 1);
+            SDL_memset(next, 0, 3 * (width + 2) * sizeof(*next));
+        }
+
+        for (x = 0; x < width; ++x) {
+            int r = (row[x] >> 16) & 0xFF;
+            int g = (row[x] >> 8) & 0xFF;
+            int b = row[x] & 0xFF;
+            int pixel;
+
+            if (match == SDL_PALETTE_MATCH_NEAREST) {
+                /* Runs of the same color are common, so remember the last one */
+                if (row[x] == last_color && last_pixel >= 0) {
+                    pixels[x] = (Uint8) last_pixel;
+                    continue;
+                }
+                last_color = row[x];
+            } else if (match == SDL_PALETTE_MATCH_ORDERED) {
+                const int offset = bayer[y & 3][x & 3];
+                r = SDL_max(SDL_min(r + offset, 255), 0);
+                g = SDL_max(SDL_min(g + offset, 255), 0);
+                b = SDL_max(SDL_min(b + offset, 255), 0);
+            } else if (errors) {
+                const int *e = error + 3 * (x + 1);
+                r = SDL_max(SDL_min(r + e[0] / 16, 255), 0);
+                g = SDL_max(SDL_min(g + e[1] / 16, 255), 0);
+                b = SDL_max(SDL_min(b + e[2] / 16, 255), 0);
+            }
+
+            pixel = FindInverseColor(inv, (Uint8) r, (Uint8) g, (Uint8) b);
+            if (pixel < 0) {
+                pixel = FindColorInPalette(pal, (Uint8) r, (Uint8) g, (Uint8) b, SDL_ALPHA_OPAQUE);
+            }
+            pixels[x] = (Uint8) pixel;
+            last_pixel = pixel;
+
+            if (errors) {
+                /* Floyd-Steinberg: 7/16 right, 3/16 below left, 5/16 below, 1/16 below right */
+                const int er = r - pal->colors[pixel].r;
+                const int eg = g - pal->colors[pixel].g;
+                const int eb = b - pal->colors[pixel].b;
+                int *e = error + 3 * (x + 2);
+                e[0] += er * 7; e[1] += eg * 7; e[2] += eb * 7;
+                e = next + 3 * x;
+                e[0] += er * 3; e[1] += eg * 3; e[2] += eb * 3;
+                e += 3;
+                e[0] += er * 5; e[1] += eg * 5; e[2] += eb * 5;
+                e += 3;
+                e[0] += er; e[1] += eg; e[2] += eb;
+            }
+        }
+    }
+
+    ReleaseInverseColormap(inv);
+    SDL_free(errors);
+    SDL_free(row);
+    return 0;
+}
+
 /* Find the opaque pixel value corresponding to an RGB triple */
 Uint32
 SDL_MapRGB(const SDL_PixelFormat * format, Uint8 r, Uint8 g, Uint8 b)
@@ -871,10 +1372,89 @@ SDL_GetRGBA(Uint32 pixel, const SDL_PixelFormat * format,
     }
 }
 
+/* Recently built palette maps, so remapping a paletted surface after a
+   color mod or blend mode change doesn't have to rebuild its lookup table.
+ */
+#define PALETTE_MAP_CACHE_SIZE  16
+
+typedef struct
+{
+    const void *src;
+    Uint32 src_version;
+    const void *dst;
+    Uint32 dst_version;
+    Uint32 mod;
+    int size;
+    Uint8 table[256 * 4];
+} SDL_PaletteMapCacheEntry;
+
+static SDL_PaletteMapCacheEntry palette_map_cache[PALETTE_MAP_CACHE_SIZE];
+static int palette_map_cache_next;
+static SDL_SpinLock palette_map_cache_lock;
+
+static Uint8 *
+LookupPaletteMap(const void *src, Uint32 src_version, const void *dst,
+                 Uint32 dst_version, Uint32 mod, int size)
+{
+    Uint8 *map = NULL;
+    int i;
+
+    if (size > (int) sizeof(palette_map_cache[0].table)) {
+        return NULL;
+    }
+
+    SDL_AtomicLock(&palette_map_cache_lock);
+    for (i = 0; i < PALETTE_MAP_CACHE_SIZE; ++i) {
+        const SDL_PaletteMapCacheEntry *entry = &palette_map_cache[i];
+        if (entry->size == size && entry->src == src &&
+            entry->src_version == src_version && entry->dst == dst &&
+            entry->dst_version == dst_version && entry->mod == mod) {
+            map = (Uint8 *) SDL_malloc(size);
+            if (map) {
+                SDL_memcpy(map, entry->table, size);
+            }
+            break;
+        }
+    }
+    SDL_AtomicUnlock(&palette_map_cache_lock);
+
+    if (map) {
+        SDL_AtomicIncRef(&SDL_palette_map_hits);
+    } else {
+        SDL_AtomicIncRef(&SDL_palette_map_misses);
+    }
+    return map;
+}
+
+static void
+StorePaletteMap(const void *src, Uint32 src_version, const void *dst,
+                Uint32 dst_version, Uint32 mod, const Uint8 * map, int size)
+{
+    SDL_PaletteMapCacheEntry *entry;
+
+    if (size > (int) sizeof(palette_map_cache[0].table)) {
+        return;
+    }
+
+    SDL_AtomicLock(&palette_map_cache_lock);
+    entry = &palette_map_cache[palette_map_cache_next];
+    palette_map_cache_next = (palette_map_cache_next + 1) % PALETTE_MAP_CACHE_SIZE;
+    entry->src = src;
+    entry->src_version = src_version;
+    entry->dst = dst;
+    entry->dst_version = dst_version;
+    entry->mod = mod;
+    entry->size = size;
+    SDL_memcpy(entry->table, map, size);
+    SDL_AtomicUnlock(&palette_map_cache_lock);
+}
+
 /* Map from Palette to Palette */
 static Uint8 *
 Map1to1(SDL_Palette * src, SDL_Palette * dst, int *identical)
 {
+    /* A version of 0 is the dither palette, which has no stable address */
+    const void *src_key = src->version ? src : NULL;
     Uint8 *map;
     int i;
 
@@ -892,6 +1472,11 @@ Map1to1(SDL_Palette * src, SDL_Palette * dst, int *identical)
         }
         *identical = 0;
     }
+    map = LookupPaletteMap(src_key, src->version, dst, dst->version, 0,
+                           src->ncolors);
+    if (map) {
+        return (map);
+    }
     map = (Uint8 *) SDL_malloc(src->ncolors);
     if (map == NULL) {
         SDL_OutOfMemory();
@@ -902,6 +1487,8 @@ Map1to1(SDL_Palette * src, SDL_Palette * dst, int *identical)
                                src->colors[i].r, src->colors[i].g,
                                src->colors[i].b, src->colors[i].a);
     }
+    StorePaletteMap(src_key, src->version, dst, dst->version, 0,
+                    map, src->ncolors);
     return (map);
 }
 
@@ -914,8 +1501,18 @@ Map1toN(SDL_PixelFormat * src, Uint8 Rmod, Uint8 Gmod, Uint8 Bmod, Uint8 Amod,
     int i;
     int bpp;
     SDL_Palette *pal = src->palette;
+    const Uint32 mod = ((Uint32) Rmod << 24) | ((Uint32) Gmod << 16) |
+                       ((Uint32) Bmod << 8) | Amod;
+    const SDL_bool cacheable = (dst->format != SDL_PIXELFORMAT_UNKNOWN);
 
     bpp = ((dst->BytesPerPixel == 3) ? 4 : dst->BytesPerPixel);
+    if (cacheable) {
+        map = LookupPaletteMap(pal, pal->version, NULL, dst->format, mod,
+                               pal->ncolors * bpp);
+        if (map) {
+            return (map);
+        }
+    }
     map = (Uint8 *) SDL_malloc(pal->ncolors * bpp);
     if (map == NULL) {
         SDL_OutOfMemory();
@@ -930,6 +1527,10 @@ Map1toN(SDL_PixelFormat * src, Uint8 Rmod, Uint8 Gmod, Uint8 Bmod, Uint8 Amod,
         Uint8 A = (Uint8) ((pal->colors[i].a * Amod) / 255);
         ASSEMBLE_RGBA(&map[i * bpp], dst->BytesPerPixel, dst, R, G, B, A);
     }
+    if (cacheable) {
+        StorePaletteMap(pal, pal->version, NULL, dst->format, mod,
+                        map, pal->ncolors * bpp);
+    }
     return (map);
 }
 
@@ -945,6 +1546,7 @@ MapNto1(SDL_PixelFormat * src, SDL_PixelFormat * dst, int *identical)
     dithered.ncolors = 256;
     SDL_DitherColors(colors, 8);
     dithered.colors = colors;
+    dithered.version = 0;
     return (Map1to1(&dithered, pal, identical));
 }
 
@@ -1078,6 +1680,8 @@ SDL_FreeBlitMap(SDL_BlitMap * map)
 {
     if (map) {
         SDL_InvalidateMap(map);
+        SDL_FreeSurface(map->linear_src);
+        SDL_FreeSurface(map->linear_dst);
         SDL_free(map);
     }
 }
@@ -34,7 +34,9 @@ extern int SDL_MapSurface(SDL_Surface * src, SDL_Surface * dst);
 extern void SDL_FreeBlitMap(SDL_BlitMap * map);
 
 /* Miscellaneous functions */
+extern Uint32 SDL_NextPaletteVersion(void);
 extern void SDL_DitherColors(SDL_Color * colors, int bpp);
 extern Uint8 SDL_FindColor(SDL_Palette * pal, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+extern int SDL_ConvertPixelsToPalette(SDL_Surface * src, SDL_Surface * dst);
 
 /* vi: set ts=4 sw=4 expandtab: */
@@ -28,201 +28,736 @@
 
 #include "SDL_video.h"
 #include "SDL_blit.h"
+#include "../thread/SDL_parallel_c.h"
 
-/* This isn't ready for general consumption yet - it should be folded
-   into the general blitting mechanism.
+/* The stretch is driven by per-column lookup tables that are built for each
+   call, so there is no shared state and no generated code: it is safe to
+   call from any thread, as long as the surfaces themselves aren't shared.
 */
 
-#if ((defined(_MSC_VER) && defined(_M_IX86))    || \
-     (defined(__WATCOMC__) && defined(__386__)) || \
-     (defined(__GNUC__) && defined(__i386__))) && SDL_ASSEMBLY_ROUTINES
-/* There's a bug with gcc 4.4.1 and -O2 where srcp doesn't get the correct
- * value after the first scanline.  FIXME? */
-/* #define USE_ASM_STRETCH */
-#endif
+/* Build the source column for every destination column, stepping exactly
+   like the original 16.16 fixed point copy_row loops did.
+*/
+static void
+build_nearest_columns(int src_w, int dst_w, int *columns)
+{
+    int i, col = -1;
+    int pos = 0x10000;
+    const int inc = (src_w << 16) / dst_w;
 
-#ifdef USE_ASM_STRETCH
+    for (i = 0; i < dst_w; ++i) {
+        while (pos >= 0x10000L) {
+            ++col;
+            pos -= 0x10000L;
+        }
+        columns[i] = col;
+        pos += inc;
+    }
+}
 
-#ifdef HAVE_MPROTECT
-#include <sys/types.h>
-#include <sys/mman.h>
-#endif
-#ifdef __GNUC__
-#define PAGE_ALIGNED __attribute__((__aligned__(4096)))
-#else
-#define PAGE_ALIGNED
-#endif
+#define DEFINE_COPY_ROW(name, type)         \
+static void name(const type *src, type *dst, const int *columns, int dst_w) \
+{                                           \
+    int i;                                  \
+                                            \
+    for (i = dst_w; i >= 4; i -= 4) {       \
+        dst[0] = src[columns[0]];           \
+        dst[1] = src[columns[1]];           \
+        dst[2] = src[columns[2]];           \
+        dst[3] = src[columns[3]];           \
+        dst += 4;                           \
+        columns += 4;                       \
+    }                                       \
+    while (i--) {                           \
+        *dst++ = src[*columns++];           \
+    }                                       \
+}
+/* *INDENT-OFF* */
+DEFINE_COPY_ROW(copy_row1, Uint8)
+DEFINE_COPY_ROW(copy_row2, Uint16)
+/* *INDENT-ON* */
+
+static void
+copy_row3(const Uint8 * src, Uint8 * dst, const int *columns, int src_w, int dst_w)
+{
+    int i = dst_w;
+
+    /* Move each pixel as an unaligned 32-bit word. The extra byte read is
+       still in the row unless the column is the last one, and the extra byte
+       written is overwritten by the next pixel. */
+    for (; i > 4 && columns[3] < src_w - 1; i -= 4) {
+        *(Uint32 *) dst = *(const Uint32 *) (src + columns[0] * 3);
+        *(Uint32 *) (dst + 3) = *(const Uint32 *) (src + columns[1] * 3);
+        *(Uint32 *) (dst + 6) = *(const Uint32 *) (src + columns[2] * 3);
+        *(Uint32 *) (dst + 9) = *(const Uint32 *) (src + columns[3] * 3);
+        dst += 12;
+        columns += 4;
+    }
+    for (; i > 0; --i) {
+        const Uint8 *pixel = src + (*columns++ * 3);
+        *dst++ = pixel[0];
+        *dst++ = pixel[1];
+        *dst++ = pixel[2];
+    }
+}
+
+static void
+copy_row4(const Uint32 * src, Uint32 * dst, const int *columns, int dst_w)
+{
+    int i = dst_w;
 
-#if defined(_M_IX86) || defined(__i386__) || defined(__386__)
-#define PREFIX16    0x66
-#define STORE_BYTE  0xAA
-#define STORE_WORD  0xAB
-#define LOAD_BYTE   0xAC
-#define LOAD_WORD   0xAD
-#define RETURN      0xC3
+#ifdef __SSE2__
+    /* Gather four pixels through the column table, store them in one go */
+    for (; i >= 4; i -= 4) {
+        const __m128i pixels = _mm_set_epi32(src[columns[3]], src[columns[2]],
+                                             src[columns[1]], src[columns[0]]);
+        _mm_storeu_si128((__m128i *) dst, pixels);
+        dst += 4;
+        columns += 4;
+    }
 #else
-#error Need assembly opcodes for this architecture
+    for (; i >= 4; i -= 4) {
+        dst[0] = src[columns[0]];
+        dst[1] = src[columns[1]];
+        dst[2] = src[columns[2]];
+        dst[3] = src[columns[3]];
+        dst += 4;
+        columns += 4;
+    }
 #endif
+    while (i--) {
+        *dst++ = src[*columns++];
+    }
+}
 
-static unsigned char copy_row[4096] PAGE_ALIGNED;
-
-static int
-generate_rowbytes(int src_w, int dst_w, int bpp)
+/* Exact 2x horizontal upscale, every source pixel is written twice */
+static void
+double_row(const Uint8 * src, Uint8 * dst, int src_w, int bpp)
 {
-    static struct
-    {
-        int bpp;
-        int src_w;
-        int dst_w;
-        int status;
-    } last;
+    int i = src_w;
 
-    int i;
-    int pos, inc;
-    unsigned char *eip, *fence;
-    unsigned char load, store;
+#ifdef __SSE2__
+    const int step = 16 / bpp;
+    for (; i >= step; i -= step) {
+        const __m128i pixels = _mm_loadu_si128((const __m128i *) src);
+        __m128i lo, hi;
+        switch (bpp) {
+        case 1:
+            lo = _mm_unpacklo_epi8(pixels, pixels);
+            hi = _mm_unpackhi_epi8(pixels, pixels);
+            break;
+        case 2:
+            lo = _mm_unpacklo_epi16(pixels, pixels);
+            hi = _mm_unpackhi_epi16(pixels, pixels);
+            break;
+        default:
+            lo = _mm_unpacklo_epi32(pixels, pixels);
+            hi = _mm_unpackhi_epi32(pixels, pixels);
+            break;
+        }
+        _mm_storeu_si128((__m128i *) dst, lo);
+        _mm_storeu_si128((__m128i *) (dst + 16), hi);
+        src += 16;
+        dst += 32;
+    }
+#endif
+    switch (bpp) {
+    case 1:
+        while (i--) {
+            dst[0] = dst[1] = *src++;
+            dst += 2;
+        }
+        break;
+    case 2:
+        while (i--) {
+            const Uint16 pixel = *(const Uint16 *) src;
+            ((Uint16 *) dst)[0] = pixel;
+            ((Uint16 *) dst)[1] = pixel;
+            src += 2;
+            dst += 4;
+        }
+        break;
+    default:
+        while (i--) {
+            const Uint32 pixel = *(const Uint32 *) src;
+            ((Uint32 *) dst)[0] = pixel;
+            ((Uint32 *) dst)[1] = pixel;
+            src += 4;
+            dst += 8;
+        }
+        break;
+    }
+}
 
-    /* See if we need to regenerate the copy buffer */
-    if ((src_w == last.src_w) && (dst_w == last.dst_w) && (bpp == last.bpp)) {
-        return (last.status);
+static void
+stretch_row_nearest(const Uint8 * srcp, Uint8 * dstp, const int *columns,
+                    int src_w, int dst_w, int bpp)
+{
+    if (src_w == dst_w) {
+        SDL_memcpy(dstp, srcp, dst_w * bpp);
+        return;
+    }
+    if (dst_w == 2 * src_w && bpp != 3) {
+        double_row(srcp, dstp, src_w, bpp);
+        return;
     }
-    last.bpp = bpp;
-    last.src_w = src_w;
-    last.dst_w = dst_w;
-    last.status = -1;
 
     switch (bpp) {
     case 1:
-        load = LOAD_BYTE;
-        store = STORE_BYTE;
+        copy_row1(srcp, dstp, columns, dst_w);
         break;
     case 2:
+        copy_row2((const Uint16 *) srcp, (Uint16 *) dstp, columns, dst_w);
+        break;
+    case 3:
+        copy_row3(srcp, dstp, columns, src_w, dst_w);
+        break;
     case 4:
-        load = LOAD_WORD;
-        store = STORE_WORD;
+        copy_row4((const Uint32 *) srcp, (Uint32 *) dstp, columns, dst_w);
         break;
-    default:
-        return SDL_SetError("ASM stretch of %d bytes isn't supported", bpp);
     }
-#ifdef HAVE_MPROTECT
-    /* Make the code writeable */
-    if (mprotect(copy_row, sizeof(copy_row), PROT_READ | PROT_WRITE) < 0) {
-        return SDL_SetError("Couldn't make copy buffer writeable");
+}
+
+static int
+stretch_nearest(SDL_Surface * src, const SDL_Rect * srcrect,
+                SDL_Surface * dst, const SDL_Rect * dstrect)
+{
+    const int bpp = dst->format->BytesPerPixel;
+    int *columns;
+    int pos, inc;
+    int dst_maxrow;
+    int src_row, dst_row;
+    Uint8 *srcp = NULL;
+    Uint8 *lastsrcp = NULL;
+    Uint8 *lastdstp = NULL;
+    Uint8 *dstp;
+
+    columns = (int *) SDL_malloc(dstrect->w * sizeof(*columns));
+    if (!columns) {
+        return SDL_OutOfMemory();
     }
-#endif
+    build_nearest_columns(srcrect->w, dstrect->w, columns);
+
+    /* Set up the data... */
     pos = 0x10000;
-    inc = (src_w << 16) / dst_w;
-    eip = copy_row;
-    fence = copy_row + sizeof(copy_row)-2;
-    for (i = 0; i < dst_w; ++i) {
+    inc = (srcrect->h << 16) / dstrect->h;
+    src_row = srcrect->y;
+    dst_row = dstrect->y;
+
+    /* Perform the stretch blit */
+    for (dst_maxrow = dst_row + dstrect->h; dst_row < dst_maxrow; ++dst_row) {
+        dstp = (Uint8 *) dst->pixels + (dst_row * dst->pitch)
+            + (dstrect->x * bpp);
         while (pos >= 0x10000L) {
-            if (eip == fence) {
-                return -1;
-            }
-            if (bpp == 2) {
-                *eip++ = PREFIX16;
-            }
-            *eip++ = load;
+            srcp = (Uint8 *) src->pixels + (src_row * src->pitch)
+                + (srcrect->x * bpp);
+            ++src_row;
             pos -= 0x10000L;
         }
-        if (eip == fence) {
-            return -1;
-        }
-        if (bpp == 2) {
-            *eip++ = PREFIX16;
+        if (srcp == lastsrcp) {
+            /* Vertical upscale, the previous output row is already done */
+            SDL_memcpy(dstp, lastdstp, dstrect->w * bpp);
+        } else {
+            stretch_row_nearest(srcp, dstp, columns, srcrect->w, dstrect->w, bpp);
+            lastsrcp = srcp;
+            lastdstp = dstp;
         }
-        *eip++ = store;
         pos += inc;
     }
-    *eip++ = RETURN;
 
-#ifdef HAVE_MPROTECT
-    /* Make the code executable but not writeable */
-    if (mprotect(copy_row, sizeof(copy_row), PROT_READ | PROT_EXEC) < 0) {
-        return SDL_SetError("Couldn't make copy buffer executable");
-    }
-#endif
-    last.status = 0;
-    return (0);
+    SDL_free(columns);
+    return 0;
 }
 
-#endif /* USE_ASM_STRETCH */
+/* Blend two 8888 pixels, frac is the weight of b in the range [0..256] */
+static SDL_INLINE Uint32
+lerp_pixel(Uint32 a, Uint32 b, Uint32 frac)
+{
+    const Uint32 inv = 256 - frac;
+    const Uint32 rb = (((a & 0x00FF00FF) * inv + (b & 0x00FF00FF) * frac) >> 8) & 0x00FF00FF;
+    const Uint32 ag = (((a >> 8) & 0x00FF00FF) * inv + ((b >> 8) & 0x00FF00FF) * frac) & 0xFF00FF00;
+    return rb | ag;
+}
 
-#define DEFINE_COPY_ROW(name, type)         \
-static void name(type *src, int src_w, type *dst, int dst_w)    \
-{                                           \
-    int i;                                  \
-    int pos, inc;                           \
-    type pixel = 0;                         \
-                                            \
-    pos = 0x10000;                          \
-    inc = (src_w << 16) / dst_w;            \
-    for ( i=dst_w; i>0; --i ) {             \
-        while ( pos >= 0x10000L ) {         \
-            pixel = *src++;                 \
-            pos -= 0x10000L;                \
-        }                                   \
-        *dst++ = pixel;                     \
-        pos += inc;                         \
-    }                                       \
+/* Build pixel center aligned sample positions for a linear stretch, as
+   pairs of (first source index, weight of the next one).  The index is
+   kept one short of the end so the next pixel can always be read.
+*/
+static void
+build_linear_steps(int src_len, int dst_len, int *steps)
+{
+    int i;
+    const int inc = (src_len << 16) / dst_len;
+    const int last = SDL_max(src_len - 2, 0);
+    int pos = (inc >> 1) - 0x8000;
+
+    for (i = 0; i < dst_len; ++i) {
+        const int p = SDL_max(pos, 0);
+        int index = p >> 16;
+        int frac = (p >> 8) & 0xFF;
+        if (index > last) {
+            index = last;
+            frac = (src_len > 1) ? 256 : 0;
+        }
+        steps[2 * i] = index;
+        steps[2 * i + 1] = frac;
+        pos += inc;
+    }
 }
-/* *INDENT-OFF* */
-DEFINE_COPY_ROW(copy_row1, Uint8)
-DEFINE_COPY_ROW(copy_row2, Uint16)
-DEFINE_COPY_ROW(copy_row4, Uint32)
-/* *INDENT-ON* */
 
-/* The ASM code doesn't handle 24-bpp stretch blits */
 static void
-copy_row3(Uint8 * src, int src_w, Uint8 * dst, int dst_w)
+scale_row_linear(const Uint32 * src, Uint32 * dst, const int *columns,
+                 int next, int dst_w)
 {
     int i;
-    int pos, inc;
-    Uint8 pixel[3] = { 0, 0, 0 };
 
-    pos = 0x10000;
-    inc = (src_w << 16) / dst_w;
     for (i = dst_w; i > 0; --i) {
-        while (pos >= 0x10000L) {
-            pixel[0] = *src++;
-            pixel[1] = *src++;
-            pixel[2] = *src++;
-            pos -= 0x10000L;
+        const Uint32 *pixel = src + columns[0];
+        *dst++ = lerp_pixel(pixel[0], pixel[next], columns[1]);
+        columns += 2;
+    }
+}
+
+static void
+blend_rows_linear(const Uint32 * row0, const Uint32 * row1, Uint32 * dst,
+                  int frac, int dst_w)
+{
+    int i = dst_w;
+
+    if (frac == 0) {
+        SDL_memcpy(dst, row0, dst_w * sizeof(Uint32));
+        return;
+    }
+
+#ifdef __SSE2__
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i w0 = _mm_set1_epi16((short) (256 - frac));
+        const __m128i w1 = _mm_set1_epi16((short) frac);
+
+        for (; i >= 4; i -= 4) {
+            const __m128i a = _mm_loadu_si128((const __m128i *) row0);
+            const __m128i b = _mm_loadu_si128((const __m128i *) row1);
+            /* a * (256 - frac) + b * frac never exceeds 0xFF00 per lane */
+            const __m128i lo = _mm_srli_epi16(_mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1)), 8);
+            const __m128i hi = _mm_srli_epi16(_mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1)), 8);
+            _mm_storeu_si128((__m128i *) dst, _mm_packus_epi16(lo, hi));
+            row0 += 4;
+            row1 += 4;
+            dst += 4;
         }
-        *dst++ = pixel[0];
-        *dst++ = pixel[1];
-        *dst++ = pixel[2];
-        pos += inc;
+    }
+#endif
+    while (i--) {
+        *dst++ = lerp_pixel(*row0++, *row1++, frac);
     }
 }
 
-/* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
+/* Full screen stretches are split into bands of rows done in parallel */
+#define STRETCH_PARALLEL_PIXELS (256 * 256)
+#define STRETCH_BAND_ROWS       32
+
+typedef struct
+{
+    const SDL_Surface *src;
+    const SDL_Rect *srcrect;
+    SDL_Surface *dst;
+    const SDL_Rect *dstrect;
+    const int *columns;
+    const int *rows;
+    SDL_atomic_t failed;
+} SDL_LinearStretch;
+
+static void
+stretch_linear_band(void *data, int y0, int y1)
+{
+    SDL_LinearStretch *ctx = (SDL_LinearStretch *) data;
+    const SDL_Rect *srcrect = ctx->srcrect;
+    const SDL_Rect *dstrect = ctx->dstrect;
+    const int next = (srcrect->w > 1) ? 1 : 0;
+    const int *rows = ctx->rows;
+    Uint32 *cache[2];
+    int cached[2] = { -1, -1 };
+    int y;
+
+    /* Two horizontally scaled source rows */
+    cache[0] = (Uint32 *) SDL_malloc(dstrect->w * 2 * sizeof(Uint32));
+    if (!cache[0]) {
+        SDL_AtomicSet(&ctx->failed, 1);
+        return;
+    }
+    cache[1] = cache[0] + dstrect->w;
+
+    for (y = y0; y < y1; ++y) {
+        const int frac = rows[2 * y + 1];
+        int want[2], slot[2];
+        int i;
+        Uint32 *dstp;
+
+        want[0] = rows[2 * y];
+        want[1] = want[0] + ((frac && srcrect->h > 1) ? 1 : 0);
+
+        /* Each source row is scaled horizontally only once while upscaling */
+        for (i = 0; i < 2; ++i) {
+            if (cached[0] == want[i]) {
+                slot[i] = 0;
+            } else if (cached[1] == want[i]) {
+                slot[i] = 1;
+            } else {
+                const Uint8 *srcp = (const Uint8 *) ctx->src->pixels +
+                    (srcrect->y + want[i]) * ctx->src->pitch + srcrect->x * 4;
+                slot[i] = (i == 1) ? !slot[0] : (cached[0] == want[1]);
+                scale_row_linear((const Uint32 *) srcp, cache[slot[i]],
+                                 ctx->columns, next, dstrect->w);
+                cached[slot[i]] = want[i];
+            }
+        }
+
+        dstp = (Uint32 *) ((Uint8 *) ctx->dst->pixels +
+                           (dstrect->y + y) * ctx->dst->pitch + dstrect->x * 4);
+        blend_rows_linear(cache[slot[0]], cache[slot[1]], dstp,
+                          (want[1] != want[0]) ? frac : 0, dstrect->w);
+    }
+
+    SDL_free(cache[0]);
+}
+
+static int
+stretch_linear(SDL_Surface * src, const SDL_Rect * srcrect,
+               SDL_Surface * dst, const SDL_Rect * dstrect)
+{
+    SDL_LinearStretch ctx;
+    int *columns;
+
+    /* Column and row steps */
+    columns = (int *) SDL_malloc((dstrect->w + dstrect->h) * 2 * sizeof(int));
+    if (!columns) {
+        return SDL_OutOfMemory();
+    }
+    build_linear_steps(srcrect->w, dstrect->w, columns);
+    build_linear_steps(srcrect->h, dstrect->h, columns + dstrect->w * 2);
+
+    ctx.src = src;
+    ctx.srcrect = srcrect;
+    ctx.dst = dst;
+    ctx.dstrect = dstrect;
+    ctx.columns = columns;
+    ctx.rows = columns + dstrect->w * 2;
+    SDL_AtomicSet(&ctx.failed, 0);
+
+    if (dstrect->w * dstrect->h >= STRETCH_PARALLEL_PIXELS) {
+        SDL_ParallelFor(dstrect->h, STRETCH_BAND_ROWS, stretch_linear_band, &ctx);
+    } else {
+        stretch_linear_band(&ctx, 0, dstrect->h);
+    }
+
+    SDL_free(columns);
+    if (SDL_AtomicGet(&ctx.failed)) {
+        return SDL_OutOfMemory();
+    }
+    return 0;
+}
+
+/* Downscaling averages every source pixel covered by a destination pixel
+   (a box filter), since two taps would skip most of the source.  Each
+   dimension is described by a list of taps per destination pixel: the first
+   source pixel, how many follow and their weights, which add up to 256.
+   Upscaled dimensions use the two linear taps.
 */
-int
-SDL_SoftStretch(SDL_Surface * src, const SDL_Rect * srcrect,
-                SDL_Surface * dst, const SDL_Rect * dstrect)
+typedef struct
+{
+    int start;
+    int count;
+    int weights;        /* index of the first weight */
+} SDL_FilterTaps;
+
+/* Number of weights needed to filter src_len down or up to dst_len */
+static int
+count_filter_weights(int src_len, int dst_len)
+{
+    if (dst_len >= src_len) {
+        return dst_len * 2;
+    }
+    return src_len + dst_len;
+}
+
+/* Returns the largest number of taps used by a destination pixel */
+static int
+build_filter_taps(int src_len, int dst_len, SDL_FilterTaps * taps,
+                  Uint16 * weights)
+{
+    int i, n = 0, max_count = 1;
+
+    if (dst_len >= src_len) {
+        int *steps = (int *) SDL_malloc(dst_len * 2 * sizeof(int));
+        if (!steps) {
+            return -1;
+        }
+        build_linear_steps(src_len, dst_len, steps);
+        for (i = 0; i < dst_len; ++i) {
+            const int frac = (src_len > 1) ? steps[2 * i + 1] : 0;
+            taps[i].start = steps[2 * i];
+            taps[i].count = frac ? 2 : 1;
+            taps[i].weights = n;
+            weights[n++] = 256 - frac;
+            if (frac) {
+                weights[n++] = frac;
+                max_count = 2;
+            }
+        }
+        SDL_free(steps);
+        return max_count;
+    }
+
+    /* Positions are in 1/dst_len source pixels: destination pixel i covers
+       [i * src_len, (i + 1) * src_len) and source pixel j covers
+       [j * dst_len, (j + 1) * dst_len).  The weights are taken from the
+       running coverage so they always add up to exactly 256.
+    */
+    for (i = 0; i < dst_len; ++i) {
+        const int a = i * src_len;
+        const int b = a + src_len;
+        const int last = (b - 1) / dst_len;
+        int j = a / dst_len;
+        int covered = 0, given = 0;
+
+        taps[i].start = j;
+        taps[i].count = last - j + 1;
+        taps[i].weights = n;
+        for (; j <= last; ++j) {
+            int w;
+            covered += SDL_min(b, (j + 1) * dst_len) - SDL_max(a, j * dst_len);
+            w = covered * 256 / src_len - given;
+            weights[n++] = (Uint16) w;
+            given += w;
+        }
+        max_count = SDL_max(max_count, taps[i].count);
+    }
+    return max_count;
+}
+
+/* Filter a source row horizontally into 16-bit channels.  The sums are
+   halved (at most 255 * 256 / 2) so the vertical pass can use signed
+   multiplies.
+*/
+static void
+filter_row(const Uint32 * src, Uint16 * dst, const SDL_FilterTaps * taps,
+           const Uint16 * weights, int dst_w)
+{
+    int i, j;
+
+    for (i = dst_w; i > 0; --i, ++taps) {
+        const Uint32 *pixel = src + taps->start;
+        const Uint16 *w = weights + taps->weights;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sum = _mm_set1_epi16(1);
+
+        for (j = 0; j < taps->count; ++j) {
+            const __m128i p = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int) pixel[j]), zero);
+            sum = _mm_add_epi16(sum, _mm_mullo_epi16(p, _mm_set1_epi16((short) w[j])));
+        }
+        _mm_storel_epi64((__m128i *) dst, _mm_srli_epi16(sum, 1));
+#else
+        Uint32 sum0 = 1, sum1 = 1, sum2 = 1, sum3 = 1;
+
+        for (j = 0; j < taps->count; ++j) {
+            const Uint32 p = pixel[j];
+            sum0 += (p & 0xFF) * w[j];
+            sum1 += ((p >> 8) & 0xFF) * w[j];
+            sum2 += ((p >> 16) & 0xFF) * w[j];
+            sum3 += (p >> 24) * w[j];
+        }
+        dst[0] = (Uint16) (sum0 >> 1);
+        dst[1] = (Uint16) (sum1 >> 1);
+        dst[2] = (Uint16) (sum2 >> 1);
+        dst[3] = (Uint16) (sum3 >> 1);
+#endif
+        dst += 4;
+    }
+}
+
+/* Combine horizontally filtered rows into one destination row */
+static void
+filter_column(const Uint16 ** rows, const Uint16 * weights, int count,
+              Uint32 * dst, int dst_w)
+{
+    const int n = dst_w * 4;
+    int i = 0, j;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo = _mm_set1_epi32(1 << 14);
+        __m128i hi = lo;
+
+        /* Two rows at a time, interleaved for _mm_madd_epi16() */
+        for (j = 0; j < count; j += 2) {
+            const __m128i a = _mm_loadu_si128((const __m128i *) (rows[j] + i));
+            __m128i b, w;
+            if (j + 1 < count) {
+                b = _mm_loadu_si128((const __m128i *) (rows[j + 1] + i));
+                w = _mm_set1_epi32(weights[j] | (weights[j + 1] << 16));
+            } else {
+                b = zero;
+                w = _mm_set1_epi32(weights[j]);
+            }
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        lo = _mm_srai_epi32(lo, 15);
+        hi = _mm_srai_epi32(hi, 15);
+        _mm_storel_epi64((__m128i *) (dst + i / 4),
+                         _mm_packus_epi16(_mm_packs_epi32(lo, hi), zero));
+    }
+#endif
+    for (; i < n; ++i) {
+        Uint32 sum = 1 << 14;
+        for (j = 0; j < count; ++j) {
+            sum += rows[j][i] * weights[j];
+        }
+        ((Uint8 *) dst)[i] = (Uint8) (sum >> 15);
+    }
+}
+
+typedef struct
+{
+    const SDL_Surface *src;
+    const SDL_Rect *srcrect;
+    SDL_Surface *dst;
+    const SDL_Rect *dstrect;
+    const SDL_FilterTaps *xtaps;
+    const SDL_FilterTaps *ytaps;
+    const Uint16 *xweights;
+    const Uint16 *yweights;
+    int ymax;
+    SDL_atomic_t failed;
+} SDL_FilterStretch;
+
+static void
+stretch_filtered_band(void *data, int y0, int y1)
+{
+    SDL_FilterStretch *ctx = (SDL_FilterStretch *) data;
+    const SDL_Rect *srcrect = ctx->srcrect;
+    const SDL_Rect *dstrect = ctx->dstrect;
+    const int ring = ctx->ymax;
+    const int row_len = dstrect->w * 4;
+    Uint16 *cache;
+    const Uint16 **rows;
+    int *cached;
+    int i, y;
+
+    /* A ring of horizontally filtered source rows, enough for the taps of
+       any destination row, indexed by source row modulo its size.
+    */
+    cache = (Uint16 *) SDL_malloc(ring * (row_len * sizeof(Uint16) +
+                                          sizeof(*rows) + sizeof(*cached)));
+    if (!cache) {
+        SDL_AtomicSet(&ctx->failed, 1);
+        return;
+    }
+    rows = (const Uint16 **) (cache + ring * row_len);
+    cached = (int *) (rows + ring);
+    for (i = 0; i < ring; ++i) {
+        cached[i] = -1;
+    }
+
+    for (y = y0; y < y1; ++y) {
+        const SDL_FilterTaps *taps = &ctx->ytaps[y];
+        Uint32 *dstp;
+
+        for (i = 0; i < taps->count; ++i) {
+            const int row = taps->start + i;
+            Uint16 *slot = cache + (row % ring) * row_len;
+            if (cached[row % ring] != row) {
+                const Uint8 *srcp = (const Uint8 *) ctx->src->pixels +
+                    (srcrect->y + row) * ctx->src->pitch + srcrect->x * 4;
+                filter_row((const Uint32 *) srcp, slot, ctx->xtaps,
+                           ctx->xweights, dstrect->w);
+                cached[row % ring] = row;
+            }
+            rows[i] = slot;
+        }
+
+        dstp = (Uint32 *) ((Uint8 *) ctx->dst->pixels +
+                           (dstrect->y + y) * ctx->dst->pitch + dstrect->x * 4);
+        filter_column(rows, ctx->yweights + taps->weights, taps->count,
+                      dstp, dstrect->w);
+    }
+
+    SDL_free(cache);
+}
+
+static int
+stretch_filtered(SDL_Surface * src, const SDL_Rect * srcrect,
+                 SDL_Surface * dst, const SDL_Rect * dstrect)
+{
+    SDL_FilterStretch ctx;
+    SDL_FilterTaps *taps;
+    Uint16 *weights;
+    const int xn = count_filter_weights(srcrect->w, dstrect->w);
+    const int yn = count_filter_weights(srcrect->h, dstrect->h);
+
+    taps = (SDL_FilterTaps *) SDL_malloc((dstrect->w + dstrect->h) * sizeof(*taps) +
+                                         (xn + yn) * sizeof(*weights));
+    if (!taps) {
+        return SDL_OutOfMemory();
+    }
+    weights = (Uint16 *) (taps + dstrect->w + dstrect->h);
+
+    ctx.xtaps = taps;
+    ctx.ytaps = taps + dstrect->w;
+    ctx.xweights = weights;
+    ctx.yweights = weights + xn;
+    if (build_filter_taps(srcrect->w, dstrect->w, taps, weights) < 0 ||
+        (ctx.ymax = build_filter_taps(srcrect->h, dstrect->h,
+                                      taps + dstrect->w, weights + xn)) < 0) {
+        SDL_free(taps);
+        return SDL_OutOfMemory();
+    }
+
+    ctx.src = src;
+    ctx.srcrect = srcrect;
+    ctx.dst = dst;
+    ctx.dstrect = dstrect;
+    SDL_AtomicSet(&ctx.failed, 0);
+
+    if (dstrect->w * dstrect->h >= STRETCH_PARALLEL_PIXELS) {
+        SDL_ParallelFor(dstrect->h, STRETCH_BAND_ROWS, stretch_filtered_band, &ctx);
+    } else {
+        stretch_filtered_band(&ctx, 0, dstrect->h);
+    }
+
+    SDL_free(taps);
+    if (SDL_AtomicGet(&ctx.failed)) {
+        return SDL_OutOfMemory();
+    }
+    return 0;
+}
+
+static int
+SDL_StretchSurface(SDL_Surface * src, const SDL_Rect * srcrect,
+                   SDL_Surface * dst, const SDL_Rect * dstrect,
+                   SDL_bool linear)
 {
     int src_locked;
     int dst_locked;
-    int pos, inc;
-    int dst_maxrow;
-    int src_row, dst_row;
-    Uint8 *srcp = NULL;
-    Uint8 *dstp;
+    int retval;
     SDL_Rect full_src;
     SDL_Rect full_dst;
-#ifdef USE_ASM_STRETCH
-    SDL_bool use_asm = SDL_TRUE;
-#ifdef __GNUC__
-    int u1, u2;
-#endif
-#endif /* USE_ASM_STRETCH */
-    const int bpp = dst->format->BytesPerPixel;
 
     if (src->format->format != dst->format->format) {
         return SDL_SetError("Only works with same format surfaces");
     }
+    if (linear && (src->format->BytesPerPixel != 4 ||
+                   SDL_ISPIXELFORMAT_INDEXED(src->format->format))) {
+        return SDL_SetError("Linear stretch only works with 32-bit RGB surfaces");
+    }
 
     /* Verify the blit rectangles */
     if (srcrect) {
@@ -252,6 +787,11 @@ SDL_SoftStretch(SDL_Surface * src, const SDL_Rect * srcrect,
         dstrect = &full_dst;
     }
 
+    if (srcrect->w <= 0 || srcrect->h <= 0 ||
+        dstrect->w <= 0 || dstrect->h <= 0) {
+        return 0;
+    }
+
     /* Lock the destination if it's in hardware */
     dst_locked = 0;
     if (SDL_MUSTLOCK(dst)) {
@@ -272,72 +812,12 @@ SDL_SoftStretch(SDL_Surface * src, const SDL_Rect * srcrect,
         src_locked = 1;
     }
 
-    /* Set up the data... */
-    pos = 0x10000;
-    inc = (srcrect->h << 16) / dstrect->h;
-    src_row = srcrect->y;
-    dst_row = dstrect->y;
-
-#ifdef USE_ASM_STRETCH
-    /* Write the opcodes for this stretch */
-    if ((bpp == 3) || (generate_rowbytes(srcrect->w, dstrect->w, bpp) < 0)) {
-        use_asm = SDL_FALSE;
-    }
-#endif
-
-    /* Perform the stretch blit */
-    for (dst_maxrow = dst_row + dstrect->h; dst_row < dst_maxrow; ++dst_row) {
-        dstp = (Uint8 *) dst->pixels + (dst_row * dst->pitch)
-            + (dstrect->x * bpp);
-        while (pos >= 0x10000L) {
-            srcp = (Uint8 *) src->pixels + (src_row * src->pitch)
-                + (srcrect->x * bpp);
-            ++src_row;
-            pos -= 0x10000L;
-        }
-#ifdef USE_ASM_STRETCH
-        if (use_asm) {
-#ifdef __GNUC__
-            __asm__ __volatile__("call *%4":"=&D"(u1), "=&S"(u2)
-                                 :"0"(dstp), "1"(srcp), "r"(copy_row)
-                                 :"memory");
-#elif defined(_MSC_VER) || defined(__WATCOMC__)
-            /* *INDENT-OFF* */
-            {
-                void *code = copy_row;
-                __asm {
-                    push edi
-                    push esi
-                    mov edi, dstp
-                    mov esi, srcp
-                    call dword ptr code
-                    pop esi
-                    pop edi
-                }
-            }
-            /* *INDENT-ON* */
-#else
-#error Need inline assembly for this compiler
-#endif
-        } else
-#endif
-            switch (bpp) {
-            case 1:
-                copy_row1(srcp, srcrect->w, dstp, dstrect->w);
-                break;
-            case 2:
-                copy_row2((Uint16 *) srcp, srcrect->w,
-                          (Uint16 *) dstp, dstrect->w);
-                break;
-            case 3:
-                copy_row3(srcp, srcrect->w, dstp, dstrect->w);
-                break;
-            case 4:
-                copy_row4((Uint32 *) srcp, srcrect->w,
-                          (Uint32 *) dstp, dstrect->w);
-                break;
-            }
-        pos += inc;
+    if (!linear) {
+        retval = stretch_nearest(src, srcrect, dst, dstrect);
+    } else if (dstrect->w >= srcrect->w && dstrect->h >= srcrect->h) {
+        retval = stretch_linear(src, srcrect, dst, dstrect);
+    } else {
+        retval = stretch_filtered(src, srcrect, dst, dstrect);
     }
 
     /* We need to unlock the surfaces if they're locked */
@@ -347,7 +827,27 @@ SDL_SoftStretch(SDL_Surface * src, const SDL_Rect * srcrect,
     if (src_locked) {
         SDL_UnlockSurface(src);
     }
-    return (0);
+    return retval;
+}
+
+/* Perform a nearest neighbour stretch blit between two surfaces of the
+   same format.
+*/
+int
+SDL_SoftStretch(SDL_Surface * src, const SDL_Rect * srcrect,
+                SDL_Surface * dst, const SDL_Rect * dstrect)
+{
+    return SDL_StretchSurface(src, srcrect, dst, dstrect, SDL_FALSE);
+}
+
+/* Perform a bilinear filtered stretch blit between two 32-bit surfaces of
+   the same format, averaging the covered source pixels when shrinking.
+*/
+int
+SDL_SoftStretchLinear(SDL_Surface * src, const SDL_Rect * srcrect,
+                      SDL_Surface * dst, const SDL_Rect * dstrect)
+{
+    return SDL_StretchSurface(src, srcrect, dst, dstrect, SDL_TRUE);
 }
 
 /* vi: set ts=4 sw=4 expandtab: */
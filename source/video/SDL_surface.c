@@ -270,18 +270,12 @@ SDL_SetColorKey(SDL_Surface * surface, int flag, Uint32 key)
         surface->map->info.colorkey = key;
         if (surface->format->palette) {
             surface->format->palette->colors[surface->map->info.colorkey].a = SDL_ALPHA_TRANSPARENT;
-            ++surface->format->palette->version;
-            if (!surface->format->palette->version) {
-                surface->format->palette->version = 1;
-            }
+            surface->format->palette->version = SDL_NextPaletteVersion();
         }
     } else {
         if (surface->format->palette) {
             surface->format->palette->colors[surface->map->info.colorkey].a = SDL_ALPHA_OPAQUE;
-            ++surface->format->palette->version;
-            if (!surface->format->palette->version) {
-                surface->format->palette->version = 1;
-            }
+            surface->format->palette->version = SDL_NextPaletteVersion();
         }
         surface->map->info.flags &= ~SDL_COPY_COLORKEY;
     }
@@ -842,6 +836,123 @@ SDL_UpperBlitScaled(SDL_Surface * src, const SDL_Rect * srcrect,
     return SDL_LowerBlitScaled(src, &final_src, dst, &final_dst);
 }
 
+/*
+ * Return the scratch surface in *cache, replacing it if it is in another
+ * format or smaller than w x h. It only ever grows, so a texture drawn at
+ * several sizes settles on one buffer.
+ */
+static SDL_Surface *
+SDL_GetScratchSurface(SDL_Surface ** cache, int w, int h, Uint32 format)
+{
+    SDL_Surface *surface = *cache;
+
+    if (surface && (surface->format->format != format || surface->w < w || surface->h < h)) {
+        if (surface->format->format == format) {
+            w = SDL_max(w, surface->w);
+            h = SDL_max(h, surface->h);
+        }
+        SDL_FreeSurface(surface);
+        surface = NULL;
+    }
+    if (!surface) {
+        surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, format);
+    }
+    *cache = surface;
+    return surface;
+}
+
+/*
+ * Filter the source rectangle into a 32-bit scratch surface the size of the
+ * destination, then blit that with the source's modulation and blending.
+ * The scratch surfaces are kept on the source's blit map for the next draw.
+ */
+static int
+SDL_LowerBlitLinear(SDL_Surface * src, SDL_Rect * srcrect,
+                    SDL_Surface * dst, SDL_Rect * dstrect)
+{
+    const SDL_PixelFormat *fmt = src->format;
+    SDL_BlitMap *map = src->map;
+    SDL_Surface *filtered;
+    SDL_Surface *scaled;
+    SDL_Rect filtered_rect;
+    SDL_Rect rect;
+    Uint8 r, g, b, a;
+    SDL_BlendMode blendMode;
+    int retval = -1;
+
+    if (SDL_LockSurface(src) < 0) {
+        return -1;
+    }
+
+    if (fmt->BytesPerPixel == 4 && !SDL_ISPIXELFORMAT_INDEXED(fmt->format)) {
+        /* The stretch ignores copy flags, so it can read the source directly */
+        filtered = src;
+        filtered_rect = *srcrect;
+    } else {
+        const Uint32 format = fmt->Amask ? SDL_PIXELFORMAT_ARGB8888 : SDL_PIXELFORMAT_RGB888;
+        void *pixels = (Uint8 *) src->pixels + srcrect->y * src->pitch + srcrect->x * fmt->BytesPerPixel;
+
+        filtered = SDL_GetScratchSurface(&map->linear_src, srcrect->w, srcrect->h, format);
+        if (!filtered) {
+            goto done;
+        }
+        filtered_rect.x = 0;
+        filtered_rect.y = 0;
+        filtered_rect.w = srcrect->w;
+        filtered_rect.h = srcrect->h;
+
+        if (!fmt->palette) {
+            if (SDL_ConvertPixels(srcrect->w, srcrect->h, fmt->format, pixels, src->pitch,
+                                  format, filtered->pixels, filtered->pitch) < 0) {
+                goto done;
+            }
+        } else {
+            /* Look at the source rectangle through a surface without any copy flags */
+            SDL_Surface *view = SDL_CreateRGBSurfaceFrom(pixels, srcrect->w, srcrect->h,
+                                                         fmt->BitsPerPixel, src->pitch,
+                                                         fmt->Rmask, fmt->Gmask,
+                                                         fmt->Bmask, fmt->Amask);
+            if (!view) {
+                goto done;
+            }
+            SDL_SetSurfacePalette(view, fmt->palette);
+            SDL_SetSurfaceBlendMode(view, SDL_BLENDMODE_NONE);
+            rect = filtered_rect;
+            retval = SDL_LowerBlit(view, &rect, filtered, &filtered_rect);
+            SDL_FreeSurface(view);
+            if (retval < 0) {
+                goto done;
+            }
+            retval = -1;
+        }
+    }
+
+    scaled = SDL_GetScratchSurface(&map->linear_dst, dstrect->w, dstrect->h, filtered->format->format);
+    if (!scaled) {
+        goto done;
+    }
+    rect.x = 0;
+    rect.y = 0;
+    rect.w = dstrect->w;
+    rect.h = dstrect->h;
+    if (SDL_SoftStretchLinear(filtered, &filtered_rect, scaled, &rect) < 0) {
+        goto done;
+    }
+
+    SDL_GetSurfaceColorMod(src, &r, &g, &b);
+    SDL_GetSurfaceAlphaMod(src, &a);
+    SDL_GetSurfaceBlendMode(src, &blendMode);
+    SDL_SetSurfaceColorMod(scaled, r, g, b);
+    SDL_SetSurfaceAlphaMod(scaled, a);
+    SDL_SetSurfaceBlendMode(scaled, blendMode);
+
+    retval = SDL_LowerBlit(scaled, &rect, dst, dstrect);
+
+done:
+    SDL_UnlockSurface(src);
+    return retval;
+}
+
 /**
  *  This is a semi-private blit function and it performs low-level surface
  *  scaled blitting only.
@@ -861,6 +972,18 @@ SDL_LowerBlitScaled(SDL_Surface * src, SDL_Rect * srcrect,
         SDL_InvalidateMap(src->map);
     }
 
+    /* Filtering would bleed the colorkey into its neighbours */
+    if ((src->map->info.flags & (SDL_COPY_LINEAR | SDL_COPY_COLORKEY)) == SDL_COPY_LINEAR &&
+        src->format->BitsPerPixel >= 8) {
+        if (!(src->map->info.flags & complex_copy_flags) &&
+            src->format->format == dst->format->format &&
+            src->format->BytesPerPixel == 4 &&
+            !SDL_ISPIXELFORMAT_INDEXED(src->format->format)) {
+            return SDL_SoftStretchLinear(src, srcrect, dst, dstrect);
+        }
+        return SDL_LowerBlitLinear(src, srcrect, dst, dstrect);
+    }
+
     if ( !(src->map->info.flags & complex_copy_flags) &&
          src->format->format == dst->format->format &&
          !SDL_ISPIXELFORMAT_INDEXED(src->format->format) ) {
@@ -918,6 +1041,86 @@ SDL_DuplicateSurface(SDL_Surface * surface)
     return SDL_ConvertSurface(surface, surface->format, surface->flags);
 }
 
+/*
+ * Create a surface sharing an area of the pixels of an existing surface
+ */
+SDL_Surface *
+SDL_CreateSurfaceView(SDL_Surface * surface, const SDL_Rect * rect)
+{
+    SDL_Surface *owner;
+    SDL_Surface *view;
+    SDL_Rect area;
+    SDL_BlendMode blendMode;
+    Uint32 key;
+    Uint8 r, g, b, a;
+
+    if (!surface) {
+        SDL_InvalidParamError("surface");
+        return NULL;
+    }
+    if (surface->format->BitsPerPixel < 8) {
+        SDL_SetError("Can't create a view of a surface with less than 8 bits per pixel");
+        return NULL;
+    }
+
+    area.x = 0;
+    area.y = 0;
+    area.w = surface->w;
+    area.h = surface->h;
+    if (rect && !SDL_IntersectRect(rect, &area, &area)) {
+        SDL_SetError("View rectangle is outside the surface");
+        return NULL;
+    }
+
+    /* Views of views share the pixels of the original surface */
+    owner = (surface->flags & SDL_SURFACEVIEW) ? surface->map->owner : surface;
+
+    /* An RLE encoded surface may not have its pixels around */
+    if ((owner->flags & SDL_RLEACCEL) && !owner->locked) {
+        SDL_UnRLESurface(owner, 1);
+    }
+    if (!surface->pixels) {
+        SDL_SetError("Surface has no pixels to share");
+        return NULL;
+    }
+
+    view = SDL_CreateRGBSurfaceWithFormatFrom((Uint8 *) surface->pixels +
+                                              area.y * surface->pitch +
+                                              area.x * surface->format->BytesPerPixel,
+                                              area.w, area.h,
+                                              surface->format->BitsPerPixel,
+                                              surface->pitch,
+                                              surface->format->format);
+    if (!view) {
+        return NULL;
+    }
+    if (surface->format->palette) {
+        SDL_SetSurfacePalette(view, surface->format->palette);
+    }
+    if (SDL_GetColorKey(surface, &key) == 0) {
+        SDL_SetColorKey(view, SDL_TRUE, key);
+    }
+    SDL_GetSurfaceBlendMode(surface, &blendMode);
+    SDL_SetSurfaceBlendMode(view, blendMode);
+    SDL_GetSurfaceColorMod(surface, &r, &g, &b);
+    SDL_SetSurfaceColorMod(view, r, g, b);
+    SDL_GetSurfaceAlphaMod(surface, &a);
+    SDL_SetSurfaceAlphaMod(view, a);
+
+    /* The view keeps the owner, and so the pixels, alive */
+    view->flags |= SDL_SURFACEVIEW;
+    view->map->owner = owner;
+    ++owner->refcount;
+
+    /* Keep the owner from being RLE encoded, which would release its pixels */
+    if (owner->map->views++ == 0) {
+        owner->flags |= SDL_SHAREDPIXELS;
+        SDL_InvalidateMap(owner->map);
+    }
+
+    return view;
+}
+
 /*
  * Convert a surface into the specified pixel format.
  */
@@ -989,7 +1192,17 @@ SDL_ConvertSurface(SDL_Surface * surface, const SDL_PixelFormat * format,
     bounds.y = 0;
     bounds.w = surface->w;
     bounds.h = surface->h;
-    SDL_LowerBlit(surface, &bounds, convert, &bounds);
+    if (convert->format->BitsPerPixel == 8 && convert->format->palette &&
+        !surface->format->palette && !(surface->flags & SDL_RLEACCEL) &&
+        surface->format->format != SDL_PIXELFORMAT_UNKNOWN &&
+        surface->format->BitsPerPixel >= 8) {
+        /* Match each pixel to the palette, if not through a 3-3-2 color cube */
+        if (SDL_ConvertPixelsToPalette(surface, convert) != 0) {
+            SDL_LowerBlit(surface, &bounds, convert, &bounds);
+        }
+    } else {
+        SDL_LowerBlit(surface, &bounds, convert, &bounds);
+    }
 
     /* Clean up the original surface, and update converted surface */
     convert->map->info.r = copy_color.r;
@@ -1223,6 +1436,16 @@ SDL_FreeSurface(SDL_Surface * surface)
     if (!(surface->flags & SDL_PREALLOC)) {
         SDL_free(surface->pixels);
     }
+    if (surface->flags & SDL_SURFACEVIEW) {
+        SDL_Surface *owner = surface->map->owner;
+
+        /* With its last view gone, the owner may be RLE encoded again */
+        if (--owner->map->views == 0) {
+            owner->flags &= ~SDL_SHAREDPIXELS;
+            SDL_InvalidateMap(owner->map);
+        }
+        SDL_FreeSurface(owner);
+    }
     if (surface->map) {
         SDL_FreeBlitMap(surface->map);
     }
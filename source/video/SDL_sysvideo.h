@@ -279,6 +279,14 @@ struct SDL_VideoDevice
      */
     void (*PumpEvents) (_THIS);
 
+    /* Optional: block until PumpEvents may have something to do, or until
+       timeout milliseconds have passed (-1 waits forever). SendWakeupEvent
+       is called from other threads to make it return early, when an event
+       is added or a device has input to pump while someone is waiting.
+     */
+    void (*WaitEventTimeout) (_THIS, int timeout);
+    void (*SendWakeupEvent) (_THIS);
+
     /* Suspend the screensaver */
     void (*SuspendScreenSaver) (_THIS);
 
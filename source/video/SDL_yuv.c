@@ -25,6 +25,7 @@
 #include "SDL_pixels_c.h"
 
 #include "yuv2rgb/yuv_rgb.h"
+#include "../thread/SDL_parallel_c.h"
 
 #define SDL_YUV_SD_THRESHOLD    576
 
@@ -178,16 +179,15 @@ static int GetYUVPlanes(int width, int height, Uint32 format, const void *yuv, i
     return 0;
 }
 
-static SDL_bool yuv_rgb_sse(
-    Uint32 src_format, Uint32 dst_format,
-	Uint32 width, Uint32 height, 
-	const Uint8 *y, const Uint8 *u, const Uint8 *v, Uint32 y_stride, Uint32 uv_stride, 
-	Uint8 *rgb, Uint32 rgb_stride, 
-	YCbCrType yuv_type)
+typedef void (*YUVtoRGBFunc)(uint32_t width, uint32_t height,
+    const uint8_t *Y, const uint8_t *U, const uint8_t *V, uint32_t Y_stride, uint32_t UV_stride,
+    uint8_t *RGB, uint32_t RGB_stride, YCbCrType yuv_type);
+
+static YUVtoRGBFunc yuv_rgb_sse(Uint32 src_format, Uint32 dst_format)
 {
 #ifdef __SSE2__
     if (!SDL_HasSSE2()) {
-        return SDL_FALSE;
+        return NULL;
     }
 
     if (src_format == SDL_PIXELFORMAT_YV12 ||
@@ -195,27 +195,21 @@ static SDL_bool yuv_rgb_sse(
 
         switch (dst_format) {
         case SDL_PIXELFORMAT_RGB565:
-            yuv420_rgb565_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_rgb565_sseu;
         case SDL_PIXELFORMAT_RGB24:
-            yuv420_rgb24_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_rgb24_sseu;
         case SDL_PIXELFORMAT_RGBX8888:
         case SDL_PIXELFORMAT_RGBA8888:
-            yuv420_rgba_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_rgba_sseu;
         case SDL_PIXELFORMAT_BGRX8888:
         case SDL_PIXELFORMAT_BGRA8888:
-            yuv420_bgra_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_bgra_sseu;
         case SDL_PIXELFORMAT_RGB888:
         case SDL_PIXELFORMAT_ARGB8888:
-            yuv420_argb_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_argb_sseu;
         case SDL_PIXELFORMAT_BGR888:
         case SDL_PIXELFORMAT_ABGR8888:
-            yuv420_abgr_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_abgr_sseu;
         default:
             break;
         }
@@ -227,27 +221,21 @@ static SDL_bool yuv_rgb_sse(
 
         switch (dst_format) {
         case SDL_PIXELFORMAT_RGB565:
-            yuv422_rgb565_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_rgb565_sseu;
         case SDL_PIXELFORMAT_RGB24:
-            yuv422_rgb24_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_rgb24_sseu;
         case SDL_PIXELFORMAT_RGBX8888:
         case SDL_PIXELFORMAT_RGBA8888:
-            yuv422_rgba_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_rgba_sseu;
         case SDL_PIXELFORMAT_BGRX8888:
         case SDL_PIXELFORMAT_BGRA8888:
-            yuv422_bgra_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_bgra_sseu;
         case SDL_PIXELFORMAT_RGB888:
         case SDL_PIXELFORMAT_ARGB8888:
-            yuv422_argb_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_argb_sseu;
         case SDL_PIXELFORMAT_BGR888:
         case SDL_PIXELFORMAT_ABGR8888:
-            yuv422_abgr_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_abgr_sseu;
         default:
             break;
         }
@@ -258,68 +246,51 @@ static SDL_bool yuv_rgb_sse(
 
         switch (dst_format) {
         case SDL_PIXELFORMAT_RGB565:
-            yuvnv12_rgb565_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_rgb565_sseu;
         case SDL_PIXELFORMAT_RGB24:
-            yuvnv12_rgb24_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_rgb24_sseu;
         case SDL_PIXELFORMAT_RGBX8888:
         case SDL_PIXELFORMAT_RGBA8888:
-            yuvnv12_rgba_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_rgba_sseu;
         case SDL_PIXELFORMAT_BGRX8888:
         case SDL_PIXELFORMAT_BGRA8888:
-            yuvnv12_bgra_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_bgra_sseu;
         case SDL_PIXELFORMAT_RGB888:
         case SDL_PIXELFORMAT_ARGB8888:
-            yuvnv12_argb_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_argb_sseu;
         case SDL_PIXELFORMAT_BGR888:
         case SDL_PIXELFORMAT_ABGR8888:
-            yuvnv12_abgr_sseu(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_abgr_sseu;
         default:
             break;
         }
     }
 #endif
-    return SDL_FALSE;
+    return NULL;
 }
 
-static SDL_bool yuv_rgb_std(
-    Uint32 src_format, Uint32 dst_format,
-	Uint32 width, Uint32 height, 
-	const Uint8 *y, const Uint8 *u, const Uint8 *v, Uint32 y_stride, Uint32 uv_stride, 
-	Uint8 *rgb, Uint32 rgb_stride, 
-	YCbCrType yuv_type)
+static YUVtoRGBFunc yuv_rgb_std(Uint32 src_format, Uint32 dst_format)
 {
     if (src_format == SDL_PIXELFORMAT_YV12 ||
         src_format == SDL_PIXELFORMAT_IYUV) {
 
         switch (dst_format) {
         case SDL_PIXELFORMAT_RGB565:
-            yuv420_rgb565_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_rgb565_std;
         case SDL_PIXELFORMAT_RGB24:
-            yuv420_rgb24_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_rgb24_std;
         case SDL_PIXELFORMAT_RGBX8888:
         case SDL_PIXELFORMAT_RGBA8888:
-            yuv420_rgba_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_rgba_std;
         case SDL_PIXELFORMAT_BGRX8888:
         case SDL_PIXELFORMAT_BGRA8888:
-            yuv420_bgra_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_bgra_std;
         case SDL_PIXELFORMAT_RGB888:
         case SDL_PIXELFORMAT_ARGB8888:
-            yuv420_argb_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_argb_std;
         case SDL_PIXELFORMAT_BGR888:
         case SDL_PIXELFORMAT_ABGR8888:
-            yuv420_abgr_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv420_abgr_std;
         default:
             break;
         }
@@ -331,27 +302,21 @@ static SDL_bool yuv_rgb_std(
 
         switch (dst_format) {
         case SDL_PIXELFORMAT_RGB565:
-            yuv422_rgb565_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_rgb565_std;
         case SDL_PIXELFORMAT_RGB24:
-            yuv422_rgb24_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_rgb24_std;
         case SDL_PIXELFORMAT_RGBX8888:
         case SDL_PIXELFORMAT_RGBA8888:
-            yuv422_rgba_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_rgba_std;
         case SDL_PIXELFORMAT_BGRX8888:
         case SDL_PIXELFORMAT_BGRA8888:
-            yuv422_bgra_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_bgra_std;
         case SDL_PIXELFORMAT_RGB888:
         case SDL_PIXELFORMAT_ARGB8888:
-            yuv422_argb_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_argb_std;
         case SDL_PIXELFORMAT_BGR888:
         case SDL_PIXELFORMAT_ABGR8888:
-            yuv422_abgr_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuv422_abgr_std;
         default:
             break;
         }
@@ -362,60 +327,203 @@ static SDL_bool yuv_rgb_std(
 
         switch (dst_format) {
         case SDL_PIXELFORMAT_RGB565:
-            yuvnv12_rgb565_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_rgb565_std;
         case SDL_PIXELFORMAT_RGB24:
-            yuvnv12_rgb24_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_rgb24_std;
         case SDL_PIXELFORMAT_RGBX8888:
         case SDL_PIXELFORMAT_RGBA8888:
-            yuvnv12_rgba_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_rgba_std;
         case SDL_PIXELFORMAT_BGRX8888:
         case SDL_PIXELFORMAT_BGRA8888:
-            yuvnv12_bgra_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_bgra_std;
         case SDL_PIXELFORMAT_RGB888:
         case SDL_PIXELFORMAT_ARGB8888:
-            yuvnv12_argb_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_argb_std;
         case SDL_PIXELFORMAT_BGR888:
         case SDL_PIXELFORMAT_ABGR8888:
-            yuvnv12_abgr_std(width, height, y, u, v, y_stride, uv_stride, rgb, rgb_stride, yuv_type);
-            return SDL_TRUE;
+            return yuvnv12_abgr_std;
         default:
             break;
         }
     }
-    return SDL_FALSE;
+    return NULL;
 }
 
-int
-SDL_ConvertPixels_YUV_to_RGB(int width, int height,
-         Uint32 src_format, const void *src, int src_pitch,
-         Uint32 dst_format, void *dst, int dst_pitch)
+static YUVtoRGBFunc GetYUVtoRGBFunc(Uint32 src_format, Uint32 dst_format)
 {
-	const Uint8 *y = NULL;
-    const Uint8 *u = NULL;
-    const Uint8 *v = NULL;
-    Uint32 y_stride = 0;
-    Uint32 uv_stride = 0;
-    YCbCrType yuv_type = YCBCR_601;
-
-    if (GetYUVPlanes(width, height, src_format, src, src_pitch, &y, &u, &v, &y_stride, &uv_stride) < 0) {
-        return -1;
+    YUVtoRGBFunc func = yuv_rgb_sse(src_format, dst_format);
+    if (!func) {
+        func = yuv_rgb_std(src_format, dst_format);
     }
+    return func;
+}
+
+/* Frames this large are converted in bands of rows across the CPU cores */
+#define YUV_PARALLEL_PIXELS (256 * 256)
+#define YUV_BAND_ROWS       32
 
-    if (GetYUVConversionType(width, height, &yuv_type) < 0) {
+typedef struct
+{
+    YUVtoRGBFunc func;
+    YCbCrType yuv_type;
+    const Uint8 *y;
+    const Uint8 *u;
+    const Uint8 *v;
+    Uint32 y_stride;
+    Uint32 uv_stride;
+    int y_step;             /* bytes between luma samples */
+    int uv_step;            /* bytes between horizontal chroma samples */
+    int uv_rows;            /* rows sharing a chroma row */
+    SDL_Rect srcrect;
+    Uint8 *dst;
+    int dst_pitch;
+    int dst_bpp;
+    int dst_w;
+    int dst_h;
+    const int *columns;     /* source column of each destination column */
+    SDL_atomic_t failed;
+} SDL_YUVBlit;
+
+static void ConvertYUVBlock(const SDL_YUVBlit *blit, int x, int y, int w, int h, Uint8 *rgb, int rgb_pitch)
+{
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+    blit->func(w, h,
+               blit->y + y * blit->y_stride + x * blit->y_step,
+               blit->u + (y / blit->uv_rows) * blit->uv_stride + (x / 2) * blit->uv_step,
+               blit->v + (y / blit->uv_rows) * blit->uv_stride + (x / 2) * blit->uv_step,
+               blit->y_stride, blit->uv_stride, rgb, rgb_pitch, blit->yuv_type);
+}
+
+/* The kernels pair rows and columns that share chroma samples, so blocks
+   starting on an odd row or column begin with a single row or column.
+*/
+static void ConvertYUVRect(const SDL_YUVBlit *blit, int x, int y, int w, int h, Uint8 *rgb, int rgb_pitch)
+{
+    const int odd_x = (x & 1);
+
+    while (w > 0 && h > 0) {
+        const int rows = (blit->uv_rows == 2 && (y & 1)) ? 1 : h;
+        if (odd_x) {
+            ConvertYUVBlock(blit, x, y, 1, rows, rgb, rgb_pitch);
+        }
+        ConvertYUVBlock(blit, x + odd_x, y, w - odd_x, rows, rgb + odd_x * blit->dst_bpp, rgb_pitch);
+        y += rows;
+        h -= rows;
+        rgb += rows * rgb_pitch;
+    }
+}
+
+static void ConvertYUVBand(void *data, int y0, int y1)
+{
+    SDL_YUVBlit *blit = (SDL_YUVBlit *) data;
+    const SDL_Rect *srcrect = &blit->srcrect;
+    Uint32 *rows;
+    int last = -1;
+    int y, x;
+
+    if (!blit->columns && blit->dst_h == srcrect->h) {
+        ConvertYUVRect(blit, srcrect->x, srcrect->y + y0, srcrect->w, y1 - y0,
+                       blit->dst + y0 * blit->dst_pitch, blit->dst_pitch);
+        return;
+    }
+
+    /* Scaling: convert each pair of source rows sharing chroma once, then
+       sample them.
+    */
+    rows = (Uint32 *) SDL_malloc(srcrect->w * 2 * sizeof(Uint32));
+    if (!rows) {
+        SDL_AtomicSet(&blit->failed, 1);
+        return;
+    }
+    for (y = y0; y < y1; ++y) {
+        const int src_y = srcrect->y + ((2 * y + 1) * srcrect->h) / (2 * blit->dst_h);
+        const Uint32 *row;
+        Uint32 *dst = (Uint32 *) (blit->dst + y * blit->dst_pitch);
+        int pair = SDL_max(src_y & ~1, srcrect->y);
+
+        if (pair != last) {
+            const int count = SDL_min(2, srcrect->y + srcrect->h - pair);
+            ConvertYUVRect(blit, srcrect->x, pair, srcrect->w, count,
+                           (Uint8 *) rows, srcrect->w * sizeof(Uint32));
+            last = pair;
+        }
+        row = rows + (src_y - pair) * srcrect->w;
+        if (blit->columns) {
+            for (x = 0; x < blit->dst_w; ++x) {
+                dst[x] = row[blit->columns[x]];
+            }
+        } else {
+            SDL_memcpy(dst, row, blit->dst_w * sizeof(Uint32));
+        }
+    }
+    SDL_free(rows);
+}
+
+static int SetupYUVBlit(SDL_YUVBlit *blit, int width, int height,
+                        Uint32 src_format, const void *src, int src_pitch,
+                        Uint32 dst_format, void *dst, int dst_pitch)
+{
+    blit->func = GetYUVtoRGBFunc(src_format, dst_format);
+    if (!blit->func) {
+        return SDL_SetError("Unsupported YUV conversion");
+    }
+    if (GetYUVPlanes(width, height, src_format, src, src_pitch, &blit->y, &blit->u, &blit->v, &blit->y_stride, &blit->uv_stride) < 0) {
         return -1;
     }
+    if (GetYUVConversionType(width, height, &blit->yuv_type) < 0) {
+        return -1;
+    }
+    if (IsPacked4Format(src_format)) {
+        blit->y_step = 2;
+        blit->uv_step = 4;
+        blit->uv_rows = 1;
+    } else {
+        blit->y_step = 1;
+        blit->uv_step = (src_format == SDL_PIXELFORMAT_NV12 ||
+                         src_format == SDL_PIXELFORMAT_NV21) ? 2 : 1;
+        blit->uv_rows = 2;
+    }
+    blit->dst = (Uint8 *) dst;
+    blit->dst_pitch = dst_pitch;
+    blit->dst_bpp = SDL_BYTESPERPIXEL(dst_format);
+    blit->columns = NULL;
+    SDL_AtomicSet(&blit->failed, 0);
+    return 0;
+}
 
-    if (yuv_rgb_sse(src_format, dst_format, width, height, y, u, v, y_stride, uv_stride, (Uint8*)dst, dst_pitch, yuv_type)) {
-        return 0;
+static int RunYUVBlit(SDL_YUVBlit *blit)
+{
+    if (blit->dst_w * blit->dst_h >= YUV_PARALLEL_PIXELS) {
+        SDL_ParallelFor(blit->dst_h, YUV_BAND_ROWS, ConvertYUVBand, blit);
+    } else {
+        ConvertYUVBand(blit, 0, blit->dst_h);
+    }
+    if (SDL_AtomicGet(&blit->failed)) {
+        return SDL_OutOfMemory();
     }
+    return 0;
+}
 
-    if (yuv_rgb_std(src_format, dst_format, width, height, y, u, v, y_stride, uv_stride, (Uint8*)dst, dst_pitch, yuv_type)) {
-        return 0;
+int
+SDL_ConvertPixels_YUV_to_RGB(int width, int height,
+         Uint32 src_format, const void *src, int src_pitch,
+         Uint32 dst_format, void *dst, int dst_pitch)
+{
+    SDL_YUVBlit blit;
+
+    if (GetYUVtoRGBFunc(src_format, dst_format)) {
+        if (SetupYUVBlit(&blit, width, height, src_format, src, src_pitch, dst_format, dst, dst_pitch) < 0) {
+            return -1;
+        }
+        blit.srcrect.x = 0;
+        blit.srcrect.y = 0;
+        blit.srcrect.w = width;
+        blit.srcrect.h = height;
+        blit.dst_w = width;
+        blit.dst_h = height;
+        return RunYUVBlit(&blit);
     }
 
     /* No fast path for the RGB format, instead convert using an intermediate buffer */
@@ -445,6 +553,51 @@ SDL_ConvertPixels_YUV_to_RGB(int width, int height,
     return SDL_SetError("Unsupported YUV conversion");
 }
 
+/* Convert a rectangle of a YUV frame straight into a 32-bit destination,
+   scaling it to dst_w x dst_h with nearest sampling on the way.
+*/
+int
+SDL_ConvertPixels_YUV_to_RGB_Scaled(int width, int height,
+         Uint32 src_format, const void *src, int src_pitch, const SDL_Rect *srcrect,
+         Uint32 dst_format, void *dst, int dst_pitch, int dst_w, int dst_h)
+{
+    SDL_YUVBlit blit;
+    int *columns = NULL;
+    int x, retval;
+
+    if (dst_w <= 0 || dst_h <= 0 || srcrect->w <= 0 || srcrect->h <= 0) {
+        return 0;
+    }
+    if (srcrect->x < 0 || srcrect->y < 0 ||
+        srcrect->x + srcrect->w > width || srcrect->y + srcrect->h > height) {
+        return SDL_SetError("Invalid source rectangle");
+    }
+    if (SDL_BYTESPERPIXEL(dst_format) != 4) {
+        return SDL_SetError("Unsupported YUV conversion");
+    }
+    if (SetupYUVBlit(&blit, width, height, src_format, src, src_pitch, dst_format, dst, dst_pitch) < 0) {
+        return -1;
+    }
+    blit.srcrect = *srcrect;
+    blit.dst_w = dst_w;
+    blit.dst_h = dst_h;
+
+    if (dst_w != srcrect->w) {
+        columns = (int *) SDL_malloc(dst_w * sizeof(int));
+        if (!columns) {
+            return SDL_OutOfMemory();
+        }
+        for (x = 0; x < dst_w; ++x) {
+            columns[x] = ((2 * x + 1) * srcrect->w) / (2 * dst_w);
+        }
+    }
+    blit.columns = columns;
+
+    retval = RunYUVBlit(&blit);
+    SDL_free(columns);
+    return retval;
+}
+
 struct RGB2YUVFactors
 {
     int y_offset;
@@ -453,329 +606,284 @@ struct RGB2YUVFactors
     float v[3]; /* Rfactor, Gfactor, Bfactor */
 };
 
-static int
-SDL_ConvertPixels_ARGB8888_to_YUV(int width, int height, const void *src, int src_pitch, Uint32 dst_format, void *dst, int dst_pitch)
+static const struct RGB2YUVFactors RGB2YUVFactorTables[SDL_YUV_CONVERSION_BT709 + 1] =
 {
-    const int src_pitch_x_2    = src_pitch * 2;
-    const int height_half      = height / 2;
-    const int height_remainder = (height & 0x1);
-    const int width_half       = width / 2;
-    const int width_remainder  = (width & 0x1);
-    int i, j;
- 
-    static struct RGB2YUVFactors RGB2YUVFactorTables[SDL_YUV_CONVERSION_BT709 + 1] =
+    /* ITU-T T.871 (JPEG) */
     {
-        /* ITU-T T.871 (JPEG) */
-        {
-            0,
-            {  0.2990f,  0.5870f,  0.1140f },
-            { -0.1687f, -0.3313f,  0.5000f },
-            {  0.5000f, -0.4187f, -0.0813f },
-        },
-        /* ITU-R BT.601-7 */
-        {
-            16,
-            {  0.2568f,  0.5041f,  0.0979f },
-            { -0.1482f, -0.2910f,  0.4392f },
-            {  0.4392f, -0.3678f, -0.0714f },
-        },
-        /* ITU-R BT.709-6 */
-        {
-            16,
-            { 0.1826f,  0.6142f,  0.0620f },
-            {-0.1006f, -0.3386f,  0.4392f },
-            { 0.4392f, -0.3989f, -0.0403f },
-        },
-    };
-    const struct RGB2YUVFactors *cvt = &RGB2YUVFactorTables[SDL_GetYUVConversionModeForResolution(width, height)];
-
-#define MAKE_Y(r, g, b) (Uint8)((int)(cvt->y[0] * (r) + cvt->y[1] * (g) + cvt->y[2] * (b) + 0.5f) + cvt->y_offset)
-#define MAKE_U(r, g, b) (Uint8)((int)(cvt->u[0] * (r) + cvt->u[1] * (g) + cvt->u[2] * (b) + 0.5f) + 128)
-#define MAKE_V(r, g, b) (Uint8)((int)(cvt->v[0] * (r) + cvt->v[1] * (g) + cvt->v[2] * (b) + 0.5f) + 128)
-
-#define READ_2x2_PIXELS                                                                                         \
-        const Uint32 p1 = ((const Uint32 *)curr_row)[2 * i];                                                    \
-        const Uint32 p2 = ((const Uint32 *)curr_row)[2 * i + 1];                                                \
-        const Uint32 p3 = ((const Uint32 *)next_row)[2 * i];                                                    \
-        const Uint32 p4 = ((const Uint32 *)next_row)[2 * i + 1];                                                \
-        const Uint32 r = ((p1 & 0x00ff0000) + (p2 & 0x00ff0000) + (p3 & 0x00ff0000) + (p4 & 0x00ff0000)) >> 18; \
-        const Uint32 g = ((p1 & 0x0000ff00) + (p2 & 0x0000ff00) + (p3 & 0x0000ff00) + (p4 & 0x0000ff00)) >> 10; \
-        const Uint32 b = ((p1 & 0x000000ff) + (p2 & 0x000000ff) + (p3 & 0x000000ff) + (p4 & 0x000000ff)) >> 2;  \
-
-#define READ_2x1_PIXELS                                                                                         \
-        const Uint32 p1 = ((const Uint32 *)curr_row)[2 * i];                                                    \
-        const Uint32 p2 = ((const Uint32 *)next_row)[2 * i];                                                    \
-        const Uint32 r = ((p1 & 0x00ff0000) + (p2 & 0x00ff0000)) >> 17;                                         \
-        const Uint32 g = ((p1 & 0x0000ff00) + (p2 & 0x0000ff00)) >> 9;                                          \
-        const Uint32 b = ((p1 & 0x000000ff) + (p2 & 0x000000ff)) >> 1;                                          \
-
-#define READ_1x2_PIXELS                                                                                         \
-        const Uint32 p1 = ((const Uint32 *)curr_row)[2 * i];                                                    \
-        const Uint32 p2 = ((const Uint32 *)curr_row)[2 * i + 1];                                                \
-        const Uint32 r = ((p1 & 0x00ff0000) + (p2 & 0x00ff0000)) >> 17;                                         \
-        const Uint32 g = ((p1 & 0x0000ff00) + (p2 & 0x0000ff00)) >> 9;                                          \
-        const Uint32 b = ((p1 & 0x000000ff) + (p2 & 0x000000ff)) >> 1;                                          \
-
-#define READ_1x1_PIXEL                                                                                          \
-        const Uint32 p = ((const Uint32 *)curr_row)[2 * i];                                                     \
-        const Uint32 r = (p & 0x00ff0000) >> 16;                                                                \
-        const Uint32 g = (p & 0x0000ff00) >> 8;                                                                 \
-        const Uint32 b = (p & 0x000000ff);                                                                      \
-
-#define READ_TWO_RGB_PIXELS                                                                                     \
-        const Uint32 p = ((const Uint32 *)curr_row)[2 * i];                                                     \
-        const Uint32 r = (p & 0x00ff0000) >> 16;                                                                \
-        const Uint32 g = (p & 0x0000ff00) >> 8;                                                                 \
-        const Uint32 b = (p & 0x000000ff);                                                                      \
-        const Uint32 p1 = ((const Uint32 *)curr_row)[2 * i + 1];                                                \
-        const Uint32 r1 = (p1 & 0x00ff0000) >> 16;                                                              \
-        const Uint32 g1 = (p1 & 0x0000ff00) >> 8;                                                               \
-        const Uint32 b1 = (p1 & 0x000000ff);                                                                    \
-        const Uint32 R = (r + r1)/2;                                                                            \
-        const Uint32 G = (g + g1)/2;                                                                            \
-        const Uint32 B = (b + b1)/2;                                                                            \
-
-#define READ_ONE_RGB_PIXEL  READ_1x1_PIXEL
-
-    switch (dst_format) 
+        0,
+        {  0.2990f,  0.5870f,  0.1140f },
+        { -0.1687f, -0.3313f,  0.5000f },
+        {  0.5000f, -0.4187f, -0.0813f },
+    },
+    /* ITU-R BT.601-7 */
     {
-    case SDL_PIXELFORMAT_YV12:
-    case SDL_PIXELFORMAT_IYUV:
-    case SDL_PIXELFORMAT_NV12:
-    case SDL_PIXELFORMAT_NV21:
-        {
-            const Uint8 *curr_row, *next_row;
-            
-            Uint8 *plane_y;
-            Uint8 *plane_u;
-            Uint8 *plane_v;
-            Uint8 *plane_interleaved_uv;
-            Uint32 y_stride, uv_stride, y_skip, uv_skip;
-
-            GetYUVPlanes(width, height, dst_format, dst, dst_pitch,
-	                     (const Uint8 **)&plane_y, (const Uint8 **)&plane_u, (const Uint8 **)&plane_v,
-                         &y_stride, &uv_stride);
-            plane_interleaved_uv = (plane_y + height * y_stride);
-            y_skip = (y_stride - width);
-
-            curr_row = (const Uint8*)src;
-
-            /* Write Y plane */
-            for (j = 0; j < height; j++) {
-                for (i = 0; i < width; i++) {
-                    const Uint32 p1 = ((const Uint32 *)curr_row)[i];
-                    const Uint32 r = (p1 & 0x00ff0000) >> 16;
-                    const Uint32 g = (p1 & 0x0000ff00) >> 8;
-                    const Uint32 b = (p1 & 0x000000ff);
-                    *plane_y++ = MAKE_Y(r, g, b);
-                }
-                plane_y += y_skip;
-                curr_row += src_pitch;
-            }
+        16,
+        {  0.2568f,  0.5041f,  0.0979f },
+        { -0.1482f, -0.2910f,  0.4392f },
+        {  0.4392f, -0.3678f, -0.0714f },
+    },
+    /* ITU-R BT.709-6 */
+    {
+        16,
+        { 0.1826f,  0.6142f,  0.0620f },
+        {-0.1006f, -0.3386f,  0.4392f },
+        { 0.4392f, -0.3989f, -0.0403f },
+    },
+};
 
-            curr_row = (const Uint8*)src;
-            next_row = (const Uint8*)src;
-            next_row += src_pitch;
-
-            if (dst_format == SDL_PIXELFORMAT_YV12 || dst_format == SDL_PIXELFORMAT_IYUV)
-            {
-                /* Write UV planes, not interleaved */
-                uv_skip = (uv_stride - (width + 1)/2);
-                for (j = 0; j < height_half; j++) {
-                    for (i = 0; i < width_half; i++) {
-                        READ_2x2_PIXELS;
-                        *plane_u++ = MAKE_U(r, g, b);
-                        *plane_v++ = MAKE_V(r, g, b);
-                    }
-                    if (width_remainder) {
-                        READ_2x1_PIXELS;
-                        *plane_u++ = MAKE_U(r, g, b);
-                        *plane_v++ = MAKE_V(r, g, b);
-                    }
-                    plane_u += uv_skip;
-                    plane_v += uv_skip;
-                    curr_row += src_pitch_x_2;
-                    next_row += src_pitch_x_2;
-                }
-                if (height_remainder) {
-                    for (i = 0; i < width_half; i++) {
-                        READ_1x2_PIXELS;
-                        *plane_u++ = MAKE_U(r, g, b);
-                        *plane_v++ = MAKE_V(r, g, b);
-                    }
-                    if (width_remainder) {
-                        READ_1x1_PIXEL;
-                        *plane_u++ = MAKE_U(r, g, b);
-                        *plane_v++ = MAKE_V(r, g, b);
-                    }
-                    plane_u += uv_skip;
-                    plane_v += uv_skip;
-                }
+typedef struct
+{
+    const struct RGB2YUVFactors *cvt;
+    const Uint8 *src;
+    int src_pitch;
+    int width;
+    int height;
+    Uint8 *y;
+    Uint8 *u;
+    Uint8 *v;
+    int y_stride;
+    int uv_stride;
+    int y_step;
+    int uv_step;
+    SDL_bool packed;
+#ifdef __SSE2__
+    SDL_bool use_SSE2;
+#endif
+} SDL_RGBtoYUV;
+
+static SDL_INLINE Uint8 ClampYUV(int value)
+{
+    return (Uint8)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+/* The SSE2 paths below evaluate these in the same order, so both agree exactly */
+#define MAKE_Y(r, g, b) ClampYUV((int)(cvt->y[0] * (r) + cvt->y[1] * (g) + cvt->y[2] * (b) + 0.5f) + cvt->y_offset)
+#define MAKE_U(r, g, b) ClampYUV((int)(cvt->u[0] * (r) + cvt->u[1] * (g) + cvt->u[2] * (b) + 0.5f) + 128)
+#define MAKE_V(r, g, b) ClampYUV((int)(cvt->v[0] * (r) + cvt->v[1] * (g) + cvt->v[2] * (b) + 0.5f) + 128)
+
+#ifdef __SSE2__
+/* Applies one row of the conversion matrix to four pixels */
+static SDL_INLINE __m128i TransformRGB_SSE2(__m128i r, __m128i g, __m128i b, const float *factors, int offset)
+{
+    __m128 sum = _mm_mul_ps(_mm_set1_ps(factors[0]), _mm_cvtepi32_ps(r));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(factors[1]), _mm_cvtepi32_ps(g)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(factors[2]), _mm_cvtepi32_ps(b)));
+    sum = _mm_add_ps(sum, _mm_set1_ps(0.5f));
+    return _mm_add_epi32(_mm_cvttps_epi32(sum), _mm_set1_epi32(offset));
+}
+
+/* Averages one channel over 2x2 blocks of eight pixels from two rows */
+static SDL_INLINE __m128i Average2x2_SSE2(__m128i row0_lo, __m128i row0_hi, __m128i row1_lo, __m128i row1_hi, int shift)
+{
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128i lo = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(row0_lo, shift), mask),
+                                     _mm_and_si128(_mm_srli_epi32(row1_lo, shift), mask));
+    const __m128i hi = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(row0_hi, shift), mask),
+                                     _mm_and_si128(_mm_srli_epi32(row1_hi, shift), mask));
+    const __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm_srli_epi32(_mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd)), 2);
+}
+
+/* Converts 2x2 blocks of 8 pixels from two rows to four U and four V values */
+static SDL_INLINE void ConvertBlockToUV_SSE2(const struct RGB2YUVFactors *cvt, const Uint32 *row0, const Uint32 *row1, __m128i *u, __m128i *v)
+{
+    const __m128i row0_lo = _mm_loadu_si128((const __m128i *)row0);
+    const __m128i row0_hi = _mm_loadu_si128((const __m128i *)(row0 + 4));
+    const __m128i row1_lo = _mm_loadu_si128((const __m128i *)row1);
+    const __m128i row1_hi = _mm_loadu_si128((const __m128i *)(row1 + 4));
+    const __m128i r = Average2x2_SSE2(row0_lo, row0_hi, row1_lo, row1_hi, 16);
+    const __m128i g = Average2x2_SSE2(row0_lo, row0_hi, row1_lo, row1_hi, 8);
+    const __m128i b = Average2x2_SSE2(row0_lo, row0_hi, row1_lo, row1_hi, 0);
+
+    *u = TransformRGB_SSE2(r, g, b, cvt->u, 128);
+    *v = TransformRGB_SSE2(r, g, b, cvt->v, 128);
+}
+#endif /* __SSE2__ */
+
+static void ConvertRowToY(const SDL_RGBtoYUV *ctx, const Uint32 *src, Uint8 *dst)
+{
+    const struct RGB2YUVFactors *cvt = ctx->cvt;
+    const int width = ctx->width;
+    const int step = ctx->y_step;
+    int i = 0;
+
+#ifdef __SSE2__
+    if (ctx->use_SSE2) {
+        const __m128i mask = _mm_set1_epi32(0xFF);
+        __m128i y[4];
+        int k;
+
+        for (; i + 16 <= width; i += 16) {
+            __m128i luma;
+
+            for (k = 0; k < 4; ++k) {
+                const __m128i p = _mm_loadu_si128((const __m128i *)(src + i + 4 * k));
+                const __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask);
+                const __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), mask);
+                const __m128i b = _mm_and_si128(p, mask);
+                y[k] = TransformRGB_SSE2(r, g, b, cvt->y, cvt->y_offset);
             }
-            else if (dst_format == SDL_PIXELFORMAT_NV12)
-            {
-                uv_skip = (uv_stride - ((width + 1)/2)*2);
-                for (j = 0; j < height_half; j++) {
-                    for (i = 0; i < width_half; i++) {
-                        READ_2x2_PIXELS;
-                        *plane_interleaved_uv++ = MAKE_U(r, g, b);
-                        *plane_interleaved_uv++ = MAKE_V(r, g, b);
-                    }
-                    if (width_remainder) {
-                        READ_2x1_PIXELS;
-                        *plane_interleaved_uv++ = MAKE_U(r, g, b);
-                        *plane_interleaved_uv++ = MAKE_V(r, g, b);
-                    }
-                    plane_interleaved_uv += uv_skip;
-                    curr_row += src_pitch_x_2;
-                    next_row += src_pitch_x_2;
-                }
-                if (height_remainder) {
-                    for (i = 0; i < width_half; i++) {
-                        READ_1x2_PIXELS;
-                        *plane_interleaved_uv++ = MAKE_U(r, g, b);
-                        *plane_interleaved_uv++ = MAKE_V(r, g, b);
-                    }
-                    if (width_remainder) {
-                        READ_1x1_PIXEL;
-                        *plane_interleaved_uv++ = MAKE_U(r, g, b);
-                        *plane_interleaved_uv++ = MAKE_V(r, g, b);
-                    }
-                }
-            } 
-            else /* dst_format == SDL_PIXELFORMAT_NV21 */
-            {
-                uv_skip = (uv_stride - ((width + 1)/2)*2);
-                for (j = 0; j < height_half; j++) {
-                    for (i = 0; i < width_half; i++) {
-                        READ_2x2_PIXELS;
-                        *plane_interleaved_uv++ = MAKE_V(r, g, b);
-                        *plane_interleaved_uv++ = MAKE_U(r, g, b);
-                    }
-                    if (width_remainder) {
-                        READ_2x1_PIXELS;
-                        *plane_interleaved_uv++ = MAKE_V(r, g, b);
-                        *plane_interleaved_uv++ = MAKE_U(r, g, b);
-                    }
-                    plane_interleaved_uv += uv_skip;
-                    curr_row += src_pitch_x_2;
-                    next_row += src_pitch_x_2;
-                }
-                if (height_remainder) {
-                    for (i = 0; i < width_half; i++) {
-                        READ_1x2_PIXELS;
-                        *plane_interleaved_uv++ = MAKE_V(r, g, b);
-                        *plane_interleaved_uv++ = MAKE_U(r, g, b);
-                    }
-                    if (width_remainder) {
-                        READ_1x1_PIXEL;
-                        *plane_interleaved_uv++ = MAKE_V(r, g, b);
-                        *plane_interleaved_uv++ = MAKE_U(r, g, b);
-                    }
+            luma = _mm_packus_epi16(_mm_packs_epi32(y[0], y[1]), _mm_packs_epi32(y[2], y[3]));
+            if (step == 1) {
+                _mm_storeu_si128((__m128i *)(dst + i), luma);
+            } else {
+                Uint8 values[16];
+                _mm_storeu_si128((__m128i *)values, luma);
+                for (k = 0; k < 16; ++k) {
+                    dst[(i + k) * step] = values[k];
                 }
             }
         }
-        break;
+    }
+#endif
+    for (; i < width; ++i) {
+        const Uint32 p = src[i];
+        const Uint32 r = (p & 0x00ff0000) >> 16;
+        const Uint32 g = (p & 0x0000ff00) >> 8;
+        const Uint32 b = (p & 0x000000ff);
+        dst[i * step] = MAKE_Y(r, g, b);
+    }
+}
 
-    case SDL_PIXELFORMAT_YUY2:
-    case SDL_PIXELFORMAT_UYVY:
-    case SDL_PIXELFORMAT_YVYU:
-        {
-            const Uint8 *curr_row = (const Uint8*) src;
-            Uint8 *plane           = (Uint8*) dst;
-            const int row_size = (4 * ((width + 1) / 2));
-            int plane_skip;
-
-            if (dst_pitch < row_size) {
-                return SDL_SetError("Destination pitch is too small, expected at least %d\n", row_size);
-            }
-            plane_skip = (dst_pitch - row_size);
-
-            /* Write YUV plane, packed */
-            if (dst_format == SDL_PIXELFORMAT_YUY2) 
-            {
-                for (j = 0; j < height; j++) {
-                    for (i = 0; i < width_half; i++) {
-                        READ_TWO_RGB_PIXELS;
-                        /* Y U Y1 V */
-                        *plane++ = MAKE_Y(r, g, b);
-                        *plane++ = MAKE_U(R, G, B);
-                        *plane++ = MAKE_Y(r1, g1, b1);
-                        *plane++ = MAKE_V(R, G, B);
-                    }
-                    if (width_remainder) {
-                        READ_ONE_RGB_PIXEL;
-                        /* Y U Y V */
-                        *plane++ = MAKE_Y(r, g, b);
-                        *plane++ = MAKE_U(r, g, b);
-                        *plane++ = MAKE_Y(r, g, b);
-                        *plane++ = MAKE_V(r, g, b);
-                    }
-                    plane += plane_skip;
-                    curr_row += src_pitch;
-                }
-            } 
-            else if (dst_format == SDL_PIXELFORMAT_UYVY)
-            {
-                for (j = 0; j < height; j++) {
-                    for (i = 0; i < width_half; i++) {
-                        READ_TWO_RGB_PIXELS;
-                        /* U Y V Y1 */
-                        *plane++ = MAKE_U(R, G, B);
-                        *plane++ = MAKE_Y(r, g, b);
-                        *plane++ = MAKE_V(R, G, B);
-                        *plane++ = MAKE_Y(r1, g1, b1);
-                    }
-                    if (width_remainder) {
-                        READ_ONE_RGB_PIXEL;
-                        /* U Y V Y */
-                        *plane++ = MAKE_U(r, g, b);
-                        *plane++ = MAKE_Y(r, g, b);
-                        *plane++ = MAKE_V(r, g, b);
-                        *plane++ = MAKE_Y(r, g, b);
-                    }
-                    plane += plane_skip;
-                    curr_row += src_pitch;
-                }
-            }
-            else if (dst_format == SDL_PIXELFORMAT_YVYU)
-            {
-                for (j = 0; j < height; j++) {
-                    for (i = 0; i < width_half; i++) {
-                        READ_TWO_RGB_PIXELS;
-                        /* Y V Y1 U */
-                        *plane++ = MAKE_Y(r, g, b);
-                        *plane++ = MAKE_V(R, G, B);
-                        *plane++ = MAKE_Y(r1, g1, b1);
-                        *plane++ = MAKE_U(R, G, B);
-                    }
-                    if (width_remainder) {
-                        READ_ONE_RGB_PIXEL;
-                        /* Y V Y U */
-                        *plane++ = MAKE_Y(r, g, b);
-                        *plane++ = MAKE_V(r, g, b);
-                        *plane++ = MAKE_Y(r, g, b);
-                        *plane++ = MAKE_U(r, g, b);
-                    }
-                    plane += plane_skip;
-                    curr_row += src_pitch;
+/* Converts a pair of rows to one row of chroma. Both rows are the same
+   pointer for the last row of odd height images and for packed formats.
+ */
+static void ConvertRowsToUV(const SDL_RGBtoYUV *ctx, const Uint32 *row0, const Uint32 *row1, Uint8 *u, Uint8 *v)
+{
+    const struct RGB2YUVFactors *cvt = ctx->cvt;
+    const int width = ctx->width;
+    const int width_uv = (width + 1) / 2;
+    const int step = ctx->uv_step;
+    int i = 0;
+
+#ifdef __SSE2__
+    if (ctx->use_SSE2) {
+        for (; i + 8 <= width / 2; i += 8) {
+            __m128i u0, v0, u1, v1, uv;
+            int k;
+
+            ConvertBlockToUV_SSE2(cvt, row0 + 2 * i, row1 + 2 * i, &u0, &v0);
+            ConvertBlockToUV_SSE2(cvt, row0 + 2 * i + 8, row1 + 2 * i + 8, &u1, &v1);
+            /* Eight U values in the low half, eight V values in the high half */
+            uv = _mm_packus_epi16(_mm_packs_epi32(u0, u1), _mm_packs_epi32(v0, v1));
+            if (step == 1) {
+                _mm_storel_epi64((__m128i *)(u + i), uv);
+                _mm_storel_epi64((__m128i *)(v + i), _mm_srli_si128(uv, 8));
+            } else if (step == 2 && v == u + 1) {
+                _mm_storeu_si128((__m128i *)(u + 2 * i), _mm_unpacklo_epi8(uv, _mm_srli_si128(uv, 8)));
+            } else if (step == 2 && u == v + 1) {
+                _mm_storeu_si128((__m128i *)(v + 2 * i), _mm_unpacklo_epi8(_mm_srli_si128(uv, 8), uv));
+            } else {
+                Uint8 values[16];
+                _mm_storeu_si128((__m128i *)values, uv);
+                for (k = 0; k < 8; ++k) {
+                    u[(i + k) * step] = values[k];
+                    v[(i + k) * step] = values[k + 8];
                 }
             }
         }
-        break;
-
-    default:
-        return SDL_SetError("Unsupported YUV destination format: %s", SDL_GetPixelFormatName(dst_format));
     }
+#endif
+    for (; i < width_uv; ++i) {
+        /* The last column of odd width images pairs with itself */
+        const int x0 = 2 * i;
+        const int x1 = (x0 + 1 < width) ? x0 + 1 : x0;
+        const Uint32 p1 = row0[x0];
+        const Uint32 p2 = row0[x1];
+        const Uint32 p3 = row1[x0];
+        const Uint32 p4 = row1[x1];
+        const Uint32 r = ((p1 & 0x00ff0000) + (p2 & 0x00ff0000) + (p3 & 0x00ff0000) + (p4 & 0x00ff0000)) >> 18;
+        const Uint32 g = ((p1 & 0x0000ff00) + (p2 & 0x0000ff00) + (p3 & 0x0000ff00) + (p4 & 0x0000ff00)) >> 10;
+        const Uint32 b = ((p1 & 0x000000ff) + (p2 & 0x000000ff) + (p3 & 0x000000ff) + (p4 & 0x000000ff)) >> 2;
+        u[i * step] = MAKE_U(r, g, b);
+        v[i * step] = MAKE_V(r, g, b);
+    }
+}
+
 #undef MAKE_Y
 #undef MAKE_U
 #undef MAKE_V
-#undef READ_2x2_PIXELS
-#undef READ_2x1_PIXELS
-#undef READ_1x2_PIXELS
-#undef READ_1x1_PIXEL
-#undef READ_TWO_RGB_PIXELS
-#undef READ_ONE_RGB_PIXEL
+
+/* Converts rows of chroma: row pairs for planar formats, single rows for packed ones */
+static void ConvertRGBtoYUVRows(void *data, int start, int end)
+{
+    const SDL_RGBtoYUV *ctx = (const SDL_RGBtoYUV *)data;
+    int j;
+
+    for (j = start; j < end; ++j) {
+        const Uint32 *row0, *row1;
+
+        if (ctx->packed) {
+            Uint8 *y = ctx->y + j * ctx->y_stride;
+
+            row0 = row1 = (const Uint32 *)(ctx->src + j * ctx->src_pitch);
+            ConvertRowToY(ctx, row0, y);
+            if (ctx->width & 1) {
+                /* The last macropixel repeats the odd pixel */
+                y[ctx->width * ctx->y_step] = y[(ctx->width - 1) * ctx->y_step];
+            }
+        } else {
+            row0 = row1 = (const Uint32 *)(ctx->src + 2 * j * ctx->src_pitch);
+            ConvertRowToY(ctx, row0, ctx->y + 2 * j * ctx->y_stride);
+            if (2 * j + 1 < ctx->height) {
+                row1 = (const Uint32 *)((const Uint8 *)row0 + ctx->src_pitch);
+                ConvertRowToY(ctx, row1, ctx->y + (2 * j + 1) * ctx->y_stride);
+            }
+        }
+        ConvertRowsToUV(ctx, row0, row1, ctx->u + j * ctx->uv_stride, ctx->v + j * ctx->uv_stride);
+    }
+}
+
+static int
+SDL_ConvertPixels_ARGB8888_to_YUV(int width, int height, const void *src, int src_pitch, Uint32 dst_format, void *dst, int dst_pitch)
+{
+    SDL_RGBtoYUV ctx;
+    const Uint8 *plane_y, *plane_u, *plane_v;
+    Uint32 y_stride, uv_stride;
+    int rows;
+
+    if (IsPacked4Format(dst_format)) {
+        const int row_size = (4 * ((width + 1) / 2));
+
+        if (dst_pitch < row_size) {
+            return SDL_SetError("Destination pitch is too small, expected at least %d\n", row_size);
+        }
+        ctx.packed = SDL_TRUE;
+        ctx.y_step = 2;
+        ctx.uv_step = 4;
+        rows = height;
+    } else if (IsPlanar2x2Format(dst_format)) {
+        ctx.packed = SDL_FALSE;
+        ctx.y_step = 1;
+        ctx.uv_step = (dst_format == SDL_PIXELFORMAT_NV12 || dst_format == SDL_PIXELFORMAT_NV21) ? 2 : 1;
+        rows = (height + 1) / 2;
+    } else {
+        return SDL_SetError("Unsupported YUV destination format: %s", SDL_GetPixelFormatName(dst_format));
+    }
+
+    GetYUVPlanes(width, height, dst_format, dst, dst_pitch,
+                 &plane_y, &plane_u, &plane_v, &y_stride, &uv_stride);
+
+    ctx.cvt = &RGB2YUVFactorTables[SDL_GetYUVConversionModeForResolution(width, height)];
+    ctx.src = (const Uint8 *)src;
+    ctx.src_pitch = src_pitch;
+    ctx.width = width;
+    ctx.height = height;
+    ctx.y = (Uint8 *)plane_y;
+    ctx.u = (Uint8 *)plane_u;
+    ctx.v = (Uint8 *)plane_v;
+    ctx.y_stride = y_stride;
+    ctx.uv_stride = uv_stride;
+#ifdef __SSE2__
+    ctx.use_SSE2 = SDL_HasSSE2();
+#endif
+
+    if (width * height >= YUV_PARALLEL_PIXELS) {
+        SDL_ParallelFor(rows, ctx.packed ? YUV_BAND_ROWS : YUV_BAND_ROWS / 2, ConvertRGBtoYUVRows, &ctx);
+    } else {
+        ConvertRGBtoYUVRows(&ctx, 0, rows);
+    }
     return 0;
 }
 
@@ -891,6 +999,137 @@ SDL_ConvertPixels_YUV_to_YUV_Copy(int width, int height, Uint32 format,
     return SDL_SetError("SDL_ConvertPixels_YUV_to_YUV_Copy: Unsupported YUV format: %s", SDL_GetPixelFormatName(format));
 }
 
+/* Exchanges the contents of two rows */
+static void SwapRows(Uint8 *row1, Uint8 *row2, int width)
+{
+    int x = width;
+#ifdef __SSE2__
+    if (SDL_HasSSE2()) {
+        while (x >= 16) {
+            __m128i a = _mm_loadu_si128((__m128i*)row1);
+            __m128i b = _mm_loadu_si128((__m128i*)row2);
+            _mm_storeu_si128((__m128i*)row1, b);
+            _mm_storeu_si128((__m128i*)row2, a);
+            row1 += 16;
+            row2 += 16;
+            x -= 16;
+        }
+    }
+#endif
+    while (x--) {
+        Uint8 tmp = *row1;
+        *row1++ = *row2;
+        *row2++ = tmp;
+    }
+}
+
+/* Interleaves two chroma rows into one NV row. The destination may hold
+   the second source row at half its pitch or more, as in-place packing does.
+ */
+static void PackUVRow(const Uint8 *src1, const Uint8 *src2, Uint8 *dstUV, int width)
+{
+    int x = width;
+#ifdef __SSE2__
+    if (SDL_HasSSE2()) {
+        while (x >= 16) {
+            __m128i u = _mm_loadu_si128((__m128i*)src1);
+            __m128i v = _mm_loadu_si128((__m128i*)src2);
+            __m128i uv1 = _mm_unpacklo_epi8(u, v);
+            __m128i uv2 = _mm_unpackhi_epi8(u, v);
+            _mm_storeu_si128((__m128i*)dstUV, uv1);
+            _mm_storeu_si128((__m128i*)(dstUV + 16), uv2);
+            src1 += 16;
+            src2 += 16;
+            dstUV += 32;
+            x -= 16;
+        }
+    }
+#endif
+    while (x--) {
+        *dstUV++ = *src1++;
+        *dstUV++ = *src2++;
+    }
+}
+
+/* Splits one NV row into two chroma rows. Either destination may be the
+   start of the source row, as in-place splitting does.
+ */
+static void SplitUVRow(const Uint8 *srcUV, Uint8 *dst1, Uint8 *dst2, int width)
+{
+    int x = width;
+#ifdef __SSE2__
+    if (SDL_HasSSE2()) {
+        __m128i mask = _mm_set1_epi16(0x00FF);
+        while (x >= 16) {
+            __m128i uv1 = _mm_loadu_si128((__m128i*)srcUV);
+            __m128i uv2 = _mm_loadu_si128((__m128i*)(srcUV+16));
+            __m128i u1 = _mm_and_si128(uv1, mask);
+            __m128i u2 = _mm_and_si128(uv2, mask);
+            __m128i u = _mm_packus_epi16(u1, u2);
+            __m128i v1 = _mm_srli_epi16(uv1, 8);
+            __m128i v2 = _mm_srli_epi16(uv2, 8);
+            __m128i v = _mm_packus_epi16(v1, v2);
+            _mm_storeu_si128((__m128i*)dst1, u);
+            _mm_storeu_si128((__m128i*)dst2, v);
+            srcUV += 32;
+            dst1 += 16;
+            dst2 += 16;
+            x -= 16;
+        }
+    }
+#endif
+    while (x--) {
+        Uint8 u = *srcUV++;
+        Uint8 v = *srcUV++;
+        *dst1++ = u;
+        *dst2++ = v;
+    }
+}
+
+/* Reorders the chroma rows of a frame in place, between planar order (every
+   row of the first plane, then every row of the second) and NV order (the
+   rows of both planes alternating). Rows are moved by following the cycles
+   of the permutation, so only one row of scratch space is needed.
+ */
+static int ShuffleUVRows(Uint8 *rows, int pitch, int width, int count, SDL_bool to_NV)
+{
+    const int total = 2 * count;
+    Uint8 *scratch;
+    Uint8 *moved;
+    int i, j, k;
+
+    scratch = (Uint8 *)SDL_malloc(width + (total + 7) / 8);
+    if (!scratch) {
+        return SDL_OutOfMemory();
+    }
+    moved = scratch + width;
+    SDL_memset(moved, 0, (total + 7) / 8);
+
+    for (i = 0; i < total; ++i) {
+        if (moved[i / 8] & (1 << (i % 8))) {
+            continue;
+        }
+        SDL_memcpy(scratch, rows + i * pitch, width);
+        for (j = i; ; j = k) {
+            moved[j / 8] |= (1 << (j % 8));
+
+            /* Find the row that belongs in slot j */
+            if (to_NV) {
+                k = (j & 1) ? (count + j / 2) : (j / 2);
+            } else {
+                k = (j < count) ? (2 * j) : (2 * (j - count) + 1);
+            }
+            if (k == i) {
+                break;
+            }
+            SDL_memcpy(rows + j * pitch, rows + k * pitch, width);
+        }
+        SDL_memcpy(rows + j * pitch, scratch, width);
+    }
+    SDL_free(scratch);
+    return 0;
+}
+
 static int
 SDL_ConvertPixels_SwapUVPlanes(int width, int height, const void *src, int src_pitch, void *dst, int dst_pitch)
 {
@@ -904,23 +1143,14 @@ SDL_ConvertPixels_SwapUVPlanes(int width, int height, const void *src, int src_p
 
     if (src == dst) {
         int UVpitch = (dst_pitch + 1)/2;
-        Uint8 *tmp;
         Uint8 *row1 = dst;
         Uint8 *row2 = (Uint8 *)dst + UVheight * UVpitch;
 
-        /* Allocate a temporary row for the swap */
-        tmp = (Uint8 *)SDL_malloc(UVwidth);
-        if (!tmp) {
-            return SDL_OutOfMemory();
-        }
         for (y = 0; y < UVheight; ++y) {
-            SDL_memcpy(tmp, row1, UVwidth);
-            SDL_memcpy(row1, row2, UVwidth);
-            SDL_memcpy(row2, tmp, UVwidth);
+            SwapRows(row1, row2, UVwidth);
             row1 += UVpitch;
             row2 += UVpitch;
         }
-        SDL_free(tmp);
     } else {
         const Uint8 *srcUV;
         Uint8 *dstUV;
@@ -950,24 +1180,43 @@ SDL_ConvertPixels_SwapUVPlanes(int width, int height, const void *src, int src_p
 static int
 SDL_ConvertPixels_PackUVPlanes_to_NV(int width, int height, const void *src, int src_pitch, void *dst, int dst_pitch, SDL_bool reverseUV)
 {
-    int x, y;
+    int y;
     const int UVwidth = (width + 1)/2;
     const int UVheight = (height + 1)/2;
     const int srcUVPitch = ((src_pitch + 1)/2);
-    const int srcUVPitchLeft = srcUVPitch - UVwidth;
     const int dstUVPitch = ((dst_pitch + 1)/2)*2;
-    const int dstUVPitchLeft = dstUVPitch - UVwidth*2;
     const Uint8 *src1, *src2;
     Uint8 *dstUV;
     Uint8 *tmp = NULL;
-#ifdef __SSE2__
-    const SDL_bool use_SSE2 = SDL_HasSSE2();
-#endif
 
     /* Skip the Y plane */
     src = (const Uint8 *)src + height * src_pitch;
     dst = (Uint8 *)dst + height * dst_pitch;
 
+    if (src == dst && src_pitch == dst_pitch) {
+        /* Pair up the rows of the two planes, then interleave each pair */
+        Uint8 *row = (Uint8 *)dst;
+
+        if (ShuffleUVRows(row, srcUVPitch, UVwidth, UVheight, SDL_TRUE) < 0) {
+            return -1;
+        }
+        tmp = (Uint8 *)SDL_malloc(UVwidth);
+        if (!tmp) {
+            return SDL_OutOfMemory();
+        }
+        for (y = 0; y < UVheight; ++y) {
+            SDL_memcpy(tmp, row, UVwidth);
+            if (reverseUV) {
+                PackUVRow(row + srcUVPitch, tmp, row, UVwidth);
+            } else {
+                PackUVRow(tmp, row + srcUVPitch, row, UVwidth);
+            }
+            row += dstUVPitch;
+        }
+        SDL_free(tmp);
+        return 0;
+    }
+
     if (src == dst) {
         /* Need to make a copy of the buffer so we don't clobber it while converting */
         tmp = (Uint8 *)SDL_malloc(2*UVheight*srcUVPitch);
@@ -987,32 +1236,11 @@ SDL_ConvertPixels_PackUVPlanes_to_NV(int width, int height, const void *src, int
     }
     dstUV = (Uint8 *)dst;
 
-    y = UVheight;
-    while (y--) {
-        x = UVwidth;
-#ifdef __SSE2__
-        if (use_SSE2) {
-            while (x >= 16) {
-                __m128i u = _mm_loadu_si128((__m128i *)src1);
-                __m128i v = _mm_loadu_si128((__m128i *)src2);
-                __m128i uv1 = _mm_unpacklo_epi8(u, v);
-                __m128i uv2 = _mm_unpackhi_epi8(u, v);
-                _mm_storeu_si128((__m128i*)dstUV, uv1);
-                _mm_storeu_si128((__m128i*)(dstUV + 16), uv2);
-                src1 += 16;
-                src2 += 16;
-                dstUV += 32;
-                x -= 16;
-            }
-        }
-#endif
-        while (x--) {
-            *dstUV++ = *src1++;
-            *dstUV++ = *src2++;
-        }
-        src1 += srcUVPitchLeft;
-        src2 += srcUVPitchLeft;
-        dstUV += dstUVPitchLeft;
+    for (y = 0; y < UVheight; ++y) {
+        PackUVRow(src1, src2, dstUV, UVwidth);
+        src1 += srcUVPitch;
+        src2 += srcUVPitch;
+        dstUV += dstUVPitch;
     }
 
     if (tmp) {
@@ -1024,24 +1252,40 @@ SDL_ConvertPixels_PackUVPlanes_to_NV(int width, int height, const void *src, int
 static int
 SDL_ConvertPixels_SplitNV_to_UVPlanes(int width, int height, const void *src, int src_pitch, void *dst, int dst_pitch, SDL_bool reverseUV)
 {
-    int x, y;
+    int y;
     const int UVwidth = (width + 1)/2;
     const int UVheight = (height + 1)/2;
     const int srcUVPitch = ((src_pitch + 1)/2)*2;
-    const int srcUVPitchLeft = srcUVPitch - UVwidth*2;
     const int dstUVPitch = ((dst_pitch + 1)/2);
-    const int dstUVPitchLeft = dstUVPitch - UVwidth;
     const Uint8 *srcUV;
     Uint8 *dst1, *dst2;
     Uint8 *tmp = NULL;
-#ifdef __SSE2__
-    const SDL_bool use_SSE2 = SDL_HasSSE2();
-#endif
 
     /* Skip the Y plane */
     src = (const Uint8 *)src + height * src_pitch;
     dst = (Uint8 *)dst + height * dst_pitch;
 
+    if (src == dst && src_pitch == dst_pitch) {
+        /* Split each row into a pair of plane rows, then gather the planes */
+        Uint8 *row = (Uint8 *)dst;
+
+        tmp = (Uint8 *)SDL_malloc(UVwidth);
+        if (!tmp) {
+            return SDL_OutOfMemory();
+        }
+        for (y = 0; y < UVheight; ++y) {
+            if (reverseUV) {
+                SplitUVRow(row, tmp, row, UVwidth);
+            } else {
+                SplitUVRow(row, row, tmp, UVwidth);
+            }
+            SDL_memcpy(row + dstUVPitch, tmp, UVwidth);
+            row += srcUVPitch;
+        }
+        SDL_free(tmp);
+        return ShuffleUVRows((Uint8 *)dst, dstUVPitch, UVwidth, UVheight, SDL_FALSE);
+    }
+
     if (src == dst) {
         /* Need to make a copy of the buffer so we don't clobber it while converting */
         tmp = (Uint8 *)SDL_malloc(UVheight*srcUVPitch);
@@ -1061,37 +1305,11 @@ SDL_ConvertPixels_SplitNV_to_UVPlanes(int width, int height, const void *src, in
     }
     srcUV = (const Uint8 *)src;
 
-    y = UVheight;
-    while (y--) {
-        x = UVwidth;
-#ifdef __SSE2__
-        if (use_SSE2) {
-            __m128i mask = _mm_set1_epi16(0x00FF);
-            while (x >= 16) {
-                __m128i uv1 = _mm_loadu_si128((__m128i*)srcUV);
-                __m128i uv2 = _mm_loadu_si128((__m128i*)(srcUV+16));
-                __m128i u1 = _mm_and_si128(uv1, mask);
-                __m128i u2 = _mm_and_si128(uv2, mask);
-                __m128i u = _mm_packus_epi16(u1, u2);
-                __m128i v1 = _mm_srli_epi16(uv1, 8);
-                __m128i v2 = _mm_srli_epi16(uv2, 8);
-                __m128i v = _mm_packus_epi16(v1, v2);
-                _mm_storeu_si128((__m128i*)dst1, u);
-                _mm_storeu_si128((__m128i*)dst2, v);
-                srcUV += 32;
-                dst1 += 16;
-                dst2 += 16;
-                x -= 16;
-            }
-        }
-#endif
-        while (x--) {
-            *dst1++ = *srcUV++;
-            *dst2++ = *srcUV++;
-        }
-        srcUV += srcUVPitchLeft;
-        dst1 += dstUVPitchLeft;
-        dst2 += dstUVPitchLeft;
+    for (y = 0; y < UVheight; ++y) {
+        SplitUVRow(srcUV, dst1, dst2, UVwidth);
+        srcUV += srcUVPitch;
+        dst1 += dstUVPitch;
+        dst2 += dstUVPitch;
     }
 
     if (tmp) {
@@ -1530,6 +1748,93 @@ SDL_ConvertPixels_Packed4_to_Packed4(int width, int height,
     return SDL_SetError("SDL_ConvertPixels_Packed4_to_Packed4: Unsupported YUV conversion: %s -> %s", SDL_GetPixelFormatName(src_format), SDL_GetPixelFormatName(dst_format));
 }
 
+#ifdef __SSE2__
+static SDL_INLINE __m128i SwapBytes16_SSE2(__m128i x)
+{
+    return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+/* Loads 8 chroma pairs from a 2x2 planar format as interleaved U,V bytes */
+static SDL_INLINE __m128i LoadChroma_SSE2(Uint32 format, const Uint8 *u, const Uint8 *v)
+{
+    switch (format) {
+    case SDL_PIXELFORMAT_NV12:
+        return _mm_loadu_si128((const __m128i *)u);
+    case SDL_PIXELFORMAT_NV21:
+        return SwapBytes16_SSE2(_mm_loadu_si128((const __m128i *)v));
+    default:
+        return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)u), _mm_loadl_epi64((const __m128i *)v));
+    }
+}
+
+/* Stores 8 interleaved U,V pairs to a 2x2 planar format */
+static SDL_INLINE void StoreChroma_SSE2(Uint32 format, __m128i uv, Uint8 *u, Uint8 *v)
+{
+    switch (format) {
+    case SDL_PIXELFORMAT_NV12:
+        _mm_storeu_si128((__m128i *)u, uv);
+        break;
+    case SDL_PIXELFORMAT_NV21:
+        _mm_storeu_si128((__m128i *)v, SwapBytes16_SSE2(uv));
+        break;
+    default:
+        _mm_storel_epi64((__m128i *)u, _mm_packus_epi16(_mm_and_si128(uv, _mm_set1_epi16(0x00FF)), _mm_setzero_si128()));
+        _mm_storel_epi64((__m128i *)v, _mm_packus_epi16(_mm_srli_epi16(uv, 8), _mm_setzero_si128()));
+        break;
+    }
+}
+
+/* Stores 16 luma samples and 8 U,V pairs as 32 bytes of packed YUV */
+static SDL_INLINE void StorePacked4_SSE2(Uint32 format, __m128i y, __m128i uv, Uint8 *dst)
+{
+    __m128i lo, hi;
+
+    switch (format) {
+    case SDL_PIXELFORMAT_UYVY:
+        lo = _mm_unpacklo_epi8(uv, y);
+        hi = _mm_unpackhi_epi8(uv, y);
+        break;
+    case SDL_PIXELFORMAT_YVYU:
+        uv = SwapBytes16_SSE2(uv);
+        /* Fall through */
+    default:
+        lo = _mm_unpacklo_epi8(y, uv);
+        hi = _mm_unpackhi_epi8(y, uv);
+        break;
+    }
+    _mm_storeu_si128((__m128i *)dst, lo);
+    _mm_storeu_si128((__m128i *)(dst + 16), hi);
+}
+
+/* Loads 32 bytes of packed YUV as 16 luma samples and 8 U,V pairs */
+static SDL_INLINE __m128i LoadPacked4_SSE2(Uint32 format, const Uint8 *src, __m128i *uv)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i lo = _mm_loadu_si128((const __m128i *)src);
+    const __m128i hi = _mm_loadu_si128((const __m128i *)(src + 16));
+    __m128i even = _mm_packus_epi16(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+    __m128i odd = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+
+    switch (format) {
+    case SDL_PIXELFORMAT_UYVY:
+        *uv = even;
+        return odd;
+    case SDL_PIXELFORMAT_YVYU:
+        *uv = SwapBytes16_SSE2(odd);
+        return even;
+    default:
+        *uv = odd;
+        return even;
+    }
+}
+
+/* Averages two rows of chroma, rounding down like the scalar code */
+static SDL_INLINE __m128i AverageChroma_SSE2(__m128i a, __m128i b)
+{
+    return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+#endif /* __SSE2__ */
+
 static int
 SDL_ConvertPixels_Planar2x2_to_Packed4(int width, int height,
          Uint32 src_format, const void *src, int src_pitch,
@@ -1542,6 +1847,10 @@ SDL_ConvertPixels_Planar2x2_to_Packed4(int width, int height,
     Uint8 *dstY1, *dstY2, *dstU1, *dstU2, *dstV1, *dstV2;
     Uint32 dstY_pitch, dstUV_pitch;
     Uint32 dst_pitch_left;
+#ifdef __SSE2__
+    const SDL_bool use_SSE2 = SDL_HasSSE2();
+    const int dstY_offset = (dst_format == SDL_PIXELFORMAT_UYVY) ? 1 : 0;
+#endif
 
     if (src == dst) {
         return SDL_SetError("Can't change YUV plane types in-place");
@@ -1574,7 +1883,27 @@ SDL_ConvertPixels_Planar2x2_to_Packed4(int width, int height,
 
     /* Copy 2x2 blocks of pixels at a time */
     for (y = 0; y < (height - 1); y += 2) {
-        for (x = 0; x < (width - 1); x += 2) {
+        x = 0;
+#ifdef __SSE2__
+        if (use_SSE2) {
+            for (; x + 16 <= width; x += 16) {
+                const __m128i uv = LoadChroma_SSE2(src_format, srcU, srcV);
+                StorePacked4_SSE2(dst_format, _mm_loadu_si128((const __m128i *)srcY1), uv, dstY1 - dstY_offset);
+                StorePacked4_SSE2(dst_format, _mm_loadu_si128((const __m128i *)srcY2), uv, dstY2 - dstY_offset);
+                srcY1 += 16;
+                srcY2 += 16;
+                srcU += 8 * srcUV_pixel_stride;
+                srcV += 8 * srcUV_pixel_stride;
+                dstY1 += 32;
+                dstY2 += 32;
+                dstU1 += 32;
+                dstU2 += 32;
+                dstV1 += 32;
+                dstV2 += 32;
+            }
+        }
+#endif
+        for (; x < (width - 1); x += 2) {
             /* Row 1 */
             *dstY1 = *srcY1++;
             dstY1 += 2;
@@ -1639,7 +1968,22 @@ SDL_ConvertPixels_Planar2x2_to_Packed4(int width, int height,
 
     /* Last row */
     if (y == (height - 1)) {
-        for (x = 0; x < (width - 1); x += 2) {
+        x = 0;
+#ifdef __SSE2__
+        if (use_SSE2) {
+            for (; x + 16 <= width; x += 16) {
+                const __m128i uv = LoadChroma_SSE2(src_format, srcU, srcV);
+                StorePacked4_SSE2(dst_format, _mm_loadu_si128((const __m128i *)srcY1), uv, dstY1 - dstY_offset);
+                srcY1 += 16;
+                srcU += 8 * srcUV_pixel_stride;
+                srcV += 8 * srcUV_pixel_stride;
+                dstY1 += 32;
+                dstU1 += 32;
+                dstV1 += 32;
+            }
+        }
+#endif
+        for (; x < (width - 1); x += 2) {
             /* Row 1 */
             *dstY1 = *srcY1++;
             dstY1 += 2;
@@ -1685,6 +2029,10 @@ SDL_ConvertPixels_Packed4_to_Planar2x2(int width, int height,
     Uint8 *dstY1, *dstY2, *dstU, *dstV;
     Uint32 dstY_pitch, dstUV_pitch;
     Uint32 dstY_pitch_left, dstUV_pitch_left, dstUV_pixel_stride;
+#ifdef __SSE2__
+    const SDL_bool use_SSE2 = SDL_HasSSE2();
+    const int srcY_offset = (src_format == SDL_PIXELFORMAT_UYVY) ? 1 : 0;
+#endif
 
     if (src == dst) {
         return SDL_SetError("Can't change YUV plane types in-place");
@@ -1717,7 +2065,28 @@ SDL_ConvertPixels_Packed4_to_Planar2x2(int width, int height,
 
     /* Copy 2x2 blocks of pixels at a time */
     for (y = 0; y < (height - 1); y += 2) {
-        for (x = 0; x < (width - 1); x += 2) {
+        x = 0;
+#ifdef __SSE2__
+        if (use_SSE2) {
+            for (; x + 16 <= width; x += 16) {
+                __m128i uv1, uv2;
+                _mm_storeu_si128((__m128i *)dstY1, LoadPacked4_SSE2(src_format, srcY1 - srcY_offset, &uv1));
+                _mm_storeu_si128((__m128i *)dstY2, LoadPacked4_SSE2(src_format, srcY2 - srcY_offset, &uv2));
+                StoreChroma_SSE2(dst_format, AverageChroma_SSE2(uv1, uv2), dstU, dstV);
+                srcY1 += 32;
+                srcY2 += 32;
+                srcU1 += 32;
+                srcU2 += 32;
+                srcV1 += 32;
+                srcV2 += 32;
+                dstY1 += 16;
+                dstY2 += 16;
+                dstU += 8 * dstUV_pixel_stride;
+                dstV += 8 * dstUV_pixel_stride;
+            }
+        }
+#endif
+        for (; x < (width - 1); x += 2) {
             /* Row 1 */
             *dstY1++ = *srcY1;
             srcY1 += 2;
@@ -1780,7 +2149,23 @@ SDL_ConvertPixels_Packed4_to_Planar2x2(int width, int height,
 
     /* Last row */
     if (y == (height - 1)) {
-        for (x = 0; x < (width - 1); x += 2) {
+        x = 0;
+#ifdef __SSE2__
+        if (use_SSE2) {
+            for (; x + 16 <= width; x += 16) {
+                __m128i uv;
+                _mm_storeu_si128((__m128i *)dstY1, LoadPacked4_SSE2(src_format, srcY1 - srcY_offset, &uv));
+                StoreChroma_SSE2(dst_format, uv, dstU, dstV);
+                srcY1 += 32;
+                srcU1 += 32;
+                srcV1 += 32;
+                dstY1 += 16;
+                dstU += 8 * dstUV_pixel_stride;
+                dstV += 8 * dstUV_pixel_stride;
+            }
+        }
+#endif
+        for (; x < (width - 1); x += 2) {
             *dstY1++ = *srcY1;
             srcY1 += 2;
             *dstY1++ = *srcY1;
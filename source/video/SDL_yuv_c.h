@@ -25,6 +25,7 @@
 
 extern int SDL_ConvertPixels_YUV_to_RGB(int width, int height, Uint32 src_format, const void *src, int src_pitch, Uint32 dst_format, void *dst, int dst_pitch);
 extern int SDL_ConvertPixels_RGB_to_YUV(int width, int height, Uint32 src_format, const void *src, int src_pitch, Uint32 dst_format, void *dst, int dst_pitch);
+extern int SDL_ConvertPixels_YUV_to_RGB_Scaled(int width, int height, Uint32 src_format, const void *src, int src_pitch, const SDL_Rect *srcrect, Uint32 dst_format, void *dst, int dst_pitch, int dst_w, int dst_h);
 extern int SDL_ConvertPixels_YUV_to_YUV(int width, int height, Uint32 src_format, const void *src, int src_pitch, Uint32 dst_format, void *dst, int dst_pitch);
 
 /* vi: set ts=4 sw=4 expandtab: */